@@ -0,0 +1,270 @@
+// Микробенчмарки горячих путей на Google Benchmark: очереди задач при
+// N производителях / M потребителях, разбор тела /ingest, сборка
+// EnqueuedTask и Block для INSERT в ClickHouse (с числом аллокаций на
+// строку — operator new здесь считающий).
+// Запуск: sensors_bench [--benchmark_filter=<regex>] [--benchmark_format=json]
+#include <sensors/ch_block.hpp>
+#include <sensors/fast_ingest_parser.hpp>
+#include <sensors/ingest_json.hpp>
+#include <sensors/mpmc_ring_queue.hpp>
+#include <sensors/request_context.hpp>
+#include <sensors/threadsafe_queue.hpp>
+#include <sensors/time_utils.hpp>
+#include <sensors/types.hpp>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::atomic<unsigned long long> g_allocs{0};
+} // namespace
+
+void *operator new(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace sensors;
+
+namespace {
+
+const std::string kBody =
+    R"({"sensor_id":"plant-7/line-3/sensor-0042","ts":1730000000123,)"
+    R"("metrics":{"temperature":21.53,"humidity":40.1,"pressure":1013.25,)"
+    R"("vibration":0.0031,"voltage":229.7}})";
+
+// --- очереди ---------------------------------------------------------------
+
+// За итерацию producers потоков кладут по kItems / producers задач
+// блокирующим push, consumers потоков разбирают их pop_bulk, как воркеры
+// ClickHouse. Потоки создаются на каждую итерацию, поэтому kItems
+// выбран так, чтобы их запуск был в пределах процента от времени.
+constexpr std::size_t kItems = 1 << 18;
+constexpr std::size_t kQueueCapacity = 65536;
+
+template <class Queue>
+void BM_Queue(benchmark::State &state) {
+  const auto producers = static_cast<std::size_t>(state.range(0));
+  const auto consumers = static_cast<std::size_t>(state.range(1));
+  const std::size_t per_producer = kItems / producers;
+  const std::size_t total = per_producer * producers;
+
+  for (auto _ : state) {
+    Queue q(kQueueCapacity);
+    std::atomic<std::size_t> consumed{0};
+    std::vector<std::thread> threads;
+    for (std::size_t c = 0; c < consumers; ++c)
+      threads.emplace_back([&] {
+        std::vector<EnqueuedTask> batch;
+        while (consumed.load(std::memory_order_relaxed) < total) {
+          if (q.pop_bulk(batch, 256) == 0) {
+            auto t = q.pop_for(std::chrono::milliseconds(1));
+            if (!t)
+              continue;
+            batch.push_back(std::move(*t));
+          }
+          consumed.fetch_add(batch.size(), std::memory_order_relaxed);
+          batch.clear();
+        }
+      });
+    for (std::size_t p = 0; p < producers; ++p)
+      threads.emplace_back([&, p] {
+        for (std::size_t i = 0; i < per_producer; ++i) {
+          EnqueuedTask t;
+          t.request_id = p * per_producer + i;
+          t.ts = 1730000000;
+          q.push(std::move(t));
+        }
+      });
+    for (auto &t : threads)
+      t.join();
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * total));
+}
+
+void QueueArgs(benchmark::internal::Benchmark *b) {
+  for (int p : {1, 2, 4, 8})
+    for (int c : {1, 2, 4})
+      b->Args({p, c});
+  b->ArgNames({"producers", "consumers"})->UseRealTime()->Unit(
+      benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_Queue, ThreadSafeQueue<EnqueuedTask>)->Apply(QueueArgs);
+BENCHMARK_TEMPLATE(BM_Queue, MpmcRingQueue<EnqueuedTask>)->Apply(QueueArgs);
+
+// --- разбор /ingest --------------------------------------------------------
+
+// прежний путь через nlohmann::json DOM → IngestRequest → EnqueuedTask
+void BM_ParseDom(benchmark::State &state) {
+  for (auto _ : state) {
+    EnqueuedTask task; // как в обработчике: новая задача на запрос
+    IngestRequest in;
+    auto j = nlohmann::json::parse(kBody);
+    in.sensor_id = j.at("sensor_id").get<std::string>();
+    in.ts = j.at("ts").get<std::int64_t>();
+    for (auto &[k, v] : j.at("metrics").items())
+      in.metrics[k] = v.get<double>();
+
+    task.sensor = g_symbols.intern(in.sensor_id);
+    task.ts = in.ts;
+    for (const auto &[k, v] : in.metrics)
+      task.kv.emplace_back(g_symbols.intern(k), v);
+    benchmark::DoNotOptimize(task.kv.data());
+  }
+  state.SetBytesProcessed(
+      static_cast<std::int64_t>(state.iterations() * kBody.size()));
+}
+BENCHMARK(BM_ParseDom);
+
+// однопроходный разбор (ingest_fast_parser=true)
+void BM_ParseFast(benchmark::State &state) {
+  std::string err;
+  for (auto _ : state) {
+    EnqueuedTask task;
+    if (parse_reading_fast(kBody, task, err) != FastParseResult::ok)
+      std::abort();
+    benchmark::DoNotOptimize(task.kv.data());
+  }
+  state.SetBytesProcessed(
+      static_cast<std::int64_t>(state.iterations() * kBody.size()));
+}
+BENCHMARK(BM_ParseFast);
+
+// parse_reading — то, что реально зовёт /ingest (с откатом на DOM)
+void BM_ParseReading(benchmark::State &state) {
+  const bool fast = state.range(0) != 0;
+  std::string err;
+  for (auto _ : state) {
+    EnqueuedTask task;
+    if (!parse_reading(kBody, task, err, fast))
+      std::abort();
+    benchmark::DoNotOptimize(task.kv.data());
+  }
+  state.SetBytesProcessed(
+      static_cast<std::int64_t>(state.iterations() * kBody.size()));
+}
+BENCHMARK(BM_ParseReading)->Arg(0)->Arg(1)->ArgName("fast");
+
+// --- задача ----------------------------------------------------------------
+
+// задача, как её собирает HTTP-поток: пары в KvBuffer из slab-пула и
+// ответный хэндл; разрушение входит в замер, как в воркере
+void BM_TaskConstruct(benchmark::State &state) {
+  const SymbolId sensor = g_symbols.intern("plant-7/line-3/sensor-0042");
+  const SymbolId keys[] = {
+      g_symbols.intern("temperature"), g_symbols.intern("humidity"),
+      g_symbols.intern("pressure"), g_symbols.intern("vibration"),
+      g_symbols.intern("voltage")};
+  for (auto _ : state) {
+    EnqueuedTask task;
+    task.sensor = sensor;
+    task.ts = 1730000000123;
+    task.kv.reserve(std::size(keys));
+    for (const SymbolId k : keys)
+      task.kv.emplace_back(k, 1.5);
+    task.reply = make_reply_handle([](int, std::string) {});
+    benchmark::DoNotOptimize(task);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_TaskConstruct);
+
+// --- Block для INSERT ------------------------------------------------------
+
+std::vector<EnqueuedTask> make_batch(std::size_t tasks) {
+  std::vector<EnqueuedTask> batch(tasks);
+  std::string err;
+  for (std::size_t i = 0; i < tasks; ++i) {
+    const std::string body =
+        R"({"sensor_id":"sensor-)" + std::to_string(i % 500) +
+        R"(","ts":1730000000123,"metrics":{"temperature":21.53,)"
+        R"("humidity":40.1,"pressure":1013.25,"vibration":0.0031,)"
+        R"("voltage":229.7}})";
+    if (!parse_reading(body, batch[i], err, true))
+      std::abort();
+  }
+  return batch;
+}
+
+std::size_t rows_of(const std::vector<EnqueuedTask> &batch) {
+  std::size_t rows = 0;
+  for (const auto &t : batch)
+    rows += t.kv.size();
+  return rows;
+}
+
+// items/s — строки; allocs_per_row — аллокаций на вставленную строку
+void report_rows(benchmark::State &state, std::size_t rows,
+                 unsigned long long allocs) {
+  const auto total = static_cast<double>(state.iterations() * rows);
+  state.SetItemsProcessed(static_cast<std::int64_t>(total));
+  state.counters["allocs_per_row"] = static_cast<double>(allocs) / total;
+}
+
+// новый Block и колонки на каждый батч
+void BM_BuildBlock(benchmark::State &state) {
+  const auto batch = make_batch(static_cast<std::size_t>(state.range(0)));
+  const bool low_cardinality = state.range(1) != 0;
+  const auto allocs0 = g_allocs.load();
+  for (auto _ : state) {
+    auto block = build_insert_block(batch, low_cardinality);
+    benchmark::DoNotOptimize(block);
+  }
+  report_rows(state, rows_of(batch), g_allocs.load() - allocs0);
+}
+BENCHMARK(BM_BuildBlock)
+    ->ArgsProduct({{100, 1000, 10000}, {0, 1}})
+    ->ArgNames({"tasks", "low_cardinality"});
+
+// колонки воркера переиспользуются между батчами (как в ClickHousePool)
+void BM_InsertBuilder(benchmark::State &state) {
+  const auto batch = make_batch(static_cast<std::size_t>(state.range(0)));
+  InsertBuilder builder(state.range(1) != 0);
+  builder.build(batch); // прогрев: ёмкость колонок набрана
+  const auto allocs0 = g_allocs.load();
+  for (auto _ : state) {
+    const auto &block = builder.build(batch);
+    benchmark::DoNotOptimize(&block);
+  }
+  report_rows(state, rows_of(batch), g_allocs.load() - allocs0);
+}
+BENCHMARK(BM_InsertBuilder)
+    ->ArgsProduct({{100, 1000, 10000}, {0, 1}})
+    ->ArgNames({"tasks", "low_cardinality"});
+
+// перевод ts батча в секунды: поэлементно и одним проходом
+void BM_NormalizeTs(benchmark::State &state) {
+  const bool batched = state.range(0) != 0;
+  std::vector<std::int64_t> in(4096), out(in.size());
+  for (std::size_t i = 0; i < in.size(); ++i)
+    in[i] = 1730000000123 + static_cast<std::int64_t>(i) * 37;
+  for (auto _ : state) {
+    if (batched) {
+      normalize_ts(in.data(), out.data(), in.size());
+    } else {
+      for (std::size_t i = 0; i < in.size(); ++i)
+        out[i] = to_time_t_seconds(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(
+      static_cast<std::int64_t>(state.iterations() * in.size()));
+}
+BENCHMARK(BM_NormalizeTs)->Arg(0)->Arg(1)->ArgName("batched");
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+// Счётчик аллокаций на задачу по пути «разбор → очередь → воркер»:
+// HTTP-поток собирает EnqueuedTask с ответным хэндлом и кладёт в очередь,
+// воркер забирает пачками, отвечает и уничтожает задачи.
+// Запуск: task_alloc_bench [tasks]
+#include <sensors/fast_ingest_parser.hpp>
+#include <sensors/mpmc_ring_queue.hpp>
+#include <sensors/request_context.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<unsigned long long> g_allocs{0};
+
+const std::string kBody =
+    R"({"sensor_id":"plant-7/line-3/sensor-0042","ts":1730000000123,)"
+    R"("metrics":{"temperature":21.53,"humidity":40.1,"pressure":1013.25,)"
+    R"("vibration":0.0031,"voltage":229.7}})";
+
+} // namespace
+
+void *operator new(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace sensors;
+
+namespace {
+
+void run(MpmcRingQueue<EnqueuedTask> &q, std::size_t tasks) {
+  std::atomic<std::size_t> answered{0};
+  std::thread worker([&] {
+    std::vector<EnqueuedTask> batch;
+    while (answered.load(std::memory_order_relaxed) < tasks) {
+      auto t = q.pop();
+      if (!t)
+        break;
+      batch.push_back(std::move(*t));
+      q.pop_bulk(batch, 256);
+      for (auto &x : batch)
+        x.reply->respond(200, R"({"status":"ok"})");
+      answered.fetch_add(batch.size(), std::memory_order_relaxed);
+      batch.clear();
+    }
+  });
+
+  std::string err;
+  for (std::size_t i = 0; i < tasks; ++i) {
+    EnqueuedTask task;
+    if (parse_reading_fast(kBody, task, err) != FastParseResult::ok)
+      std::abort();
+    task.request_id = i;
+    task.reply = make_reply_handle([](int, std::string) {});
+    q.push(std::move(task));
+  }
+  worker.join();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t tasks =
+      argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1])) : 1'000'000;
+
+  MpmcRingQueue<EnqueuedTask> q(4096);
+  run(q, tasks / 10 + 1); // прогрев пула и таблицы символов
+
+  const auto before = g_allocs.load();
+  run(q, tasks);
+  const auto allocs = g_allocs.load() - before;
+  std::printf("tasks=%zu allocations=%llu per_task=%.3f\n", tasks, allocs,
+              static_cast<double>(allocs) / static_cast<double>(tasks));
+  return 0;
+}
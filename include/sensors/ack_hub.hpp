@@ -0,0 +1,104 @@
+#pragma once
+#include "request_context.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace sensors {
+
+// Получатель групповых подтверждений — HTTP-сессия. Вызовы приходят в
+// потоке хаба; сессия сама переходит в свой executor (в режиме per_thread
+// это тот же поток, переход делается на месте).
+struct AckTarget {
+  virtual ~AckTarget() = default;
+  // все задачи запроса seq отчитались: status — худший из кодов,
+  // failed — сколько задач неуспешны, error — тело ответа воркера об ошибке
+  virtual void on_ack(std::uint64_t seq, int status, std::size_t failed,
+                      const std::string &error) = 0;
+  // за write_timeout_ms воркеры не отчитались — пора ответить 202
+  virtual void on_ack_timeout(std::uint64_t seq) = 0;
+};
+
+// Групповые подтверждения (http_ack_mode = "group"), по хабу на io-поток.
+// Сессия регистрирует запрос и получает билет, который едет в задачах.
+// Воркер после вставки батча шлёт каждому хабу одно уведомление со всеми
+// билетами батча (ack_batch) вместо dispatch в strand каждой сессии, а
+// таймаут 202 отрабатывает одно грубое колесо таймеров на хаб вместо
+// steady_timer на запрос: срабатывание — не раньше write_timeout_ms и не
+// позже чем на шаг колеса (write_timeout_ms / kWheelSteps) после него.
+class AckHub {
+public:
+  static constexpr int kWheelSteps = 16;
+
+  AckHub(boost::asio::any_io_executor ex, int timeout_ms);
+  ~AckHub();
+
+  AckHub(const AckHub &) = delete;
+  AckHub &operator=(const AckHub &) = delete;
+
+  // запрос seq сессии target из tasks задач; возвращает билет
+  std::uint64_t add(std::shared_ptr<AckTarget> target, std::uint64_t seq,
+                    std::size_t tasks);
+  // задачи не попали в очередь — билет больше не нужен
+  void cancel(std::uint64_t ticket);
+  // из воркера: итог вставки для задач с билетами tickets (повторы билета
+  // допустимы — по одному на задачу)
+  void notify(std::vector<std::uint64_t> tickets, int status,
+              std::string error);
+  void stop();
+
+  std::size_t pending() const;
+
+private:
+  struct Entry {
+    std::shared_ptr<AckTarget> target; // nullptr — ячейка свободна
+    std::uint64_t seq{0};
+    std::uint64_t expire{0}; // шаг колеса, на котором отвечаем 202
+    std::uint32_t gen{0};
+    std::uint32_t remaining{0};
+    std::uint32_t failed{0};
+    int worst{200};
+    std::string error;
+  };
+  struct Done {
+    std::shared_ptr<AckTarget> target;
+    std::uint64_t seq;
+    int status;
+    std::size_t failed;
+    std::string error;
+  };
+
+  Entry *find(std::uint64_t ticket);
+  void release(std::uint32_t slot);
+  void complete(const std::vector<std::uint64_t> &tickets, int status,
+                const std::string &error);
+  void arm();
+  void on_tick();
+
+  boost::asio::any_io_executor ex_;
+  boost::asio::steady_timer timer_;
+  const std::chrono::milliseconds step_;
+  const std::uint64_t ticks_; // таймаут в шагах колеса
+
+  mutable std::mutex mu_;
+  std::vector<Entry> entries_;
+  std::vector<std::uint32_t> free_;
+  std::vector<std::vector<std::uint64_t>> wheel_; // билеты по шагам
+  std::uint64_t cursor_{0};
+  std::size_t live_{0};
+  bool armed_{false};
+  bool stopped_{false};
+};
+
+// Ответ задачам батча после вставки: ReplyHandle — каждой задаче,
+// билеты AckHub — одним уведомлением на хаб
+void ack_batch(const std::vector<EnqueuedTask> &batch, int status,
+               const std::string &body);
+
+} // namespace sensors
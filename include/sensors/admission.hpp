@@ -0,0 +1,91 @@
+#pragma once
+#include "intern_table.hpp"
+#include "latency_histogram.hpp"
+#include "types.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace sensors {
+
+struct QueueShardStats;
+
+// Контроль приёма на HTTP-ingest (admission_enabled / sensor_rate_limit).
+//
+// 1. Ранний сброс по образцу RED: пока очередь заполнена меньше чем на
+//    admission_min_fill, принимается всё; дальше запрос отклоняется 429
+//    с вероятностью, линейно растущей до 1 к admission_max_fill. Так
+//    клиенты начинают отступать раньше, чем очередь упрётся в ёмкость и
+//    задержка вырастет у всех. Retry-After — время, за которое воркеры
+//    при измеренной скорости разбора очереди вернут её к порогу.
+//    С журналом (wal_enabled) очередь при лежащем ClickHouse стоит полной
+//    по замыслу — запас держит журнал, — поэтому заполненность считается
+//    по байтам журнала на диске относительно wal_max_bytes. У очереди
+//    с шардами (queue_shards > 0) заполненность — у самого полного шарда
+//    относительно ёмкости шарда.
+// 2. Token bucket на датчик: sensor_rate_limit показаний в секунду с
+//    запасом на sensor_rate_burst_s секунд (переопределения по sensor_id —
+//    sensor_rate_limits). Таблица адресуется SymbolId через двухуровневый
+//    индекс, как LatestCache: на датчик одно 64-битное слово (время
+//    пополнения и остаток), обновляемое CAS без блокировок.
+class AdmissionController {
+public:
+  // capacity — общая ёмкость очереди задач (Config::queue_capacity);
+  // с журналом не используется
+  AdmissionController(const Config &cfg, std::size_t capacity);
+  ~AdmissionController();
+
+  AdmissionController(const AdmissionController &) = delete;
+  AdmissionController &operator=(const AdmissionController &) = delete;
+
+  // true — запрос сбрасывается; retry_after_s — значение Retry-After
+  bool shed(int &retry_after_s, std::int64_t now_ns = mono_ns());
+  // списать n показаний датчика; false — лимит исчерпан
+  bool allow(SymbolId sensor, int &retry_after_s, std::uint32_t n = 1,
+             std::int64_t now_ns = mono_ns());
+
+  bool rate_limited() const noexcept { return default_rate_ > 0 || !rates_.empty(); }
+  // вероятность сброса при глубине очереди depth (с журналом — байт в нём)
+  double drop_probability(std::size_t depth) const noexcept;
+  // сглаженная скорость разбора очереди воркерами, задач в секунду
+  double drain_rate() const noexcept {
+    return drain_rate_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Chunk;
+
+  void sample_drain(std::int64_t now_ns);
+  // текущая глубина: задачи в очереди (в самом полном шарде) или байты
+  // журнала
+  std::size_t depth() const noexcept;
+  std::atomic<std::uint64_t> &bucket(SymbolId sensor);
+  double rate_of(SymbolId sensor) const;
+
+  const bool red_enabled_;
+  const bool wal_; // глубина — байты журнала
+  const double min_depth_;
+  const double max_depth_;
+  const int retry_max_s_;
+  const double default_rate_;
+  const double burst_s_;
+  std::unordered_map<SymbolId, double> rates_; // только чтение после ctor
+  std::vector<QueueShardStats *> shards_; // пусто — очередь без шардов
+
+  const std::int64_t epoch_ns_;
+  std::atomic<std::int64_t> sample_ns_{0};
+  std::atomic<unsigned long long> sample_dequeued_{0};
+  std::atomic<double> drain_rate_{0};
+  // с журналом: байт журнала на показание, чтобы перевести скорость
+  // разбора в байты для Retry-After
+  std::atomic<unsigned long long> sample_appended_{0};
+  std::atomic<unsigned long long> sample_written_{0};
+  std::atomic<double> bytes_per_item_{0};
+
+  std::unique_ptr<std::atomic<Chunk *>[]> chunks_;
+};
+
+} // namespace sensors
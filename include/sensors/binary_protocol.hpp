@@ -0,0 +1,87 @@
+#pragma once
+#include "request_context.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sensors {
+
+// Компактный бинарный протокол приёма показаний (все числа little-endian).
+//
+//   frame   := u32 len | u8 type | payload        (len — байты после len)
+//   READINGS (type 0x01), клиент → сервер:
+//     u32 seq | u16 count | count * reading
+//     reading := strref sensor_id | i64 ts | u16 nkv | nkv * (strref key | f64 value)
+//     strref  := u8 0x00 | u16 len | bytes   — строка inline, получает
+//                                              следующий номер в словаре
+//              | u8 0x01 | u16 id            — ссылка на ранее переданную
+//   ACK (type 0x81), сервер → клиент:
+//     u32 last_seq | u32 frames | u32 accepted | u32 rejected
+//
+// Словарь строк живёт в пределах соединения (для UDP — одной датаграммы),
+// так что повторяющиеся sensor_id и ключи метрик передаются один раз.
+// Номер в словаре соединения сразу отображается в SymbolId из g_symbols.
+namespace binproto {
+
+constexpr std::uint8_t kFrameReadings = 0x01;
+constexpr std::uint8_t kFrameAck = 0x81;
+
+constexpr std::uint8_t kStrInline = 0x00;
+constexpr std::uint8_t kStrRef = 0x01;
+
+constexpr std::size_t kLenPrefix = 4;
+constexpr std::size_t kAckPayload = 1 + 4 * 4;
+constexpr std::size_t kMaxDictionary = 65535;
+
+struct Ack {
+  std::uint32_t last_seq{0};
+  std::uint32_t frames{0};
+  std::uint32_t accepted{0};
+  std::uint32_t rejected{0};
+};
+
+// Декодер со словарём строк одного соединения
+class Decoder {
+public:
+  // Разбирает тело кадра (начиная с байта type, без префикса длины).
+  // Показания дописываются в out; при ошибке out откатывается к исходному
+  // размеру, возвращается false и причина в err.
+  bool decode(const std::uint8_t *data, std::size_t size,
+              std::vector<EnqueuedTask> &out, std::uint32_t &seq,
+              std::string &err);
+
+  void reset() { dict_.clear(); }
+
+private:
+  std::vector<SymbolId> dict_;
+};
+
+// Кодировщик с зеркальным словарём (клиенты, тесты, WAL)
+class Encoder {
+public:
+  // Дописывает в out полный кадр READINGS вместе с префиксом длины
+  void encode(std::uint32_t seq, const std::vector<EnqueuedTask> &tasks,
+              std::vector<std::uint8_t> &out);
+
+  void reset() {
+    ids_.clear();
+    next_id_ = 0;
+  }
+
+private:
+  void put_str(SymbolId sym, std::vector<std::uint8_t> &out);
+
+  std::unordered_map<SymbolId, std::uint16_t> ids_;
+  std::size_t next_id_{0}; // номер, который декодер присвоит следующей inline-строке
+};
+
+// Дописывает в out кадр ACK вместе с префиксом длины
+void encode_ack(const Ack &ack, std::vector<std::uint8_t> &out);
+
+// Разбирает тело кадра ACK (начиная с байта type)
+bool decode_ack(const std::uint8_t *data, std::size_t size, Ack &ack);
+
+} // namespace binproto
+} // namespace sensors
@@ -0,0 +1,39 @@
+#pragma once
+#include "types.hpp"
+#include "request_context.hpp"
+#include "latest_cache.hpp"
+#include "task_queue.hpp"
+#include "wal.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+
+namespace sensors {
+
+// Отдельный TCP-листенер для бинарного протокола (см. binary_protocol.hpp).
+// Кадры декодируются сразу в EnqueuedTask и кладутся в очередь пачкой,
+// клиенту периодически уходят ACK с числом принятых/отброшенных показаний.
+// ACK подтверждает постановку в очередь (с журналом — запись на диск),
+// а не запись в ClickHouse.
+class BinaryIngestServer {
+public:
+  BinaryIngestServer(boost::asio::io_context& ioc, const Config& cfg,
+                     TaskQueue& queue, WriteAheadLog* wal = nullptr,
+                     LatestCache* latest = nullptr);
+
+  void run();
+  void stop();
+
+private:
+  struct Session;
+  void do_accept();
+
+  boost::asio::io_context& ioc_;
+  const Config cfg_;
+  TaskQueue& queue_;
+  WriteAheadLog* wal_;
+  LatestCache* latest_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::atomic<bool> running_{false};
+};
+
+} // namespace sensors
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// непрозрачные контексты zstd/lz4: заголовки библиотек нужны только в .cpp
+struct ZSTD_DCtx_s;
+struct ZSTD_DDict_s;
+struct LZ4F_dctx_s;
+
+namespace sensors {
+
+// Content-Encoding тела запроса на приёме
+enum class ContentEncoding { identity, zstd, lz4, unsupported };
+
+// значение заголовка без учёта регистра; пустое — identity
+ContentEncoding parse_content_encoding(std::string_view value);
+
+// Заранее разделённый с клиентами словарь zstd (см. tools/zstd_dict_train).
+// Короткие JSON-показания почти целиком состоят из повторяющихся ключей,
+// и без словаря кадр в сотню байт почти не сжимается.
+class ZstdDictionary {
+public:
+  // бросает std::runtime_error, если файл не читается или это не словарь
+  static std::unique_ptr<ZstdDictionary> load(const std::string &path);
+  ~ZstdDictionary();
+
+  ZstdDictionary(const ZstdDictionary &) = delete;
+  ZstdDictionary &operator=(const ZstdDictionary &) = delete;
+
+  const ZSTD_DDict_s *get() const { return ddict_; }
+  std::uint32_t id() const { return id_; }
+
+private:
+  ZstdDictionary(ZSTD_DDict_s *d, std::uint32_t id) : ddict_(d), id_(id) {}
+
+  ZSTD_DDict_s *ddict_;
+  std::uint32_t id_;
+};
+
+// Распаковщик тел запросов, по одному на HTTP-сессию: контексты zstd/lz4
+// создаются при первом сжатом теле и дальше только сбрасываются.
+class BodyDecoder {
+public:
+  enum class Status { ok, too_large, corrupt };
+
+  explicit BodyDecoder(const ZstdDictionary *dict = nullptr) : dict_(dict) {}
+  ~BodyDecoder();
+
+  BodyDecoder(const BodyDecoder &) = delete;
+  BodyDecoder &operator=(const BodyDecoder &) = delete;
+
+  // тело целиком; out переиспользует свою ёмкость, больше max_bytes
+  // распакованных байт не пишется
+  Status decode(ContentEncoding enc, std::string_view in, std::string &out,
+                std::size_t max_bytes);
+
+  // потоковый режим: begin в начале тела, затем step на каждое окно.
+  // step распаковывает из in сколько влезет в out (cap байт) и сдвигает in;
+  // если produced == cap, в контексте могли остаться данные — вызвать ещё
+  bool begin(ContentEncoding enc);
+  bool step(std::string_view &in, char *out, std::size_t cap,
+            std::size_t &produced);
+  // последний кадр дочитан до конца (обрезанное тело — false)
+  bool frame_done() const { return done_; }
+
+private:
+  const ZstdDictionary *dict_;
+  ContentEncoding enc_{ContentEncoding::identity};
+  ZSTD_DCtx_s *zstd_{nullptr};
+  LZ4F_dctx_s *lz4_{nullptr};
+  bool done_{true};
+};
+
+} // namespace sensors
@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace sensors {
+
+// Общий интерфейс ограниченной очереди между HTTP-потоками и воркерами.
+// Реализации: ThreadSafeQueue (mutex + condvar) и MpmcRingQueue (lock-free).
+template <class T>
+class BoundedQueue {
+public:
+  virtual ~BoundedQueue() = default;
+
+  // блокирующая попытка положить (ждёт свободного места)
+  virtual bool push(const T& v) = 0;
+  virtual bool push(T&& v) = 0;
+
+  // неблокирующая попытка; при неудаче v не трогаем
+  virtual bool try_push(const T& v) = 0;
+  virtual bool try_push(T&& v) = 0;
+
+  // неблокирующая вставка пачки целиком: либо все элементы, либо ни одного.
+  // При успехе элементы items перемещены (moved-from), при неудаче не тронуты
+  virtual bool try_push_bulk(std::vector<T>& items) = 0;
+
+  // блокирующее извлечение; nullopt — очередь остановлена и пуста
+  virtual std::optional<T> pop() = 0;
+
+  // извлечение с ожиданием не дольше timeout; nullopt — если очередь пуста
+  virtual std::optional<T> pop_for(std::chrono::milliseconds timeout) = 0;
+
+  // неблокирующее извлечение до max элементов в конец out; возвращает число
+  virtual std::size_t pop_bulk(std::vector<T>& out, std::size_t max) = 0;
+
+  virtual void stop() = 0;
+};
+
+} // namespace sensors
@@ -0,0 +1,50 @@
+#pragma once
+#include "request_context.hpp"
+#include "rollup_buffer.hpp"
+#include <clickhouse/client.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sensors {
+
+// Block для INSERT из всех задач батча: по строке (sensor_id, ts, key, value)
+// на каждую пару key/value. low_cardinality — строковые колонки как
+// LowCardinality(String), под таблицы с таким типом sensor_id/key
+clickhouse::Block build_insert_block(const std::vector<EnqueuedTask> &batch,
+                                     bool low_cardinality);
+
+// Построитель Block для INSERT, один на воркер ClickHouse: колонки живут
+// между вставками и очищаются Clear() вместо четырёх make_shared и нового
+// Block на каждый батч, ёмкость колонок только растёт. ts батча приводятся
+// к секундам одним проходом normalize_ts.
+class InsertBuilder {
+public:
+  explicit InsertBuilder(bool low_cardinality);
+
+  // Block смотрит в колонки построителя: валиден до следующего build()
+  const clickhouse::Block &build(const std::vector<EnqueuedTask> &batch);
+
+private:
+  using LcString = clickhouse::ColumnLowCardinalityT<clickhouse::ColumnString>;
+
+  template <class StrColumn>
+  void fill(StrColumn &sensor, StrColumn &key,
+            const std::vector<EnqueuedTask> &batch);
+
+  // строковые колонки — String или LowCardinality(String)
+  std::shared_ptr<clickhouse::ColumnString> sensor_, key_;
+  std::shared_ptr<LcString> lc_sensor_, lc_key_;
+  std::shared_ptr<clickhouse::ColumnDateTime> ts_;
+  std::shared_ptr<clickhouse::ColumnFloat64> value_;
+  clickhouse::Block block_;
+  std::vector<std::int64_t> raw_ts_, ts_s_; // ts задач батча
+  std::size_t reserved_rows_ = 0;
+};
+
+// Block для INSERT в таблицу агрегатов: (sensor_id, ts — начало окна, key,
+// count, min, max, sum, last, last_ts) по строке на группу
+clickhouse::Block build_rollup_block(const std::vector<RollupBuffer::Row> &rows,
+                                     bool low_cardinality);
+
+} // namespace sensors
@@ -0,0 +1,103 @@
+#pragma once
+#include "metrics_export.hpp"
+#include "types.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sensors {
+
+struct ChEndpoint {
+  std::string host;
+  std::uint16_t port{9000};
+  std::size_t shard{0}; // группа реплик; в режиме failover всегда 0
+
+  std::string name() const { return host + ":" + std::to_string(port); }
+};
+
+// Узлы из конфига: ch_routing = "failover" — ch_endpoints (пусто —
+// ch_host:ch_port), "sharded" — ch_shards, по списку реплик на шард.
+// Адрес "host:port" или "host" (порт ch_port). Ошибка — std::invalid_argument.
+std::vector<ChEndpoint> ch_endpoints_from_config(const Config &cfg);
+
+// шард датчика по sensor_id: FNV-1a, не зависит от порядка
+// интернирования, поэтому датчик остаётся в своём шарде между запусками
+std::size_t ch_shard_of(std::string_view sensor_id, std::size_t shards);
+
+// Состояние узлов ClickHouse для выбора воркерами.
+//
+// Узел выключается сразу после сетевой ошибки соединения или вставки
+// (или неудачного ping) и возвращается проверкой здоровья после kRise
+// удачных ping подряд. Оценка узла — EWMA времени вставки; узел без
+// вставок считается не хуже лучшего известного в шарде (а пока вставок
+// не было нигде — сравниваются ping). Простаивающий узел между
+// проверками подтягивает оценку к лучшей, так что переживший медленный
+// период узел со временем снова получает воркеров. Воркер берёт здоровый
+// узел шарда: узлы не дальше kNearFactor от лучшего делятся между
+// воркерами по номеру воркера.
+class ChEndpointSet {
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+  static constexpr int kRise = 2;
+  static constexpr double kNearFactor = 1.5;
+  // воркер уходит с узла, который стал медленнее лучшего в kLeaveFactor раз
+  static constexpr double kLeaveFactor = 2.0;
+
+  explicit ChEndpointSet(std::vector<ChEndpoint> endpoints);
+
+  std::size_t size() const { return nodes_.size(); }
+  std::size_t shards() const { return shards_.size(); }
+  const ChEndpoint &endpoint(std::size_t i) const { return nodes_[i]->ep; }
+
+  // узел шарда для воркера worker; npos — здоровых нет
+  std::size_t pick(std::size_t shard, std::size_t worker) const;
+  // пора ли воркеру worker переключиться с узла i: узел выключен,
+  // медленнее лучшего в kLeaveFactor раз или набор близких к лучшему
+  // узлов изменился и воркеру теперь выпадает другой
+  bool should_leave(std::size_t i, std::size_t worker) const;
+  bool healthy(std::size_t i) const;
+  // ждёт, пока в шарде появится здоровый узел (или timeout / wake_all)
+  bool wait_healthy(std::size_t shard, std::chrono::milliseconds timeout);
+  void wake_all();
+
+  // вставка rows строк на узел i: ns — её длительность
+  void on_insert(std::size_t i, std::int64_t ns, std::size_t rows);
+  // ошибка вставки; down — узел недоступен (сеть, соединение), а не
+  // отказ сервера в конкретном запросе
+  void on_failure(std::size_t i, bool down);
+  // итог ping проверки здоровья
+  void on_probe(std::size_t i, bool ok, std::int64_t ns);
+
+private:
+  struct Node {
+    ChEndpoint ep;
+    ChEndpointStats &stats;
+    bool up{true}; // до первой проверки узел считается живым
+    int rise{0};
+    double insert_ns{0}; // EWMA, 0 — вставок не было
+    double probe_ns{0};
+    bool inserted{false}; // были вставки с прошлой проверки
+  };
+
+  // под m_
+  double known_insert_ns(std::size_t shard, const Node *except) const;
+  double score(const Node &n) const;
+  double best_score(std::size_t shard) const;
+  std::size_t pick_locked(std::size_t shard, std::size_t worker) const;
+  void publish(Node &n) const;
+
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::vector<std::vector<std::size_t>> shards_; // узлы по шардам
+  mutable std::mutex m_;
+  std::condition_variable cv_;
+  std::uint64_t wake_gen_{0};
+};
+
+} // namespace sensors
@@ -1,7 +1,12 @@
 #pragma once
+#include "ch_endpoints.hpp"
+#include "dedup_filter.hpp"
+#include "redis_writer.hpp"
 #include "request_context.hpp"
-#include "threadsafe_queue.hpp"
+#include "rollup_writer.hpp"
+#include "task_queue.hpp"
 #include "types.hpp"
+#include "wal.hpp"
 #include <atomic>
 #include <memory>
 #include <vector>
@@ -11,18 +16,39 @@ namespace sensors {
 
 class ClickHousePool {
 public:
-  ClickHousePool(const Config &cfg, ThreadSafeQueue<EnqueuedTask> &queue);
+  // redis — зеркало последних значений в Redis (кэш процесса для
+  // GET /latest пополняют серверы приёма), wal — журнал, из которого
+  // подаются задачи, rollup — стадия
+  // предагрегации, dedup — ключи идемпотентности приёма, их воркер
+  // фиксирует или забывает по итогу вставки (nullptr, если
+  // соответствующая функция выключена).
+  // Узлы ClickHouse — из ch_routing/ch_endpoints/ch_shards: конфиг с
+  // ошибкой в них даёт std::invalid_argument
+  ClickHousePool(const Config &cfg, TaskQueue &queue,
+                 RedisWriter *redis = nullptr, WriteAheadLog *wal = nullptr,
+                 RollupWriter *rollup = nullptr, DedupFilter *dedup = nullptr);
   ~ClickHousePool();
 
   void start();
   void stop();
 
+  // узлы и их здоровье, общие с RollupWriter
+  ChEndpointSet &endpoints() { return endpoints_; }
+
 private:
-  void worker_loop();
+  void worker_loop(std::size_t index);
+  // ping узлов раз в ch_health_interval_ms
+  void health_loop();
 
   const Config cfg_;
-  ThreadSafeQueue<EnqueuedTask> &queue_;
+  TaskQueue &queue_;
+  RedisWriter *redis_;
+  WriteAheadLog *wal_;
+  RollupWriter *rollup_;
+  DedupFilter *dedup_;
+  ChEndpointSet endpoints_;
   std::vector<std::unique_ptr<boost::thread>> workers_;
+  std::unique_ptr<boost::thread> health_;
   std::atomic<bool> running_{false};
 };
 
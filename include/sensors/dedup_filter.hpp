@@ -0,0 +1,63 @@
+#pragma once
+#include "latency_histogram.hpp"
+#include "request_context.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace sensors {
+
+// Ключи идемпотентности приёма за последние dedup_window_s (dedup_enabled).
+//
+// Ключ — 64-битный хэш: либо клиентского Idempotency-Key, либо самого
+// показания (sensor, ts, пары key/value), так что повтор запроса после
+// таймаута 202 или обрыва соединения не пишется второй раз. Ключ сначала
+// «в работе» (claim), а помнящимся становится только после успешной записи
+// (commit); при ошибке его забывают (forget). Так повтор, пришедший, пока
+// исходный запрос ещё не записан, не теряется молча: приём отвечает ему
+// 409 и Retry-After. Хранятся только хэши — по 8 байт на ключ — в двух
+// поколениях хэш-множеств с открытой адресацией (отдельно записанные и
+// «в работе»): раз в окно (или при заполнении) текущее поколение становится
+// прошлым, а прошлое очищается. Ключ помнится не меньше окна и не больше
+// двух. Множества разбиты на полосы со своим mutex по старшим битам ключа.
+class DedupFilter {
+public:
+  enum class Claim {
+    fresh,     // ключ новый, отмечен «в работе» до commit/forget
+    duplicate, // запись с этим ключом уже удалась
+    in_flight, // запрос с этим ключом ещё не завершён
+  };
+
+  // capacity — ключей в одном поколении (на все полосы)
+  DedupFilter(std::size_t capacity, int window_s);
+  ~DedupFilter();
+
+  DedupFilter(const DedupFilter &) = delete;
+  DedupFilter &operator=(const DedupFilter &) = delete;
+
+  Claim claim(std::uint64_t key, std::int64_t now_ns = mono_ns());
+  // запись удалась: повторы ключа дальше отклоняются как duplicate
+  void commit(std::uint64_t key, std::int64_t now_ns = mono_ns());
+  // забыть ключ (запись не удалась — повтор клиента должен пройти)
+  void forget(std::uint64_t key);
+
+  // ключей в обоих поколениях, записанных и «в работе»
+  std::size_t size() const;
+
+private:
+  struct Stripe;
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+  const std::int64_t window_ns_;
+};
+
+// хэш клиентского ключа идемпотентности
+std::uint64_t idempotency_key(std::string_view client_key);
+// ключ показания index в пачке с Idempotency-Key (хэш request_key): повтор
+// пачки после частичной ошибки дописывает только неудавшиеся показания
+std::uint64_t idempotency_key(std::uint64_t request_key, std::size_t index);
+// хэш показания: датчик, ts и пары key/value
+std::uint64_t idempotency_key(const EnqueuedTask &task);
+
+} // namespace sensors
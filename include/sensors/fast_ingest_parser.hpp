@@ -0,0 +1,27 @@
+#pragma once
+#include "request_context.hpp"
+#include <string>
+#include <string_view>
+
+namespace sensors {
+
+enum class FastParseResult {
+  ok,       // показание разобрано в out
+  error,    // вход невалиден, причина в err
+  fallback, // вход вне быстрого пути (escape-последовательности, дробный
+            // или огромный ts, поле не того типа, глубокая вложенность) —
+            // решает полный JSON-парсер
+};
+
+// Однопроходный разбор показания известной формы
+//   {"sensor_id": "...", "ts": <int>, "metrics": {"key": <number>, ...}}
+// прямо из буфера тела запроса в задачу, без промежуточного DOM: строки
+// интернируются в g_symbols прямо из буфера, без временных std::string.
+// Порядок полей произвольный, неизвестные поля пропускаются.
+// Принимает и отвергает те же входы, что nlohmann::json + task_from_json
+// (грамматика чисел, UTF-8, баланс скобок); отличие одно — kv идут в
+// порядке входа, а не по имени ключа.
+FastParseResult parse_reading_fast(std::string_view text, EnqueuedTask &out,
+                                   std::string &err);
+
+} // namespace sensors
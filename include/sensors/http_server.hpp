@@ -1,8 +1,15 @@
 // include/sensors/http_server.hpp
 #pragma once
 #include "types.hpp"
+#include "ack_hub.hpp"
+#include "admission.hpp"
+#include "body_codec.hpp"
+#include "dedup_filter.hpp"
+#include "io_context_pool.hpp"
+#include "latest_cache.hpp"
 #include "request_context.hpp"
-#include "threadsafe_queue.hpp"
+#include "task_queue.hpp"
+#include "wal.hpp"
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <atomic>
@@ -13,21 +20,52 @@ namespace sensors {
 
 class HttpServer {
 public:
+  // latest — кэш последних значений: пополняется при приёме, читается
+  // GET /latest (nullptr — выключен),
+  // wal — журнал, в который уходят показания вместо очереди (nullptr — нет),
+  // admission — контроль приёма с ответами 429, dedup — ключи
+  // идемпотентности (nullptr — выключены). Словарь zstd из
+  // ingest_zstd_dictionary читается здесь же: ошибка — std::runtime_error
   HttpServer(boost::asio::io_context& ioc, const Config& cfg,
-             ThreadSafeQueue<EnqueuedTask>& queue);
+             TaskQueue& queue, LatestCache* latest = nullptr,
+             WriteAheadLog* wal = nullptr,
+             AdmissionController* admission = nullptr,
+             DedupFilter* dedup = nullptr);
+  // http_io_model = "per_thread": по acceptor'у (SO_REUSEPORT) на каждый
+  // контекст пула; без SO_REUSEPORT — один acceptor, соединения
+  // раздаются контекстам по кругу
+  HttpServer(IoContextPool& pool, const Config& cfg, TaskQueue& queue,
+             LatestCache* latest = nullptr, WriteAheadLog* wal = nullptr,
+             AdmissionController* admission = nullptr,
+             DedupFilter* dedup = nullptr);
 
   void run();
   void stop();
 
 private:
   struct Session;
-  void do_accept();
+  HttpServer(boost::asio::io_context& ioc, IoContextPool* pool,
+             const Config& cfg, TaskQueue& queue, LatestCache* latest,
+             WriteAheadLog* wal, AdmissionController* admission,
+             DedupFilter* dedup);
+  void do_accept(std::size_t index);
 
   boost::asio::io_context& ioc_;
   const Config cfg_;
-  ThreadSafeQueue<EnqueuedTask>& queue_;
-  boost::asio::ip::tcp::acceptor acceptor_;
-  boost::asio::ip::tcp::socket socket_;
+  TaskQueue& queue_;
+  LatestCache* latest_;
+  WriteAheadLog* wal_;
+  AdmissionController* admission_;
+  DedupFilter* dedup_;
+  IoContextPool* pool_;
+  // shared — один acceptor; per_thread — по одному на контекст пула
+  std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> acceptors_;
+  // раздача по кругу: контексты без SO_REUSEPORT, хабы в режиме shared
+  std::atomic<std::size_t> next_ctx_{0};
+  // http_ack_mode = "group": хаб на контекст пула (shared — на каждый из
+  // http_threads, у каждого свой strand)
+  std::vector<std::unique_ptr<AckHub>> hubs_;
+  std::unique_ptr<ZstdDictionary> zstd_dict_; // общий для всех сессий
   std::vector<std::unique_ptr<boost::thread>> threads_;
   std::atomic<bool> running_{false};
   boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard_;
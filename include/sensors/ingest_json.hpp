@@ -0,0 +1,88 @@
+#pragma once
+#include "request_context.hpp"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace sensors {
+
+// Разбор одного показания {sensor_id, ts, metrics:{key:value}} в задачу.
+// При ошибке возвращает false и текст причины в err; out при этом может
+// быть заполнен частично.
+bool task_from_json(const nlohmann::json &j, EnqueuedTask &out,
+                    std::string &err);
+
+// Разбор показания из текста: сначала быстрый однопроходный парсер
+// (fast_ingest_parser.hpp), при fallback или fast = false — nlohmann::json
+bool parse_reading(std::string_view text, EnqueuedTask &out, std::string &err,
+                   bool fast = true);
+
+// Нарезка NDJSON-потока на строки по мере прихода кусков (POST
+// /ingest/stream): целые строки отдаются прямо из куска без копирования,
+// хвост без '\n' копится до следующего куска. Строка длиннее max_line
+// отбрасывается целиком, так что память на соединение ограничена.
+class NdjsonSplitter {
+public:
+  explicit NdjsonSplitter(std::size_t max_line) : max_line_(max_line) {}
+
+  // fn(std::string_view) на каждую целую строку (без '\n'); возвращает
+  // число отброшенных слишком длинных строк
+  template <class F> std::size_t feed(const char *p, std::size_t n, F &&fn) {
+    std::size_t dropped = 0;
+    const char *end = p + n;
+    while (p < end) {
+      const auto *eol = static_cast<const char *>(
+          std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+      if (!eol) {
+        const auto tail = static_cast<std::size_t>(end - p);
+        if (skipping_)
+          break;
+        if (carry_.size() + tail > max_line_) {
+          ++dropped;
+          skipping_ = true;
+          carry_.clear();
+        } else {
+          carry_.append(p, tail);
+        }
+        break;
+      }
+      const auto len = static_cast<std::size_t>(eol - p);
+      if (skipping_) {
+        skipping_ = false;
+      } else if (carry_.empty()) {
+        if (len > max_line_)
+          ++dropped;
+        else
+          fn(std::string_view(p, len));
+      } else if (carry_.size() + len > max_line_) {
+        ++dropped;
+        carry_.clear();
+      } else {
+        carry_.append(p, len);
+        fn(std::string_view(carry_));
+        carry_.clear();
+      }
+      p = eol + 1;
+    }
+    return dropped;
+  }
+
+  // конец потока: последняя строка могла прийти без '\n'
+  template <class F> void finish(F &&fn) {
+    if (!carry_.empty() && !skipping_)
+      fn(std::string_view(carry_));
+    carry_.clear();
+    skipping_ = false;
+  }
+
+  std::size_t pending() const { return carry_.size(); }
+
+private:
+  const std::size_t max_line_;
+  std::string carry_;     // начало строки, не уместившейся в кусок
+  bool skipping_{false};  // строка длиннее лимита: пропуск до '\n'
+};
+
+} // namespace sensors
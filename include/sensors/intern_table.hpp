@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sensors {
+
+using SymbolId = std::uint32_t;
+constexpr SymbolId kInvalidSymbol = 0xFFFFFFFFu;
+
+// Конкурентная таблица интернирования строк (sensor_id, ключи метрик).
+// Строка получает компактный номер один раз и дальше по очереди и воркерам
+// ходит только номер. Номера никогда не освобождаются, view() стабилен на
+// всё время жизни таблицы и не берёт блокировок.
+class InternTable {
+public:
+  // жёсткий потолок числа строк (размер индекса номер → строка)
+  static constexpr std::size_t kMaxSymbols = std::size_t{1} << 24;
+
+  explicit InternTable(std::size_t limit = std::size_t{1} << 20);
+  ~InternTable();
+
+  InternTable(const InternTable &) = delete;
+  InternTable &operator=(const InternTable &) = delete;
+
+  // номер строки; kInvalidSymbol — если таблица заполнена до limit
+  SymbolId intern(std::string_view s);
+
+  // номер уже известной строки без добавления; kInvalidSymbol — не встречалась
+  SymbolId find(std::string_view s) const;
+
+  std::string_view view(SymbolId id) const {
+    const Chunk *c = chunks_[id >> kChunkBits].load(std::memory_order_acquire);
+    return *c->slots[id & kChunkMask].load(std::memory_order_acquire);
+  }
+
+  std::size_t size() const { return next_.load(std::memory_order_relaxed); }
+
+  // меняется только при старте, до приёма трафика
+  void set_limit(std::size_t limit) {
+    limit_ = limit < kMaxSymbols ? limit : kMaxSymbols;
+  }
+
+private:
+  static constexpr unsigned kChunkBits = 12;
+  static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkBits;
+  static constexpr std::size_t kChunkMask = kChunkSize - 1;
+  static constexpr std::size_t kShards = 16;
+
+  struct Chunk {
+    std::atomic<const std::string *> slots[kChunkSize];
+  };
+
+  struct Shard {
+    mutable std::shared_mutex m;
+    std::unordered_map<std::string_view, SymbolId> ids; // ключи смотрят в strings
+    std::deque<std::string> strings;                    // стабильные адреса
+  };
+
+  void publish(SymbolId id, const std::string &s);
+
+  std::size_t limit_;
+  std::atomic<std::size_t> next_{0};
+  std::unique_ptr<std::atomic<Chunk *>[]> chunks_;
+  Shard shards_[kShards];
+};
+
+// Общая таблица процесса для sensor_id и ключей метрик
+extern InternTable g_symbols;
+
+} // namespace sensors
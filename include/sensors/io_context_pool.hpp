@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+namespace sensors {
+
+// Привязка текущего потока к ядру cpu; false — не вышло или платформа
+// не поддерживается
+bool pin_current_thread(int cpu);
+
+// ядро для i-го потока из списка http_cpu_affinity / ch_cpu_affinity
+// (по кругу); -1 — список пуст, без привязки
+inline int affinity_cpu(const std::vector<int> &cpus, std::size_t i) {
+  return cpus.empty() ? -1 : cpus[i % cpus.size()];
+}
+
+// Есть ли SO_REUSEPORT: несколько acceptor'ов на одном порту, ядро само
+// раскладывает входящие соединения между ними
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+inline constexpr bool kHasReusePort = true;
+#else
+inline constexpr bool kHasReusePort = false;
+#endif
+
+// open/bind/listen с reuse_address и, если просили и платформа умеет,
+// SO_REUSEPORT (ставится до bind)
+boost::system::error_code
+listen_on(boost::asio::ip::tcp::acceptor &acceptor,
+          const boost::asio::ip::tcp::endpoint &ep, bool reuse_port);
+
+// Набор io_context «по одному на поток» (http_io_model = "per_thread"):
+// каждый контекст крутит ровно один поток, поэтому соединение, попавшее
+// в контекст, живёт на нём целиком — без strand'ов и общего реактора.
+class IoContextPool {
+public:
+  // cpus — ядра для потоков (см. affinity_cpu), пусто — без привязки
+  explicit IoContextPool(std::size_t n, std::vector<int> cpus = {});
+  ~IoContextPool();
+
+  IoContextPool(const IoContextPool &) = delete;
+  IoContextPool &operator=(const IoContextPool &) = delete;
+
+  std::size_t size() const { return iocs_.size(); }
+  boost::asio::io_context &get(std::size_t i) { return *iocs_[i]; }
+
+  void start(); // по потоку на контекст
+  void stop();  // отпускает контексты и будит их потоки
+  void join();
+
+private:
+  using WorkGuard =
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+  std::vector<std::unique_ptr<boost::asio::io_context>> iocs_;
+  std::vector<WorkGuard> guards_;
+  std::vector<std::unique_ptr<boost::thread>> threads_;
+  const std::vector<int> cpus_;
+};
+
+} // namespace sensors
@@ -0,0 +1,61 @@
+#pragma once
+#include "intern_table.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sensors {
+
+// Последние значения по паре (sensor, key) за одно окно сброса в Redis.
+// Повторное обновление той же пары перезаписывает запись на месте, так что
+// в Redis уходит только самое свежее значение (по ts). Без блокировок —
+// синхронизацию обеспечивает владелец (RedisWriter).
+class LastValueBuffer {
+public:
+  struct Entry {
+    SymbolId sensor;
+    SymbolId key;
+    double value;
+    std::int64_t ts;
+  };
+
+  // true — новая пара; false — пара уже была в окне (значение схлопнуто)
+  bool put(SymbolId sensor, SymbolId key, double value, std::int64_t ts) {
+    const std::uint64_t k = (std::uint64_t{sensor} << 32) | key;
+    auto [it, fresh] = index_.try_emplace(k, entries_.size());
+    if (fresh) {
+      entries_.push_back({sensor, key, value, ts});
+      return true;
+    }
+    Entry &e = entries_[it->second];
+    if (ts >= e.ts) { // запоздавшее старое показание не затирает новое
+      e.value = value;
+      e.ts = ts;
+    }
+    return false;
+  }
+
+  bool contains(SymbolId sensor, SymbolId key) const {
+    return index_.count((std::uint64_t{sensor} << 32) | key) != 0;
+  }
+
+  // Забирает накопленное в out (сгруппировано по датчику), буфер пустеет
+  void drain(std::vector<Entry> &out) {
+    out.swap(entries_);
+    entries_.clear();
+    index_.clear();
+    std::sort(out.begin(), out.end(), [](const Entry &a, const Entry &b) {
+      return a.sensor < b.sensor;
+    });
+  }
+
+  std::size_t size() const { return entries_.size(); }
+
+private:
+  std::unordered_map<std::uint64_t, std::size_t> index_; // пара → entries_
+  std::vector<Entry> entries_;
+};
+
+} // namespace sensors
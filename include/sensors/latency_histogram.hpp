@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sensors {
+
+// монотонное время в наносекундах для отметок стадий
+inline std::int64_t mono_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Гистограмма задержек с логарифмическими корзинами в духе HDR: каждая
+// октава [2^k, 2^(k+1)) нс делится пополам, т.е. граница корзины не дальше
+// чем в 1.5 раза от значения. Диапазон — от ~1 мкс (2^10 нс) до ~69 с
+// (2^36 нс), всё меньше — в первой корзине, больше — в последней.
+// observe() — два relaxed fetch_add без блокировок; снимок для /metrics
+// не атомарен целиком, но каждая корзина монотонна.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kMinShift = 10;
+  static constexpr unsigned kMaxShift = 36;
+  static constexpr std::size_t kBuckets = 1 + 2 * (kMaxShift - kMinShift) + 1;
+
+  // границы включительные, как le у Prometheus
+  static std::size_t bucket_for(std::uint64_t ns) {
+    if (ns <= (std::uint64_t{1} << kMinShift))
+      return 0;
+    const std::uint64_t x = ns - 1;
+    const unsigned k = static_cast<unsigned>(std::bit_width(x)) - 1;
+    if (k >= kMaxShift)
+      return kBuckets - 1;
+    const std::size_t half = (x >> (k - 1)) & 1;
+    return 1 + 2 * (k - kMinShift) + half;
+  }
+
+  // верхняя граница корзины i в наносекундах (последняя — +Inf)
+  static double upper_bound_ns(std::size_t i) {
+    if (i == 0)
+      return static_cast<double>(std::uint64_t{1} << kMinShift);
+    const unsigned k = kMinShift + static_cast<unsigned>((i - 1) / 2);
+    const double base = static_cast<double>(std::uint64_t{1} << k);
+    return (i - 1) % 2 == 0 ? base * 1.5 : base * 2;
+  }
+
+  void observe_ns(std::int64_t ns) {
+    const auto v = static_cast<std::uint64_t>(ns > 0 ? ns : 0);
+    buckets_[bucket_for(v)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(v, std::memory_order_relaxed);
+  }
+  void observe_us(std::int64_t us) { observe_ns(us * 1000); }
+  void observe_since(std::int64_t start_ns) { observe_ns(mono_ns() - start_ns); }
+
+  struct Snapshot {
+    std::array<std::uint64_t, kBuckets> buckets{};
+    std::uint64_t count{0};
+    std::uint64_t sum_ns{0};
+  };
+
+  Snapshot snapshot() const {
+    Snapshot s;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+      s.count += s.buckets[i];
+    }
+    s.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    return s;
+  }
+
+private:
+  std::atomic<std::uint64_t> buckets_[kBuckets]{};
+  std::atomic<std::uint64_t> sum_ns_{0};
+};
+
+} // namespace sensors
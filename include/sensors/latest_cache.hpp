@@ -0,0 +1,60 @@
+#pragma once
+#include "intern_table.hpp"
+#include "request_context.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sensors {
+
+// Последние значения метрик по датчикам в памяти процесса (GET /latest).
+//
+// Датчик адресуется своим SymbolId напрямую через двухуровневый индекс
+// (чанки по 4096 датчиков — они же шарды), без общей хэш-таблицы.
+// У каждого датчика свой слот под seqlock: писатели (потоки приёма после
+// разбора показаний) сериализуются только между собой на одном датчике,
+// читатели ничего не захватывают и при гонке с записью просто повторяют
+// копирование — чтение никогда не задерживает приём.
+class LatestCache {
+public:
+  struct Value {
+    SymbolId key;
+    double value;
+    std::int64_t ts;
+  };
+
+  // больше ключей на датчик не храним (лишние — g_latest_dropped_keys)
+  static constexpr std::uint32_t kMaxKeysPerSensor = 256;
+
+  LatestCache();
+  ~LatestCache();
+
+  LatestCache(const LatestCache &) = delete;
+  LatestCache &operator=(const LatestCache &) = delete;
+
+  // значение по ключу меняется, только если ts не старше сохранённого
+  void update(SymbolId sensor, const KvBuffer &kv, std::int64_t ts);
+  void update(const std::vector<EnqueuedTask> &batch);
+
+  // копия последних значений датчика в out; false — датчик не встречался
+  bool read(SymbolId sensor, std::vector<Value> &out) const;
+
+private:
+  struct Slot;
+  struct Chunk;
+
+  Slot *slot_for_write(SymbolId sensor);
+  Slot *grow(Slot *old, std::uint32_t need, SymbolId sensor);
+
+  std::unique_ptr<std::atomic<Chunk *>[]> chunks_;
+
+  // слоты, вытесненные при росте: читатель мог успеть взять указатель,
+  // поэтому освобождаются только вместе с кэшем
+  std::mutex retired_m_;
+  std::vector<Slot *> retired_;
+};
+
+} // namespace sensors
@@ -1,10 +1,152 @@
 #pragma once
+#include "latency_histogram.hpp"
 #include <atomic>
 #include <cstddef>
+#include <string>
 
 namespace sensors {
 // сколько метрик успешно записали в ClickHouse (counter)
 extern std::atomic<unsigned long long> g_total_received;
 // текущий размер очереди задач (gauge, приблизительный)
 extern std::atomic<unsigned long long> g_queue_size;
+// задачи, забранные воркерами из очереди (counter), и сглаженная скорость
+// разбора очереди в задачах в секунду (gauge, считает AdmissionController)
+extern std::atomic<unsigned long long> g_queue_dequeued;
+extern std::atomic<unsigned long long> g_queue_drain_rate;
+// контроль приёма: запросы, сброшенные 429 по заполнению очереди, и
+// показания, отклонённые лимитом датчика
+extern std::atomic<unsigned long long> g_admission_shed;
+extern std::atomic<unsigned long long> g_admission_rate_limited;
+// идемпотентность приёма: повторы, не поставленные в очередь, повторы
+// незавершённых запросов (409) и смены поколений ключей
+extern std::atomic<unsigned long long> g_dedup_suppressed;
+extern std::atomic<unsigned long long> g_dedup_in_flight;
+extern std::atomic<unsigned long long> g_dedup_rotations;
+extern std::atomic<unsigned long long> g_ack_notices;
+extern std::atomic<unsigned long long> g_ack_timeouts;
+// принятые HTTP-соединения и разобранные HTTP-запросы (counters)
+extern std::atomic<unsigned long long> g_http_connections;
+extern std::atomic<unsigned long long> g_http_requests;
+extern std::atomic<unsigned long long> g_stream_requests;
+extern std::atomic<unsigned long long> g_stream_readings;
+extern std::atomic<unsigned long long> g_stream_pauses;
+// сжатые тела ingest: байты до и после распаковки, битые/слишком большие
+extern std::atomic<unsigned long long> g_ingest_compressed_bytes;
+extern std::atomic<unsigned long long> g_ingest_decompressed_bytes;
+extern std::atomic<unsigned long long> g_ingest_decode_errors;
+// бинарный листенер: кадры, принятые/отброшенные показания, ошибки разбора
+extern std::atomic<unsigned long long> g_bin_frames;
+extern std::atomic<unsigned long long> g_bin_readings;
+extern std::atomic<unsigned long long> g_bin_rejected;
+extern std::atomic<unsigned long long> g_bin_decode_errors;
+// UDP-приём: датаграммы, принятые показания, потери из-за полной очереди,
+// неразобранные/обрезанные датаграммы, ошибки сокета при приёме
+extern std::atomic<unsigned long long> g_udp_datagrams;
+extern std::atomic<unsigned long long> g_udp_readings;
+extern std::atomic<unsigned long long> g_udp_dropped;
+extern std::atomic<unsigned long long> g_udp_parse_errors;
+extern std::atomic<unsigned long long> g_udp_receive_errors;
+// стадия записи в Redis: входящие обновления, схлопнутые в окне сброса,
+// отброшенные при переполнении, ожидающие сброса (gauge), записанные пары,
+// сбросы, ошибки сбросов и время сбросов в микросекундах (сумма/последний)
+extern std::atomic<unsigned long long> g_redis_updates;
+extern std::atomic<unsigned long long> g_redis_coalesced;
+extern std::atomic<unsigned long long> g_redis_dropped;
+extern std::atomic<unsigned long long> g_redis_pending;
+extern std::atomic<unsigned long long> g_redis_written;
+extern std::atomic<unsigned long long> g_redis_flushes;
+extern std::atomic<unsigned long long> g_redis_flush_errors;
+extern std::atomic<unsigned long long> g_redis_flush_us;
+extern std::atomic<unsigned long long> g_redis_last_flush_us;
+// кэш последних значений: датчики в кэше (gauge), запросы GET /latest,
+// ключи сверх LatestCache::kMaxKeysPerSensor
+extern std::atomic<unsigned long long> g_latest_sensors;
+extern std::atomic<unsigned long long> g_latest_reads;
+extern std::atomic<unsigned long long> g_latest_dropped_keys;
+// журнал на диске: принятые и отклонённые (журнал заполнен) показания,
+// поданные из журнала в очередь и подтверждённые воркерами, объём и число
+// сегментов (gauges), всего записано байт, fdatasync и их суммарное время в микросекундах,
+// ошибки записи и битые записи при чтении, показания, отвергнутые
+// ClickHouse и снятые с журнала в dead-letter
+extern std::atomic<unsigned long long> g_wal_appended;
+extern std::atomic<unsigned long long> g_wal_rejected;
+extern std::atomic<unsigned long long> g_wal_replayed;
+extern std::atomic<unsigned long long> g_wal_committed;
+extern std::atomic<unsigned long long> g_wal_bytes;
+extern std::atomic<unsigned long long> g_wal_segments;
+extern std::atomic<unsigned long long> g_wal_written_bytes;
+extern std::atomic<unsigned long long> g_wal_fsyncs;
+extern std::atomic<unsigned long long> g_wal_fsync_us;
+extern std::atomic<unsigned long long> g_wal_write_errors;
+extern std::atomic<unsigned long long> g_wal_corrupt_records;
+extern std::atomic<unsigned long long> g_wal_dead_letter;
+// предагрегация: показания, прошедшие через стадию, отклонённые как
+// запоздавшие (окно уже закрыто) и сверх rollup_max_groups, открытые группы
+// (gauge), записанные строки агрегатов и неудачные вставки
+extern std::atomic<unsigned long long> g_rollup_readings;
+extern std::atomic<unsigned long long> g_rollup_late;
+extern std::atomic<unsigned long long> g_rollup_dropped;
+extern std::atomic<unsigned long long> g_rollup_groups;
+extern std::atomic<unsigned long long> g_rollup_rows;
+extern std::atomic<unsigned long long> g_rollup_flush_errors;
+
+// Задержки по стадиям (cpp_sensors_stage_latency_seconds{stage=...}):
+// разбор тела/кадра/датаграммы, запись в журнал до fdatasync, ожидание в
+// очереди (enqueue → pop), ожидание добора батча (pop → INSERT), INSERT в
+// ClickHouse, сброс в Redis, вставка агрегатов, запись HTTP-ответа и
+// HTTP-запрос целиком (прочитан → ответ записан)
+extern LatencyHistogram g_lat_parse;
+extern LatencyHistogram g_lat_wal_sync;
+extern LatencyHistogram g_lat_queue_wait;
+extern LatencyHistogram g_lat_batch_wait;
+extern LatencyHistogram g_lat_ch_insert;
+extern LatencyHistogram g_lat_redis_flush;
+extern LatencyHistogram g_lat_rollup_flush;
+extern LatencyHistogram g_lat_http_write;
+extern LatencyHistogram g_lat_http_request;
+
+// HTTP-ответы по кодам (cpp_sensors_http_responses_total{code=...})
+void count_http_response(int status);
+
+// Счётчики воркера ClickHouse: вставки (батчи), строки, ошибки вставки,
+// переподключения после ошибок
+struct ChWorkerStats {
+  std::atomic<unsigned long long> inserts{0};
+  std::atomic<unsigned long long> rows{0};
+  std::atomic<unsigned long long> errors{0};
+  std::atomic<unsigned long long> reconnects{0};
+};
+// статистика воркера по номеру; создаётся при первом обращении,
+// ссылка остаётся валидной до конца процесса
+ChWorkerStats &ch_worker_stats(std::size_t worker);
+
+// Узлы ClickHouse (см. ch_endpoints.hpp): вставки, строки, ошибки
+// вставки, неудачные проверки здоровья, доступность, текущая оценка
+// задержки для выбора узла и гистограмма времени вставки
+struct ChEndpointStats {
+  std::string name; // host:port
+  std::size_t shard{0};
+  std::atomic<unsigned long long> inserts{0};
+  std::atomic<unsigned long long> rows{0};
+  std::atomic<unsigned long long> errors{0};
+  std::atomic<unsigned long long> probe_failures{0};
+  std::atomic<unsigned long long> up{1};
+  std::atomic<unsigned long long> score_us{0};
+  LatencyHistogram insert_latency;
+};
+// регистрирует узел под номером index (повторно — переименовывает);
+// ссылка остаётся валидной до конца процесса
+ChEndpointStats &register_ch_endpoint(std::size_t index, std::string name,
+                                      std::size_t shard);
+
+// Шарды очереди (queue_shards > 0): глубина и число батчей, забранных
+// чужим воркером (кража)
+struct QueueShardStats {
+  std::atomic<unsigned long long> depth{0};
+  std::atomic<unsigned long long> steals{0};
+};
+QueueShardStats &queue_shard_stats(std::size_t shard);
+
+// Текст для GET /metrics в формате Prometheus exposition 0.0.4
+std::string render_metrics();
 } // namespace sensors
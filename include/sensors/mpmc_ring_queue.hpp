@@ -0,0 +1,310 @@
+#pragma once
+#include "bounded_queue.hpp"
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace sensors {
+
+// Ограниченная lock-free MPMC-очередь на кольцевом буфере (схема Д. Вьюкова):
+// у каждой ячейки свой счётчик seq, производители и потребители захватывают
+// позиции через CAS и не мешают друг другу, пока кольцо не пусто и не полно.
+// Ёмкость округляется вверх до степени двойки.
+//
+// Ожидание: сначала короткий спин с yield, затем парковка на condvar.
+// Mutex трогается только если кто-то действительно спит, горячий путь
+// push/pop от него не зависит.
+template <class T>
+class MpmcRingQueue : public BoundedQueue<T> {
+public:
+  static constexpr std::size_t kCacheLine = 64;
+
+  explicit MpmcRingQueue(std::size_t cap)
+      : mask_(round_up_pow2(cap) - 1), cells_(new Cell[mask_ + 1]) {
+    for (std::size_t i = 0; i <= mask_; ++i)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  ~MpmcRingQueue() override {
+    // к этому моменту конкурентных обращений уже нет
+    const std::size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+    for (std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+         pos != end; ++pos) {
+      Cell &c = cells_[pos & mask_];
+      if (c.seq.load(std::memory_order_relaxed) == pos + 1)
+        c.ptr()->~T();
+    }
+  }
+
+  MpmcRingQueue(const MpmcRingQueue &) = delete;
+  MpmcRingQueue &operator=(const MpmcRingQueue &) = delete;
+
+  std::size_t capacity() const noexcept { return mask_ + 1; }
+
+  bool push(const T& v) override { return push_impl(v); }
+  bool push(T&& v) override { return push_impl(std::move(v)); }
+
+  bool try_push(const T& v) override { return try_push_impl(v); }
+  bool try_push(T&& v) override { return try_push_impl(std::move(v)); }
+
+  // Все n ячеек начиная с хвоста проверяются на свободность до CAS: свободная
+  // ячейка не может стать занятой, пока enqueue_pos_ не сдвинут, поэтому
+  // успешный CAS на pos + n гарантирует, что вся пачка наша
+  bool try_push_bulk(std::vector<T>& items) override {
+    const std::size_t n = items.size();
+    if (n == 0) return true;
+    if (n > capacity() || stopped_.load(std::memory_order_relaxed))
+      return false;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      bool stale = false;
+      for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t seq =
+            cells_[(pos + i) & mask_].seq.load(std::memory_order_acquire);
+        const auto dif = static_cast<std::intptr_t>(seq) -
+                         static_cast<std::intptr_t>(pos + i);
+        if (dif < 0) return false; // места на всю пачку нет
+        if (dif > 0) {
+          stale = true;
+          break;
+        }
+      }
+      if (stale) {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + n,
+                                             std::memory_order_relaxed))
+        break;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      Cell &c = cells_[(pos + i) & mask_];
+      ::new (static_cast<void *>(c.storage)) T(std::move(items[i]));
+      c.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    wake(consumers_parked_, cv_not_empty_, n > 1);
+    return true;
+  }
+
+  std::optional<T> pop() override {
+    for (;;) {
+      if (auto v = try_pop()) return v;
+      if (stopped_.load(std::memory_order_acquire)) return try_pop();
+      if (!spin_until([&] { return has_item(); }))
+        park_consumer(nullptr);
+    }
+  }
+
+  std::optional<T> pop_for(std::chrono::milliseconds timeout) override {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+      if (auto v = try_pop()) return v;
+      if (stopped_.load(std::memory_order_acquire)) return try_pop();
+      if (std::chrono::steady_clock::now() >= deadline) return std::nullopt;
+      if (!spin_until([&] { return has_item(); }))
+        park_consumer(&deadline);
+    }
+  }
+
+  // захватываем подряд идущие готовые ячейки одним CAS
+  std::size_t pop_bulk(std::vector<T>& out, std::size_t max) override {
+    if (max == 0) return 0;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    std::size_t n = 0;
+    for (;;) {
+      n = 0;
+      while (n < max && n <= mask_ &&
+             cells_[(pos + n) & mask_].seq.load(std::memory_order_acquire) ==
+                 pos + n + 1)
+        ++n;
+      if (n == 0) {
+        // либо пусто, либо другой потребитель уже сдвинул голову
+        const std::size_t cur = dequeue_pos_.load(std::memory_order_relaxed);
+        if (cur == pos) return 0;
+        pos = cur;
+        continue;
+      }
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + n,
+                                             std::memory_order_relaxed))
+        break;
+    }
+    out.reserve(out.size() + n);
+    for (std::size_t i = 0; i < n; ++i) {
+      Cell &c = cells_[(pos + i) & mask_];
+      out.push_back(std::move(*c.ptr()));
+      c.ptr()->~T();
+      c.seq.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    wake(producers_parked_, cv_not_full_, true);
+    return n;
+  }
+
+  void stop() override {
+    stopped_.store(true, std::memory_order_release);
+    {
+      boost::lock_guard<boost::mutex> lk(park_m_);
+    }
+    cv_not_empty_.notify_all();
+    cv_not_full_.notify_all();
+  }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *ptr() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  static std::size_t round_up_pow2(std::size_t v) {
+    std::size_t p = 2;
+    while (p < v) p <<= 1;
+    return p;
+  }
+
+  template <class U>
+  bool try_push_impl(U&& v) {
+    if (stopped_.load(std::memory_order_relaxed)) return false;
+    Cell *cell = nullptr;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto dif =
+          static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (dif < 0) {
+        return false; // кольцо заполнено
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void *>(cell->storage)) T(std::forward<U>(v));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    wake(consumers_parked_, cv_not_empty_, false);
+    return true;
+  }
+
+  template <class U>
+  bool push_impl(U&& v) {
+    for (;;) {
+      if (try_push_impl(std::forward<U>(v))) return true;
+      if (stopped_.load(std::memory_order_acquire)) return false;
+      if (!spin_until([&] { return has_space(); }))
+        park(producers_parked_, cv_not_full_, nullptr,
+             [&] { return has_space(); });
+    }
+  }
+
+  std::optional<T> try_pop() {
+    Cell *cell = nullptr;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto dif = static_cast<std::intptr_t>(seq) -
+                       static_cast<std::intptr_t>(pos + 1);
+      if (dif == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (dif < 0) {
+        return std::nullopt; // пусто
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    std::optional<T> v(std::move(*cell->ptr()));
+    cell->ptr()->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    wake(producers_parked_, cv_not_full_, false);
+    return v;
+  }
+
+  bool has_item() const {
+    const std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos + 1;
+  }
+
+  bool has_space() const {
+    const std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos;
+  }
+
+  template <class Pred>
+  bool spin_until(Pred pred) const {
+    for (int i = 0; i < kSpinRounds; ++i) {
+      if (pred() || stopped_.load(std::memory_order_relaxed)) return true;
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+  void park_consumer(const std::chrono::steady_clock::time_point *deadline) {
+    park(consumers_parked_, cv_not_empty_, deadline,
+         [&] { return has_item(); });
+  }
+
+  // Счётчик спящих увеличивается до проверки предиката, а будящая сторона
+  // после публикации ячейки ставит seq_cst-барьер и читает счётчик — так
+  // либо спящий увидит элемент, либо будящий увидит спящего.
+  template <class Pred>
+  void park(std::atomic<int> &parked, boost::condition_variable_any &cv,
+            const std::chrono::steady_clock::time_point *deadline,
+            Pred ready) {
+    boost::unique_lock<boost::mutex> lk(park_m_);
+    parked.fetch_add(1, std::memory_order_seq_cst);
+    auto pred = [&] {
+      return stopped_.load(std::memory_order_acquire) || ready();
+    };
+    if (deadline) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          *deadline - std::chrono::steady_clock::now());
+      if (left.count() > 0)
+        cv.wait_for(lk, boost::chrono::milliseconds(left.count()), pred);
+    } else {
+      cv.wait(lk, pred);
+    }
+    parked.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void wake(std::atomic<int> &parked, boost::condition_variable_any &cv,
+            bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) == 0) return;
+    {
+      boost::lock_guard<boost::mutex> lk(park_m_);
+    }
+    if (all)
+      cv.notify_all();
+    else
+      cv.notify_one();
+  }
+
+  static constexpr int kSpinRounds = 64;
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  alignas(kCacheLine) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(kCacheLine) std::atomic<std::size_t> dequeue_pos_{0};
+
+  alignas(kCacheLine) std::atomic<bool> stopped_{false};
+  std::atomic<int> consumers_parked_{0};
+  std::atomic<int> producers_parked_{0};
+  boost::mutex park_m_;
+  boost::condition_variable_any cv_not_empty_;
+  boost::condition_variable_any cv_not_full_;
+};
+
+} // namespace sensors
@@ -3,6 +3,9 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace sw {
 namespace redis {
@@ -25,8 +28,14 @@ public:
 
   bool is_enabled() const noexcept { return enabled_; }
 
-  void save_metric(const std::string &sensor_id, const std::string &key,
-                   double value, std::int64_t ts);
+  // один multi-field HSET: ключ хэша и пары поле → значение
+  struct Hash {
+    std::string key;
+    std::vector<std::pair<std::string, std::string>> fields;
+  };
+
+  // все HSET одним pipeline (один round trip); false — ошибка Redis
+  bool hset_pipelined(const std::vector<Hash> &hashes);
 
 private:
   bool enabled_{false};
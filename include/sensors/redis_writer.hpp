@@ -0,0 +1,52 @@
+#pragma once
+#include "last_value_buffer.hpp"
+#include "redis_client.hpp"
+#include "request_context.hpp"
+#include "types.hpp"
+#include <atomic>
+#include <boost/thread.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sensors {
+
+// Отдельная стадия записи последних значений в Redis.
+// Воркеры ClickHouse после успешной вставки только складывают пачку в
+// LastValueBuffer (под коротким mutex) и не ждут Redis. Поток writer'а раз
+// в redis_flush_interval_ms забирает накопленное и пишет его одним
+// pipeline: по одному multi-field HSET на датчик. Неудачный сброс
+// возвращается в буфер; и приём, и возврат держат в нём не больше
+// redis_max_pending пар, лишние считаются в g_redis_dropped.
+class RedisWriter {
+public:
+  // запись одного сброса; false — не удалась, пары вернутся в буфер
+  using Flush = std::function<bool(const std::vector<RedisClient::Hash> &)>;
+
+  // пишет в redis_host:redis_port, при обрыве переподключается
+  explicit RedisWriter(const Config &cfg);
+  // пишет через flush (тесты)
+  RedisWriter(const Config &cfg, Flush flush);
+  ~RedisWriter();
+
+  void start();
+  // останавливает поток после финального сброса
+  void stop();
+
+  // вызывается воркером ClickHouse после успешного INSERT
+  void submit(const std::vector<EnqueuedTask> &batch);
+
+private:
+  void run();
+  void requeue(const std::vector<LastValueBuffer::Entry> &entries);
+
+  const Config cfg_;
+  Flush flush_;
+  boost::mutex m_;
+  boost::condition_variable cv_;
+  LastValueBuffer buffer_;
+  std::unique_ptr<boost::thread> thread_;
+  std::atomic<bool> running_{false};
+};
+
+} // namespace sensors
@@ -1,23 +1,59 @@
 #pragma once
-#include <functional>
-#include <string>
+#include "intern_table.hpp"
+#include "slab_pool.hpp"
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace sensors {
 
-// Обратный канал к сетевому exe для ответа клиенту
+class AckHub;
+
+// Обратный канал к сетевому exe для ответа клиенту.
+// respond вызывается из потока воркера и сам переходит в strand/executor
+// соединения; реализации создаются через allocate_shared c PoolAllocator.
 struct ReplyHandle {
-  // вызывает write внутри strand/executor соединения
-  std::function<void(int http_status, std::string body)> respond;
+  virtual ~ReplyHandle() = default;
+  virtual void respond(int http_status, std::string body) = 0;
 };
 
+// ReplyHandle поверх произвольного callable (ответ на пачку и т.п.)
+template <class F>
+std::shared_ptr<ReplyHandle> make_reply_handle(F fn) {
+  struct Impl final : ReplyHandle {
+    explicit Impl(F f) : fn(std::move(f)) {}
+    void respond(int http_status, std::string body) override {
+      fn(http_status, std::move(body));
+    }
+    F fn;
+  };
+  return std::allocate_shared<Impl>(PoolAllocator<Impl>(), std::move(fn));
+}
+
+// пары (key в g_symbols, value); буфер берётся из slab-пула и при
+// уничтожении задачи в воркере возвращается в него же
+using KvBuffer =
+    std::vector<std::pair<SymbolId, double>,
+                PoolAllocator<std::pair<SymbolId, double>>>;
+
 struct EnqueuedTask {
-  std::string request_id; // корреляция
-  std::string sensor_id;
+  std::uint64_t request_id{0}; // корреляция
+  // ключ в DedupFilter, который фиксирует или забывает воркер по итогу
+  // вставки (0 — нет; с журналом ключ фиксируется после fdatasync)
+  std::uint64_t dedup_key{0};
+  SymbolId sensor{kInvalidSymbol}; // sensor_id в g_symbols
+  std::uint32_t wal_segment{0}; // сегмент журнала, откуда задача (0 — не из журнала)
   std::int64_t ts;
-  std::vector<std::pair<std::string, double>> kv; // (key,value)
+  std::int64_t enqueue_ns{0}; // mono_ns() перед постановкой в очередь
+  std::int64_t dequeue_ns{0}; // mono_ns() после извлечения воркером
+  std::int64_t received_s{0}; // unix-секунды приёма сервером (0 — неизвестно)
+  KvBuffer kv;
   std::shared_ptr<ReplyHandle> reply; // может быть nullptr, если ответим 202 сразу
+  // групповое подтверждение вместо reply (http_ack_mode = "group")
+  AckHub *ack_hub{nullptr};
+  std::uint64_t ack_ticket{0};
 };
 
 } // namespace sensors
@@ -0,0 +1,147 @@
+#pragma once
+#include "intern_table.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace sensors {
+
+// Агрегаты count/min/max/sum/last по (окно, sensor, key) для одного
+// размера окна (tumbling window). Окно [start, start + window) закрывается,
+// когда часы сервера дошли до start + window + grace: тогда его группы
+// уходят в drain_closed. Опоздание судится по времени приёма показания:
+// принятое сервером после закрытия окна отклоняется, а принятое вовремя,
+// но дошедшее позже (очередь, журнал после простоя ClickHouse), снова
+// открывает группу окна и уходит следующей частью.
+// Не потокобезопасен: один поток-владелец — RollupWriter под своим mutex.
+class RollupBuffer {
+public:
+  struct Row {
+    SymbolId sensor;
+    SymbolId key;
+    std::int64_t start; // начало окна, unix-секунды
+    std::uint64_t count;
+    double min;
+    double max;
+    double sum;
+    double last;
+    std::int64_t last_ts; // секунды последнего показания (для last)
+  };
+
+  enum class Put { added, merged, late, full };
+
+  RollupBuffer(std::int64_t window_s, std::int64_t grace_s,
+               std::size_t max_groups)
+      : window_(window_s > 0 ? window_s : 1), grace_(grace_s > 0 ? grace_s : 0),
+        max_groups_(max_groups) {}
+
+  std::int64_t window() const { return window_; }
+
+  std::int64_t window_start(std::int64_t ts_s) const {
+    const std::int64_t r = ts_s % window_;
+    return ts_s - (r < 0 ? r + window_ : r);
+  }
+
+  // ts_s и received_s (время приёма показания) — unix-секунды
+  Put put(SymbolId sensor, SymbolId key, double value, std::int64_t ts_s,
+          std::int64_t received_s) {
+    const std::int64_t start = window_start(ts_s);
+    if (start + window_ + grace_ <= received_s)
+      return Put::late;
+    const Group g{start, sensor, key};
+    auto it = groups_.find(g);
+    if (it == groups_.end()) {
+      if (groups_.size() >= max_groups_)
+        return Put::full;
+      groups_.emplace(g, Row{sensor, key, start, 1, value, value, value, value,
+                             ts_s});
+      oldest_ = std::min(oldest_, start);
+      return Put::added;
+    }
+    Row &r = it->second;
+    ++r.count;
+    r.min = std::min(r.min, value);
+    r.max = std::max(r.max, value);
+    r.sum += value;
+    if (ts_s >= r.last_ts) {
+      r.last = value;
+      r.last_ts = ts_s;
+    }
+    return Put::merged;
+  }
+
+  // Забирает в out группы окон, закрытых к now_s (все — при flush_all)
+  std::size_t drain_closed(std::int64_t now_s, std::vector<Row> &out,
+                           bool flush_all = false) {
+    if (!flush_all && oldest_ + window_ + grace_ > now_s)
+      return 0; // ни одно окно ещё не закрыто — без обхода
+    std::size_t n = 0;
+    std::int64_t oldest = kOpen;
+    for (auto it = groups_.begin(); it != groups_.end();) {
+      if (flush_all || it->first.start + window_ + grace_ <= now_s) {
+        out.push_back(it->second);
+        it = groups_.erase(it);
+        ++n;
+      } else {
+        oldest = std::min(oldest, it->first.start);
+        ++it;
+      }
+    }
+    oldest_ = oldest;
+    return n;
+  }
+
+  // Возвращает неотправленные строки: сливаются со свежими данными тех же
+  // групп, лимит групп не проверяется
+  void restore(const std::vector<Row> &rows) {
+    for (const Row &row : rows) {
+      const Group g{row.start, row.sensor, row.key};
+      auto [it, fresh] = groups_.try_emplace(g, row);
+      oldest_ = std::min(oldest_, row.start);
+      if (fresh)
+        continue;
+      Row &r = it->second;
+      r.count += row.count;
+      r.min = std::min(r.min, row.min);
+      r.max = std::max(r.max, row.max);
+      r.sum += row.sum;
+      if (row.last_ts >= r.last_ts) {
+        r.last = row.last;
+        r.last_ts = row.last_ts;
+      }
+    }
+  }
+
+  std::size_t size() const { return groups_.size(); }
+
+private:
+  static constexpr std::int64_t kOpen = std::numeric_limits<std::int64_t>::max() / 2;
+
+  struct Group {
+    std::int64_t start;
+    SymbolId sensor;
+    SymbolId key;
+    bool operator==(const Group &o) const {
+      return start == o.start && sensor == o.sensor && key == o.key;
+    }
+  };
+  struct GroupHash {
+    std::size_t operator()(const Group &g) const noexcept {
+      std::uint64_t h = (std::uint64_t{g.sensor} << 32) | g.key;
+      h ^= static_cast<std::uint64_t>(g.start) * 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+      return static_cast<std::size_t>(h * 0xBF58476D1CE4E5B9ULL);
+    }
+  };
+
+  const std::int64_t window_;
+  const std::int64_t grace_;
+  const std::size_t max_groups_;
+  std::unordered_map<Group, Row, GroupHash> groups_;
+  std::int64_t oldest_ = kOpen; // самое раннее открытое окно
+};
+
+} // namespace sensors
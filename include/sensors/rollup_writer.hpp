@@ -0,0 +1,65 @@
+#pragma once
+#include "ch_endpoints.hpp"
+#include "request_context.hpp"
+#include "rollup_buffer.hpp"
+#include "types.hpp"
+#include <atomic>
+#include <boost/thread.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sensors {
+
+// Стадия предагрегации (rollup_enabled): count/min/max/sum/last по датчику
+// и ключу в tumbling-окнах из rollup_windows (таблица → размер окна в
+// секундах). Воркеры ClickHouse после успешного INSERT сырых строк
+// складывают пачку в RollupBuffer'ы (под коротким mutex); поток стадии раз
+// в rollup_flush_interval_ms забирает окна, закрытые с учётом
+// rollup_grace_s, и вставляет их одним Block на таблицу и шард. Узлы
+// ClickHouse — общие с пулом воркеров (ChEndpointSet): строки делятся по
+// шардам тем же хэшем sensor_id, что и сырые, узел шарда выбирается по
+// здоровью, которое ведёт проверка пула, а сетевая ошибка выключает узел.
+// Неудачная вставка возвращает строки в буфер и повторяется на следующем
+// сбросе, на другом узле, если этот выключен.
+//
+// Таблица агрегатов, например:
+//   CREATE TABLE metrics_1m (sensor_id String, ts DateTime, key String,
+//     count UInt64, min Float64, max Float64, sum Float64, last Float64,
+//     last_ts DateTime) ENGINE = MergeTree ORDER BY (sensor_id, key, ts)
+// Окно может прийти несколькими частями (показания, принятые вовремя, но
+// вставленные после его сброса; перезапуск), поэтому запросы
+// объединяют строки окна: sum(count), min(min), max(max), sum(sum),
+// argMax(last, last_ts).
+class RollupWriter {
+public:
+  explicit RollupWriter(const Config &cfg);
+  ~RollupWriter();
+
+  // endpoints — узлы пула воркеров; живут дольше stop()
+  void start(ChEndpointSet &endpoints);
+  // останавливает поток после сброса всех, в том числе открытых, окон
+  void stop();
+
+  // вызывается воркером ClickHouse после успешного INSERT
+  void submit(const std::vector<EnqueuedTask> &batch);
+
+private:
+  struct Window {
+    std::string table;
+    RollupBuffer buffer;
+  };
+
+  void run();
+  std::size_t open_groups() const;
+
+  const Config cfg_;
+  ChEndpointSet *endpoints_{nullptr};
+  boost::mutex m_;
+  boost::condition_variable cv_;
+  std::vector<Window> windows_;
+  std::unique_ptr<boost::thread> thread_;
+  std::atomic<bool> running_{false};
+};
+
+} // namespace sensors
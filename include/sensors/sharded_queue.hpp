@@ -0,0 +1,106 @@
+#pragma once
+#include "bounded_queue.hpp"
+#include "request_context.hpp"
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sensors {
+
+// Очередь задач, разбитая на шарды по sensor_id (Config::queue_shards > 0).
+//
+// Показания одного датчика всегда попадают в один шард, а шард в каждый
+// момент обрабатывает не больше одного воркера: воркер захватывает шард
+// (acquire), собирает из него батч и отпускает (release) только после
+// INSERT. Поэтому порядок показаний датчика в ClickHouse, кэше последних
+// значений и Redis совпадает с порядком приёма.
+//
+// Шард s «домашний» для воркера s % workers: воркер сначала берёт свои
+// шарды, а если они пусты — крадёт батч из самого глубокого свободного
+// чужого шарда с глубиной не меньше steal_min_depth. Так занятый горячим
+// датчиком воркер не оставляет без обработки остальные свои шарды.
+//
+// Ёмкость — на шард (queue_capacity / queue_shards); try_push_bulk
+// резервирует место во всех затронутых шардах сразу, поэтому пачка
+// по-прежнему принимается целиком или не принимается вовсе. Исключение —
+// остановка очереди посреди раскладки: тогда try_push_bulk возвращает
+// false, а в items остаются только задачи, не попавшие в шарды.
+//
+// Обычные pop/pop_for/pop_bulk тоже работают (берут из любого свободного
+// шарда), но порядок между батчами гарантирует только acquire/release.
+class ShardedTaskQueue final : public BoundedQueue<EnqueuedTask> {
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  // impl — "mutex" или "mpmc", как Config::queue_impl
+  ShardedTaskQueue(std::size_t shards, std::size_t capacity_per_shard,
+                   const std::string &impl, std::size_t workers,
+                   std::size_t steal_min_depth);
+  ~ShardedTaskQueue() override;
+
+  std::size_t shard_count() const noexcept { return shards_.size(); }
+  std::size_t shard_of(SymbolId sensor) const noexcept;
+  std::size_t depth(std::size_t shard) const noexcept;
+
+  bool push(const EnqueuedTask &v) override;
+  bool push(EnqueuedTask &&v) override;
+  bool try_push(const EnqueuedTask &v) override;
+  bool try_push(EnqueuedTask &&v) override;
+  bool try_push_bulk(std::vector<EnqueuedTask> &items) override;
+
+  std::optional<EnqueuedTask> pop() override;
+  std::optional<EnqueuedTask> pop_for(std::chrono::milliseconds timeout) override;
+  std::size_t pop_bulk(std::vector<EnqueuedTask> &out, std::size_t max) override;
+
+  void stop() override;
+
+  // Воркер worker захватывает шард и забирает из него до max задач в out.
+  // Ждёт не дольше timeout; npos — ничего не нашлось или очередь
+  // остановлена и пуста. Захваченный шард нужно отпустить release().
+  std::size_t acquire(std::size_t worker, std::vector<EnqueuedTask> &out,
+                      std::size_t max, std::chrono::milliseconds timeout);
+  // добор из захваченного шарда: без ожидания / с ожиданием до timeout
+  std::size_t pop_bulk_from(std::size_t shard, std::vector<EnqueuedTask> &out,
+                            std::size_t max);
+  std::size_t pop_for_from(std::size_t shard, std::vector<EnqueuedTask> &out,
+                           std::size_t max, std::chrono::milliseconds timeout);
+  void release(std::size_t shard);
+
+private:
+  struct Shard;
+
+  bool reserve(Shard &s, std::size_t n);
+  void unreserve(Shard &s, std::size_t n);
+  template <class U> bool push_one(U &&v, bool block);
+  std::size_t take(Shard &s, std::vector<EnqueuedTask> &out, std::size_t max);
+  // захват свободного непустого шарда: сначала домашние, потом кража
+  std::size_t try_acquire(std::size_t worker);
+  bool claim(Shard &s);
+
+  void notify_consumers();
+  void notify_producers();
+  template <class Pred>
+  bool wait(std::atomic<int> &waiters, boost::condition_variable &cv,
+            std::chrono::steady_clock::time_point deadline, Pred pred);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  const std::size_t capacity_;
+  const std::size_t workers_;
+  const std::size_t steal_min_depth_;
+  std::atomic<bool> stopped_{false};
+
+  boost::mutex park_m_;
+  boost::condition_variable cv_items_; // появились задачи / шард отпущен
+  boost::condition_variable cv_space_; // освободилось место
+  std::atomic<int> consumers_parked_{0};
+  std::atomic<int> producers_parked_{0};
+  std::atomic<std::size_t> rr_{0}; // начало обхода для обычных pop
+};
+
+} // namespace sensors
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace sensors {
+
+// Пул небольших блоков памяти под данные задач (буферы key/value, ответные
+// хэндлы, обработчики asio). Блоки раскладываются по классам размеров
+// 64..2048 байт; освобождённый блок попадает в список свободных своего
+// потока. Задачи создаются в HTTP-потоках, а умирают в воркерах, поэтому
+// излишки из потока уходят пачкой в общее хранилище, откуда их забирают
+// потоки, которым блоков не хватает. Блоки крупнее 2048 байт и блоки сверх
+// лимита хранилища отдаются обычному operator new/delete.
+namespace slab {
+
+constexpr std::size_t kMaxBlock = 2048;
+
+void *allocate(std::size_t bytes);
+void deallocate(void *p, std::size_t bytes) noexcept;
+
+} // namespace slab
+
+// Аллокатор поверх slab-пула для контейнеров и allocate_shared
+template <class T>
+struct PoolAllocator {
+  using value_type = T;
+
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "PoolAllocator: over-aligned types are not supported");
+
+  PoolAllocator() noexcept = default;
+  template <class U>
+  PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(slab::allocate(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t n) noexcept {
+    slab::deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  bool operator==(const PoolAllocator<U> &) const noexcept {
+    return true;
+  }
+  template <class U>
+  bool operator!=(const PoolAllocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+} // namespace sensors
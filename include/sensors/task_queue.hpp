@@ -0,0 +1,29 @@
+#pragma once
+#include "bounded_queue.hpp"
+#include "mpmc_ring_queue.hpp"
+#include "request_context.hpp"
+#include "sharded_queue.hpp"
+#include "threadsafe_queue.hpp"
+#include "types.hpp"
+#include <memory>
+#include <stdexcept>
+
+namespace sensors {
+
+using TaskQueue = BoundedQueue<EnqueuedTask>;
+
+// Выбор реализации очереди задач по Config::queue_impl (и queue_shards)
+inline std::unique_ptr<TaskQueue> make_task_queue(const Config &cfg) {
+  if (cfg.queue_shards > 0)
+    return std::make_unique<ShardedTaskQueue>(
+        cfg.queue_shards, cfg.queue_capacity / cfg.queue_shards, cfg.queue_impl,
+        cfg.ch_pool_size, cfg.queue_steal_min_depth);
+  if (cfg.queue_impl == "mutex")
+    return std::make_unique<ThreadSafeQueue<EnqueuedTask>>(cfg.queue_capacity);
+  if (cfg.queue_impl == "mpmc")
+    return std::make_unique<MpmcRingQueue<EnqueuedTask>>(cfg.queue_capacity);
+  throw std::invalid_argument("unknown queue_impl: " + cfg.queue_impl +
+                              " (expected \"mutex\" or \"mpmc\")");
+}
+
+} // namespace sensors
@@ -1,36 +1,39 @@
 #pragma once
+#include "bounded_queue.hpp"
 #include <boost/thread.hpp>
+#include <chrono>
 #include <deque>
 #include <optional>
 
 namespace sensors {
 
 template <class T>
-class ThreadSafeQueue {
+class ThreadSafeQueue : public BoundedQueue<T> {
 public:
   explicit ThreadSafeQueue(std::size_t cap) : capacity_(cap) {}
 
   // блокирующая попытка положить
-  bool push(const T& v) {
-    boost::unique_lock<boost::mutex> lk(m_);
-    cv_not_full_.wait(lk, [&]{ return stopped_ || q_.size() < capacity_; });
-    if (stopped_) return false;
-    q_.push_back(v);
-    cv_not_empty_.notify_one();
-    return true;
-  }
+  bool push(const T& v) override { return push_impl(v); }
+  bool push(T&& v) override { return push_impl(std::move(v)); }
 
   // неблокирующая попытка
-  bool try_push(const T& v) {
+  bool try_push(const T& v) override { return try_push_impl(v); }
+  bool try_push(T&& v) override { return try_push_impl(std::move(v)); }
+
+  bool try_push_bulk(std::vector<T>& items) override {
     boost::unique_lock<boost::mutex> lk(m_);
-    if (stopped_ || q_.size() >= capacity_) return false;
-    q_.push_back(v);
-    cv_not_empty_.notify_one();
+    if (stopped_ || q_.size() + items.size() > capacity_) return false;
+    for (auto& v : items)
+      q_.push_back(std::move(v));
+    if (items.size() == 1)
+      cv_not_empty_.notify_one();
+    else if (!items.empty())
+      cv_not_empty_.notify_all();
     return true;
   }
 
   // блокирующее извлечение
-  std::optional<T> pop() {
+  std::optional<T> pop() override {
     boost::unique_lock<boost::mutex> lk(m_);
     cv_not_empty_.wait(lk, [&]{ return stopped_ || !q_.empty(); });
     if (q_.empty()) return std::nullopt;
@@ -40,7 +43,32 @@ public:
     return v;
   }
 
-  void stop() {
+  // извлечение с ожиданием не дольше timeout; nullopt — если очередь пуста
+  std::optional<T> pop_for(std::chrono::milliseconds timeout) override {
+    boost::unique_lock<boost::mutex> lk(m_);
+    cv_not_empty_.wait_for(lk, boost::chrono::milliseconds(timeout.count()),
+                           [&]{ return stopped_ || !q_.empty(); });
+    if (q_.empty()) return std::nullopt;
+    T v = std::move(q_.front());
+    q_.pop_front();
+    cv_not_full_.notify_one();
+    return v;
+  }
+
+  // забираем сразу до max элементов под одной блокировкой
+  std::size_t pop_bulk(std::vector<T>& out, std::size_t max) override {
+    boost::unique_lock<boost::mutex> lk(m_);
+    std::size_t n = 0;
+    while (n < max && !q_.empty()) {
+      out.push_back(std::move(q_.front()));
+      q_.pop_front();
+      ++n;
+    }
+    if (n) cv_not_full_.notify_all();
+    return n;
+  }
+
+  void stop() override {
     {
       boost::lock_guard<boost::mutex> lk(m_);
       stopped_ = true;
@@ -50,6 +78,25 @@ public:
   }
 
 private:
+  template <class U>
+  bool push_impl(U&& v) {
+    boost::unique_lock<boost::mutex> lk(m_);
+    cv_not_full_.wait(lk, [&]{ return stopped_ || q_.size() < capacity_; });
+    if (stopped_) return false;
+    q_.push_back(std::forward<U>(v));
+    cv_not_empty_.notify_one();
+    return true;
+  }
+
+  template <class U>
+  bool try_push_impl(U&& v) {
+    boost::unique_lock<boost::mutex> lk(m_);
+    if (stopped_ || q_.size() >= capacity_) return false;
+    q_.push_back(std::forward<U>(v));
+    cv_not_empty_.notify_one();
+    return true;
+  }
+
   std::deque<T> q_;
   std::size_t capacity_;
   bool stopped_{false};
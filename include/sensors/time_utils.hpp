@@ -1,9 +1,20 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
+#include <type_traits>
 
 namespace sensors {
 
+// текущее время сервера, unix-секунды
+inline std::int64_t unix_now_s() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
 // Приводит timestamp к секундам (UTC).
 // Если приходит миллисекунды/микросекунды — конвертируем эвристикой.
 inline std::time_t to_time_t_seconds(int64_t ts) {
@@ -16,4 +27,36 @@ inline std::time_t to_time_t_seconds(int64_t ts) {
   return static_cast<std::time_t>(ts); // секунды
 }
 
+// to_time_t_seconds для массива: out[i] = to_time_t_seconds(in[i]).
+// Обычно весь батч в одних единицах, поэтому за один проход делим на
+// делитель первого элемента (без ветвлений на элемент) и попутно считаем
+// min/max; если они показали смешанные единицы — пересчёт поэлементно.
+inline void normalize_ts(const std::int64_t *in, std::int64_t *out,
+                         std::size_t n) {
+  if (n == 0)
+    return;
+  auto divisor = [](std::int64_t ts) -> std::int64_t {
+    return ts > 10'000'000'000'000LL ? 1'000'000
+           : ts > 10'000'000'000LL   ? 1'000
+                                     : 1;
+  };
+  auto convert = [&](auto d) {
+    std::int64_t lo = in[0], hi = in[0];
+    for (std::size_t i = 0; i < n; ++i) {
+      lo = std::min(lo, in[i]);
+      hi = std::max(hi, in[i]);
+      out[i] = in[i] / decltype(d)::value;
+    }
+    return divisor(lo) == d && divisor(hi) == d;
+  };
+  const std::int64_t d = divisor(in[0]);
+  const bool uniform =
+      d == 1       ? convert(std::integral_constant<std::int64_t, 1>{})
+      : d == 1'000 ? convert(std::integral_constant<std::int64_t, 1'000>{})
+                   : convert(std::integral_constant<std::int64_t, 1'000'000>{});
+  if (!uniform)
+    for (std::size_t i = 0; i < n; ++i)
+      out[i] = to_time_t_seconds(in[i]);
+}
+
 } // namespace sensors
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace sensors {
 
@@ -16,9 +17,87 @@ struct Config {
   std::string host = "0.0.0.0";
   unsigned short port = 8080;
   std::size_t http_threads = 4;
+  // "shared" — один io_context на все http_threads; "per_thread" — свой
+  // io_context и свой acceptor (SO_REUSEPORT) на каждый из http_threads
+  // потоков, соединение целиком живёт на одном ядре
+  std::string http_io_model = "shared";
+  // ядра для io-потоков per_thread и воркеров ClickHouse: поток i
+  // привязывается к list[i % size] (пусто — без привязки)
+  std::vector<int> http_cpu_affinity;
+  std::vector<int> ch_cpu_affinity;
   std::size_t ch_pool_size = 4;
   std::size_t queue_capacity = 100000;
+  // "mutex" — ThreadSafeQueue, "mpmc" — lock-free MpmcRingQueue
+  // (ёмкость округляется вверх до степени двойки)
+  std::string queue_impl = "mutex";
+  // Шарды очереди по sensor_id (см. sharded_queue.hpp): 0 — одна общая
+  // очередь. queue_capacity делится поровну между шардами; воркер крадёт
+  // из чужого шарда, только если в нём не меньше queue_steal_min_depth задач
+  std::size_t queue_shards = 0;
+  std::size_t queue_steal_min_depth = 256;
   int write_timeout_ms = 200; // сколько ждём, чтобы ответить 200 OK
+  // Подтверждение HTTP-ingest: "request" — ответ воркера и таймер 202 на
+  // каждый запрос; "group" — групповые подтверждения (см. ack_hub.hpp):
+  // одно уведомление на батч в io-поток и колесо таймеров на поток;
+  // "immediate" — 202 сразу после постановки в очередь (или в журнал),
+  // без подтверждения записи
+  std::string http_ack_mode = "request";
+  // HTTP/1.1 keep-alive: простой между запросами и лимит запросов
+  // на одно соединение (0 — без лимита)
+  bool http_keep_alive = true;
+  int http_idle_timeout_ms = 30000;
+  std::size_t http_max_requests_per_conn = 0;
+  // максимум показаний в одном POST /ingest/batch
+  std::size_t ingest_batch_max_items = 10000;
+  // однопроходный парсер показаний вместо nlohmann::json DOM
+  bool ingest_fast_parser = true;
+  // POST /ingest/stream (NDJSON в chunked-теле): окно чтения тела,
+  // потолок длины строки, период строк-итогов в ответе (0 — только
+  // финальный) и пауза перед повтором, пока очередь полна
+  std::size_t ingest_stream_buffer_bytes = 64 * 1024;
+  std::size_t ingest_stream_max_line_bytes = 64 * 1024;
+  int ingest_stream_ack_interval_ms = 1000;
+  int ingest_stream_pause_ms = 5;
+  // сжатые тела ingest (Content-Encoding: zstd или lz4): потолок
+  // распакованного тела /ingest и /ingest/batch (сверх — 413) и путь к
+  // словарю zstd, общему с клиентами ("" — без словаря; обучается
+  // tools/zstd_dict_train на образцах показаний)
+  std::size_t ingest_max_decompressed_bytes = 8 * 1024 * 1024;
+  std::string ingest_zstd_dictionary;
+  // Контроль приёма на HTTP-ingest (см. admission.hpp): ранний сброс 429
+  // с Retry-After, когда очередь заполнена больше чем на admission_min_fill
+  // (вероятность растёт до 1 к admission_max_fill), и лимит показаний в
+  // секунду на датчик (0 — без лимита) с запасом на sensor_rate_burst_s
+  // секунд; sensor_rate_limits — лимиты отдельных датчиков по sensor_id.
+  // С журналом заполненность — байты журнала относительно wal_max_bytes
+  bool admission_enabled = false;
+  double admission_min_fill = 0.5;
+  double admission_max_fill = 0.9;
+  int admission_retry_after_max_s = 30;
+  double sensor_rate_limit = 0;
+  double sensor_rate_burst_s = 1.0;
+  std::unordered_map<std::string, double> sensor_rate_limits;
+  // Идемпотентность приёма (см. dedup_filter.hpp): ключ из заголовка
+  // Idempotency-Key или хэш показания помнится dedup_window_s..2×окно,
+  // не больше dedup_capacity ключей в поколении; повтор записанного
+  // отвечает 202 без повторной записи, ещё не записанного — 409 с
+  // Retry-After
+  bool dedup_enabled = false;
+  int dedup_window_s = 600;
+  std::size_t dedup_capacity = std::size_t{1} << 20;
+  // Бинарный протокол на отдельном порту (см. binary_protocol.hpp):
+  // ACK раз в bin_ack_every кадров (0 — без ACK)
+  bool bin_enabled = false;
+  unsigned short bin_port = 9100;
+  std::size_t bin_ack_every = 64;
+  std::size_t bin_max_frame_bytes = 1024 * 1024;
+  // UDP-приём (см. udp_server.hpp): датаграмм за один recvmmsg,
+  // максимальный размер датаграммы и SO_RCVBUF (0 — системный)
+  bool udp_enabled = false;
+  unsigned short udp_port = 9200;
+  std::size_t udp_batch = 64;
+  std::size_t udp_max_datagram = 8192;
+  int udp_rcvbuf_bytes = 8 * 1024 * 1024;
   // ClickHouse
   std::string ch_host = "127.0.0.1";
   int ch_port = 9000;
@@ -26,10 +105,69 @@ struct Config {
   std::string ch_password = "";
   std::string ch_database = "sensors";
   std::string ch_table = "metrics";
+  // Несколько узлов ClickHouse (см. ch_endpoints.hpp), адреса "host:port".
+  // "failover" — любой узел из ch_endpoints (пусто — ch_host:ch_port),
+  // воркер берёт здоровый с лучшей задержкой вставки и уходит с упавшего
+  // сразу, без паузы; "sharded" — ch_shards, списки реплик по шардам:
+  // строки делятся по хэшу sensor_id и вставляются в шарды параллельно.
+  // Проверка здоровья — ping каждого узла раз в ch_health_interval_ms,
+  // ch_connect_timeout_ms — таймаут соединения (и ответа на ping),
+  // ch_insert_timeout_ms — таймаут приёма/отправки на соединениях вставки
+  // (0 — без таймаута): зависший узел считается упавшим
+  std::string ch_routing = "failover";
+  std::vector<std::string> ch_endpoints;
+  std::vector<std::vector<std::string>> ch_shards;
+  int ch_health_interval_ms = 1000;
+  int ch_connect_timeout_ms = 1000;
+  int ch_insert_timeout_ms = 30000;
+  // Микробатчинг вставок: воркер копит задачи в один Block, пока не упрётся
+  // в лимит строк/байт или не истечёт linger с момента первой задачи в батче
+  std::size_t ch_batch_max_rows = 10000;
+  std::size_t ch_batch_max_bytes = 4 * 1024 * 1024;
+  int ch_batch_linger_ms = 20;
+  // колонки sensor_id/key в таблице объявлены как LowCardinality(String)
+  bool ch_low_cardinality = false;
+  // потолок числа различных sensor_id и ключей метрик (см. intern_table.hpp);
+  // показания с новыми строками сверх лимита отклоняются как невалидные
+  std::size_t intern_max_symbols = std::size_t{1} << 20;
+
+  // кэш последних значений в процессе (GET /latest) и максимум датчиков
+  // в одном запросе к нему
+  bool latest_enabled = true;
+  std::size_t latest_max_sensors_per_request = 1000;
+
+  // Журнал на диске перед очередью (см. wal.hpp): приём отвечает 202
+  // после fdatasync журнала, вставка в ClickHouse идёт из него. Сегменты
+  // по wal_segment_bytes, fdatasync не чаще раза в wal_fsync_interval_ms,
+  // сверх wal_max_bytes на диске приём отвечает 503
+  bool wal_enabled = false;
+  std::string wal_dir = "wal";
+  std::size_t wal_segment_bytes = 64 * 1024 * 1024;
+  int wal_fsync_interval_ms = 2;
+  std::size_t wal_max_bytes = std::size_t{8} << 30;
+  // сколько раз повторять вставку из журнала, отвергнутую сервером
+  // ClickHouse (не сетевую ошибку), прежде чем убрать батч в dead-letter
+  int wal_server_error_retries = 3;
+
+  // Предагрегация (см. rollup_writer.hpp): count/min/max/sum/last по
+  // датчику и ключу в окнах rollup_windows (таблица → размер окна, с);
+  // показания, принятые сервером позже чем через rollup_grace_s после
+  // конца окна, в агрегаты не попадают. rollup_max_groups — потолок
+  // открытых групп на одно окно
+  bool rollup_enabled = false;
+  std::unordered_map<std::string, int> rollup_windows{{"metrics_1m", 60},
+                                                      {"metrics_1h", 3600}};
+  int rollup_grace_s = 30;
+  int rollup_flush_interval_ms = 1000;
+  std::size_t rollup_max_groups = 1000000;
 
   bool redis_enabled{false};
   std::string redis_host{"127.0.0.1"};
   int redis_port{6379};
+  // окно схлопывания последних значений перед сбросом в Redis и потолок
+  // ожидающих пар sensor/key (сверх него новые пары отбрасываются)
+  int redis_flush_interval_ms{100};
+  std::size_t redis_max_pending{1000000};
 };
 
 } // namespace sensors
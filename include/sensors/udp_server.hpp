@@ -0,0 +1,43 @@
+#pragma once
+#include "types.hpp"
+#include "request_context.hpp"
+#include "latest_cache.hpp"
+#include "task_queue.hpp"
+#include "wal.hpp"
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <memory>
+
+namespace sensors {
+
+// UDP-приём показаний «выстрелил и забыл»: одна датаграмма — JSON-объект
+// показания или тело бинарного кадра READINGS без префикса длины.
+// На Linux датаграммы вычитываются пачками через recvmmsg, разобранные
+// задачи кладутся в очередь пачкой. Ответов клиенту нет.
+class UdpIngestServer {
+public:
+  // wal — журнал, в который уходят показания вместо очереди (nullptr — нет),
+  // latest — кэш последних значений, пополняется при приёме
+  UdpIngestServer(const Config& cfg, TaskQueue& queue,
+                  WriteAheadLog* wal = nullptr,
+                  LatestCache* latest = nullptr);
+  ~UdpIngestServer();
+
+  void start();
+  void stop();
+
+private:
+  void receive_loop();
+
+  const Config cfg_;
+  TaskQueue& queue_;
+  WriteAheadLog* wal_;
+  LatestCache* latest_;
+  boost::asio::io_context ioc_; // только для владения сокетом
+  boost::asio::ip::udp::socket socket_;
+  std::unique_ptr<boost::thread> thread_;
+  std::atomic<bool> running_{false};
+};
+
+} // namespace sensors
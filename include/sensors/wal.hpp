@@ -0,0 +1,132 @@
+#pragma once
+#include "binary_protocol.hpp"
+#include "request_context.hpp"
+#include "task_queue.hpp"
+#include "types.hpp"
+#include <atomic>
+#include <boost/thread.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sensors {
+
+// Журнал принятых показаний на локальном диске (write-ahead log).
+//
+// Приём не кладёт задачи в очередь сам: append() отдаёт их журналу, поток
+// записи раз в wal_fsync_interval_ms дописывает всё накопленное в текущий
+// сегмент одной записью и одним fdatasync (group commit) и только после
+// этого отвечает клиентам 202. Поток подачи читает сегменты по порядку и
+// кладёт задачи в очередь блокирующим push: если ClickHouse лежит, очередь
+// стоит полной, а журнал растёт на диске до wal_max_bytes (дальше — 503).
+// После восстановления воркеры разбирают накопленное с диска.
+//
+// Сегмент — файл <wal_dir>/<id>.wal из записей
+//   record := u32 crc32(frame body) | frame READINGS (см. binary_protocol.hpp)
+// со своим словарём строк; seq кадра — время приёма, unix-секунды.
+// Сегмент удаляется, когда он закрыт, прочитан до конца и воркеры
+// подтвердили (commit) все прочитанные из него задачи.
+// Оставшиеся от прошлого запуска сегменты переигрываются целиком: доставка
+// «хотя бы раз», после аварии возможны повторы задач из незакрытых
+// сегментов. Оборванная последняя запись (сбой посреди записи) отбрасывается.
+// Задачи, которые ClickHouse отвергает (схема, данные), не повторяются
+// вечно: их пишут в <wal_dir>/dead-letter.ndjson (dead_letter()).
+class WriteAheadLog {
+public:
+  WriteAheadLog(const Config &cfg, TaskQueue &queue);
+  ~WriteAheadLog();
+
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+  // создаёт wal_dir и подхватывает сегменты прошлого запуска;
+  // std::runtime_error, если каталог недоступен
+  void open();
+  void start();
+  // дописывает накопленное и останавливает потоки; вызывать после
+  // queue.stop(), иначе поток подачи может ждать места в очереди
+  void stop();
+
+  // false — журнал заполнен или остановлен, tasks не тронуты.
+  // true — задачи забраны (tasks moved-from); reply, если задан, получит
+  // 202 после fdatasync или 500 при ошибке записи
+  bool append(std::vector<EnqueuedTask> &tasks,
+              std::shared_ptr<ReplyHandle> reply);
+
+  // воркер после успешного INSERT: задачи батча больше не нужны на диске
+  void commit(const std::vector<EnqueuedTask> &batch);
+  // батч, который сервер отвергает и после повторов: показания дописываются
+  // строками NDJSON в dead-letter.ndjson (после исправления их можно
+  // отправить в /ingest/batch) и снимаются с журнала, как после commit.
+  // Файл растёт не больше wal_max_bytes, дальше показания только считаются
+  void dead_letter(const std::vector<EnqueuedTask> &batch,
+                   const std::string &reason);
+
+private:
+  struct Frame {
+    std::vector<EnqueuedTask> tasks;
+    std::shared_ptr<ReplyHandle> reply;
+    std::int64_t appended_ns{0}; // mono_ns() в append()
+    std::int64_t received_s{0};  // unix-секунды в append()
+  };
+
+  struct Segment {
+    std::uint64_t bytes{0};     // записано и сброшено на диск
+    std::uint64_t fed{0};       // задач отдано в очередь
+    std::uint64_t committed{0}; // из них подтверждено воркерами
+    bool sealed{false};         // запись в сегмент закончена
+    bool read_done{false};      // поток подачи дочитал сегмент
+    bool damaged{false};        // битая запись в открытом сегменте
+  };
+
+  void write_loop();
+  void feed_loop();
+
+  // ok — группа на диске; lost — записана в сегмент, который поток подачи
+  // успел бросить как битый, её нужно повторить в новом
+  enum class Written { ok, failed, lost };
+  bool write_group(std::vector<Frame> &group);
+  Written write_group_once(const std::vector<Frame> &group);
+  bool open_segment();
+  void seal_segment();
+  // под m_: удаляет сегмент, если он больше не нужен
+  void maybe_drop(std::uint32_t id);
+  // под m_: gauges объёма и числа сегментов
+  void publish_gauges();
+
+  std::filesystem::path segment_path(std::uint32_t id) const;
+
+  const Config cfg_;
+  TaskQueue &queue_;
+
+  std::mutex m_;
+  std::condition_variable write_cv_; // есть что писать / остановка
+  std::condition_variable feed_cv_;  // сегменты изменились / остановка
+  std::vector<Frame> pending_;
+  std::map<std::uint32_t, Segment> segments_;
+  std::uint64_t disk_bytes_{0};
+  std::uint64_t progress_{0}; // растёт при каждом изменении segments_
+  std::uint32_t next_id_{1};
+  std::uint32_t feed_id_{0}; // позиция потока подачи
+  std::uint64_t feed_off_{0};
+  std::atomic<bool> running_{false};
+
+  std::mutex dead_m_; // файл dead-letter пишут воркеры
+
+  // только поток записи
+  std::FILE *file_{nullptr};
+  std::uint32_t active_{0}; // 0 — открытого сегмента нет
+  binproto::Encoder encoder_;
+  std::vector<std::uint8_t> buf_;
+
+  std::unique_ptr<boost::thread> writer_;
+  std::unique_ptr<boost::thread> feeder_;
+};
+
+} // namespace sensors
@@ -0,0 +1,188 @@
+#include "sensors/ack_hub.hpp"
+#include "sensors/metrics_export.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace net = boost::asio;
+
+namespace sensors {
+
+namespace {
+
+std::uint64_t make_ticket(std::uint32_t gen, std::uint32_t slot) {
+  return (std::uint64_t{gen} << 32) | slot;
+}
+
+} // namespace
+
+AckHub::AckHub(net::any_io_executor ex, int timeout_ms)
+    : ex_(std::move(ex)), timer_(ex_),
+      step_(std::max(1, timeout_ms / kWheelSteps)),
+      ticks_(static_cast<std::uint64_t>(
+          (std::max(1, timeout_ms) + step_.count() - 1) / step_.count())),
+      wheel_(ticks_ + 2) {}
+
+AckHub::~AckHub() = default;
+
+AckHub::Entry *AckHub::find(std::uint64_t ticket) {
+  const auto slot = static_cast<std::uint32_t>(ticket);
+  if (slot >= entries_.size())
+    return nullptr;
+  Entry &e = entries_[slot];
+  if (!e.target || e.gen != static_cast<std::uint32_t>(ticket >> 32))
+    return nullptr;
+  return &e;
+}
+
+void AckHub::release(std::uint32_t slot) {
+  Entry &e = entries_[slot];
+  e.target.reset();
+  e.error.clear();
+  if (++e.gen == 0)
+    e.gen = 1; // билет 0 зарезервирован под «нет билета»
+  free_.push_back(slot);
+  --live_;
+}
+
+std::uint64_t AckHub::add(std::shared_ptr<AckTarget> target,
+                          std::uint64_t seq, std::size_t tasks) {
+  std::lock_guard<std::mutex> lk(mu_);
+  std::uint32_t slot;
+  if (!free_.empty()) {
+    slot = free_.back();
+    free_.pop_back();
+  } else {
+    slot = static_cast<std::uint32_t>(entries_.size());
+    entries_.emplace_back().gen = 1;
+  }
+  Entry &e = entries_[slot];
+  e.target = std::move(target);
+  e.seq = seq;
+  e.remaining = static_cast<std::uint32_t>(tasks);
+  e.failed = 0;
+  e.worst = 200;
+  // +1: до ближайшего шага может оставаться сколь угодно мало
+  e.expire = cursor_ + ticks_ + 1;
+  const std::uint64_t ticket = make_ticket(e.gen, slot);
+  wheel_[e.expire % wheel_.size()].push_back(ticket);
+  ++live_;
+  if (!armed_ && !stopped_) {
+    armed_ = true;
+    net::post(ex_, [this] { arm(); });
+  }
+  return ticket;
+}
+
+void AckHub::cancel(std::uint64_t ticket) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (find(ticket))
+    release(static_cast<std::uint32_t>(ticket));
+}
+
+void AckHub::notify(std::vector<std::uint64_t> tickets, int status,
+                    std::string error) {
+  g_ack_notices.fetch_add(1ULL, std::memory_order_relaxed);
+  net::post(ex_, [this, tickets = std::move(tickets), status,
+                  error = std::move(error)] {
+    complete(tickets, status, error);
+  });
+}
+
+void AckHub::complete(const std::vector<std::uint64_t> &tickets, int status,
+                      const std::string &error) {
+  std::vector<Done> done;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const std::uint64_t ticket : tickets) {
+      Entry *e = find(ticket);
+      if (!e)
+        continue; // уже ответили 202 по таймауту
+      if (status != 200) {
+        ++e->failed;
+        if (status > e->worst) {
+          e->worst = status;
+          e->error = error;
+        }
+      }
+      if (--e->remaining != 0)
+        continue;
+      done.push_back({std::move(e->target), e->seq, e->worst, e->failed,
+                      std::move(e->error)});
+      release(static_cast<std::uint32_t>(ticket));
+    }
+  }
+  // вне блокировки: сессия пишет ответ прямо здесь, если живёт в этом потоке
+  for (Done &d : done)
+    d.target->on_ack(d.seq, d.status, d.failed, d.error);
+}
+
+void AckHub::arm() {
+  timer_.expires_after(step_);
+  timer_.async_wait([this](const boost::system::error_code &ec) {
+    if (!ec)
+      on_tick();
+  });
+}
+
+void AckHub::on_tick() {
+  std::vector<Done> expired;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    ++cursor_;
+    auto &bucket = wheel_[cursor_ % wheel_.size()];
+    for (const std::uint64_t ticket : bucket) {
+      Entry *e = find(ticket);
+      if (!e || e->expire != cursor_)
+        continue; // ответили раньше, ячейка могла уйти другому запросу
+      expired.push_back({std::move(e->target), e->seq, 202, 0, {}});
+      release(static_cast<std::uint32_t>(ticket));
+    }
+    bucket.clear();
+    // без ожидающих запросов колесо стоит и не будит поток
+    armed_ = live_ > 0 && !stopped_;
+    if (armed_)
+      arm();
+  }
+  g_ack_timeouts.fetch_add(expired.size(), std::memory_order_relaxed);
+  for (Done &d : expired)
+    d.target->on_ack_timeout(d.seq);
+}
+
+void AckHub::stop() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopped_ = true;
+  }
+  net::post(ex_, [this] { timer_.cancel(); });
+}
+
+std::size_t AckHub::pending() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return live_;
+}
+
+void ack_batch(const std::vector<EnqueuedTask> &batch, int status,
+               const std::string &body) {
+  // хабов столько же, сколько io-потоков: хватает линейного поиска
+  std::vector<std::pair<AckHub *, std::vector<std::uint64_t>>> groups;
+  for (const auto &t : batch) {
+    if (t.reply)
+      t.reply->respond(status, body);
+    if (!t.ack_hub)
+      continue;
+    auto it = std::find_if(groups.begin(), groups.end(),
+                           [&](const auto &g) { return g.first == t.ack_hub; });
+    if (it == groups.end()) {
+      groups.emplace_back(t.ack_hub, std::vector<std::uint64_t>{});
+      it = std::prev(groups.end());
+    }
+    it->second.push_back(t.ack_ticket);
+  }
+  for (auto &[hub, tickets] : groups)
+    hub->notify(std::move(tickets), status,
+                status == 200 ? std::string{} : body);
+}
+
+} // namespace sensors
@@ -0,0 +1,236 @@
+#include "sensors/admission.hpp"
+#include "sensors/metrics_export.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace sensors {
+
+namespace {
+
+constexpr unsigned kChunkBits = 12;
+constexpr std::size_t kChunkSize = std::size_t{1} << kChunkBits;
+constexpr std::size_t kChunkMask = kChunkSize - 1;
+constexpr std::size_t kChunks = InternTable::kMaxSymbols / kChunkSize;
+
+// скорость разбора очереди пересчитывается не чаще раза в 100 мс
+constexpr std::int64_t kSampleNs = 100'000'000;
+constexpr double kDrainAlpha = 0.3;
+
+// остаток в bucket хранится в тысячных долях показания
+constexpr std::uint64_t kMilli = 1000;
+constexpr std::uint64_t kMaxMilli = 0xFFFFFFFFu;
+
+double uniform01() {
+  static thread_local std::mt19937_64 rng{std::random_device{}()};
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+int clamp_retry(double seconds, int max_s) {
+  if (!(seconds < max_s)) // и NaN/inf
+    return max_s;
+  return std::max(1, static_cast<int>(std::ceil(seconds)));
+}
+
+// порог считается от ёмкости одного шарда: у шардированной очереди
+// каждый шард принимает не больше queue_capacity / queue_shards
+double fill_base(const Config &cfg, std::size_t capacity) {
+  if (cfg.wal_enabled)
+    return static_cast<double>(cfg.wal_max_bytes);
+  if (cfg.queue_shards > 0)
+    return static_cast<double>(
+        std::max<std::size_t>(capacity / cfg.queue_shards, 1));
+  return static_cast<double>(capacity);
+}
+
+} // namespace
+
+struct AdmissionController::Chunk {
+  // старшие 32 бита — миллисекунда последнего пополнения (от epoch_ns_,
+  // со сдвигом на 1), младшие — остаток; 0 — датчик ещё не встречался
+  std::atomic<std::uint64_t> buckets[kChunkSize];
+};
+
+AdmissionController::AdmissionController(const Config &cfg,
+                                         std::size_t capacity)
+    : red_enabled_(cfg.admission_enabled), wal_(cfg.wal_enabled),
+      min_depth_(fill_base(cfg, capacity) * cfg.admission_min_fill),
+      max_depth_(fill_base(cfg, capacity) *
+                 std::max(cfg.admission_max_fill, cfg.admission_min_fill)),
+      retry_max_s_(std::max(1, cfg.admission_retry_after_max_s)),
+      default_rate_(cfg.sensor_rate_limit),
+      burst_s_(cfg.sensor_rate_burst_s > 0 ? cfg.sensor_rate_burst_s : 1.0),
+      epoch_ns_(mono_ns()), chunks_(new std::atomic<Chunk *>[kChunks]) {
+  for (std::size_t i = 0; i < kChunks; ++i)
+    chunks_[i].store(nullptr, std::memory_order_relaxed);
+  if (!wal_)
+    for (std::size_t i = 0; i < cfg.queue_shards; ++i)
+      shards_.push_back(&queue_shard_stats(i));
+  for (const auto &[id, rate] : cfg.sensor_rate_limits) {
+    const SymbolId s = g_symbols.intern(id);
+    if (s != kInvalidSymbol)
+      rates_[s] = rate;
+  }
+}
+
+AdmissionController::~AdmissionController() {
+  for (std::size_t i = 0; i < kChunks; ++i)
+    delete chunks_[i].load(std::memory_order_relaxed);
+}
+
+double AdmissionController::drop_probability(std::size_t depth) const noexcept {
+  const double d = static_cast<double>(depth);
+  if (d < min_depth_)
+    return 0.0;
+  if (d >= max_depth_)
+    return 1.0;
+  return (d - min_depth_) / (max_depth_ - min_depth_);
+}
+
+void AdmissionController::sample_drain(std::int64_t now_ns) {
+  std::int64_t last = sample_ns_.load(std::memory_order_relaxed);
+  if (last != 0 && now_ns - last < kSampleNs)
+    return;
+  if (!sample_ns_.compare_exchange_strong(last, now_ns,
+                                          std::memory_order_acq_rel))
+    return; // пересчитывает другой поток
+  const unsigned long long dequeued =
+      g_queue_dequeued.load(std::memory_order_relaxed);
+  const unsigned long long prev =
+      sample_dequeued_.exchange(dequeued, std::memory_order_relaxed);
+  unsigned long long items = 0, bytes = 0;
+  if (wal_) {
+    const unsigned long long appended =
+        g_wal_appended.load(std::memory_order_relaxed);
+    const unsigned long long written =
+        g_wal_written_bytes.load(std::memory_order_relaxed);
+    items = appended -
+            sample_appended_.exchange(appended, std::memory_order_relaxed);
+    bytes = written -
+            sample_written_.exchange(written, std::memory_order_relaxed);
+  }
+  if (last == 0)
+    return; // первая отметка
+  const double inst = static_cast<double>(dequeued - prev) * 1e9 /
+                      static_cast<double>(now_ns - last);
+  const double old = drain_rate_.load(std::memory_order_relaxed);
+  const double rate = old == 0 ? inst : old + kDrainAlpha * (inst - old);
+  drain_rate_.store(rate, std::memory_order_relaxed);
+  g_queue_drain_rate.store(static_cast<unsigned long long>(std::llround(rate)),
+                           std::memory_order_relaxed);
+
+  // байт журнала на показание; запись отстаёт от append на группу,
+  // поэтому только сглаженно
+  if (items > 0 && bytes > 0) {
+    const double b = static_cast<double>(bytes) / static_cast<double>(items);
+    const double was = bytes_per_item_.load(std::memory_order_relaxed);
+    bytes_per_item_.store(was == 0 ? b : was + kDrainAlpha * (b - was),
+                          std::memory_order_relaxed);
+  }
+}
+
+std::size_t AdmissionController::depth() const noexcept {
+  if (wal_)
+    return g_wal_bytes.load(std::memory_order_relaxed);
+  if (shards_.empty())
+    return g_queue_size.load(std::memory_order_relaxed);
+  // запрос ещё не разобран и шард его датчиков неизвестен — сбрасываем
+  // по самому заполненному: горячий датчик упирается в ёмкость своего
+  // шарда, пока общая очередь почти пуста
+  unsigned long long fill = 0;
+  for (const QueueShardStats *s : shards_)
+    fill = std::max(fill, s->depth.load(std::memory_order_relaxed));
+  return static_cast<std::size_t>(fill);
+}
+
+bool AdmissionController::shed(int &retry_after_s, std::int64_t now_ns) {
+  if (!red_enabled_)
+    return false;
+  sample_drain(now_ns);
+  const std::size_t d = depth();
+  const double p = drop_probability(d);
+  if (p <= 0.0 || (p < 1.0 && uniform01() >= p))
+    return false;
+  // за сколько воркеры вернут очередь (журнал) к порогу начала сброса
+  const double rate =
+      wal_ ? drain_rate() * bytes_per_item_.load(std::memory_order_relaxed)
+           : drain_rate();
+  retry_after_s =
+      clamp_retry(rate > 0 ? (static_cast<double>(d) - min_depth_) / rate
+                           : static_cast<double>(retry_max_s_),
+                  retry_max_s_);
+  g_admission_shed.fetch_add(1ULL, std::memory_order_relaxed);
+  return true;
+}
+
+double AdmissionController::rate_of(SymbolId sensor) const {
+  if (!rates_.empty()) {
+    const auto it = rates_.find(sensor);
+    if (it != rates_.end())
+      return it->second;
+  }
+  return default_rate_;
+}
+
+std::atomic<std::uint64_t> &AdmissionController::bucket(SymbolId sensor) {
+  std::atomic<Chunk *> &chunk = chunks_[sensor >> kChunkBits];
+  Chunk *c = chunk.load(std::memory_order_acquire);
+  if (!c) {
+    auto *fresh = new Chunk();
+    for (auto &b : fresh->buckets)
+      b.store(0, std::memory_order_relaxed);
+    if (chunk.compare_exchange_strong(c, fresh, std::memory_order_acq_rel))
+      c = fresh;
+    else
+      delete fresh;
+  }
+  return c->buckets[sensor & kChunkMask];
+}
+
+bool AdmissionController::allow(SymbolId sensor, int &retry_after_s,
+                                std::uint32_t n, std::int64_t now_ns) {
+  if (sensor == kInvalidSymbol || sensor >= InternTable::kMaxSymbols)
+    return true;
+  const double rate = rate_of(sensor);
+  if (rate <= 0)
+    return true; // без лимита
+
+  const std::uint64_t cap = std::min<std::uint64_t>(
+      kMaxMilli,
+      static_cast<std::uint64_t>(std::max(1.0, rate * burst_s_) * kMilli));
+  // пачка больше запаса целиком не пройдёт никогда — требуем полный запас
+  const std::uint64_t need = std::min<std::uint64_t>(std::uint64_t{n} * kMilli, cap);
+  const auto now_ms =
+      static_cast<std::uint32_t>((now_ns - epoch_ns_) / 1'000'000 + 1);
+
+  std::atomic<std::uint64_t> &b = bucket(sensor);
+  std::uint64_t cur = b.load(std::memory_order_relaxed);
+  for (;;) {
+    std::uint32_t stamp = now_ms;
+    std::uint64_t tokens = cap;
+    if (cur != 0) {
+      const auto last = static_cast<std::uint32_t>(cur >> 32);
+      tokens = cur & kMaxMilli;
+      // rate показаний в секунду — это rate тысячных за миллисекунду
+      const auto added = static_cast<std::uint64_t>(
+          static_cast<double>(static_cast<std::uint32_t>(now_ms - last)) * rate);
+      if (added == 0)
+        stamp = last; // дробное пополнение не теряем
+      tokens = std::min(cap, tokens + added);
+    }
+    if (tokens < need) {
+      retry_after_s = clamp_retry(
+          static_cast<double>(need - tokens) / (rate * kMilli), retry_max_s_);
+      g_admission_rate_limited.fetch_add(n, std::memory_order_relaxed);
+      return false;
+    }
+    const std::uint64_t next =
+        (std::uint64_t{stamp} << 32) | (tokens - need);
+    if (b.compare_exchange_weak(cur, next == 0 ? 1 : next,
+                                std::memory_order_relaxed))
+      return true;
+  }
+}
+
+} // namespace sensors
@@ -0,0 +1,203 @@
+#include "sensors/binary_protocol.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <boost/endian/conversion.hpp>
+
+namespace sensors::binproto {
+
+namespace {
+
+namespace endian = boost::endian;
+
+// Последовательное чтение из буфера с проверкой границ
+class Reader {
+public:
+  Reader(const std::uint8_t *p, std::size_t n) : p_(p), end_(p + n) {}
+
+  bool u8(std::uint8_t &v) {
+    if (left() < 1)
+      return false;
+    v = *p_++;
+    return true;
+  }
+  bool u16(std::uint16_t &v) {
+    if (left() < 2)
+      return false;
+    v = endian::load_little_u16(p_);
+    p_ += 2;
+    return true;
+  }
+  bool u32(std::uint32_t &v) {
+    if (left() < 4)
+      return false;
+    v = endian::load_little_u32(p_);
+    p_ += 4;
+    return true;
+  }
+  bool i64(std::int64_t &v) {
+    if (left() < 8)
+      return false;
+    v = endian::load_little_s64(p_);
+    p_ += 8;
+    return true;
+  }
+  bool f64(double &v) {
+    if (left() < 8)
+      return false;
+    v = std::bit_cast<double>(endian::load_little_u64(p_));
+    p_ += 8;
+    return true;
+  }
+  bool bytes(std::size_t n, const char *&out) {
+    if (left() < n)
+      return false;
+    out = reinterpret_cast<const char *>(p_);
+    p_ += n;
+    return true;
+  }
+  std::size_t left() const { return static_cast<std::size_t>(end_ - p_); }
+
+private:
+  const std::uint8_t *p_;
+  const std::uint8_t *end_;
+};
+
+void put_u16(std::vector<std::uint8_t> &out, std::uint16_t v) {
+  const auto at = out.size();
+  out.resize(at + 2);
+  endian::store_little_u16(out.data() + at, v);
+}
+
+void put_u32(std::vector<std::uint8_t> &out, std::uint32_t v) {
+  const auto at = out.size();
+  out.resize(at + 4);
+  endian::store_little_u32(out.data() + at, v);
+}
+
+void put_u64(std::vector<std::uint8_t> &out, std::uint64_t v) {
+  const auto at = out.size();
+  out.resize(at + 8);
+  endian::store_little_u64(out.data() + at, v);
+}
+
+} // namespace
+
+bool Decoder::decode(const std::uint8_t *data, std::size_t size,
+                     std::vector<EnqueuedTask> &out, std::uint32_t &seq,
+                     std::string &err) {
+  const std::size_t rollback = out.size();
+  auto fail = [&](const char *why) {
+    out.resize(rollback);
+    err = why;
+    return false;
+  };
+
+  Reader r(data, size);
+  std::uint8_t type = 0;
+  if (!r.u8(type) || type != kFrameReadings)
+    return fail("unexpected frame type");
+
+  std::uint16_t count = 0;
+  if (!r.u32(seq) || !r.u16(count))
+    return fail("truncated frame header");
+
+  auto read_sym = [&](SymbolId &sym) {
+    std::uint8_t tag = 0;
+    if (!r.u8(tag))
+      return false;
+    if (tag == kStrRef) {
+      std::uint16_t id = 0;
+      if (!r.u16(id) || id >= dict_.size())
+        return false;
+      sym = dict_[id];
+      return true;
+    }
+    if (tag != kStrInline)
+      return false;
+    std::uint16_t len = 0;
+    const char *p = nullptr;
+    if (!r.u16(len) || !r.bytes(len, p))
+      return false;
+    sym = g_symbols.intern(std::string_view(p, len));
+    if (sym == kInvalidSymbol)
+      return false;
+    if (dict_.size() < kMaxDictionary)
+      dict_.push_back(sym);
+    return true;
+  };
+
+  out.reserve(out.size() + count);
+  for (std::uint16_t i = 0; i < count; ++i) {
+    EnqueuedTask t;
+    std::uint16_t nkv = 0;
+    if (!read_sym(t.sensor) || !r.i64(t.ts) || !r.u16(nkv))
+      return fail("malformed reading");
+    t.kv.resize(nkv);
+    for (auto &kv : t.kv) {
+      if (!read_sym(kv.first) || !r.f64(kv.second))
+        return fail("malformed metric");
+    }
+    out.push_back(std::move(t));
+  }
+  if (r.left() != 0)
+    return fail("trailing bytes in frame");
+  return true;
+}
+
+void Encoder::put_str(SymbolId sym, std::vector<std::uint8_t> &out) {
+  if (auto it = ids_.find(sym); it != ids_.end()) {
+    out.push_back(kStrRef);
+    put_u16(out, it->second);
+    return;
+  }
+  // строки длиннее u16 обрезаются — так же их увидит и декодер
+  const std::string_view s = g_symbols.view(sym);
+  const auto len =
+      static_cast<std::uint16_t>(std::min<std::size_t>(s.size(), 0xFFFF));
+  out.push_back(kStrInline);
+  put_u16(out, len);
+  out.insert(out.end(), s.begin(), s.begin() + len);
+  if (next_id_ < kMaxDictionary)
+    ids_.emplace(sym, static_cast<std::uint16_t>(next_id_++));
+}
+
+void Encoder::encode(std::uint32_t seq, const std::vector<EnqueuedTask> &tasks,
+                     std::vector<std::uint8_t> &out) {
+  const std::size_t start = out.size();
+  put_u32(out, 0); // длину допишем в конце
+  out.push_back(kFrameReadings);
+  put_u32(out, seq);
+  put_u16(out, static_cast<std::uint16_t>(tasks.size()));
+  for (const auto &t : tasks) {
+    put_str(t.sensor, out);
+    put_u64(out, static_cast<std::uint64_t>(t.ts));
+    put_u16(out, static_cast<std::uint16_t>(t.kv.size()));
+    for (const auto &kv : t.kv) {
+      put_str(kv.first, out);
+      put_u64(out, std::bit_cast<std::uint64_t>(kv.second));
+    }
+  }
+  endian::store_little_u32(
+      out.data() + start,
+      static_cast<std::uint32_t>(out.size() - start - kLenPrefix));
+}
+
+void encode_ack(const Ack &ack, std::vector<std::uint8_t> &out) {
+  put_u32(out, static_cast<std::uint32_t>(kAckPayload));
+  out.push_back(kFrameAck);
+  put_u32(out, ack.last_seq);
+  put_u32(out, ack.frames);
+  put_u32(out, ack.accepted);
+  put_u32(out, ack.rejected);
+}
+
+bool decode_ack(const std::uint8_t *data, std::size_t size, Ack &ack) {
+  Reader r(data, size);
+  std::uint8_t type = 0;
+  return r.u8(type) && type == kFrameAck && r.u32(ack.last_seq) &&
+         r.u32(ack.frames) && r.u32(ack.accepted) && r.u32(ack.rejected) &&
+         r.left() == 0;
+}
+
+} // namespace sensors::binproto
@@ -0,0 +1,264 @@
+#include "sensors/binary_server.hpp"
+#include "sensors/binary_protocol.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/time_utils.hpp"
+
+#include <boost/endian/conversion.hpp>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace sensors {
+
+namespace {
+constexpr std::size_t kReadChunk = 64 * 1024;
+} // namespace
+
+struct BinaryIngestServer::Session
+    : public std::enable_shared_from_this<BinaryIngestServer::Session> {
+  // executor сокета — strand, созданный при accept
+  tcp::socket socket;
+  TaskQueue &queue;
+  WriteAheadLog *wal;
+  LatestCache *latest;
+  const Config &cfg;
+
+  std::vector<std::uint8_t> in; // накопленные, ещё не разобранные байты
+  std::size_t in_used{0};
+  binproto::Decoder decoder;
+  std::vector<EnqueuedTask> tasks;
+  std::string err;
+
+  binproto::Ack pending;         // итоги с момента последнего ACK
+  std::vector<std::uint8_t> out; // буфер исходящего ACK
+  bool writing{false};
+
+  // с журналом кадр засчитывается в ACK после fdatasync; итоги копятся
+  // здесь и уходят в pending строго в порядке кадров
+  struct InFlight {
+    std::uint32_t seq;
+    std::uint32_t n;
+    int status; // 0 — ждёт журнала, 202 — записан, иначе отклонён
+  };
+  std::deque<InFlight> inflight;
+  std::uint64_t inflight_base{0}; // номер кадра inflight.front()
+
+  Session(tcp::socket s, TaskQueue &q, WriteAheadLog *w, LatestCache *l,
+          const Config &c)
+      : socket(std::move(s)), queue(q), wal(w), latest(l), cfg(c) {}
+
+  void run() { read_more(); }
+
+  void read_more() {
+    if (in.size() - in_used < kReadChunk)
+      in.resize(in_used + kReadChunk);
+    auto self = shared_from_this();
+    socket.async_read_some(
+        net::buffer(in.data() + in_used, in.size() - in_used),
+        [self](const boost::system::error_code &ec, std::size_t n) {
+          if (ec) {
+            self->close();
+            return;
+          }
+          self->in_used += n;
+          self->consume();
+        });
+  }
+
+  void consume() {
+    std::size_t off = 0;
+    while (in_used - off >= binproto::kLenPrefix) {
+      const std::uint32_t len =
+          boost::endian::load_little_u32(in.data() + off);
+      if (len == 0 || len > cfg.bin_max_frame_bytes) {
+        g_bin_decode_errors.fetch_add(1ULL, std::memory_order_relaxed);
+        close(); // рассинхронизация потока — дальше читать бессмысленно
+        return;
+      }
+      if (in_used - off - binproto::kLenPrefix < len) {
+        // неполный кадр: гарантируем место под него целиком
+        if (in.size() < len + binproto::kLenPrefix + off)
+          in.resize(len + binproto::kLenPrefix + off);
+        break;
+      }
+      if (!handle_frame(in.data() + off + binproto::kLenPrefix, len))
+        return;
+      off += binproto::kLenPrefix + len;
+    }
+    if (off) {
+      std::memmove(in.data(), in.data() + off, in_used - off);
+      in_used -= off;
+    }
+    maybe_ack(in_used == 0);
+    read_more();
+  }
+
+  bool handle_frame(const std::uint8_t *p, std::size_t len) {
+    std::uint32_t seq = 0;
+    tasks.clear();
+    const std::int64_t parse_start = mono_ns();
+    const bool decoded = decoder.decode(p, len, tasks, seq, err);
+    const std::int64_t now = mono_ns();
+    g_lat_parse.observe_ns(now - parse_start);
+    if (!decoded) {
+      // словарь соединения мог разойтись с клиентским — закрываем
+      g_bin_decode_errors.fetch_add(1ULL, std::memory_order_relaxed);
+      close();
+      return false;
+    }
+    g_bin_frames.fetch_add(1ULL, std::memory_order_relaxed);
+
+    const auto n = static_cast<std::uint32_t>(tasks.size());
+    if (latest)
+      latest->update(tasks);
+    if (wal) {
+      append_to_wal(seq, n);
+      return true;
+    }
+    ++pending.frames;
+    pending.last_seq = seq;
+    const std::int64_t received = unix_now_s();
+    for (auto &t : tasks) {
+      t.enqueue_ns = now;
+      t.received_s = received;
+    }
+    if (queue.try_push_bulk(tasks)) {
+      pending.accepted += n;
+      g_queue_size.fetch_add(n, std::memory_order_relaxed);
+      g_bin_readings.fetch_add(n, std::memory_order_relaxed);
+    } else {
+      pending.rejected += n;
+      g_bin_rejected.fetch_add(n, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void append_to_wal(std::uint32_t seq, std::uint32_t n) {
+    const std::uint64_t frame = inflight_base + inflight.size();
+    inflight.push_back({seq, n, 0});
+    auto self = shared_from_this();
+    auto done = make_reply_handle([self, frame](int code, std::string) {
+      net::dispatch(self->socket.get_executor(), [self, frame, code] {
+        self->inflight[frame - self->inflight_base].status = code;
+        if (self->settle())
+          self->maybe_ack(self->in_used == 0);
+      });
+    });
+    if (!wal->append(tasks, std::move(done))) {
+      inflight.back().status = 503;
+      settle();
+    }
+  }
+
+  // переносит завершённые кадры из головы inflight в итоги ACK
+  bool settle() {
+    bool moved = false;
+    while (!inflight.empty() && inflight.front().status != 0) {
+      const InFlight &f = inflight.front();
+      ++pending.frames;
+      pending.last_seq = f.seq;
+      if (f.status == 202) {
+        pending.accepted += f.n;
+        g_bin_readings.fetch_add(f.n, std::memory_order_relaxed);
+      } else {
+        pending.rejected += f.n;
+        g_bin_rejected.fetch_add(f.n, std::memory_order_relaxed);
+      }
+      inflight.pop_front();
+      ++inflight_base;
+      moved = true;
+    }
+    return moved;
+  }
+
+  // ACK пачкой: раз в bin_ack_every кадров или когда входной буфер
+  // опустел (клиент, ждущий подтверждения, не зависнет)
+  void maybe_ack(bool drained) {
+    if (cfg.bin_ack_every == 0 || pending.frames == 0 || writing)
+      return;
+    if (pending.frames < cfg.bin_ack_every && !drained)
+      return;
+
+    out.clear();
+    binproto::encode_ack(pending, out);
+    pending = binproto::Ack{pending.last_seq, 0, 0, 0};
+    writing = true;
+
+    auto self = shared_from_this();
+    net::async_write(socket, net::buffer(out),
+                     [self](const boost::system::error_code &ec, std::size_t) {
+                       self->writing = false;
+                       if (ec) {
+                         self->close();
+                         return;
+                       }
+                       self->maybe_ack(self->in_used == 0);
+                     });
+  }
+
+  void close() {
+    boost::system::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+  }
+};
+
+BinaryIngestServer::BinaryIngestServer(net::io_context &ioc, const Config &cfg,
+                                       TaskQueue &queue, WriteAheadLog *wal,
+                                       LatestCache *latest)
+    : ioc_(ioc), cfg_(cfg), queue_(queue), wal_(wal), latest_(latest),
+      acceptor_(ioc) {
+  tcp::endpoint ep{net::ip::make_address(cfg_.host),
+                   static_cast<unsigned short>(cfg_.bin_port)};
+  boost::system::error_code ec;
+  acceptor_.open(ep.protocol(), ec);
+  if (!ec)
+    acceptor_.set_option(net::socket_base::reuse_address(true), ec);
+  if (!ec)
+    acceptor_.bind(ep, ec);
+  if (!ec)
+    acceptor_.listen(net::socket_base::max_listen_connections, ec);
+  if (ec) {
+    acceptor_.close(ec);
+  }
+}
+
+void BinaryIngestServer::run() {
+  if (!acceptor_.is_open())
+    throw std::runtime_error("binary listener: cannot listen on port " +
+                             std::to_string(cfg_.bin_port));
+  if (running_.exchange(true))
+    return;
+  do_accept();
+}
+
+void BinaryIngestServer::stop() {
+  if (!running_.exchange(false))
+    return;
+  boost::system::error_code ec;
+  acceptor_.close(ec);
+}
+
+void BinaryIngestServer::do_accept() {
+  acceptor_.async_accept(
+      net::make_strand(ioc_),
+      [this](const boost::system::error_code &ec, tcp::socket socket) {
+        if (!ec) {
+          boost::system::error_code opt_ec;
+          socket.set_option(tcp::no_delay(true), opt_ec);
+          std::make_shared<Session>(std::move(socket), queue_, wal_, latest_,
+                                    cfg_)
+              ->run();
+        }
+        if (running_)
+          do_accept();
+      });
+}
+
+} // namespace sensors
@@ -0,0 +1,189 @@
+#include "sensors/body_codec.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <lz4frame.h>
+#include <zstd.h>
+
+namespace sensors {
+
+namespace {
+
+// окно zstd не больше 8 МБ: клиентский кадр с огромным окном иначе
+// заставил бы сессию выделить до 128 МБ (умолчание библиотеки)
+constexpr int kZstdWindowLogMax = 23;
+
+bool iequals(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) ==
+                  std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+} // namespace
+
+ContentEncoding parse_content_encoding(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    value.remove_prefix(1);
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    value.remove_suffix(1);
+  if (value.empty() || iequals(value, "identity"))
+    return ContentEncoding::identity;
+  if (iequals(value, "zstd"))
+    return ContentEncoding::zstd;
+  if (iequals(value, "lz4"))
+    return ContentEncoding::lz4;
+  return ContentEncoding::unsupported;
+}
+
+std::unique_ptr<ZstdDictionary> ZstdDictionary::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("cannot open zstd dictionary " + path);
+  const std::vector<char> raw((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+  // id есть только у обученного словаря; сырые данные не принимаем,
+  // чтобы не подсунуть по ошибке посторонний файл
+  const unsigned id = ZSTD_getDictID_fromDict(raw.data(), raw.size());
+  if (id == 0)
+    throw std::runtime_error("not a zstd dictionary: " + path);
+  ZSTD_DDict *d = ZSTD_createDDict(raw.data(), raw.size());
+  if (!d)
+    throw std::runtime_error("cannot load zstd dictionary " + path);
+  return std::unique_ptr<ZstdDictionary>(new ZstdDictionary(d, id));
+}
+
+ZstdDictionary::~ZstdDictionary() { ZSTD_freeDDict(ddict_); }
+
+BodyDecoder::~BodyDecoder() {
+  ZSTD_freeDCtx(zstd_);
+  if (lz4_)
+    LZ4F_freeDecompressionContext(lz4_);
+}
+
+bool BodyDecoder::begin(ContentEncoding enc) {
+  enc_ = enc;
+  done_ = true;
+  switch (enc) {
+  case ContentEncoding::zstd:
+    if (!zstd_) {
+      zstd_ = ZSTD_createDCtx();
+      if (!zstd_)
+        return false;
+      ZSTD_DCtx_setParameter(zstd_, ZSTD_d_windowLogMax, kZstdWindowLogMax);
+      // кадры без словаря (dictID 0) распаковываются и со ссылкой на него
+      if (dict_)
+        ZSTD_DCtx_refDDict(zstd_, dict_->get());
+    } else {
+      // сброс сессии сохраняет параметры и словарь
+      ZSTD_DCtx_reset(zstd_, ZSTD_reset_session_only);
+    }
+    return true;
+  case ContentEncoding::lz4:
+    if (!lz4_)
+      return !LZ4F_isError(
+          LZ4F_createDecompressionContext(&lz4_, LZ4F_VERSION));
+    LZ4F_resetDecompressionContext(lz4_);
+    return true;
+  default:
+    return enc == ContentEncoding::identity;
+  }
+}
+
+bool BodyDecoder::step(std::string_view &in, char *out, std::size_t cap,
+                       std::size_t &produced) {
+  produced = 0;
+  std::size_t consumed = 0;
+  // 0 от библиотеки — кадр дочитан и выдан целиком; следующий вход
+  // начинает новый кадр (склеенные кадры допустимы)
+  std::size_t hint = 0;
+  if (enc_ == ContentEncoding::zstd && zstd_) {
+    ZSTD_inBuffer ib{in.data(), in.size(), 0};
+    ZSTD_outBuffer ob{out, cap, 0};
+    hint = ZSTD_decompressStream(zstd_, &ob, &ib);
+    if (ZSTD_isError(hint))
+      return false;
+    consumed = ib.pos;
+    produced = ob.pos;
+  } else if (enc_ == ContentEncoding::lz4 && lz4_) {
+    std::size_t dst = cap, src = in.size();
+    hint = LZ4F_decompress(lz4_, out, &dst, in.data(), &src, nullptr);
+    if (LZ4F_isError(hint))
+      return false;
+    consumed = src;
+    produced = dst;
+  } else {
+    return false;
+  }
+  in.remove_prefix(consumed);
+  // пустой вызов (дослив выхода без входа) состояние кадра не меняет
+  if (consumed || produced)
+    done_ = hint == 0;
+  return true;
+}
+
+BodyDecoder::Status BodyDecoder::decode(ContentEncoding enc,
+                                        std::string_view in, std::string &out,
+                                        std::size_t max_bytes) {
+  out.clear();
+  if (in.empty())
+    return Status::ok;
+  if (!begin(enc))
+    return Status::corrupt;
+
+  // размер из заголовка кадра zstd: заведомо большое тело отклоняем
+  // до распаковки, известный размер — сразу точный буфер
+  std::size_t guess = in.size() * 4;
+  if (enc == ContentEncoding::zstd) {
+    const auto declared = ZSTD_getFrameContentSize(in.data(), in.size());
+    if (declared != ZSTD_CONTENTSIZE_UNKNOWN &&
+        declared != ZSTD_CONTENTSIZE_ERROR) {
+      if (declared > max_bytes)
+        return Status::too_large;
+      guess = static_cast<std::size_t>(declared) + 1;
+    }
+  }
+  // +1 байт сверх лимита: так превышение видно без лишнего прохода
+  out.resize(std::min(max_bytes + 1, std::max<std::size_t>(guess, 4096)));
+
+  std::size_t len = 0;
+  while (true) {
+    if (len == out.size()) {
+      if (len > max_bytes)
+        break;
+      out.resize(std::min(max_bytes + 1, out.size() * 2));
+    }
+    const std::size_t before = in.size();
+    std::size_t produced = 0;
+    if (!step(in, out.data() + len, out.size() - len, produced)) {
+      out.clear();
+      return Status::corrupt;
+    }
+    len += produced;
+    // вход кончился и выход не упёрся в буфер — контекст выдал всё
+    if (in.empty() && len < out.size())
+      break;
+    if (produced == 0 && in.size() == before) {
+      out.clear();
+      return Status::corrupt;
+    }
+  }
+  if (len > max_bytes) {
+    out.clear();
+    return Status::too_large;
+  }
+  out.resize(len);
+  if (!done_) {
+    out.clear();
+    return Status::corrupt; // тело оборвано посреди кадра
+  }
+  return Status::ok;
+}
+
+} // namespace sensors
@@ -0,0 +1,159 @@
+#include "sensors/ch_block.hpp"
+#include "sensors/time_utils.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace sensors {
+
+namespace {
+
+// StrColumn — ColumnString или ColumnLowCardinalityT<ColumnString>
+template <class StrColumn>
+clickhouse::Block build_block(const std::vector<EnqueuedTask> &batch) {
+  using namespace clickhouse;
+  auto col_sensor = std::make_shared<StrColumn>();
+  auto col_ts = std::make_shared<ColumnDateTime>(); // секунды (UTC)
+  auto col_key = std::make_shared<StrColumn>();
+  auto col_value = std::make_shared<ColumnFloat64>();
+
+  for (const auto &t : batch) {
+    const auto ts = to_time_t_seconds(static_cast<int64_t>(t.ts));
+    const std::string_view sensor = g_symbols.view(t.sensor);
+    for (const auto &kv : t.kv) {
+      col_sensor->Append(sensor);
+      col_ts->Append(ts);
+      col_key->Append(g_symbols.view(kv.first));
+      col_value->Append(kv.second);
+    }
+  }
+
+  Block block;
+  block.AppendColumn("sensor_id", col_sensor);
+  block.AppendColumn("ts", col_ts);
+  block.AppendColumn("key", col_key);
+  block.AppendColumn("value", col_value);
+  return block;
+}
+
+template <class StrColumn>
+clickhouse::Block build_rollup(const std::vector<RollupBuffer::Row> &rows) {
+  using namespace clickhouse;
+  auto col_sensor = std::make_shared<StrColumn>();
+  auto col_ts = std::make_shared<ColumnDateTime>();
+  auto col_key = std::make_shared<StrColumn>();
+  auto col_count = std::make_shared<ColumnUInt64>();
+  auto col_min = std::make_shared<ColumnFloat64>();
+  auto col_max = std::make_shared<ColumnFloat64>();
+  auto col_sum = std::make_shared<ColumnFloat64>();
+  auto col_last = std::make_shared<ColumnFloat64>();
+  auto col_last_ts = std::make_shared<ColumnDateTime>();
+
+  for (const auto &r : rows) {
+    col_sensor->Append(g_symbols.view(r.sensor));
+    col_ts->Append(static_cast<std::time_t>(r.start));
+    col_key->Append(g_symbols.view(r.key));
+    col_count->Append(r.count);
+    col_min->Append(r.min);
+    col_max->Append(r.max);
+    col_sum->Append(r.sum);
+    col_last->Append(r.last);
+    col_last_ts->Append(static_cast<std::time_t>(r.last_ts));
+  }
+
+  Block block;
+  block.AppendColumn("sensor_id", col_sensor);
+  block.AppendColumn("ts", col_ts);
+  block.AppendColumn("key", col_key);
+  block.AppendColumn("count", col_count);
+  block.AppendColumn("min", col_min);
+  block.AppendColumn("max", col_max);
+  block.AppendColumn("sum", col_sum);
+  block.AppendColumn("last", col_last);
+  block.AppendColumn("last_ts", col_last_ts);
+  return block;
+}
+
+} // namespace
+
+clickhouse::Block build_insert_block(const std::vector<EnqueuedTask> &batch,
+                                     bool low_cardinality) {
+  if (low_cardinality)
+    return build_block<clickhouse::ColumnLowCardinalityT<clickhouse::ColumnString>>(
+        batch);
+  return build_block<clickhouse::ColumnString>(batch);
+}
+
+InsertBuilder::InsertBuilder(bool low_cardinality)
+    : ts_(std::make_shared<clickhouse::ColumnDateTime>()),
+      value_(std::make_shared<clickhouse::ColumnFloat64>()) {
+  clickhouse::ColumnRef sensor, key;
+  if (low_cardinality) {
+    sensor = lc_sensor_ = std::make_shared<LcString>();
+    key = lc_key_ = std::make_shared<LcString>();
+  } else {
+    sensor = sensor_ = std::make_shared<clickhouse::ColumnString>();
+    key = key_ = std::make_shared<clickhouse::ColumnString>();
+  }
+  block_.AppendColumn("sensor_id", sensor);
+  block_.AppendColumn("ts", ts_);
+  block_.AppendColumn("key", key);
+  block_.AppendColumn("value", value_);
+}
+
+template <class StrColumn>
+void InsertBuilder::fill(StrColumn &sensor, StrColumn &key,
+                         const std::vector<EnqueuedTask> &batch) {
+  sensor.Clear();
+  key.Clear();
+  ts_->Clear();
+  value_->Clear();
+
+  raw_ts_.resize(batch.size());
+  ts_s_.resize(batch.size());
+  std::size_t rows = 0;
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    raw_ts_[i] = batch[i].ts;
+    rows += batch[i].kv.size();
+  }
+  normalize_ts(raw_ts_.data(), ts_s_.data(), batch.size());
+
+  if (rows > reserved_rows_) {
+    sensor.Reserve(rows);
+    key.Reserve(rows);
+    ts_->Reserve(rows);
+    value_->Reserve(rows);
+    reserved_rows_ = rows;
+  }
+
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    const auto ts = static_cast<std::time_t>(ts_s_[i]);
+    const std::string_view s = g_symbols.view(batch[i].sensor);
+    for (const auto &kv : batch[i].kv) {
+      sensor.Append(s);
+      ts_->Append(ts);
+      key.Append(g_symbols.view(kv.first));
+      value_->Append(kv.second);
+    }
+  }
+}
+
+const clickhouse::Block &
+InsertBuilder::build(const std::vector<EnqueuedTask> &batch) {
+  if (lc_sensor_)
+    fill(*lc_sensor_, *lc_key_, batch);
+  else
+    fill(*sensor_, *key_, batch);
+  block_.RefreshRowCount();
+  return block_;
+}
+
+clickhouse::Block build_rollup_block(const std::vector<RollupBuffer::Row> &rows,
+                                     bool low_cardinality) {
+  if (low_cardinality)
+    return build_rollup<
+        clickhouse::ColumnLowCardinalityT<clickhouse::ColumnString>>(rows);
+  return build_rollup<clickhouse::ColumnString>(rows);
+}
+
+} // namespace sensors
@@ -0,0 +1,266 @@
+#include "sensors/ch_endpoints.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace sensors {
+
+namespace {
+
+// близость к лучшему узлу считается с запасом: доли миллисекунды между
+// ping соседних реплик не повод сгонять всех воркеров на одну
+constexpr double kSlackNs = 1e6;
+// сглаживание времени вставки и ping
+constexpr double kInsertAlpha = 0.2;
+constexpr double kProbeAlpha = 0.3;
+// шаг, с которым оценка простаивающего узла тянется к лучшей
+constexpr double kIdleAlpha = 0.2;
+
+ChEndpoint parse_endpoint(const std::string &s, int default_port,
+                          std::size_t shard) {
+  ChEndpoint ep;
+  ep.shard = shard;
+  std::string_view host = s;
+  std::string_view port;
+  // [::1]:9000 — IPv6 в скобках
+  if (!host.empty() && host.front() == '[') {
+    const auto close = host.find(']');
+    if (close != std::string_view::npos) {
+      port = host.substr(close + 1);
+      host = host.substr(1, close - 1);
+      if (!port.empty() && port.front() == ':')
+        port.remove_prefix(1);
+      else if (!port.empty())
+        host = {};
+    }
+  } else if (const auto colon = host.rfind(':');
+             colon != std::string_view::npos) {
+    port = host.substr(colon + 1);
+    host = host.substr(0, colon);
+  }
+  int p = default_port;
+  if (!port.empty()) {
+    const auto [end, ec] =
+        std::from_chars(port.data(), port.data() + port.size(), p);
+    if (ec != std::errc{} || end != port.data() + port.size())
+      p = -1;
+  }
+  if (host.empty() || p <= 0 || p > 65535)
+    throw std::invalid_argument("bad ClickHouse endpoint '" + s + "'");
+  ep.host = std::string(host);
+  ep.port = static_cast<std::uint16_t>(p);
+  return ep;
+}
+
+} // namespace
+
+std::vector<ChEndpoint> ch_endpoints_from_config(const Config &cfg) {
+  std::vector<ChEndpoint> out;
+  if (cfg.ch_routing == "sharded") {
+    if (cfg.ch_shards.empty())
+      throw std::invalid_argument("ch_routing \"sharded\" needs ch_shards");
+    for (std::size_t s = 0; s < cfg.ch_shards.size(); ++s) {
+      if (cfg.ch_shards[s].empty())
+        throw std::invalid_argument("ch_shards[" + std::to_string(s) +
+                                    "] has no replicas");
+      for (const auto &addr : cfg.ch_shards[s])
+        out.push_back(parse_endpoint(addr, cfg.ch_port, s));
+    }
+  } else if (cfg.ch_routing == "failover") {
+    if (cfg.ch_endpoints.empty())
+      out.push_back(parse_endpoint(cfg.ch_host, cfg.ch_port, 0));
+    for (const auto &addr : cfg.ch_endpoints)
+      out.push_back(parse_endpoint(addr, cfg.ch_port, 0));
+  } else {
+    throw std::invalid_argument("unknown ch_routing '" + cfg.ch_routing + "'");
+  }
+  return out;
+}
+
+std::size_t ch_shard_of(std::string_view sensor_id, std::size_t shards) {
+  std::uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a
+  for (const char c : sensor_id) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001B3ULL;
+  }
+  return shards > 1 ? static_cast<std::size_t>(h % shards) : 0;
+}
+
+ChEndpointSet::ChEndpointSet(std::vector<ChEndpoint> endpoints) {
+  for (std::size_t i = 0; i < endpoints.size(); ++i) {
+    auto &stats =
+        register_ch_endpoint(i, endpoints[i].name(), endpoints[i].shard);
+    stats.up.store(1, std::memory_order_relaxed);
+    const std::size_t shard = endpoints[i].shard;
+    nodes_.push_back(
+        std::unique_ptr<Node>(new Node{std::move(endpoints[i]), stats}));
+    if (shards_.size() <= shard)
+      shards_.resize(shard + 1);
+    shards_[shard].push_back(i);
+  }
+}
+
+double ChEndpointSet::known_insert_ns(std::size_t shard,
+                                      const Node *except) const {
+  double best = 0;
+  for (const std::size_t i : shards_[shard]) {
+    const Node &n = *nodes_[i];
+    if (&n != except && n.up && n.insert_ns > 0 &&
+        (best == 0 || n.insert_ns < best))
+      best = n.insert_ns;
+  }
+  return best;
+}
+
+double ChEndpointSet::score(const Node &n) const {
+  if (n.insert_ns > 0)
+    return n.insert_ns;
+  const double known = known_insert_ns(n.ep.shard, &n);
+  return known > 0 ? known : n.probe_ns;
+}
+
+double ChEndpointSet::best_score(std::size_t shard) const {
+  double best = -1;
+  for (const std::size_t i : shards_[shard]) {
+    const Node &n = *nodes_[i];
+    if (n.up && (best < 0 || score(n) < best))
+      best = score(n);
+  }
+  return best;
+}
+
+std::size_t ChEndpointSet::pick_locked(std::size_t shard,
+                                       std::size_t worker) const {
+  const double best = best_score(shard);
+  if (best < 0)
+    return npos;
+  auto near = [&](const Node &n) {
+    return n.up && score(n) <= best * kNearFactor + kSlackNs;
+  };
+  const auto count = static_cast<std::size_t>(
+      std::count_if(shards_[shard].begin(), shards_[shard].end(),
+                    [&](std::size_t i) { return near(*nodes_[i]); }));
+  std::size_t k = worker % count; // лучший узел всегда среди близких
+  for (const std::size_t i : shards_[shard])
+    if (near(*nodes_[i]) && k-- == 0)
+      return i;
+  return npos;
+}
+
+std::size_t ChEndpointSet::pick(std::size_t shard, std::size_t worker) const {
+  std::lock_guard<std::mutex> lk(m_);
+  return pick_locked(shard, worker);
+}
+
+bool ChEndpointSet::should_leave(std::size_t i, std::size_t worker) const {
+  std::lock_guard<std::mutex> lk(m_);
+  const Node &n = *nodes_[i];
+  if (!n.up)
+    return true;
+  const double best = best_score(n.ep.shard);
+  const double s = score(n);
+  if (s > best * kLeaveFactor + kSlackNs)
+    return true;
+  // между kNearFactor и kLeaveFactor воркер остаётся где был: без этого
+  // оценки у границы гоняли бы его туда-обратно
+  if (s > best * kNearFactor + kSlackNs)
+    return false;
+  return pick_locked(n.ep.shard, worker) != i;
+}
+
+bool ChEndpointSet::healthy(std::size_t i) const {
+  std::lock_guard<std::mutex> lk(m_);
+  return nodes_[i]->up;
+}
+
+bool ChEndpointSet::wait_healthy(std::size_t shard,
+                                 std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lk(m_);
+  auto any_up = [&] {
+    return std::any_of(shards_[shard].begin(), shards_[shard].end(),
+                       [&](std::size_t i) { return nodes_[i]->up; });
+  };
+  const std::uint64_t gen = wake_gen_;
+  cv_.wait_for(lk, timeout, [&] { return wake_gen_ != gen || any_up(); });
+  return any_up();
+}
+
+void ChEndpointSet::wake_all() {
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    ++wake_gen_;
+  }
+  cv_.notify_all();
+}
+
+void ChEndpointSet::on_insert(std::size_t i, std::int64_t ns,
+                              std::size_t rows) {
+  std::lock_guard<std::mutex> lk(m_);
+  Node &n = *nodes_[i];
+  const double v = static_cast<double>(ns > 0 ? ns : 1);
+  n.insert_ns = n.insert_ns > 0 ? n.insert_ns + kInsertAlpha * (v - n.insert_ns)
+                                : v;
+  n.inserted = true;
+  n.stats.inserts.fetch_add(1ULL, std::memory_order_relaxed);
+  n.stats.rows.fetch_add(rows, std::memory_order_relaxed);
+  n.stats.insert_latency.observe_ns(ns);
+  publish(n);
+}
+
+void ChEndpointSet::on_failure(std::size_t i, bool down) {
+  std::lock_guard<std::mutex> lk(m_);
+  Node &n = *nodes_[i];
+  n.stats.errors.fetch_add(1ULL, std::memory_order_relaxed);
+  if (down) {
+    n.up = false;
+    n.rise = 0;
+  }
+  publish(n);
+}
+
+void ChEndpointSet::on_probe(std::size_t i, bool ok, std::int64_t ns) {
+  bool recovered = false;
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    Node &n = *nodes_[i];
+    if (!ok) {
+      n.stats.probe_failures.fetch_add(1ULL, std::memory_order_relaxed);
+      n.up = false;
+      n.rise = 0;
+      publish(n);
+      return;
+    }
+    const double v = static_cast<double>(ns > 0 ? ns : 1);
+    n.probe_ns = n.probe_ns > 0 ? n.probe_ns + kProbeAlpha * (v - n.probe_ns)
+                                : v;
+    if (!n.inserted && n.insert_ns > 0) {
+      const double known = known_insert_ns(n.ep.shard, &n);
+      if (known > 0 && known < n.insert_ns)
+        n.insert_ns += kIdleAlpha * (known - n.insert_ns);
+    }
+    n.inserted = false;
+    if (!n.up && ++n.rise >= kRise) {
+      n.up = true;
+      n.rise = 0;
+      recovered = true;
+    }
+    publish(n);
+  }
+  if (recovered)
+    cv_.notify_all();
+}
+
+void ChEndpointSet::publish(Node &n) const {
+  // оценка зависит от соседей по шарду — обновляем весь шард
+  for (const std::size_t i : shards_[n.ep.shard]) {
+    Node &m = *nodes_[i];
+    m.stats.up.store(m.up ? 1 : 0, std::memory_order_relaxed);
+    m.stats.score_us.store(
+        static_cast<unsigned long long>(score(m) / 1000),
+        std::memory_order_relaxed);
+  }
+}
+
+} // namespace sensors
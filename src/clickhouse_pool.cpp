@@ -1,22 +1,30 @@
 #include "sensors/clickhouse_pool.hpp"
-#include "sensors/redis_client.hpp"
-#include "sensors/time_utils.hpp"
+#include "sensors/ack_hub.hpp"
+#include "sensors/ch_block.hpp"
+#include "sensors/io_context_pool.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/sharded_queue.hpp"
 
 
+#include <algorithm>
 #include <atomic> // добавлено для метрик
 #include <boost/thread.hpp>
 #include <chrono>
 #include <clickhouse/client.h>
 #include <cstdint>
 #include <cstdio>
+#include <condition_variable>
+#include <deque>
 #include <exception>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 using namespace clickhouse;
-using sensors::to_time_t_seconds;
 
 namespace sensors {
 
@@ -37,6 +45,9 @@ inline void log_dbg(const char *tag, const std::string &msg) {
   std::fflush(stderr);
 }
 
+// сколько задач за раз забираем из очереди при сборке батча
+constexpr std::size_t kDrainChunk = 256;
+
 inline void sleep_with_checks(std::atomic_bool &running,
                               std::chrono::milliseconds dur) {
   const auto step = std::chrono::milliseconds(100);
@@ -47,11 +58,159 @@ inline void sleep_with_checks(std::atomic_bool &running,
   }
 }
 
+// Грубая оценка объёма задачи в native-формате: строки с varint-длиной,
+// DateTime (4 байта) и Float64 (8 байт) на каждую пару key/value
+inline std::size_t estimate_task_bytes(const EnqueuedTask &t) {
+  const std::size_t sensor = g_symbols.view(t.sensor).size();
+  std::size_t bytes = 0;
+  for (const auto &kv : t.kv)
+    bytes += sensor + g_symbols.view(kv.first).size() + 2 + 4 + 8;
+  return bytes;
+}
+
+// настройки клиента для узла; probe — соединение проверки здоровья,
+// ему и ответ ждать не дольше ch_connect_timeout_ms, соединению вставки —
+// не дольше ch_insert_timeout_ms
+ClientOptions client_options(const Config &cfg, const ChEndpoint &ep,
+                             bool probe) {
+  const std::chrono::milliseconds timeout(
+      std::max(1, cfg.ch_connect_timeout_ms));
+  ClientOptions opts;
+  opts.SetHost(ep.host)
+      .SetPort(ep.port)
+      .SetDefaultDatabase(cfg.ch_database)
+      .SetConnectionConnectTimeout(timeout);
+  if (probe)
+    opts.SetConnectionRecvTimeout(timeout).SetConnectionSendTimeout(timeout);
+  else if (cfg.ch_insert_timeout_ms > 0)
+    opts.SetConnectionRecvTimeout(
+            std::chrono::milliseconds(cfg.ch_insert_timeout_ms))
+        .SetConnectionSendTimeout(
+            std::chrono::milliseconds(cfg.ch_insert_timeout_ms));
+
+  if (!cfg.ch_user.empty())
+    opts.SetUser(cfg.ch_user);
+  if (!cfg.ch_password.empty())
+    opts.SetPassword(cfg.ch_password);
+  return opts;
+}
+
+// ключи идемпотентности задач батча: после вставки повтор отклоняется,
+// после ошибки — должен пройти
+void settle_keys(DedupFilter *dedup, const std::vector<EnqueuedTask> &batch,
+                 bool inserted) {
+  if (!dedup)
+    return;
+  for (const auto &t : batch) {
+    if (!t.dedup_key)
+      continue;
+    if (inserted)
+      dedup->commit(t.dedup_key);
+    else
+      dedup->forget(t.dedup_key);
+  }
+}
+
+// соединение воркера с узлом шарда ClickHouse и часть батча для него
+struct Lane {
+  Lane(std::size_t s, bool low_cardinality)
+      : shard(s), builder(low_cardinality) {}
+
+  std::size_t shard;
+  std::size_t node{ChEndpointSet::npos};
+  std::unique_ptr<Client> client;
+  // колонки Block'а переиспользуются всеми вставками полосы
+  InsertBuilder builder;
+  std::vector<EnqueuedTask> batch;
+  bool backoff{false}; // сервер отверг вставку — повтор не сразу
+  int rejected{0};     // отказов сервера подряд для текущей части батча
+};
+
+// Постоянные потоки вставки полос 1..n-1 одного воркера: run() раздаёт
+// им непустые полосы, полосу 0 вставляет в своём потоке и ждёт остальных.
+// Без шардов (одна полоса) потоков нет
+class LaneFlushers {
+public:
+  LaneFlushers(std::size_t lanes, std::function<void(std::size_t)> flush)
+      : flush_(std::move(flush)), go_(lanes, 0) {
+    for (std::size_t s = 1; s < lanes; ++s)
+      threads_.push_back(
+          std::make_unique<boost::thread>([this, s] { loop(s); }));
+  }
+
+  ~LaneFlushers() {
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      quit_ = true;
+    }
+    cv_.notify_all();
+    for (auto &t : threads_)
+      t->join();
+  }
+
+  LaneFlushers(const LaneFlushers &) = delete;
+  LaneFlushers &operator=(const LaneFlushers &) = delete;
+
+  // has_work(s) — в полосе s есть что вставить
+  template <class F> void run(F has_work) {
+    std::size_t n = 0;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      for (std::size_t s = 1; s < go_.size(); ++s) {
+        if (has_work(s)) {
+          go_[s] = 1;
+          ++n;
+        }
+      }
+      busy_ = n;
+    }
+    if (n)
+      cv_.notify_all();
+    if (has_work(0))
+      flush_(0);
+    if (n) {
+      std::unique_lock<std::mutex> lk(m_);
+      cv_.wait(lk, [this] { return busy_ == 0; });
+    }
+  }
+
+private:
+  void loop(std::size_t s) {
+    std::unique_lock<std::mutex> lk(m_);
+    for (;;) {
+      cv_.wait(lk, [&] { return quit_ || go_[s]; });
+      if (quit_)
+        return;
+      lk.unlock();
+      try {
+        flush_(s);
+      } catch (const std::exception &e) {
+        log_err("ERR", std::string("ClickHouse lane flush: ") + e.what());
+      }
+      lk.lock();
+      go_[s] = 0;
+      if (--busy_ == 0)
+        cv_.notify_all();
+    }
+  }
+
+  const std::function<void(std::size_t)> flush_;
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::vector<char> go_; // полосе есть что вставить в текущем раунде
+  std::size_t busy_{0};  // потоков ещё вставляют
+  bool quit_{false};
+  std::vector<std::unique_ptr<boost::thread>> threads_;
+};
+
 } // namespace
 
-ClickHousePool::ClickHousePool(const Config &cfg,
-                               ThreadSafeQueue<EnqueuedTask> &q)
-    : cfg_(cfg), queue_(q) {}
+ClickHousePool::ClickHousePool(const Config &cfg, TaskQueue &q,
+                               RedisWriter *redis, WriteAheadLog *wal,
+                               RollupWriter *rollup, DedupFilter *dedup)
+    : cfg_(cfg), queue_(q), redis_(redis), wal_(wal),
+      rollup_(rollup), dedup_(dedup),
+      endpoints_(ch_endpoints_from_config(cfg)) {}
 
 ClickHousePool::~ClickHousePool() { stop(); }
 
@@ -63,9 +222,13 @@ void ClickHousePool::start() {
   workers_.reserve(n);
 
   for (std::size_t i = 0; i < n; ++i) {
-    workers_.emplace_back(std::make_unique<boost::thread>([this] {
+    workers_.emplace_back(std::make_unique<boost::thread>([this, i] {
+      const int cpu = affinity_cpu(cfg_.ch_cpu_affinity, i);
+      if (cpu >= 0 && !pin_current_thread(cpu))
+        log_err("WARN", "ClickHouse worker " + std::to_string(i) +
+                            ": failed to pin to cpu " + std::to_string(cpu));
       try {
-        worker_loop();
+        worker_loop(i);
       } catch (const std::exception &e) {
         log_err("ERR", std::string("ClickHouse worker fatal: ") + e.what());
       } catch (...) {
@@ -73,6 +236,7 @@ void ClickHousePool::start() {
       }
     }));
   }
+  health_ = std::make_unique<boost::thread>([this] { health_loop(); });
 }
 
 void ClickHousePool::stop() {
@@ -80,134 +244,291 @@ void ClickHousePool::stop() {
     return;
 
   queue_.stop();
+  endpoints_.wake_all(); // воркеры, ждущие живой узел
 
   for (auto &w : workers_) {
     if (w && w->joinable())
       w->join();
   }
   workers_.clear();
+  if (health_ && health_->joinable())
+    health_->join();
+  health_.reset();
 }
 
-void ClickHousePool::worker_loop() {
-  if (cfg_.ch_port < 0 || cfg_.ch_port > 65535) {
-    throw std::runtime_error("ClickHouse port is out of range (0..65535)");
+void ClickHousePool::health_loop() {
+  const std::chrono::milliseconds interval(
+      std::max(100, cfg_.ch_health_interval_ms));
+  std::vector<std::unique_ptr<Client>> clients(endpoints_.size());
+  while (running_) {
+    for (std::size_t i = 0; i < clients.size() && running_; ++i) {
+      const bool was_up = endpoints_.healthy(i);
+      const std::int64_t start = mono_ns();
+      bool ok = true;
+      try {
+        if (!clients[i])
+          clients[i] = std::make_unique<Client>(
+              client_options(cfg_, endpoints_.endpoint(i), true));
+        clients[i]->Ping();
+      } catch (const std::exception &) {
+        clients[i].reset();
+        ok = false;
+      }
+      endpoints_.on_probe(i, ok, mono_ns() - start);
+      if (was_up != endpoints_.healthy(i))
+        log_dbg("CH", "endpoint " + endpoints_.endpoint(i).name() +
+                          (was_up ? " is down" : " is up again"));
+    }
+    sleep_with_checks(running_, interval);
   }
+}
 
+void ClickHousePool::worker_loop(std::size_t index) {
   const std::string table = cfg_.ch_table;
-  const std::chrono::milliseconds connect_retry_delay(3000);
-
-  while (running_) {
-    try {
-      ClientOptions opts;
-      opts.SetHost(cfg_.ch_host)
-          .SetPort(static_cast<uint16_t>(cfg_.ch_port))
-          .SetDefaultDatabase(cfg_.ch_database);
-
-      if (!cfg_.ch_user.empty())
-        opts.SetUser(cfg_.ch_user);
-      if (!cfg_.ch_password.empty())
-        opts.SetPassword(cfg_.ch_password);
-
-      Client client(opts);
-
-      // Ранний ping
+  const std::size_t max_rows = cfg_.ch_batch_max_rows ? cfg_.ch_batch_max_rows : 1;
+  const std::size_t max_bytes =
+      cfg_.ch_batch_max_bytes ? cfg_.ch_batch_max_bytes : 1;
+  const std::chrono::milliseconds linger(
+      cfg_.ch_batch_linger_ms > 0 ? cfg_.ch_batch_linger_ms : 0);
+  // пауза перед повтором, если узел жив, но вставку отверг, и предел
+  // ожидания живого узла (его возвращает проверка здоровья — будит раньше)
+  const std::chrono::milliseconds retry_delay(
+      std::max(100, cfg_.ch_health_interval_ms));
+
+  // По полосе на шард ClickHouse (в режиме failover — одна): своё
+  // соединение, свои колонки Block'а и своя часть батча. Часть батча
+  // живёт между итерациями: задачи из журнала после ошибки вставки не
+  // отвечаются 500 и не теряются, а вставляются первыми, на другом узле,
+  // если этот выключен
+  std::deque<Lane> lanes;
+  for (std::size_t s = 0; s < endpoints_.shards(); ++s)
+    lanes.emplace_back(s, cfg_.ch_low_cardinality);
+  std::vector<EnqueuedTask> batch;
+  ChWorkerStats &stats = ch_worker_stats(index);
+
+  // задача извлечена воркером: отметка и время ожидания в очереди
+  auto mark_dequeued = [](EnqueuedTask &t, std::int64_t now) {
+    t.dequeue_ns = now;
+    if (t.enqueue_ns)
+      g_lat_queue_wait.observe_ns(now - t.enqueue_ns);
+  };
+
+  // Шардированная очередь: шард захватывается вместе с первой задачей,
+  // батч добирается только из него и отпускается после INSERT — так
+  // показания одного датчика не обгоняют друг друга между воркерами.
+  // При ошибке вставки с журналом шард остаётся захваченным до повтора.
+  auto *sharded = dynamic_cast<ShardedTaskQueue *>(&queue_);
+  std::size_t shard = ShardedTaskQueue::npos;
+  auto take_first = [&]() -> bool {
+    if (!sharded) {
+      auto item = queue_.pop();
+      if (!item)
+        return false;
+      batch.push_back(std::move(*item));
+      return true;
+    }
+    shard = sharded->acquire(index, batch, kDrainChunk,
+                             std::chrono::milliseconds(100));
+    return shard != ShardedTaskQueue::npos;
+  };
+  auto take_more = [&]() -> std::size_t {
+    return sharded ? sharded->pop_bulk_from(shard, batch, kDrainChunk)
+                   : queue_.pop_bulk(batch, kDrainChunk);
+  };
+  auto take_wait = [&](std::chrono::milliseconds left) -> bool {
+    if (sharded)
+      return sharded->pop_for_from(shard, batch, kDrainChunk, left) > 0;
+    auto next = queue_.pop_for(left);
+    if (!next)
+      return false;
+    batch.push_back(std::move(*next));
+    return true;
+  };
+
+  // Соединение полосы: узел выбирается заново, если текущий выключен,
+  // заметно медленнее лучшего или выпал другому воркеру. Без живых узлов
+  // ждём проверку здоровья, а не фиксированную паузу. false — остановка
+  auto connect = [&](Lane &lane) -> bool {
+    if (lane.client && !endpoints_.should_leave(lane.node, index))
+      return true;
+    lane.client.reset();
+    while (running_) {
+      const std::size_t node = endpoints_.pick(lane.shard, index);
+      if (node == ChEndpointSet::npos) {
+        endpoints_.wait_healthy(lane.shard, retry_delay);
+        continue;
+      }
+      const ChEndpoint &ep = endpoints_.endpoint(node);
       try {
-        client.Execute("SELECT 1");
-        log_dbg("CH", "connected: host=" + cfg_.ch_host +
-                          " port=" + std::to_string(cfg_.ch_port) + " db=" +
+        auto client =
+            std::make_unique<Client>(client_options(cfg_, ep, false));
+        client->Execute("SELECT 1"); // ранний ping
+        lane.client = std::move(client);
+        lane.node = node;
+        log_dbg("CH", "worker " + std::to_string(index) + " connected: " +
+                          ep.name() + " shard=" + std::to_string(ep.shard) +
+                          " db=" +
                           (cfg_.ch_database.empty() ? "(default)"
                                                     : cfg_.ch_database));
-      } catch (const std::exception &ping_ex) {
-        throw std::runtime_error(std::string("handshake failed: ") +
-                                 ping_ex.what());
+        return true;
+      } catch (const std::exception &e) {
+        stats.reconnects.fetch_add(1ULL, std::memory_order_relaxed);
+        endpoints_.on_failure(node, true);
+        log_err("CH", "connect to " + ep.name() + " failed: " + e.what());
       }
+    }
+    return false;
+  };
+
+  // Вставка части батча полосы одним Block и ответы по задачам
+  auto flush = [&](Lane &lane) {
+    if (lane.batch.empty() || !connect(lane))
+      return;
+    std::size_t rows = 0;
+    const std::int64_t insert_start = mono_ns();
+    for (const auto &t : lane.batch) {
+      rows += t.kv.size();
+      g_lat_batch_wait.observe_ns(insert_start - t.dequeue_ns);
+    }
+    try {
+      lane.client->Insert(table, lane.builder.build(lane.batch));
+      const std::int64_t insert_ns = mono_ns() - insert_start;
+      g_lat_ch_insert.observe_ns(insert_ns);
+      endpoints_.on_insert(lane.node, insert_ns, rows);
+      stats.inserts.fetch_add(1ULL, std::memory_order_relaxed);
+      stats.rows.fetch_add(rows, std::memory_order_relaxed);
+
+      // успешная вставка: увеличиваем counter на количество пар key/value
+      g_total_received.fetch_add(static_cast<unsigned long long>(rows),
+                                 std::memory_order_relaxed);
+
+      // (опционально) зеркало в Redis и агрегаты отдельными стадиями;
+      // кэш GET /latest пополняется ещё при приёме
+      if (redis_)
+        redis_->submit(lane.batch);
+      if (rollup_)
+        rollup_->submit(lane.batch);
+      if (wal_)
+        wal_->commit(lane.batch);
+
+      settle_keys(dedup_, lane.batch, true);
+      ack_batch(lane.batch, 200, R"({"status":"ok"})");
+      lane.batch.clear();
+      lane.backoff = false;
+      lane.rejected = 0;
+    } catch (const std::exception &ex) {
+      // отказ сервера (схема, данные) — узел жив; прочее — сеть,
+      // соединение или ch_insert_timeout_ms, узел выключается и полоса
+      // переходит на другой
+      const bool down = dynamic_cast<const ServerException *>(&ex) == nullptr;
+      stats.errors.fetch_add(1ULL, std::memory_order_relaxed);
+      endpoints_.on_failure(lane.node, down);
+      lane.client.reset();
+      lane.backoff = !down;
+      const std::string msg = std::string("insert error: ") + ex.what();
+      log_err("CH", msg + " (" + endpoints_.endpoint(lane.node).name() +
+                        ", batch of " + std::to_string(lane.batch.size()) +
+                        " tasks, " + std::to_string(rows) + " rows)");
+      // с журналом недоступность узла пережидаем сколько угодно: часть
+      // батча остаётся и уходит на другой узел. Отказ сервера повтор
+      // обычно не лечит — после wal_server_error_retries батч уходит в
+      // dead-letter, иначе полоса и журнал встали бы за ним навсегда
+      if (wal_ && (down || ++lane.rejected <= cfg_.wal_server_error_retries))
+        return;
+      if (wal_)
+        wal_->dead_letter(lane.batch, msg);
+      settle_keys(dedup_, lane.batch, false);
+      ack_batch(lane.batch, 500,
+                std::string(R"({"status":"error","msg":")") + msg + "\"}");
+      lane.batch.clear();
+      lane.backoff = false;
+      lane.rejected = 0;
+    }
+  };
+
+  // Полосы с задачами вставляются параллельно, так медленный шард не
+  // суммируется с другими: первая — в этом потоке, остальные — потоками
+  // LaneFlushers, созданными один раз на воркер
+  LaneFlushers flushers(lanes.size(),
+                        [&](std::size_t s) { flush(lanes[s]); });
+  auto flush_all = [&] {
+    flushers.run([&](std::size_t s) { return !lanes[s].batch.empty(); });
+  };
+  auto pending = [&] {
+    return std::any_of(lanes.begin(), lanes.end(),
+                       [](const Lane &l) { return !l.batch.empty(); });
+  };
 
-      // Настройка Redis для этого воркера (опционально)
-      RedisConfig rcfg;
-      rcfg.redis_enabled = cfg_.redis_enabled;
-      rcfg.redis_host = cfg_.redis_host;
-      rcfg.redis_port = cfg_.redis_port;
-      RedisClient redis_client(rcfg);
-
-      // Основной цикл обработки очереди
-      while (running_) {
-        auto item_opt = queue_.pop();
-        if (!item_opt.has_value()) {
-          if (!running_)
-            break;
+  while (running_) {
+    // невставленное после ошибки (только с журналом) — раньше новых задач
+    if (pending()) {
+      if (std::any_of(lanes.begin(), lanes.end(), [](const Lane &l) {
+            return l.backoff && !l.batch.empty();
+          }))
+        sleep_with_checks(running_, retry_delay);
+      flush_all();
+    } else {
+      // Основной цикл: копим задачи в батч и вставляем одним Block на шард
+      if (!take_first()) {
+        if (!running_)
+          break;
+        if (!sharded)
           std::this_thread::sleep_for(std::chrono::milliseconds(5));
-          continue;
-        }
+        continue;
+      }
 
-        // элемент извлечён из очереди → уменьшаем gauge
-        g_queue_size.fetch_sub(1ULL, std::memory_order_relaxed);
-
-        const auto &t = *item_opt;
-
-        try {
-          auto col_sensor = std::make_shared<ColumnString>();
-          auto col_ts = std::make_shared<ColumnDateTime>(); // секунды (UTC)
-          auto col_key = std::make_shared<ColumnString>();
-          auto col_value = std::make_shared<ColumnFloat64>();
-
-          for (const auto &kv : t.kv) {
-            col_sensor->Append(t.sensor_id);
-            col_ts->Append(to_time_t_seconds(static_cast<int64_t>(t.ts)));
-            col_key->Append(kv.first);
-            col_value->Append(kv.second);
-          }
-
-          Block block;
-          block.AppendColumn("sensor_id", col_sensor);
-          block.AppendColumn("ts", col_ts);
-          block.AppendColumn("key", col_key);
-          block.AppendColumn("value", col_value);
-
-          client.Insert(table, block);
-
-          // успешная вставка: увеличиваем counter на количество пар key/value
-          g_total_received.fetch_add(
-              static_cast<unsigned long long>(t.kv.size()),
-              std::memory_order_relaxed);
-
-          // обновляем кэш последних значений в Redis (если он включён)
-          if (redis_client.is_enabled()) {
-            for (const auto &kv : t.kv) {
-              redis_client.save_metric(t.sensor_id, kv.first, kv.second,
-                                       static_cast<std::int64_t>(t.ts));
-            }
-          }
-
-          if (t.reply && t.reply->respond) {
-            t.reply->respond(200, R"({"status":"ok"})");
-          }
-        } catch (const std::exception &ex) {
-          const std::string msg = std::string("insert error: ") + ex.what();
-          if (t.reply && t.reply->respond) {
-            t.reply->respond(500, std::string(R"({"status":"error","msg":")") +
-                                      msg + "\"}");
-          } else {
-            log_err("CH", msg);
-          }
+      std::size_t rows = 0;
+      std::size_t bytes = 0;
+      // извлечённые элементы: уменьшаем gauge, отмечаем и считаем лимиты
+      auto account = [&](std::size_t from) {
+        const auto n = static_cast<unsigned long long>(batch.size() - from);
+        g_queue_size.fetch_sub(n, std::memory_order_relaxed);
+        g_queue_dequeued.fetch_add(n, std::memory_order_relaxed);
+        const std::int64_t now = mono_ns();
+        for (std::size_t i = from; i < batch.size(); ++i) {
+          mark_dequeued(batch[i], now);
+          rows += batch[i].kv.size();
+          bytes += estimate_task_bytes(batch[i]);
+        }
+      };
+      account(0);
+
+      // добираем ещё задач, пока не упрёмся в лимиты или linger:
+      // сначала забираем то, что уже лежит в очереди, потом ждём
+      const auto deadline = std::chrono::steady_clock::now() + linger;
+      while (rows < max_rows && bytes < max_bytes) {
+        const std::size_t before = batch.size();
+        if (take_more() == 0) {
+          const auto left =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  deadline - std::chrono::steady_clock::now());
+          if (left.count() <= 0 || !take_wait(left))
+            break;
         }
+        account(before);
       }
 
-    } catch (const std::exception &e) {
-      log_err("CH",
-              std::string("connection/loop error: ") + e.what() +
-                  " (host=" + cfg_.ch_host +
-                  " port=" + std::to_string(cfg_.ch_port) + " db=" +
-                  (cfg_.ch_database.empty() ? "(default)" : cfg_.ch_database) +
-                  ") — retry in " +
-                  std::to_string(connect_retry_delay.count()) + "ms");
-      sleep_with_checks(running_, connect_retry_delay);
-      continue;
-    } catch (...) {
-      log_err("CH", "connection/loop error: unknown — retry in 3000ms");
-      sleep_with_checks(running_, connect_retry_delay);
-      continue;
+      // по шардам ClickHouse: хэш sensor_id
+      if (lanes.size() == 1) {
+        lanes.front().batch.swap(batch);
+      } else {
+        for (auto &t : batch)
+          lanes[ch_shard_of(g_symbols.view(t.sensor), lanes.size())]
+              .batch.push_back(std::move(t));
+      }
+      batch.clear();
+      flush_all();
+    }
+
+    if (!pending() && shard != ShardedTaskQueue::npos) {
+      sharded->release(shard);
+      shard = ShardedTaskQueue::npos;
     }
   }
+
+  // остановка с неотправленным батчем из журнала: шард больше не держим
+  if (shard != ShardedTaskQueue::npos)
+    sharded->release(shard);
 }
 
 #ifdef SENSORS_CH_SELFTEST
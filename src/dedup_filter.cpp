@@ -0,0 +1,233 @@
+#include "sensors/dedup_filter.hpp"
+#include "sensors/metrics_export.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace sensors {
+
+namespace {
+
+constexpr std::size_t kStripes = 16; // полоса — старшие 4 бита ключа
+constexpr std::uint64_t kEmpty = 0;
+constexpr std::uint64_t kTombstone = 1;
+
+std::uint64_t mix(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// 0 и 1 в слотах заняты под «пусто» и «удалён»
+std::uint64_t normalize(std::uint64_t key) { return key < 2 ? key + 2 : key; }
+
+// открытая адресация с линейным пробированием, заполнение не выше 1/2
+class KeySet {
+public:
+  explicit KeySet(std::size_t capacity) : limit_(capacity ? capacity : 1) {
+    std::size_t n = 16;
+    while (n < limit_ * 2)
+      n <<= 1;
+    slots_.assign(n, kEmpty);
+  }
+
+  bool contains(std::uint64_t key) const { return find(key) != npos; }
+
+  // false — множество заполнено
+  bool insert(std::uint64_t key) {
+    if (used_ >= limit_)
+      return false;
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == kEmpty || slots_[i] == kTombstone) {
+        if (slots_[i] == kEmpty)
+          ++used_; // надгробия уже посчитаны в used_
+        slots_[i] = key;
+        ++size_;
+        return true;
+      }
+    }
+  }
+
+  void erase(std::uint64_t key) {
+    const std::size_t i = find(key);
+    if (i == npos)
+      return;
+    slots_[i] = kTombstone;
+    --size_;
+  }
+
+  void clear() {
+    std::memset(slots_.data(), 0, slots_.size() * sizeof(slots_[0]));
+    size_ = used_ = 0;
+  }
+
+  std::size_t size() const { return size_; }
+
+private:
+  static constexpr std::size_t npos = ~std::size_t{0};
+
+  std::size_t find(std::uint64_t key) const {
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == key)
+        return i;
+      if (slots_[i] == kEmpty)
+        return npos;
+    }
+  }
+
+  std::vector<std::uint64_t> slots_;
+  std::size_t limit_;
+  std::size_t size_ = 0; // живые ключи
+  std::size_t used_ = 0; // живые ключи и надгробия
+};
+
+} // namespace
+
+struct DedupFilter::Stripe {
+  Stripe(std::size_t capacity, std::int64_t window_ns)
+      : current(capacity), previous(capacity), pending(capacity),
+        pending_previous(capacity), window_ns(window_ns) {}
+
+  void rotate() {
+    std::swap(current, previous);
+    current.clear();
+    g_dedup_rotations.fetch_add(1ULL, std::memory_order_relaxed);
+  }
+
+  // ключи «в работе» живут теми же поколениями: потерянный без commit и
+  // forget ключ (задача пропала при остановке) не держит повторы вечно
+  void rotate_pending() {
+    std::swap(pending, pending_previous);
+    pending.clear();
+  }
+
+  // смена поколений по времени
+  void advance(std::int64_t now_ns) {
+    if (rotated_ns == 0) {
+      rotated_ns = now_ns;
+    } else if (now_ns - rotated_ns >= window_ns) {
+      // после долгого простоя прошлое поколение тоже устарело
+      if (now_ns - rotated_ns >= 2 * window_ns) {
+        rotate();
+        rotate_pending();
+      }
+      rotate();
+      rotate_pending();
+      rotated_ns = now_ns;
+    }
+  }
+
+  bool committed(std::uint64_t key) const {
+    return current.contains(key) || previous.contains(key);
+  }
+  bool in_flight(std::uint64_t key) const {
+    return pending.contains(key) || pending_previous.contains(key);
+  }
+
+  mutable std::mutex m;
+  KeySet current;
+  KeySet previous;
+  KeySet pending;
+  KeySet pending_previous;
+  const std::int64_t window_ns;
+  std::int64_t rotated_ns = 0;
+};
+
+DedupFilter::DedupFilter(std::size_t capacity, int window_s)
+    : window_ns_(std::int64_t{window_s > 0 ? window_s : 1} * 1'000'000'000) {
+  const std::size_t per_stripe = (capacity + kStripes - 1) / kStripes;
+  stripes_.reserve(kStripes);
+  for (std::size_t i = 0; i < kStripes; ++i)
+    stripes_.push_back(std::make_unique<Stripe>(per_stripe, window_ns_));
+}
+
+DedupFilter::~DedupFilter() = default;
+
+DedupFilter::Claim DedupFilter::claim(std::uint64_t key,
+                                      std::int64_t now_ns) {
+  key = normalize(key);
+  Stripe &s = *stripes_[key >> 60];
+  std::lock_guard<std::mutex> lk(s.m);
+  s.advance(now_ns);
+  if (s.committed(key)) {
+    g_dedup_suppressed.fetch_add(1ULL, std::memory_order_relaxed);
+    return Claim::duplicate;
+  }
+  if (s.in_flight(key)) {
+    g_dedup_in_flight.fetch_add(1ULL, std::memory_order_relaxed);
+    return Claim::in_flight;
+  }
+  if (!s.pending.insert(key)) {
+    s.rotate_pending(); // «в работе» больше, чем помещается в поколение
+    s.pending.insert(key);
+  }
+  return Claim::fresh;
+}
+
+void DedupFilter::commit(std::uint64_t key, std::int64_t now_ns) {
+  key = normalize(key);
+  Stripe &s = *stripes_[key >> 60];
+  std::lock_guard<std::mutex> lk(s.m);
+  s.advance(now_ns);
+  s.pending.erase(key);
+  s.pending_previous.erase(key);
+  if (s.committed(key))
+    return;
+  if (!s.current.insert(key)) {
+    s.rotate(); // поколение заполнено раньше окна
+    s.rotated_ns = now_ns;
+    s.current.insert(key);
+  }
+}
+
+void DedupFilter::forget(std::uint64_t key) {
+  key = normalize(key);
+  Stripe &s = *stripes_[key >> 60];
+  std::lock_guard<std::mutex> lk(s.m);
+  s.current.erase(key);
+  s.previous.erase(key);
+  s.pending.erase(key);
+  s.pending_previous.erase(key);
+}
+
+std::size_t DedupFilter::size() const {
+  std::size_t n = 0;
+  for (const auto &s : stripes_) {
+    std::lock_guard<std::mutex> lk(s->m);
+    n += s->current.size() + s->previous.size() + s->pending.size() +
+         s->pending_previous.size();
+  }
+  return n;
+}
+
+std::uint64_t idempotency_key(std::string_view client_key) {
+  std::uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a
+  for (const char c : client_key) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001B3ULL;
+  }
+  return mix(h ^ 0x6B6579ULL);
+}
+
+std::uint64_t idempotency_key(std::uint64_t request_key, std::size_t index) {
+  return mix(request_key ^ mix(std::uint64_t{index} + 0x696478ULL));
+}
+
+std::uint64_t idempotency_key(const EnqueuedTask &task) {
+  std::uint64_t h = mix((std::uint64_t{task.sensor} << 32) ^
+                        static_cast<std::uint64_t>(task.ts));
+  for (const auto &[key, value] : task.kv) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    h = mix(h ^ (std::uint64_t{key} * 0x9E3779B97F4A7C15ULL) ^ bits);
+  }
+  return h;
+}
+
+} // namespace sensors
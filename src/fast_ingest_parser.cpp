@@ -0,0 +1,389 @@
+#include "sensors/fast_ingest_parser.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace sensors {
+
+namespace {
+
+// итог шага разбора: bad — вход заведомо невалиден, fallback — решать
+// полному парсеру
+enum class Scan { ok, bad, fallback };
+
+// вложенность пропускаемого значения, дальше — полный парсер (у него
+// явный стек, здесь рекурсия)
+constexpr int kMaxSkipDepth = 32;
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Байты строки без escape-последовательностей: управляющие символы
+// запрещены, UTF-8 проверяется как у лексера nlohmann (RFC 3629: без
+// overlong-форм, суррогатов и кодов выше U+10FFFF).
+bool valid_string_bytes(const unsigned char *p, const unsigned char *end) {
+  while (p != end) {
+    const unsigned char c = *p;
+    if (c < 0x80) {
+      if (c < 0x20)
+        return false;
+      ++p;
+      continue;
+    }
+    std::size_t n = 0;
+    unsigned char lo = 0x80, hi = 0xBF; // допустимый второй байт
+    if (c >= 0xC2 && c <= 0xDF) {
+      n = 1;
+    } else if (c == 0xE0) {
+      n = 2;
+      lo = 0xA0;
+    } else if (c == 0xED) {
+      n = 2;
+      hi = 0x9F;
+    } else if (c >= 0xE1 && c <= 0xEF) {
+      n = 2;
+    } else if (c == 0xF0) {
+      n = 3;
+      lo = 0x90;
+    } else if (c == 0xF4) {
+      n = 3;
+      hi = 0x8F;
+    } else if (c >= 0xF1 && c <= 0xF3) {
+      n = 3;
+    } else {
+      return false;
+    }
+    if (static_cast<std::size_t>(end - p) <= n || p[1] < lo || p[1] > hi)
+      return false;
+    for (std::size_t i = 2; i <= n; ++i) {
+      if (p[i] < 0x80 || p[i] > 0xBF)
+        return false;
+    }
+    p += n + 1;
+  }
+  return true;
+}
+
+class Scanner {
+public:
+  explicit Scanner(std::string_view s)
+      : p_(s.data()), end_(s.data() + s.size()) {}
+
+  // BOM UTF-8 в начале входа nlohmann пропускает
+  void skip_bom() {
+    if (end_ - p_ >= 3 && std::memcmp(p_, "\xEF\xBB\xBF", 3) == 0)
+      p_ += 3;
+  }
+
+  void ws() {
+    while (p_ != end_ &&
+           (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+      ++p_;
+  }
+
+  bool eat(char c) {
+    ws();
+    if (p_ == end_ || *p_ != c)
+      return false;
+    ++p_;
+    return true;
+  }
+
+  bool at_end() {
+    ws();
+    return p_ == end_;
+  }
+
+  char peek() {
+    ws();
+    return p_ == end_ ? '\0' : *p_;
+  }
+
+  // Строка без escape-последовательностей: view указывает прямо в буфер.
+  // С '\' — fallback, такую строку разбирает полный парсер.
+  Scan string(std::string_view &view) {
+    if (!eat('"'))
+      return Scan::bad;
+    const char *start = p_;
+    const void *q = std::memchr(p_, '"', static_cast<std::size_t>(end_ - p_));
+    if (!q)
+      return Scan::bad;
+    const char *close = static_cast<const char *>(q);
+    if (std::memchr(start, '\\', static_cast<std::size_t>(close - start)))
+      return Scan::fallback;
+    if (!valid_string_bytes(reinterpret_cast<const unsigned char *>(start),
+                            reinterpret_cast<const unsigned char *>(close)))
+      return Scan::bad;
+    view = std::string_view(start, static_cast<std::size_t>(close - start));
+    p_ = close + 1;
+    return Scan::ok;
+  }
+
+  // Число по грамматике JSON. integral — без дробной части и экспоненты.
+  // Переполнение double — fallback: nlohmann сам решает, принять ли его.
+  Scan number(double &v, bool &integral) {
+    ws();
+    const char *end = number_end(integral);
+    if (!end)
+      return Scan::bad;
+    auto [ptr, ec] = std::from_chars(p_, end, v);
+    if (ec != std::errc() || ptr != end)
+      return Scan::fallback;
+    // "-0" у nlohmann — целый ноль, а не -0.0
+    if (integral && v == 0)
+      v = 0;
+    p_ = end;
+    return Scan::ok;
+  }
+
+  // Целое; дробное или не влезающее в int64 — fallback (nlohmann приводит
+  // такие значения к int64 по своим правилам)
+  Scan integer(std::int64_t &v) {
+    ws();
+    bool integral = false;
+    const char *end = number_end(integral);
+    if (!end)
+      return Scan::bad;
+    if (!integral)
+      return Scan::fallback;
+    auto [ptr, ec] = std::from_chars(p_, end, v);
+    if (ec != std::errc() || ptr != end)
+      return Scan::fallback;
+    p_ = end;
+    return Scan::ok;
+  }
+
+  Scan literal(std::string_view lit) {
+    ws();
+    if (static_cast<std::size_t>(end_ - p_) < lit.size() ||
+        std::memcmp(p_, lit.data(), lit.size()) != 0)
+      return Scan::bad;
+    p_ += lit.size();
+    return Scan::ok;
+  }
+
+  // Пропуск произвольного значения (для неизвестных полей) с полной
+  // проверкой грамматики
+  Scan skip_value(int depth = 0) {
+    switch (peek()) {
+    case '"': {
+      std::string_view sv;
+      return string(sv);
+    }
+    case '{':
+    case '[': {
+      if (depth >= kMaxSkipDepth)
+        return Scan::fallback;
+      const char close = *p_ == '{' ? '}' : ']';
+      ++p_;
+      if (eat(close))
+        return Scan::ok;
+      for (;;) {
+        Scan r = Scan::ok;
+        if (close == '}') {
+          std::string_view key;
+          r = string(key);
+          if (r == Scan::ok && !eat(':'))
+            r = Scan::bad;
+        }
+        if (r == Scan::ok)
+          r = skip_value(depth + 1);
+        if (r != Scan::ok)
+          return r;
+        if (eat(','))
+          continue;
+        return eat(close) ? Scan::ok : Scan::bad;
+      }
+    }
+    case 't':
+      return literal("true");
+    case 'f':
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default: {
+      double d;
+      bool integral;
+      return number(d, integral);
+    }
+    }
+  }
+
+private:
+  // конец числа -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? от p_ или
+  // nullptr; from_chars принимает больше ("01", "1.", inf, nan)
+  const char *number_end(bool &integral) const {
+    integral = true;
+    const char *q = p_;
+    if (q != end_ && *q == '-')
+      ++q;
+    if (q == end_ || !is_digit(*q))
+      return nullptr;
+    if (*q++ != '0') {
+      while (q != end_ && is_digit(*q))
+        ++q;
+    }
+    if (q != end_ && *q == '.') {
+      integral = false;
+      if (++q == end_ || !is_digit(*q))
+        return nullptr;
+      while (q != end_ && is_digit(*q))
+        ++q;
+    }
+    if (q != end_ && (*q == 'e' || *q == 'E')) {
+      integral = false;
+      if (++q != end_ && (*q == '+' || *q == '-'))
+        ++q;
+      if (q == end_ || !is_digit(*q))
+        return nullptr;
+      while (q != end_ && is_digit(*q))
+        ++q;
+    }
+    return q;
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+} // namespace
+
+FastParseResult parse_reading_fast(std::string_view text, EnqueuedTask &out,
+                                   std::string &err) {
+  Scanner s(text);
+  FastParseResult res = FastParseResult::ok;
+  // true — шаг не удался, ответ уже в res
+  auto failed = [&](Scan r, const char *why) {
+    if (r == Scan::ok)
+      return false;
+    if (r == Scan::fallback) {
+      res = FastParseResult::fallback;
+    } else {
+      err = why;
+      res = FastParseResult::error;
+    }
+    return true;
+  };
+  auto fail = [&](const char *why) {
+    failed(Scan::bad, why);
+    return res;
+  };
+
+  s.skip_bom();
+  if (!s.eat('{'))
+    return fail("reading must be a JSON object");
+
+  // имена интернируются только после разбора всей записи: иначе
+  // отвергнутые запросы забивали бы g_symbols до intern_max_symbols.
+  // До того в kv вместо номера ключа — его индекс в keys
+  static thread_local std::vector<std::string_view> keys;
+  keys.clear();
+  std::string_view sensor;
+  bool have_sensor = false, have_ts = false, have_metrics = false;
+  out.kv.clear();
+
+  if (s.peek() != '}') {
+    for (;;) {
+      std::string_view field;
+      if (failed(s.string(field), "bad json: expected field name"))
+        return res;
+      if (!s.eat(':'))
+        return fail("bad json: expected ':'");
+
+      // значение не того типа не ошибка сразу: поле может повториться
+      // (побеждает последнее), а правила приведения типов (bool, null) —
+      // у nlohmann; такие входы разбирает полный парсер
+      if (field == "sensor_id") {
+        if (s.peek() != '"')
+          return FastParseResult::fallback;
+        if (failed(s.string(sensor), "bad json: malformed string"))
+          return res;
+        have_sensor = true;
+      } else if (field == "ts") {
+        const char c = s.peek();
+        if (c != '-' && !is_digit(c))
+          return FastParseResult::fallback;
+        if (failed(s.integer(out.ts), "bad json: malformed number"))
+          return res;
+        have_ts = true;
+      } else if (field == "metrics") {
+        if (s.peek() != '{')
+          return FastParseResult::fallback;
+        s.eat('{');
+        out.kv.clear();
+        keys.clear();
+        if (s.peek() != '}') {
+          for (;;) {
+            std::string_view key;
+            if (failed(s.string(key), "bad json: expected metric name"))
+              return res;
+            if (!s.eat(':'))
+              return fail("bad json: expected ':'");
+            const char c = s.peek();
+            if (c != '-' && !is_digit(c))
+              return FastParseResult::fallback;
+            double v = 0;
+            bool integral = false;
+            if (failed(s.number(v, integral), "bad json: malformed number"))
+              return res;
+            // повтор ключа — как в JSON-объекте, побеждает последнее значение
+            bool dup = false;
+            for (auto &kv : out.kv) {
+              if (keys[kv.first] == key) {
+                kv.second = v;
+                dup = true;
+                break;
+              }
+            }
+            if (!dup) {
+              out.kv.emplace_back(static_cast<SymbolId>(keys.size()), v);
+              keys.push_back(key);
+            }
+            if (s.eat(','))
+              continue;
+            if (s.eat('}'))
+              break;
+            return fail("bad json: expected ',' or '}'");
+          }
+        } else {
+          s.eat('}');
+        }
+        have_metrics = true;
+      } else {
+        if (failed(s.skip_value(), "bad json: malformed value"))
+          return res;
+      }
+
+      if (s.eat(','))
+        continue;
+      if (s.eat('}'))
+        break;
+      return fail("bad json: expected ',' or '}'");
+    }
+  } else {
+    s.eat('}');
+  }
+
+  if (!s.at_end())
+    return fail("bad json: trailing characters");
+  if (!have_sensor)
+    return fail("key 'sensor_id' not found");
+  if (!have_ts)
+    return fail("key 'ts' not found");
+  if (!have_metrics)
+    return fail("key 'metrics' not found");
+
+  out.sensor = g_symbols.intern(sensor);
+  if (out.sensor == kInvalidSymbol)
+    return fail("too many distinct sensor ids / metric keys");
+  for (auto &kv : out.kv) {
+    kv.first = g_symbols.intern(keys[kv.first]);
+    if (kv.first == kInvalidSymbol)
+      return fail("too many distinct sensor ids / metric keys");
+  }
+  return FastParseResult::ok;
+}
+
+} // namespace sensors
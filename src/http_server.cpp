@@ -1,11 +1,21 @@
 // src/http_server.cpp
 #include "sensors/http_server.hpp"
+#include "sensors/ingest_json.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/time_utils.hpp"
+#include <algorithm>
 #include <atomic> // для счётчиков метрик
 #include <boost/beast.hpp>
+#include <cctype>
 #include <chrono>
+#include <cstdio>
+#include <deque>
+#include <initializer_list>
+#include <limits>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <random>
-#include <sstream>
+#include <utility>
 
 
 namespace beast = boost::beast;
@@ -16,110 +26,432 @@ using json = nlohmann::json;
 
 namespace sensors {
 
-// --- декларации глобальных счётчиков метрик ---
-// Определим их на следующем шаге (в одном .cpp), здесь только объявляем.
-// g_total_received: сколько метрик успешно записали в ClickHouse (counter)
-// g_queue_size: текущий размер очереди задач (gauge, приблизительный)
-extern std::atomic<unsigned long long> g_total_received;
-extern std::atomic<unsigned long long> g_queue_size;
+namespace {
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// percent-decoding значения из query string ('+' — пробел)
+bool url_decode(std::string_view in, std::string &out) {
+  out.clear();
+  out.reserve(in.size());
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    if (in[i] == '+') {
+      out.push_back(' ');
+    } else if (in[i] == '%') {
+      const int hi = i + 2 < in.size() ? hex_digit(in[i + 1]) : -1;
+      const int lo = hi >= 0 ? hex_digit(in[i + 2]) : -1;
+      if (lo < 0)
+        return false;
+      out.push_back(static_cast<char>(hi * 16 + lo));
+      i += 2;
+    } else {
+      out.push_back(in[i]);
+    }
+  }
+  return true;
+}
+
+// повтор уже принятого запроса: клиенту достаточно знать, что он принят
+constexpr const char *kDuplicateBody =
+    R"({"status":"accepted","duplicate":true})";
+
+// кадр chunked-кодирования: размер в hex, CRLF, данные, CRLF
+std::string http_chunk(std::string_view data) {
+  char size[24];
+  const int n = std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+  std::string out;
+  out.reserve(static_cast<std::size_t>(n) + data.size() + 2);
+  out.append(size, static_cast<std::size_t>(n)).append(data).append("\r\n");
+  return out;
+}
+
+} // namespace
 
 struct HttpServer::Session
-    : public std::enable_shared_from_this<HttpServer::Session> {
-  tcp::socket socket;
-  ThreadSafeQueue<EnqueuedTask> &queue;
+    : public std::enable_shared_from_this<HttpServer::Session>,
+      public AckTarget {
+  beast::tcp_stream stream;
+  TaskQueue &queue;
+  LatestCache *latest;
+  WriteAheadLog *wal;
+  AdmissionController *admission;
+  DedupFilter *dedup;
+  AckHub *ack_hub; // групповые подтверждения (nullptr — режим не "group")
+  const ZstdDictionary *zstd_dict;
   const Config cfg;
+  const bool ack_immediate;
 
   beast::flat_buffer buffer;
   http::request<http::string_body> req;
   http::response<http::string_body> res;
 
-  // strand от executora сокета — корректный тип под any_io_executor
-  net::strand<net::any_io_executor> strand;
+  // executor сокета — это strand, созданный при accept, или однопоточный
+  // io_context в режиме per_thread (см. do_accept), поэтому и таймауты
+  // tcp_stream, и наши обработчики сериализованы
+  net::any_io_executor strand;
+
+  // таймер ответа 202, если воркер не успел за write_timeout_ms
+  net::steady_timer reply_timer;
+
+  // номер текущего запроса на соединении: ответы воркера/таймера
+  // для уже отвеченного запроса отбрасываются
+  std::uint64_t req_seq{0};
+  bool responded{true};
+  std::size_t served{0};
+  std::int64_t req_start_ns{0}; // запрос прочитан целиком
 
-  explicit Session(tcp::socket s, ThreadSafeQueue<EnqueuedTask> &q,
-                   const Config &c)
-      : socket(std::move(s)), queue(q), cfg(c),
-        strand(net::make_strand(socket.get_executor())) {}
+  // текущий запрос в ожидании группового подтверждения: размер пачки
+  // (0 — одиночное показание), хвост ответа
+  std::size_t ack_accepted{0};
+  std::string ack_tail;
+
+  // распаковка сжатых тел: контексты zstd/lz4 создаются при первом сжатом
+  // теле, буфер распакованного тела переиспользуется между запросами
+  std::unique_ptr<BodyDecoder> decoder_;
+  std::string inflated;
+  bool body_inflated{false};
+
+  explicit Session(tcp::socket s, TaskQueue &q, LatestCache *l,
+                   WriteAheadLog *w, AdmissionController *a, DedupFilter *d,
+                   AckHub *h, const ZstdDictionary *z, const Config &c)
+      : stream(std::move(s)), queue(q), latest(l), wal(w), admission(a),
+        dedup(d), ack_hub(h), zstd_dict(z), cfg(c),
+        ack_immediate(c.http_ack_mode == "immediate"),
+        strand(stream.get_executor()), reply_timer(strand) {}
 
   void run() { read_request(); }
 
+  static constexpr std::size_t kInflatedKeepBytes = 1 << 20;
+
+  // заголовок читается отдельно: по нему видно, потоковый ли это приём
+  std::optional<http::request_parser<http::string_body>> parser;
+
   void read_request() {
+    req = {};
+    parser.emplace();
+    // разовое большое тело не держим в памяти соединения до его закрытия
+    if (inflated.capacity() > kInflatedKeepBytes)
+      std::string().swap(inflated);
+    // таймаут простоя keep-alive соединения между запросами
+    if (cfg.http_idle_timeout_ms > 0)
+      stream.expires_after(std::chrono::milliseconds(cfg.http_idle_timeout_ms));
+    else
+      stream.expires_never();
+
+    auto self = shared_from_this();
+    http::async_read_header(
+        stream, buffer, *parser,
+        net::bind_executor(strand, [self](beast::error_code ec, std::size_t) {
+          if (ec) {
+            // end_of_stream, таймаут простоя или мусор вместо HTTP
+            self->close();
+            return;
+          }
+          const auto &head = self->parser->get();
+          if (head.method() == http::verb::post &&
+              head.target() == "/ingest/stream") {
+            self->req_start_ns = mono_ns();
+            g_http_requests.fetch_add(1ULL, std::memory_order_relaxed);
+            self->start_stream();
+            return;
+          }
+          self->read_body();
+        }));
+  }
+
+  void read_body() {
     auto self = shared_from_this();
     http::async_read(
-        socket, buffer, req,
+        stream, buffer, *parser,
         net::bind_executor(strand, [self](beast::error_code ec, std::size_t) {
-          if (!ec)
-            self->handle_request();
+          if (ec) {
+            self->close();
+            return;
+          }
+          self->req = self->parser->release();
+          self->stream.expires_never();
+          self->req_start_ns = mono_ns();
+          g_http_requests.fetch_add(1ULL, std::memory_order_relaxed);
+          self->handle_request();
         }));
   }
 
-  static std::string gen_req_id() {
+  void close() {
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    stream.close();
+  }
+
+  static std::uint64_t gen_req_id() {
     static thread_local std::mt19937_64 rng{std::random_device{}()};
-    std::stringstream ss;
-    ss << std::hex << rng();
-    return ss.str();
+    return rng();
   }
 
   void handle_request() {
+    ++req_seq;
+    responded = false;
+
     // --- Prometheus /metrics ---
     if (req.method() == http::verb::get && req.target() == "/metrics") {
-      std::ostringstream os;
-
-      // gauge: текущий размер очереди
-      os << "# HELP cpp_sensors_queue_size Current queue size\n";
-      os << "# TYPE cpp_sensors_queue_size gauge\n";
-      os << "cpp_sensors_queue_size "
-         << g_queue_size.load(std::memory_order_relaxed) << "\n";
-
-      // counter: сколько всего успешно записали пар key/value
-      os << "# HELP cpp_sensors_total_received Total successfully written "
-            "metrics\n";
-      os << "# TYPE cpp_sensors_total_received counter\n";
-      os << "cpp_sensors_total_received "
-         << g_total_received.load(std::memory_order_relaxed) << "\n";
+      write_response(200, render_metrics(), "text/plain; version=0.0.4");
+      return;
+    }
 
-      write_response(200, os.str(), "text/plain; version=0.0.4");
+    // --- последние значения из кэша процесса ---
+    const std::string_view target(req.target().data(), req.target().size());
+    const auto qpos = target.find('?');
+    if (latest && req.method() == http::verb::get &&
+        target.substr(0, qpos) == "/latest") {
+      handle_latest(qpos == std::string_view::npos ? std::string_view{}
+                                                   : target.substr(qpos + 1));
       return;
     }
 
-    // --- основной ingest ---
-    if (req.method() != http::verb::post || req.target() != "/ingest") {
-      write_response(404, R"({"error":"not found"})");
+    // --- ingest ---
+    const bool ingest = req.method() == http::verb::post &&
+                        (req.target() == "/ingest" ||
+                         req.target() == "/ingest/batch");
+    // ранний сброс до разбора тела: под перегрузкой не тратим на него CPU
+    int retry_after = 0;
+    if (ingest && admission && admission->shed(retry_after)) {
+      too_many_requests(retry_after, R"({"error":"overloaded"})");
+      return;
+    }
+    if (ingest && !decode_body())
+      return;
+    if (ingest && req.target() == "/ingest") {
+      handle_ingest();
+      return;
+    }
+    if (ingest) {
+      handle_ingest_batch();
       return;
     }
 
-    IngestRequest in;
-    try {
-      auto j = json::parse(req.body());
-      in.sensor_id = j.at("sensor_id").get<std::string>();
-      in.ts = j.at("ts").get<std::int64_t>();
-      in.request_id = gen_req_id();
-      for (auto &[k, v] : j.at("metrics").items()) {
-        in.metrics[k] = v.get<double>();
+    write_response(404, R"({"error":"not found"})");
+  }
+
+  BodyDecoder &decoder() {
+    if (!decoder_)
+      decoder_ = std::make_unique<BodyDecoder>(zstd_dict);
+    return *decoder_;
+  }
+
+  static ContentEncoding content_encoding(const http::fields &fields) {
+    const auto v = fields[http::field::content_encoding];
+    return parse_content_encoding(std::string_view(v.data(), v.size()));
+  }
+
+  // тело ingest-запроса: распакованное или как пришло
+  const std::string &body() const {
+    return body_inflated ? inflated : req.body();
+  }
+
+  // Content-Encoding: zstd / lz4 — тело распаковывается в inflated не
+  // длиннее ingest_max_decompressed_bytes; false — ответ уже отправлен
+  bool decode_body() {
+    body_inflated = false;
+    const ContentEncoding enc = content_encoding(req);
+    if (enc == ContentEncoding::identity)
+      return true;
+    if (enc == ContentEncoding::unsupported) {
+      write_response(415, R"({"error":"unsupported content encoding"})");
+      return false;
+    }
+    g_ingest_compressed_bytes.fetch_add(req.body().size(),
+                                        std::memory_order_relaxed);
+    const auto status = decoder().decode(enc, req.body(), inflated,
+                                         cfg.ingest_max_decompressed_bytes);
+    if (status != BodyDecoder::Status::ok) {
+      g_ingest_decode_errors.fetch_add(1ULL, std::memory_order_relaxed);
+      if (status == BodyDecoder::Status::too_large)
+        write_response(413, R"({"error":"decompressed body too large"})");
+      else
+        write_response(400, R"({"error":"bad compressed body"})");
+      return false;
+    }
+    g_ingest_decompressed_bytes.fetch_add(inflated.size(),
+                                          std::memory_order_relaxed);
+    body_inflated = true;
+    return true;
+  }
+
+  // ответ воркера для текущего запроса: уходит в strand соединения
+  struct Reply final : ReplyHandle {
+    Reply(std::shared_ptr<Session> s, std::uint64_t q)
+        : self(std::move(s)), seq(q) {}
+
+    void respond(int code, std::string body) override {
+      net::dispatch(self->strand, [self = self, seq = seq, code,
+                                   body = std::move(body)]() mutable {
+        if (self->req_seq == seq && !self->responded)
+          self->write_response(code, std::move(body));
+      });
+    }
+
+    std::shared_ptr<Session> self;
+    std::uint64_t seq;
+  };
+
+  std::shared_ptr<ReplyHandle> make_reply() {
+    return std::allocate_shared<Reply>(PoolAllocator<Reply>(),
+                                       shared_from_this(), req_seq);
+  }
+
+  // ответ журнала после fdatasync: ключи идемпотентности запроса
+  // фиксируются, а при 5xx забываются — повтор клиента после ошибки записи
+  // должен пройти. inner == nullptr — клиенту уже ответили. Без журнала
+  // ключи по итогу вставки фиксирует воркер (EnqueuedTask::dedup_key)
+  std::shared_ptr<ReplyHandle>
+  settle_reply(std::vector<std::uint64_t> keys,
+               std::shared_ptr<ReplyHandle> inner) {
+    if (!dedup || keys.empty())
+      return inner;
+    return make_reply_handle([inner = std::move(inner), d = dedup,
+                              keys = std::move(keys)](int code,
+                                                      std::string body) {
+      for (const std::uint64_t k : keys) {
+        if (code >= 500)
+          d->forget(k);
+        else
+          d->commit(k);
       }
-    } catch (const std::exception &e) {
-      write_response(400, std::string(R"({"error":"bad json","msg":")") +
-                              e.what() + "\"}");
+      if (inner)
+        inner->respond(code, std::move(body));
+    });
+  }
+
+  void forget(const std::vector<std::uint64_t> &keys) {
+    for (const std::uint64_t k : keys)
+      dedup->forget(k);
+  }
+
+  // задачи не попали в очередь (журнал): их ключи больше не «в работе»
+  void forget(const std::vector<EnqueuedTask> &tasks) {
+    if (!dedup)
       return;
-    }
+    for (const auto &t : tasks)
+      if (t.dedup_key)
+        dedup->forget(t.dedup_key);
+  }
 
-    auto reply = std::make_shared<ReplyHandle>();
-    reply->respond = [self = shared_from_this()](int code, std::string body) {
-      net::dispatch(self->strand,
-                    [self, code, body = std::move(body)]() mutable {
-                      self->write_response(code, std::move(body));
-                    });
-    };
+  // повтор запроса, который ещё пишется: исход неизвестен, поэтому не
+  // 202 «duplicate», а просьба повторить позже
+  void in_progress() {
+    const int retry_after_s = std::max(1, (cfg.write_timeout_ms + 999) / 1000);
+    write_response(409, R"({"error":"request in progress"})",
+                   "application/json",
+                   {{http::field::retry_after, std::to_string(retry_after_s)}});
+  }
+
+  // хэш заголовка Idempotency-Key; 0 — клиент ключ не прислал
+  std::uint64_t client_idempotency_key() const {
+    const auto it = req.find("Idempotency-Key");
+    if (it == req.end() || it->value().empty())
+      return 0;
+    return idempotency_key(
+        std::string_view(it->value().data(), it->value().size()));
+  }
+
+  // если воркер не ответил за write_timeout_ms — отвечаем 202 с body_202
+  void arm_reply_timer(std::string body_202) {
+    reply_timer.expires_after(std::chrono::milliseconds(cfg.write_timeout_ms));
+    reply_timer.async_wait(net::bind_executor(
+        strand, [self = shared_from_this(), seq = req_seq,
+                 body = std::move(body_202)](
+                    const boost::system::error_code &ec) mutable {
+          if (ec)
+            return; // отменён — уже ответили
+          if (self->req_seq == seq && !self->responded &&
+              self->stream.socket().is_open()) {
+            self->write_response(202, std::move(body));
+          }
+        }));
+    // Ветка успеха/ошибки из воркера отменит таймер внутри write_response
+  }
 
+  void handle_ingest() {
     EnqueuedTask task;
-    task.request_id = in.request_id;
-    task.sensor_id = in.sensor_id;
-    task.ts = in.ts;
-    for (const auto &[k, v] : in.metrics)
-      task.kv.emplace_back(k, v);
-    task.reply = reply;
-
-    if (!queue.try_push(task)) {
+    std::string err;
+    const bool parsed =
+        parse_reading(body(), task, err, cfg.ingest_fast_parser);
+    g_lat_parse.observe_since(req_start_ns);
+    if (!parsed) {
+      json out = {{"error", "bad json"}, {"msg", err}};
+      write_response(400, out.dump());
+      return;
+    }
+    int retry_after = 0;
+    if (admission && !admission->allow(task.sensor, retry_after)) {
+      too_many_requests(retry_after, R"({"error":"rate limited"})");
+      return;
+    }
+
+    // ключ идемпотентности: Idempotency-Key клиента или хэш показания
+    std::vector<std::uint64_t> keys;
+    if (dedup) {
+      const std::uint64_t key = client_idempotency_key();
+      keys.push_back(key ? key : idempotency_key(task));
+      switch (dedup->claim(keys.back())) {
+      case DedupFilter::Claim::duplicate:
+        write_response(202, kDuplicateBody);
+        return;
+      case DedupFilter::Claim::in_flight:
+        in_progress();
+        return;
+      case DedupFilter::Claim::fresh:
+        break;
+      }
+      task.request_id = keys.back();
+      task.dedup_key = keys.back();
+    } else {
+      task.request_id = gen_req_id();
+    }
+
+    // последние значения видны в GET /latest с момента приёма, не дожидаясь
+    // ClickHouse; отказ очереди (503) их не откатывает — клиент повторит
+    if (latest)
+      latest->update(task.sensor, task.kv, task.ts);
+
+    // с журналом ответ 202 придёт из потока записи после fdatasync,
+    // таймер 202 не нужен
+    if (wal) {
+      std::vector<EnqueuedTask> tasks;
+      tasks.push_back(std::move(task));
+      if (!wal->append(tasks, settle_reply(keys, ack_immediate
+                                                     ? nullptr
+                                                     : make_reply()))) {
+        forget(keys);
+        write_response(503, R"({"error":"wal full"})");
+      } else if (ack_immediate) {
+        write_response(202, R"({"status":"accepted"})");
+      }
+      return;
+    }
+
+    std::uint64_t ticket = 0;
+    if (ack_hub) {
+      ack_accepted = 0;
+      ticket = ack_hub->add(shared_from_this(), req_seq, 1);
+      task.ack_hub = ack_hub;
+      task.ack_ticket = ticket;
+    } else if (!ack_immediate) {
+      task.reply = make_reply();
+    }
+    task.enqueue_ns = mono_ns();
+    task.received_s = unix_now_s();
+    if (!queue.try_push(std::move(task))) {
+      if (ticket)
+        ack_hub->cancel(ticket);
+      forget(keys);
       write_response(503, R"({"error":"queue full"})");
       return;
     }
@@ -127,84 +459,893 @@ struct HttpServer::Session
     // Увеличим gauge очереди — элемент принят в обработку
     g_queue_size.fetch_add(1ULL, std::memory_order_relaxed);
 
+    if (ack_immediate)
+      write_response(202, R"({"status":"accepted"})");
+    else if (!ack_hub)
+      arm_reply_timer(R"({"status":"accepted"})");
+  }
+
+  // POST /ingest/batch: JSON-массив показаний или NDJSON (по строке на
+  // показание). Валидные показания уходят в очередь одной пачкой, на
+  // невалидные в ответе перечисляются индексы и причины.
+  void handle_ingest_batch() {
+    const std::string &body = this->body();
+    std::vector<EnqueuedTask> tasks;
+    json rejected = json::array();
+    std::size_t index = 0;
+    std::string err;
+    // показания датчиков сверх лимита отклоняются поштучно
+    std::size_t limited = 0;
+    int retry_after = 0;
+    // ключ у каждого показания свой: с Idempotency-Key — из него и номера
+    // показания, так что повтор пачки после частичной ошибки дописывает
+    // только неудавшиеся показания; без него — хэш показания. Уже
+    // записанные повторы молча отбрасываются
+    std::vector<std::uint64_t> keys;
+    std::size_t duplicates = 0;
+    std::size_t in_flight = 0;
+    const std::uint64_t batch_key = dedup ? client_idempotency_key() : 0;
+    auto accept = [&](EnqueuedTask &&t) {
+      if (admission && admission->rate_limited() &&
+          !admission->allow(t.sensor, retry_after)) {
+        rejected.push_back({{"index", index}, {"error", "rate limited"}});
+        ++limited;
+        return;
+      }
+      if (dedup) {
+        const std::uint64_t key =
+            batch_key ? idempotency_key(batch_key, index) : idempotency_key(t);
+        switch (dedup->claim(key)) {
+        case DedupFilter::Claim::duplicate:
+          ++duplicates;
+          return;
+        case DedupFilter::Claim::in_flight:
+          ++in_flight;
+          return;
+        case DedupFilter::Claim::fresh:
+          break;
+        }
+        keys.push_back(key);
+        t.dedup_key = key;
+      }
+      tasks.push_back(std::move(t));
+    };
+
+    auto take = [&](const json &j) {
+      EnqueuedTask t;
+      if (task_from_json(j, t, err))
+        accept(std::move(t));
+      else
+        rejected.push_back({{"index", index}, {"error", err}});
+      ++index;
+    };
+
+    const auto first = body.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && body[first] == '[') {
+      auto j = json::parse(body, nullptr, false);
+      if (j.is_discarded() || !j.is_array()) {
+        write_response(400, R"({"error":"bad json"})");
+        return;
+      }
+      if (j.size() > cfg.ingest_batch_max_items) {
+        write_response(413, R"({"error":"too many readings"})");
+        return;
+      }
+      tasks.reserve(j.size());
+      for (const auto &item : j)
+        take(item);
+    } else {
+      std::size_t pos = 0;
+      while (pos < body.size()) {
+        auto eol = body.find('\n', pos);
+        if (eol == std::string::npos)
+          eol = body.size();
+        const auto line_begin = body.begin() + static_cast<std::ptrdiff_t>(pos);
+        const auto line_end = body.begin() + static_cast<std::ptrdiff_t>(eol);
+        pos = eol + 1;
+        if (std::all_of(line_begin, line_end,
+                        [](char c) { return std::isspace(
+                                         static_cast<unsigned char>(c)); }))
+          continue;
+        if (index >= cfg.ingest_batch_max_items) {
+          write_response(413, R"({"error":"too many readings"})");
+          return;
+        }
+        EnqueuedTask t;
+        if (parse_reading(std::string_view(&*line_begin,
+                                           static_cast<std::size_t>(
+                                               line_end - line_begin)),
+                          t, err, cfg.ingest_fast_parser))
+          accept(std::move(t));
+        else
+          rejected.push_back({{"index", index}, {"error", err}});
+        ++index;
+      }
+    }
+    g_lat_parse.observe_since(req_start_ns);
+
+    // часть показаний ещё пишется по прошлому запросу — пачку откладываем
+    // целиком: ответ «принято» скрыл бы их возможную потерю
+    if (in_flight) {
+      forget(keys);
+      in_progress();
+      return;
+    }
+
+    // хвост ответа: отклонённые показания и отброшенные повторы
+    std::string tail = R"(,"rejected":)" + rejected.dump();
+    if (duplicates)
+      tail += R"(,"duplicates":)" + std::to_string(duplicates);
+    tail += "}";
+
+    if (tasks.empty() && duplicates > 0) {
+      write_response(202, R"({"status":"accepted","accepted":0)" + tail);
+      return;
+    }
+    if (tasks.empty() && limited > 0 && limited == rejected.size()) {
+      forget(keys);
+      json out = {{"error", "rate limited"}, {"rejected", rejected}};
+      too_many_requests(retry_after, out.dump());
+      return;
+    }
+    if (tasks.empty()) {
+      forget(keys);
+      json out = {{"error", "no valid readings"}, {"rejected", rejected}};
+      write_response(400, out.dump());
+      return;
+    }
+
+    if (latest)
+      latest->update(tasks);
+
+    if (wal) {
+      auto reply = make_reply_handle(
+          [inner = make_reply(), accepted = tasks.size(),
+           tail](int code, std::string body) {
+            if (code == 202)
+              body = R"({"status":"accepted","accepted":)" +
+                     std::to_string(accepted) + tail;
+            inner->respond(code, std::move(body));
+          });
+      const std::uint64_t request_id = batch_key ? batch_key : gen_req_id();
+      for (auto &t : tasks)
+        t.request_id = request_id;
+      if (!wal->append(tasks,
+                       settle_reply(keys, ack_immediate ? nullptr
+                                                        : std::move(reply)))) {
+        forget(keys);
+        write_response(503, R"({"error":"wal full"})");
+      } else if (ack_immediate) {
+        write_response(202, R"({"status":"accepted","accepted":)" +
+                                std::to_string(tasks.size()) + tail);
+      }
+      return;
+    }
+
+    // Клиенту уходит один ответ, когда отчитались все задачи пачки
+    const std::size_t accepted = tasks.size();
+    std::shared_ptr<ReplyHandle> reply;
+    std::uint64_t ticket = 0;
+    if (ack_hub) {
+      ack_accepted = accepted;
+      ack_tail = tail;
+      ticket = ack_hub->add(shared_from_this(), req_seq, accepted);
+    } else if (!ack_immediate) {
+      struct Outcome {
+        std::atomic<std::size_t> pending;
+        std::atomic<std::size_t> failed{0};
+        std::atomic<int> worst{200};
+        std::size_t accepted;
+        std::string tail;
+      };
+      auto outcome = std::make_shared<Outcome>();
+      outcome->pending = accepted;
+      outcome->accepted = accepted;
+      outcome->tail = tail;
+
+      reply = make_reply_handle([inner = make_reply(),
+                                 outcome](int code, std::string) {
+        if (code != 200) {
+          outcome->failed.fetch_add(1, std::memory_order_relaxed);
+          int cur = outcome->worst.load(std::memory_order_relaxed);
+          while (code > cur &&
+                 !outcome->worst.compare_exchange_weak(cur, code)) {
+          }
+        }
+        if (outcome->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+          return;
+        const int worst = outcome->worst.load(std::memory_order_acquire);
+        inner->respond(worst, batch_result(worst, outcome->accepted,
+                                           outcome->failed.load()) +
+                                  outcome->tail);
+      });
+    }
+
+    const std::uint64_t request_id = batch_key ? batch_key : gen_req_id();
+    const std::int64_t now = mono_ns();
+    const std::int64_t received = unix_now_s();
+    for (auto &t : tasks) {
+      t.request_id = request_id;
+      t.reply = reply;
+      t.ack_hub = ack_hub;
+      t.ack_ticket = ticket;
+      t.enqueue_ns = now;
+      t.received_s = received;
+    }
+
+    if (!queue.try_push_bulk(tasks)) {
+      if (ticket)
+        ack_hub->cancel(ticket);
+      forget(keys);
+      write_response(503, R"({"error":"queue full"})");
+      return;
+    }
+    g_queue_size.fetch_add(static_cast<unsigned long long>(accepted),
+                           std::memory_order_relaxed);
+
+    const std::string accepted_body =
+        R"({"status":"accepted","accepted":)" + std::to_string(accepted) + tail;
+    if (ack_immediate)
+      write_response(202, accepted_body);
+    else if (!ack_hub)
+      arm_reply_timer(accepted_body);
+  }
+
+  // тело итогового ответа на пачку (без хвоста rejected/duplicates)
+  static std::string batch_result(int worst, std::size_t accepted,
+                                  std::size_t failed) {
+    return worst == 200 ? R"({"status":"ok","accepted":)" +
+                              std::to_string(accepted)
+                        : R"({"status":"error","accepted":)" +
+                              std::to_string(accepted) + R"(,"failed":)" +
+                              std::to_string(failed);
+  }
+
+  // --- групповые подтверждения: вызываются в потоке хаба ---
+  void on_ack(std::uint64_t seq, int status, std::size_t failed,
+              const std::string &error) override {
+    net::dispatch(strand, [self = shared_from_this(), seq, status, failed,
+                           error]() mutable {
+      if (self->req_seq != seq || self->responded)
+        return;
+      std::string body =
+          self->ack_accepted == 0
+              ? (status == 200 ? std::string(R"({"status":"ok"})")
+                               : std::move(error))
+              : batch_result(status, self->ack_accepted, failed) +
+                    self->ack_tail;
+      self->write_response(status, std::move(body));
+    });
+  }
+
+  void on_ack_timeout(std::uint64_t seq) override {
+    net::dispatch(strand, [self = shared_from_this(), seq] {
+      if (self->req_seq != seq || self->responded ||
+          !self->stream.socket().is_open())
+        return;
+      self->write_response(
+          202, self->ack_accepted == 0
+                   ? std::string(R"({"status":"accepted"})")
+                   : R"({"status":"accepted","accepted":)" +
+                         std::to_string(self->ack_accepted) + self->ack_tail);
+    });
+  }
+
+  // POST /ingest/stream: NDJSON в chunked-теле долгого запроса. Тело
+  // читается окнами по ingest_stream_buffer_bytes, строки разбираются по
+  // мере прихода и уходят в очередь пачкой на окно. Полная очередь
+  // не даёт 429/503: сокет просто не читается, пока она не разгрузится,
+  // и клиент упирается в TCP-окно. Ответ — chunked NDJSON, который
+  // начинается сразу: раз в ingest_stream_ack_interval_ms строка с
+  // итогами, в конце — итог с "done":true. Сжатое тело (zstd/lz4)
+  // распаковывается на лету по одному буферу размером с окно: как только
+  // разобранных задач набралось ingest_batch_max_items, они уходят в
+  // очередь (или распаковка ждёт места в ней), а недоразобранный остаток
+  // сжатого окна ждёт следующего шага — иначе маленький кадр с большим
+  // коэффициентом сжатия развернулся бы в память целиком. Память
+  // соединения ограничена окном, незаконченной строкой (не длиннее
+  // ingest_stream_max_line_bytes) и задачами одного окна или
+  // ingest_batch_max_items. Битый кадр завершает ответ строкой с "error"
+  // и закрывает соединение.
+  struct StreamState {
+    StreamState(http::request_parser<http::string_body> &&head,
+                const net::any_io_executor &ex, std::size_t window,
+                std::size_t max_line, ContentEncoding enc)
+        : parser(std::move(head)), chunk(window ? window : 1),
+          plain(enc == ContentEncoding::identity ? 0 : chunk.size()),
+          encoding(enc), lines(max_line), ack_timer(ex), retry_timer(ex) {
+      parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+    }
+
+    http::request_parser<http::buffer_body> parser;
+    std::vector<char> chunk; // окно чтения тела
+    std::vector<char> plain; // окно распакованных данных
+    std::string_view in; // прочитанное, но ещё не разобранное из chunk
+    bool more_out{false}; // в контексте распаковки могли остаться данные
+    ContentEncoding encoding;
+    NdjsonSplitter lines;
+    std::vector<EnqueuedTask> tasks; // разобраны, очередь ещё не приняла
+    std::uint64_t request_id{0};
+    std::uint64_t accepted{0};
+    std::uint64_t rejected{0};
+    std::uint64_t duplicates{0};
+    std::uint64_t in_flight{0}; // повторы показаний, которые ещё пишутся
+    std::uint64_t reported{0}; // сумма счётчиков в прошлом ack
+    std::deque<std::string> out; // кадры ответа в очереди на запись
+    bool writing{false};
+    bool finished{false}; // итог поставлен в очередь
+    bool aborted{false};  // соединение закрыто посреди потока
+    bool keep{false};
+    net::steady_timer ack_timer;
+    net::steady_timer retry_timer;
+  };
+  std::unique_ptr<StreamState> streaming;
+
+  void start_stream() {
+    const auto expect = parser->get()[http::field::expect];
+    const bool expect_continue = beast::iequals(expect, "100-continue");
+    const ContentEncoding enc = content_encoding(parser->get());
+    if (enc == ContentEncoding::unsupported) {
+      // тело не читали — после ответа соединение не продолжить
+      ++req_seq;
+      responded = false;
+      req.keep_alive(false);
+      write_response(415, R"({"error":"unsupported content encoding"})");
+      return;
+    }
+    if (enc != ContentEncoding::identity)
+      decoder().begin(enc);
+    streaming = std::make_unique<StreamState>(
+        std::move(*parser), strand, cfg.ingest_stream_buffer_bytes,
+        cfg.ingest_stream_max_line_bytes, enc);
+    parser.reset();
+    g_stream_requests.fetch_add(1ULL, std::memory_order_relaxed);
+
+    auto &st = *streaming;
+    st.request_id = gen_req_id();
+    st.keep = cfg.http_keep_alive && st.parser.get().keep_alive() &&
+              (cfg.http_max_requests_per_conn == 0 ||
+               served + 1 < cfg.http_max_requests_per_conn);
+    if (expect_continue)
+      st.out.push_back("HTTP/1.1 100 Continue\r\n\r\n");
+    st.out.push_back(std::string("HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: application/x-ndjson\r\n"
+                                 "Transfer-Encoding: chunked\r\n") +
+                     (st.keep ? "" : "Connection: close\r\n") + "\r\n");
+    stream_pump();
+    if (cfg.ingest_stream_ack_interval_ms > 0)
+      arm_stream_ack();
+    read_stream();
+  }
+
+  void read_stream() {
+    auto &st = *streaming;
+    for (;;) {
+      if (!stream_flush()) {
+        // очередь полна — не читаем сокет и не распаковываем дальше,
+        // пока не разгрузится
+        g_stream_pauses.fetch_add(1ULL, std::memory_order_relaxed);
+        stream.expires_never();
+        st.retry_timer.expires_after(std::chrono::milliseconds(
+            std::max(1, cfg.ingest_stream_pause_ms)));
+        st.retry_timer.async_wait(net::bind_executor(
+            strand,
+            [self = shared_from_this()](const boost::system::error_code &ec) {
+              if (!ec && !self->streaming->aborted)
+                self->read_stream();
+            }));
+        return;
+      }
+      if (st.in.empty() && !st.more_out)
+        break;
+      if (!consume_stream()) {
+        fail_stream("bad compressed body");
+        return;
+      }
+    }
+    if (st.parser.is_done()) {
+      finish_stream();
+      return;
+    }
+
+    st.parser.get().body().data = st.chunk.data();
+    st.parser.get().body().size = st.chunk.size();
+    if (cfg.http_idle_timeout_ms > 0)
+      stream.expires_after(std::chrono::milliseconds(cfg.http_idle_timeout_ms));
     auto self = shared_from_this();
-    auto timer =
-        std::make_shared<net::steady_timer>(strand.get_inner_executor());
-    timer->expires_after(std::chrono::milliseconds(cfg.write_timeout_ms));
-    timer->async_wait(net::bind_executor(
-        strand, [self, timer](const boost::system::error_code &ec) {
-          if (ec)
-            return; // отменён — уже ответили
-          if (self->socket.is_open()) {
-            self->write_response(202, R"({"status":"accepted"})");
+    http::async_read_some(
+        stream, buffer, st.parser,
+        net::bind_executor(strand, [self](beast::error_code ec, std::size_t) {
+          if (ec == http::error::need_buffer)
+            ec = {}; // окно заполнено — это не ошибка
+          auto &st = *self->streaming;
+          if (st.aborted)
+            return;
+          if (ec) {
+            self->abort_stream();
+            return;
           }
+          const std::size_t n = st.chunk.size() - st.parser.get().body().size;
+          st.in = std::string_view(st.chunk.data(), n);
+          if (st.encoding != ContentEncoding::identity)
+            g_ingest_compressed_bytes.fetch_add(n, std::memory_order_relaxed);
+          self->read_stream();
         }));
-    // Ветка успеха/ошибки из воркера отменит таймер внутри
-    // write_response/dispatch
   }
 
-  // перегрузка для явной установки content-type
-  void write_response(int status, std::string body,
-                      const std::string &content_type) {
+  // Разбирает st.in: несжатое окно — целиком (задач в нём не больше, чем
+  // строк в окне), сжатое — по буферу plain, пока задач меньше
+  // ingest_batch_max_items. false — сжатое тело оказалось битым
+  bool consume_stream() {
+    auto &st = *streaming;
+    auto split = [&](const char *data, std::size_t len) {
+      st.rejected += st.lines.feed(
+          data, len, [this](std::string_view line) { stream_line(line); });
+    };
+    if (st.encoding == ContentEncoding::identity) {
+      split(st.in.data(), st.in.size());
+      st.in = {};
+      return true;
+    }
+    const std::size_t limit =
+        std::max<std::size_t>(1, cfg.ingest_batch_max_items);
+    do {
+      const std::size_t before = st.in.size();
+      std::size_t produced = 0;
+      if (!decoder().step(st.in, st.plain.data(), st.plain.size(),
+                          produced) ||
+          (produced == 0 && !st.in.empty() && st.in.size() == before)) {
+        g_ingest_decode_errors.fetch_add(1ULL, std::memory_order_relaxed);
+        return false;
+      }
+      g_ingest_decompressed_bytes.fetch_add(produced,
+                                            std::memory_order_relaxed);
+      split(st.plain.data(), produced);
+      // буфер заполнен целиком — в контексте могли остаться данные
+      st.more_out = produced == st.plain.size();
+    } while ((!st.in.empty() || st.more_out) && st.tasks.size() < limit);
+    return true;
+  }
+
+  void stream_line(std::string_view line) {
+    auto &st = *streaming;
+    if (std::all_of(line.begin(), line.end(), [](char c) {
+          return std::isspace(static_cast<unsigned char>(c));
+        }))
+      return;
+    EnqueuedTask t;
+    std::string err;
+    int retry_after = 0;
+    if (!parse_reading(line, t, err, cfg.ingest_fast_parser) ||
+        (admission && admission->rate_limited() &&
+         !admission->allow(t.sensor, retry_after))) {
+      ++st.rejected;
+      return;
+    }
+    if (dedup) {
+      t.request_id = idempotency_key(t);
+      switch (dedup->claim(t.request_id)) {
+      case DedupFilter::Claim::duplicate:
+        ++st.duplicates;
+        return;
+      case DedupFilter::Claim::in_flight:
+        ++st.in_flight; // клиент видит счётчик и может прислать позже
+        return;
+      case DedupFilter::Claim::fresh:
+        break;
+      }
+      t.dedup_key = t.request_id;
+    } else {
+      t.request_id = st.request_id;
+    }
+    if (latest)
+      latest->update(t.sensor, t.kv, t.ts);
+    st.tasks.push_back(std::move(t));
+  }
+
+  // false — очередь (журнал) не приняла задачи окна, они остаются в tasks
+  bool stream_flush() {
+    auto &st = *streaming;
+    if (st.tasks.empty())
+      return true;
+    const std::size_t n = st.tasks.size();
+    const std::int64_t now = mono_ns();
+    const std::int64_t received = unix_now_s();
+    for (auto &t : st.tasks) {
+      t.enqueue_ns = now;
+      t.received_s = received;
+    }
+    // с журналом ключи фиксируются после fdatasync, без него — воркером
+    std::vector<std::uint64_t> keys;
+    if (wal && dedup) {
+      keys.reserve(n);
+      for (const auto &t : st.tasks)
+        keys.push_back(t.dedup_key);
+    }
+    if (wal ? !wal->append(st.tasks, settle_reply(std::move(keys), nullptr))
+            : !queue.try_push_bulk(st.tasks))
+      return false;
+    if (!wal)
+      g_queue_size.fetch_add(static_cast<unsigned long long>(n),
+                             std::memory_order_relaxed);
+    g_stream_readings.fetch_add(static_cast<unsigned long long>(n),
+                                std::memory_order_relaxed);
+    st.accepted += n;
+    st.tasks.clear();
+    return true;
+  }
+
+  std::string stream_progress(bool done, std::string_view error = {}) {
+    auto &st = *streaming;
+    st.reported = st.accepted + st.rejected + st.duplicates + st.in_flight;
+    std::string line = R"({"accepted":)" + std::to_string(st.accepted) +
+                       R"(,"rejected":)" + std::to_string(st.rejected) +
+                       R"(,"duplicates":)" + std::to_string(st.duplicates);
+    if (st.in_flight)
+      line += R"(,"in_flight":)" + std::to_string(st.in_flight);
+    if (!error.empty())
+      line.append(R"(,"error":")").append(error).append("\"");
+    line += done ? R"(,"done":true})" "\n" : "}\n";
+    return http_chunk(line);
+  }
+
+  void arm_stream_ack() {
+    auto &st = *streaming;
+    st.ack_timer.expires_after(
+        std::chrono::milliseconds(cfg.ingest_stream_ack_interval_ms));
+    st.ack_timer.async_wait(net::bind_executor(
+        strand, [self = shared_from_this()](const boost::system::error_code &ec) {
+          if (ec || !self->streaming || self->streaming->finished ||
+              self->streaming->aborted)
+            return;
+          auto &st = *self->streaming;
+          if (st.accepted + st.rejected + st.duplicates + st.in_flight !=
+              st.reported) {
+            st.out.push_back(self->stream_progress(false));
+            self->stream_pump();
+          }
+          self->arm_stream_ack();
+        }));
+  }
+
+  void finish_stream() {
+    auto &st = *streaming;
+    if (st.encoding != ContentEncoding::identity && !decoder().frame_done()) {
+      g_ingest_decode_errors.fetch_add(1ULL, std::memory_order_relaxed);
+      fail_stream("truncated compressed body");
+      return;
+    }
+    // последняя строка может прийти без '\n'
+    if (st.lines.pending()) {
+      st.lines.finish([this](std::string_view line) { stream_line(line); });
+      if (!st.tasks.empty()) {
+        read_stream(); // допринять с паузами и вернуться сюда
+        return;
+      }
+    }
+    st.ack_timer.cancel();
+    st.finished = true;
+    st.out.push_back(stream_progress(true));
+    st.out.push_back("0\r\n\r\n");
+    ++served;
+    count_http_response(200);
+    g_lat_http_request.observe_since(req_start_ns);
+    stream_pump();
+  }
+
+  // тело дальше не читается: итог с ошибкой, и соединение закрывается.
+  // Показания окна, не принятые очередью, отбрасываются — в "accepted"
+  // их нет, клиент повторит их вместе с остатком
+  void fail_stream(std::string_view error) {
+    auto &st = *streaming;
+    stream_flush();
+    forget(st.tasks);
+    st.tasks.clear();
+    st.ack_timer.cancel();
+    st.retry_timer.cancel();
+    st.finished = true;
+    st.keep = false;
+    st.out.push_back(stream_progress(true, error));
+    st.out.push_back("0\r\n\r\n");
+    ++served;
+    count_http_response(200);
+    g_lat_http_request.observe_since(req_start_ns);
+    stream_pump();
+  }
+
+  // кадры ответа пишутся по одному, параллельно с чтением тела
+  void stream_pump() {
+    auto &st = *streaming;
+    if (st.writing || st.aborted)
+      return;
+    if (st.out.empty()) {
+      if (st.finished)
+        end_stream();
+      return;
+    }
+    st.writing = true;
+    auto self = shared_from_this();
+    net::async_write(
+        stream, net::buffer(st.out.front()),
+        net::bind_executor(strand, [self](beast::error_code ec, std::size_t) {
+          auto &st = *self->streaming;
+          st.writing = false;
+          if (st.aborted)
+            return;
+          if (ec) {
+            self->abort_stream();
+            return;
+          }
+          st.out.pop_front();
+          self->stream_pump();
+        }));
+  }
+
+  void end_stream() {
+    const bool keep = streaming->keep;
+    streaming.reset();
+    if (keep) {
+      read_request();
+      return;
+    }
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+  }
+
+  void abort_stream() {
+    auto &st = *streaming;
+    st.aborted = true;
+    forget(st.tasks);
+    st.tasks.clear();
+    st.ack_timer.cancel();
+    st.retry_timer.cancel();
+    close();
+  }
+
+  // GET /latest?sensor=<id>            — один датчик
+  // GET /latest?sensor=a&sensor=b, ?sensors=a,b — несколько датчиков
+  void handle_latest(std::string_view query) {
+    g_latest_reads.fetch_add(1ULL, std::memory_order_relaxed);
+
+    std::vector<std::string> ids;
+    bool many = false;
+    std::string value;
+    while (!query.empty()) {
+      const auto amp = query.find('&');
+      const auto param = query.substr(0, amp);
+      query = amp == std::string_view::npos ? std::string_view{}
+                                            : query.substr(amp + 1);
+      const auto eq = param.find('=');
+      const auto name = param.substr(0, eq);
+      if (eq == std::string_view::npos || (name != "sensor" && name != "sensors"))
+        continue;
+      auto raw = param.substr(eq + 1);
+      many = many || name == "sensors" || !ids.empty();
+      // в sensors= идентификаторы через запятую
+      while (true) {
+        const auto comma =
+            name == "sensors" ? raw.find(',') : std::string_view::npos;
+        if (!url_decode(raw.substr(0, comma), value)) {
+          write_response(400, R"({"error":"bad sensor id encoding"})");
+          return;
+        }
+        if (!value.empty())
+          ids.push_back(value);
+        if (comma == std::string_view::npos)
+          break;
+        raw = raw.substr(comma + 1);
+      }
+    }
+
+    if (ids.empty()) {
+      write_response(400, R"({"error":"sensor is required"})");
+      return;
+    }
+    if (ids.size() > cfg.latest_max_sensors_per_request) {
+      write_response(400, R"({"error":"too many sensors"})");
+      return;
+    }
+
+    // интернирования здесь нет: неизвестный датчик таблицу не пополняет
+    std::vector<LatestCache::Value> values;
+    auto metrics_of = [&](const std::string &id, json &out) {
+      if (!latest->read(g_symbols.find(id), values))
+        return false;
+      out = json::object();
+      for (const auto &v : values)
+        out[std::string(g_symbols.view(v.key))] = {{"value", v.value},
+                                                   {"ts", v.ts}};
+      return true;
+    };
+
+    if (!many) {
+      json metrics;
+      if (!metrics_of(ids[0], metrics)) {
+        write_response(404, R"({"error":"unknown sensor"})");
+        return;
+      }
+      json out = {{"sensor_id", ids[0]}, {"metrics", std::move(metrics)}};
+      write_response(200, out.dump());
+      return;
+    }
+
+    json sensors = json::object();
+    json missing = json::array();
+    for (const auto &id : ids) {
+      json metrics;
+      if (metrics_of(id, metrics))
+        sensors[id] = std::move(metrics);
+      else
+        missing.push_back(id);
+    }
+    json out = {{"sensors", std::move(sensors)}, {"missing", std::move(missing)}};
+    write_response(200, out.dump());
+  }
+
+  // перегрузка для явной установки content-type и дополнительных заголовков
+  void write_response(
+      int status, std::string body, const std::string &content_type,
+      std::initializer_list<std::pair<http::field, std::string>> extra = {}) {
+    responded = true;
+    reply_timer.cancel();
+    ++served;
+    count_http_response(status);
+
+    // HTTP/1.1 keep-alive: после ответа читаем следующий запрос с того же
+    // соединения (конвейерные запросы уже лежат в buffer и идут по порядку)
+    const bool keep = cfg.http_keep_alive && req.keep_alive() &&
+                      (cfg.http_max_requests_per_conn == 0 ||
+                       served < cfg.http_max_requests_per_conn);
+
+    res = {};
     res.version(req.version());
-    res.keep_alive(false);
+    res.keep_alive(keep);
     res.result(static_cast<http::status>(status));
     res.set(http::field::content_type, content_type);
+    for (const auto &[field, value] : extra)
+      res.set(field, value);
     res.body() = std::move(body);
     res.prepare_payload();
 
+    if (cfg.http_idle_timeout_ms > 0)
+      stream.expires_after(std::chrono::milliseconds(cfg.http_idle_timeout_ms));
+
     auto self = shared_from_this();
     http::async_write(
-        socket, res,
-        net::bind_executor(strand, [self](beast::error_code, std::size_t) {
-          beast::error_code ec;
-          self->socket.shutdown(tcp::socket::shutdown_send, ec);
-        }));
+        stream, res,
+        net::bind_executor(strand,
+                           [self, keep, write_start = mono_ns()](
+                               beast::error_code ec, std::size_t) {
+                             const std::int64_t now = mono_ns();
+                             g_lat_http_write.observe_ns(now - write_start);
+                             g_lat_http_request.observe_ns(
+                                 now - self->req_start_ns);
+                             if (ec) {
+                               self->close();
+                               return;
+                             }
+                             if (keep) {
+                               self->read_request();
+                               return;
+                             }
+                             self->stream.socket().shutdown(
+                                 tcp::socket::shutdown_send, ec);
+                           }));
   }
 
   void write_response(int status, std::string body) {
     // по умолчанию JSON
     write_response(status, std::move(body), "application/json");
   }
+
+  void too_many_requests(int retry_after_s, std::string body) {
+    write_response(429, std::move(body), "application/json",
+                   {{http::field::retry_after, std::to_string(retry_after_s)}});
+  }
 };
 
 HttpServer::HttpServer(net::io_context &ioc, const Config &cfg,
-                       ThreadSafeQueue<EnqueuedTask> &queue)
-    : ioc_(ioc), cfg_(cfg), queue_(queue), acceptor_(ioc), socket_(ioc),
+                       TaskQueue &queue, LatestCache *latest,
+                       WriteAheadLog *wal, AdmissionController *admission,
+                       DedupFilter *dedup)
+    : HttpServer(ioc, nullptr, cfg, queue, latest, wal, admission, dedup) {}
+
+HttpServer::HttpServer(IoContextPool &pool, const Config &cfg,
+                       TaskQueue &queue, LatestCache *latest,
+                       WriteAheadLog *wal, AdmissionController *admission,
+                       DedupFilter *dedup)
+    : HttpServer(pool.get(0), &pool, cfg, queue, latest, wal, admission,
+                 dedup) {}
+
+HttpServer::HttpServer(net::io_context &ioc, IoContextPool *pool,
+                       const Config &cfg, TaskQueue &queue,
+                       LatestCache *latest, WriteAheadLog *wal,
+                       AdmissionController *admission, DedupFilter *dedup)
+    : ioc_(ioc), cfg_(cfg), queue_(queue), latest_(latest), wal_(wal),
+      admission_(admission), dedup_(dedup), pool_(pool),
       work_guard_(net::make_work_guard(ioc_)) {
+  if (!cfg_.ingest_zstd_dictionary.empty()) {
+    zstd_dict_ = ZstdDictionary::load(cfg_.ingest_zstd_dictionary);
+    std::printf("[HTTP] zstd dictionary %u loaded\n", zstd_dict_->id());
+  }
   tcp::endpoint ep{net::ip::make_address(cfg_.host),
                    static_cast<unsigned short>(cfg_.port)};
-  beast::error_code ec;
-  acceptor_.open(ep.protocol(), ec);
-  if (!ec)
-    acceptor_.set_option(net::socket_base::reuse_address(true), ec);
-  if (!ec)
-    acceptor_.bind(ep, ec);
-  if (!ec)
-    acceptor_.listen(net::socket_base::max_listen_connections, ec);
+  const std::size_t n = pool_ && kHasReusePort ? pool_->size() : 1;
+  for (std::size_t i = 0; i < n; ++i) {
+    auto &ctx = pool_ ? pool_->get(i) : ioc_;
+    acceptors_.push_back(std::make_unique<tcp::acceptor>(ctx));
+    const auto ec = listen_on(*acceptors_.back(), ep, n > 1);
+    if (ec) {
+      std::fprintf(stderr, "[ERR] http listen %s:%u: %s\n", cfg_.host.c_str(),
+                   static_cast<unsigned>(cfg_.port), ec.message().c_str());
+      break;
+    }
+  }
+  if (cfg_.http_ack_mode == "group") {
+    // shared: хаб на каждый из http_threads, каждый на своём strand, иначе
+    // все подтверждения шли бы через один strand и один mutex
+    const std::size_t hubs =
+        pool_ ? pool_->size() : std::max<std::size_t>(1, cfg_.http_threads);
+    for (std::size_t i = 0; i < hubs; ++i)
+      hubs_.push_back(std::make_unique<AckHub>(
+          pool_ ? net::any_io_executor(pool_->get(i).get_executor())
+                : net::any_io_executor(net::make_strand(ioc_)),
+          cfg_.write_timeout_ms));
+  }
 }
 
 void HttpServer::run() {
   if (running_.exchange(true))
     return;
-  do_accept();
+  for (std::size_t i = 0; i < acceptors_.size(); ++i)
+    do_accept(i);
 }
 
 void HttpServer::stop() {
   if (!running_.exchange(false))
     return;
   work_guard_.reset(); // отпускаем io_context
-  beast::error_code ec;
-  acceptor_.close(ec);
+  for (auto &h : hubs_)
+    h->stop();
+  for (auto &a : acceptors_) {
+    // закрываем в потоке своего контекста
+    net::post(a->get_executor(), [a = a.get()] {
+      beast::error_code ec;
+      a->close(ec);
+    });
+  }
 }
 
-void HttpServer::do_accept() {
-  acceptor_.async_accept(socket_, [this](beast::error_code ec) {
+void HttpServer::do_accept(std::size_t index) {
+  // shared: каждое соединение получает свой strand ещё на этапе accept,
+  // хаб подтверждений — по кругу; per_thread: контекст крутит один поток,
+  // strand не нужен — соединение садится на контекст своего acceptor'а
+  // или следующий по кругу, хаб — этого контекста
+  net::any_io_executor ex;
+  std::size_t ctx = 0;
+  if (!pool_) {
+    ex = net::make_strand(ioc_);
+    if (!hubs_.empty())
+      ctx = next_ctx_.fetch_add(1, std::memory_order_relaxed) % hubs_.size();
+  } else {
+    ctx = acceptors_.size() > 1
+              ? index
+              : next_ctx_.fetch_add(1, std::memory_order_relaxed) %
+                    pool_->size();
+    ex = pool_->get(ctx).get_executor();
+  }
+  AckHub *hub = hubs_.empty() ? nullptr : hubs_[ctx].get();
+  acceptors_[index]->async_accept(ex, [this, index, hub](beast::error_code ec,
+                                                         tcp::socket socket) {
     if (!ec) {
-      std::make_shared<Session>(std::move(socket_), queue_, cfg_)->run();
+      g_http_connections.fetch_add(1ULL, std::memory_order_relaxed);
+      std::make_shared<Session>(std::move(socket), queue_, latest_, wal_,
+                                admission_, dedup_, hub, zstd_dict_.get(),
+                                cfg_)
+          ->run();
     }
     if (running_)
-      do_accept();
+      do_accept(index);
   });
 }
 
@@ -0,0 +1,71 @@
+#include "sensors/ingest_json.hpp"
+#include "sensors/fast_ingest_parser.hpp"
+
+#include <cstdint>
+#include <exception>
+
+namespace sensors {
+
+bool task_from_json(const nlohmann::json &j, EnqueuedTask &out,
+                    std::string &err) {
+  try {
+    if (!j.is_object()) {
+      err = "reading must be a JSON object";
+      return false;
+    }
+    const auto &sensor_id = j.at("sensor_id").get_ref<const std::string &>();
+    out.ts = j.at("ts").get<std::int64_t>();
+
+    const auto &metrics = j.at("metrics");
+    if (!metrics.is_object()) {
+      err = "metrics must be a JSON object";
+      return false;
+    }
+    out.kv.clear();
+    out.kv.reserve(metrics.size());
+    for (const auto &[k, v] : metrics.items())
+      out.kv.emplace_back(kInvalidSymbol, v.get<double>());
+
+    // имена — в g_symbols только после проверки всей записи, иначе
+    // отвергнутые запросы забивали бы таблицу до intern_max_symbols
+    const auto too_many = [&] {
+      err = "too many distinct sensor ids / metric keys";
+      return false;
+    };
+    out.sensor = g_symbols.intern(sensor_id);
+    if (out.sensor == kInvalidSymbol)
+      return too_many();
+    std::size_t i = 0;
+    for (const auto &[k, v] : metrics.items()) {
+      out.kv[i].first = g_symbols.intern(k);
+      if (out.kv[i++].first == kInvalidSymbol)
+        return too_many();
+    }
+    return true;
+  } catch (const std::exception &e) {
+    err = e.what();
+    return false;
+  }
+}
+
+bool parse_reading(std::string_view text, EnqueuedTask &out, std::string &err,
+                   bool fast) {
+  if (fast) {
+    switch (parse_reading_fast(text, out, err)) {
+    case FastParseResult::ok:
+      return true;
+    case FastParseResult::error:
+      return false;
+    case FastParseResult::fallback:
+      break;
+    }
+  }
+  auto j = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+  if (j.is_discarded()) {
+    err = "bad json";
+    return false;
+  }
+  return task_from_json(j, out, err);
+}
+
+} // namespace sensors
@@ -0,0 +1,70 @@
+#include "sensors/intern_table.hpp"
+
+#include <functional>
+#include <mutex>
+
+namespace sensors {
+
+InternTable g_symbols;
+
+InternTable::InternTable(std::size_t limit)
+    : limit_(limit < kMaxSymbols ? limit : kMaxSymbols),
+      chunks_(new std::atomic<Chunk *>[kMaxSymbols / kChunkSize]) {
+  for (std::size_t i = 0; i < kMaxSymbols / kChunkSize; ++i)
+    chunks_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+InternTable::~InternTable() {
+  for (std::size_t i = 0; i < kMaxSymbols / kChunkSize; ++i)
+    delete chunks_[i].load(std::memory_order_relaxed);
+}
+
+SymbolId InternTable::intern(std::string_view s) {
+  Shard &sh = shards_[std::hash<std::string_view>{}(s) % kShards];
+  {
+    std::shared_lock lk(sh.m);
+    if (auto it = sh.ids.find(s); it != sh.ids.end())
+      return it->second;
+  }
+
+  std::unique_lock lk(sh.m);
+  if (auto it = sh.ids.find(s); it != sh.ids.end())
+    return it->second;
+
+  // номер резервируем глобально, но не больше limit_
+  std::size_t id = next_.load(std::memory_order_relaxed);
+  do {
+    if (id >= limit_)
+      return kInvalidSymbol;
+  } while (!next_.compare_exchange_weak(id, id + 1, std::memory_order_relaxed));
+
+  const std::string &stored = sh.strings.emplace_back(s);
+  publish(static_cast<SymbolId>(id), stored);
+  sh.ids.emplace(std::string_view(stored), static_cast<SymbolId>(id));
+  return static_cast<SymbolId>(id);
+}
+
+SymbolId InternTable::find(std::string_view s) const {
+  const Shard &sh = shards_[std::hash<std::string_view>{}(s) % kShards];
+  std::shared_lock lk(sh.m);
+  auto it = sh.ids.find(s);
+  return it == sh.ids.end() ? kInvalidSymbol : it->second;
+}
+
+void InternTable::publish(SymbolId id, const std::string &s) {
+  std::atomic<Chunk *> &slot = chunks_[id >> kChunkBits];
+  Chunk *c = slot.load(std::memory_order_acquire);
+  if (!c) {
+    // чанк может одновременно создавать интернирование из другого шарда
+    auto *fresh = new Chunk();
+    for (auto &p : fresh->slots)
+      p.store(nullptr, std::memory_order_relaxed);
+    if (slot.compare_exchange_strong(c, fresh, std::memory_order_acq_rel))
+      c = fresh;
+    else
+      delete fresh;
+  }
+  c->slots[id & kChunkMask].store(&s, std::memory_order_release);
+}
+
+} // namespace sensors
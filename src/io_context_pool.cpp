@@ -0,0 +1,110 @@
+#include "sensors/io_context_pool.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace sensors {
+
+bool pin_current_thread(int cpu) {
+  if (cpu < 0)
+    return false;
+#if defined(_WIN32)
+  if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+    return false;
+  return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) != 0;
+#elif defined(__linux__)
+  if (cpu >= CPU_SETSIZE)
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+boost::system::error_code listen_on(tcp::acceptor &acceptor,
+                                    const tcp::endpoint &ep, bool reuse_port) {
+  boost::system::error_code ec;
+  acceptor.open(ep.protocol(), ec);
+  if (!ec)
+    acceptor.set_option(net::socket_base::reuse_address(true), ec);
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+  if (!ec && reuse_port)
+    acceptor.set_option(
+        net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true),
+        ec);
+#else
+  (void)reuse_port;
+#endif
+  if (!ec)
+    acceptor.bind(ep, ec);
+  if (!ec)
+    acceptor.listen(net::socket_base::max_listen_connections, ec);
+  return ec;
+}
+
+IoContextPool::IoContextPool(std::size_t n, std::vector<int> cpus)
+    : cpus_(std::move(cpus)) {
+  if (n == 0)
+    n = 1;
+  iocs_.reserve(n);
+  guards_.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    // подсказка 1: контекст крутит один поток, внутренние блокировки не нужны
+    iocs_.push_back(std::make_unique<net::io_context>(1));
+    guards_.push_back(net::make_work_guard(*iocs_.back()));
+  }
+}
+
+IoContextPool::~IoContextPool() {
+  stop();
+  join();
+}
+
+void IoContextPool::start() {
+  if (!threads_.empty())
+    return;
+  threads_.reserve(iocs_.size());
+  for (std::size_t i = 0; i < iocs_.size(); ++i) {
+    threads_.emplace_back(std::make_unique<boost::thread>([this, i] {
+      const int cpu = affinity_cpu(cpus_, i);
+      if (cpu >= 0 && !pin_current_thread(cpu))
+        std::fprintf(stderr, "[WARN] io thread %zu: failed to pin to cpu %d\n",
+                     i, cpu);
+      try {
+        iocs_[i]->run();
+      } catch (const std::exception &e) {
+        std::fprintf(stderr, "[ERR] io thread %zu: %s\n", i, e.what());
+      }
+    }));
+  }
+}
+
+void IoContextPool::stop() {
+  for (auto &g : guards_)
+    g.reset();
+  for (auto &ioc : iocs_)
+    ioc->stop();
+}
+
+void IoContextPool::join() {
+  for (auto &t : threads_)
+    if (t && t->joinable())
+      t->join();
+  threads_.clear();
+}
+
+} // namespace sensors
@@ -0,0 +1,215 @@
+#include "sensors/latest_cache.hpp"
+#include "sensors/metrics_export.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace sensors {
+
+namespace {
+
+constexpr unsigned kChunkBits = 12;
+constexpr std::size_t kChunkSize = std::size_t{1} << kChunkBits;
+constexpr std::size_t kChunkMask = kChunkSize - 1;
+constexpr std::size_t kChunks = InternTable::kMaxSymbols / kChunkSize;
+constexpr std::uint32_t kInitialKeys = 8;
+
+} // namespace
+
+struct LatestCache::Slot {
+  struct Entry {
+    std::atomic<SymbolId> key{kInvalidSymbol};
+    std::atomic<double> value{0};
+    std::atomic<std::int64_t> ts{0};
+  };
+
+  explicit Slot(std::uint32_t cap) : capacity(cap), entries(new Entry[cap]) {}
+
+  std::atomic<std::uint32_t> seq{0}; // нечётный — идёт запись
+  std::atomic<std::uint32_t> size{0};
+  std::atomic<bool> retired{false};  // заменён слотом большей ёмкости
+  const std::uint32_t capacity;
+  std::unique_ptr<Entry[]> entries;
+};
+
+struct LatestCache::Chunk {
+  std::atomic<Slot *> slots[kChunkSize];
+};
+
+LatestCache::LatestCache() : chunks_(new std::atomic<Chunk *>[kChunks]) {
+  for (std::size_t i = 0; i < kChunks; ++i)
+    chunks_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+LatestCache::~LatestCache() {
+  for (std::size_t i = 0; i < kChunks; ++i) {
+    Chunk *c = chunks_[i].load(std::memory_order_relaxed);
+    if (!c)
+      continue;
+    for (auto &s : c->slots)
+      delete s.load(std::memory_order_relaxed);
+    delete c;
+  }
+  for (Slot *s : retired_)
+    delete s;
+}
+
+LatestCache::Slot *LatestCache::slot_for_write(SymbolId sensor) {
+  std::atomic<Chunk *> &chunk = chunks_[sensor >> kChunkBits];
+  Chunk *c = chunk.load(std::memory_order_acquire);
+  if (!c) {
+    auto *fresh = new Chunk();
+    for (auto &p : fresh->slots)
+      p.store(nullptr, std::memory_order_relaxed);
+    if (chunk.compare_exchange_strong(c, fresh, std::memory_order_acq_rel))
+      c = fresh;
+    else
+      delete fresh;
+  }
+
+  std::atomic<Slot *> &ref = c->slots[sensor & kChunkMask];
+  Slot *s = ref.load(std::memory_order_acquire);
+  if (!s) {
+    auto *fresh = new Slot(kInitialKeys);
+    if (ref.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) {
+      s = fresh;
+      g_latest_sensors.fetch_add(1ULL, std::memory_order_relaxed);
+    } else {
+      delete fresh;
+    }
+  }
+  return s;
+}
+
+// Вызывается писателем, захватившим old: копирует значения в слот большей
+// ёмкости и публикует его вместо old. Захват old снимает вызывающий.
+LatestCache::Slot *LatestCache::grow(Slot *old, std::uint32_t need,
+                                     SymbolId sensor) {
+  std::uint32_t cap = old->capacity;
+  while (cap < need && cap < kMaxKeysPerSensor)
+    cap *= 2;
+  cap = std::min(cap, kMaxKeysPerSensor);
+
+  auto *fresh = new Slot(cap);
+  const std::uint32_t n = old->size.load(std::memory_order_relaxed);
+  for (std::uint32_t i = 0; i < n; ++i) {
+    const auto &from = old->entries[i];
+    auto &to = fresh->entries[i];
+    to.key.store(from.key.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+    to.value.store(from.value.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+    to.ts.store(from.ts.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+  }
+  fresh->size.store(n, std::memory_order_relaxed);
+
+  old->retired.store(true, std::memory_order_relaxed);
+  Chunk *c = chunks_[sensor >> kChunkBits].load(std::memory_order_acquire);
+  c->slots[sensor & kChunkMask].store(fresh, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lk(retired_m_);
+    retired_.push_back(old);
+  }
+  return fresh;
+}
+
+void LatestCache::update(SymbolId sensor, const KvBuffer &kv, std::int64_t ts) {
+  if (kv.empty() || sensor == kInvalidSymbol ||
+      (sensor >> kChunkBits) >= kChunks)
+    return;
+
+  Slot *s = slot_for_write(sensor);
+  for (;;) {
+    // захват слота: чётный seq → нечётный; писатели одного датчика ждут
+    // друг друга, читателей не ждёт никто
+    std::uint32_t seq = s->seq.load(std::memory_order_relaxed);
+    if ((seq & 1) || !s->seq.compare_exchange_weak(
+                         seq, seq + 1, std::memory_order_acquire,
+                         std::memory_order_relaxed)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (s->retired.load(std::memory_order_relaxed)) {
+      // пока ждали, слот заменили — данные в нём не трогали
+      s->seq.store(seq, std::memory_order_release);
+      s = slot_for_write(sensor);
+      continue;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::uint32_t n = s->size.load(std::memory_order_relaxed);
+    std::uint32_t fresh_keys = 0;
+    for (const auto &[key, value] : kv) {
+      bool found = false;
+      for (std::uint32_t i = 0; i < n && !found; ++i)
+        found = s->entries[i].key.load(std::memory_order_relaxed) == key;
+      fresh_keys += found ? 0 : 1;
+    }
+    if (n + fresh_keys > s->capacity && s->capacity < kMaxKeysPerSensor) {
+      Slot *bigger = grow(s, n + fresh_keys, sensor);
+      s->seq.store(seq + 2, std::memory_order_release);
+      s = bigger;
+      continue;
+    }
+
+    for (const auto &[key, value] : kv) {
+      std::uint32_t i = 0;
+      while (i < n && s->entries[i].key.load(std::memory_order_relaxed) != key)
+        ++i;
+      if (i == n) {
+        if (n == s->capacity) {
+          g_latest_dropped_keys.fetch_add(1ULL, std::memory_order_relaxed);
+          continue;
+        }
+        s->entries[i].key.store(key, std::memory_order_relaxed);
+        ++n;
+      } else if (ts < s->entries[i].ts.load(std::memory_order_relaxed)) {
+        continue; // запоздавшее показание не затирает более свежее
+      }
+      s->entries[i].value.store(value, std::memory_order_relaxed);
+      s->entries[i].ts.store(ts, std::memory_order_relaxed);
+    }
+    s->size.store(n, std::memory_order_relaxed);
+    s->seq.store(seq + 2, std::memory_order_release);
+    return;
+  }
+}
+
+void LatestCache::update(const std::vector<EnqueuedTask> &batch) {
+  for (const auto &t : batch)
+    update(t.sensor, t.kv, t.ts);
+}
+
+bool LatestCache::read(SymbolId sensor, std::vector<Value> &out) const {
+  out.clear();
+  if (sensor == kInvalidSymbol || (sensor >> kChunkBits) >= kChunks)
+    return false;
+  const Chunk *c = chunks_[sensor >> kChunkBits].load(std::memory_order_acquire);
+  if (!c)
+    return false;
+
+  for (;;) {
+    const Slot *s = c->slots[sensor & kChunkMask].load(std::memory_order_acquire);
+    if (!s)
+      return false;
+    const std::uint32_t seq = s->seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    const std::uint32_t n =
+        std::min(s->size.load(std::memory_order_relaxed), s->capacity);
+    out.resize(n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+      out[i].key = s->entries[i].key.load(std::memory_order_relaxed);
+      out[i].value = s->entries[i].value.load(std::memory_order_relaxed);
+      out[i].ts = s->entries[i].ts.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->seq.load(std::memory_order_relaxed) == seq)
+      return true;
+  }
+}
+
+} // namespace sensors
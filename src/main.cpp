@@ -1,7 +1,18 @@
+#include "sensors/admission.hpp"
+#include "sensors/binary_server.hpp"
+#include "sensors/ch_endpoints.hpp"
 #include "sensors/clickhouse_pool.hpp"
+#include "sensors/dedup_filter.hpp"
 #include "sensors/http_server.hpp"
-#include "sensors/threadsafe_queue.hpp"
+#include "sensors/intern_table.hpp"
+#include "sensors/io_context_pool.hpp"
+#include "sensors/latest_cache.hpp"
+#include "sensors/redis_writer.hpp"
+#include "sensors/rollup_writer.hpp"
+#include "sensors/task_queue.hpp"
 #include "sensors/types.hpp"
+#include "sensors/udp_server.hpp"
+#include "sensors/wal.hpp"
 #include <csignal>
 #include <exception>
 #include <fstream>
@@ -31,15 +42,61 @@ static sensors::Config load_config(const std::string &path) {
   json j;
   f >> j;
   auto get = [&](auto key, auto def) {
-    return j.contains(key) ? j[key].get<std::decay_t<decltype(def)>>() : def;
+    return j.contains(key) ? j[key].template get<std::decay_t<decltype(def)>>() : def;
   };
 
   c.host = get("host", c.host);
   c.port = static_cast<unsigned short>(get("port", (int)c.port));
   c.http_threads = get("http_threads", c.http_threads);
+  c.http_io_model = get("http_io_model", c.http_io_model);
+  c.http_cpu_affinity = get("http_cpu_affinity", c.http_cpu_affinity);
   c.ch_pool_size = get("ch_pool_size", c.ch_pool_size);
   c.queue_capacity = get("queue_capacity", c.queue_capacity);
+  c.queue_impl = get("queue_impl", c.queue_impl);
+  c.queue_shards = get("queue_shards", c.queue_shards);
+  c.queue_steal_min_depth =
+      get("queue_steal_min_depth", c.queue_steal_min_depth);
   c.write_timeout_ms = get("write_timeout_ms", c.write_timeout_ms);
+  c.http_ack_mode = get("http_ack_mode", c.http_ack_mode);
+  c.http_keep_alive = get("http_keep_alive", c.http_keep_alive);
+  c.http_idle_timeout_ms = get("http_idle_timeout_ms", c.http_idle_timeout_ms);
+  c.http_max_requests_per_conn =
+      get("http_max_requests_per_conn", c.http_max_requests_per_conn);
+  c.ingest_batch_max_items =
+      get("ingest_batch_max_items", c.ingest_batch_max_items);
+  c.ingest_fast_parser = get("ingest_fast_parser", c.ingest_fast_parser);
+  c.ingest_stream_buffer_bytes =
+      get("ingest_stream_buffer_bytes", c.ingest_stream_buffer_bytes);
+  c.ingest_stream_max_line_bytes =
+      get("ingest_stream_max_line_bytes", c.ingest_stream_max_line_bytes);
+  c.ingest_stream_ack_interval_ms =
+      get("ingest_stream_ack_interval_ms", c.ingest_stream_ack_interval_ms);
+  c.ingest_stream_pause_ms =
+      get("ingest_stream_pause_ms", c.ingest_stream_pause_ms);
+  c.ingest_max_decompressed_bytes =
+      get("ingest_max_decompressed_bytes", c.ingest_max_decompressed_bytes);
+  c.ingest_zstd_dictionary =
+      get("ingest_zstd_dictionary", c.ingest_zstd_dictionary);
+  c.admission_enabled = get("admission_enabled", c.admission_enabled);
+  c.admission_min_fill = get("admission_min_fill", c.admission_min_fill);
+  c.admission_max_fill = get("admission_max_fill", c.admission_max_fill);
+  c.admission_retry_after_max_s =
+      get("admission_retry_after_max_s", c.admission_retry_after_max_s);
+  c.sensor_rate_limit = get("sensor_rate_limit", c.sensor_rate_limit);
+  c.sensor_rate_burst_s = get("sensor_rate_burst_s", c.sensor_rate_burst_s);
+  c.sensor_rate_limits = get("sensor_rate_limits", c.sensor_rate_limits);
+  c.dedup_enabled = get("dedup_enabled", c.dedup_enabled);
+  c.dedup_window_s = get("dedup_window_s", c.dedup_window_s);
+  c.dedup_capacity = get("dedup_capacity", c.dedup_capacity);
+  c.bin_enabled = get("bin_enabled", c.bin_enabled);
+  c.bin_port = static_cast<unsigned short>(get("bin_port", (int)c.bin_port));
+  c.bin_ack_every = get("bin_ack_every", c.bin_ack_every);
+  c.bin_max_frame_bytes = get("bin_max_frame_bytes", c.bin_max_frame_bytes);
+  c.udp_enabled = get("udp_enabled", c.udp_enabled);
+  c.udp_port = static_cast<unsigned short>(get("udp_port", (int)c.udp_port));
+  c.udp_batch = get("udp_batch", c.udp_batch);
+  c.udp_max_datagram = get("udp_max_datagram", c.udp_max_datagram);
+  c.udp_rcvbuf_bytes = get("udp_rcvbuf_bytes", c.udp_rcvbuf_bytes);
 
   c.ch_host = get("ch_host", c.ch_host);
   c.ch_port = get("ch_port", c.ch_port);
@@ -47,9 +104,43 @@ static sensors::Config load_config(const std::string &path) {
   c.ch_password = get("ch_password", c.ch_password);
   c.ch_database = get("ch_database", c.ch_database);
   c.ch_table = get("ch_table", c.ch_table);
+  c.ch_routing = get("ch_routing", c.ch_routing);
+  c.ch_endpoints = get("ch_endpoints", c.ch_endpoints);
+  c.ch_shards = get("ch_shards", c.ch_shards);
+  c.ch_health_interval_ms =
+      get("ch_health_interval_ms", c.ch_health_interval_ms);
+  c.ch_connect_timeout_ms =
+      get("ch_connect_timeout_ms", c.ch_connect_timeout_ms);
+  c.ch_insert_timeout_ms = get("ch_insert_timeout_ms", c.ch_insert_timeout_ms);
+  c.ch_batch_max_rows = get("ch_batch_max_rows", c.ch_batch_max_rows);
+  c.ch_batch_max_bytes = get("ch_batch_max_bytes", c.ch_batch_max_bytes);
+  c.ch_batch_linger_ms = get("ch_batch_linger_ms", c.ch_batch_linger_ms);
+  c.ch_low_cardinality = get("ch_low_cardinality", c.ch_low_cardinality);
+  c.ch_cpu_affinity = get("ch_cpu_affinity", c.ch_cpu_affinity);
+  c.intern_max_symbols = get("intern_max_symbols", c.intern_max_symbols);
+  c.latest_enabled = get("latest_enabled", c.latest_enabled);
+  c.latest_max_sensors_per_request =
+      get("latest_max_sensors_per_request", c.latest_max_sensors_per_request);
+  c.wal_enabled = get("wal_enabled", c.wal_enabled);
+  c.wal_dir = get("wal_dir", c.wal_dir);
+  c.wal_segment_bytes = get("wal_segment_bytes", c.wal_segment_bytes);
+  c.wal_fsync_interval_ms =
+      get("wal_fsync_interval_ms", c.wal_fsync_interval_ms);
+  c.wal_max_bytes = get("wal_max_bytes", c.wal_max_bytes);
+  c.wal_server_error_retries =
+      get("wal_server_error_retries", c.wal_server_error_retries);
+  c.rollup_enabled = get("rollup_enabled", c.rollup_enabled);
+  c.rollup_windows = get("rollup_windows", c.rollup_windows);
+  c.rollup_grace_s = get("rollup_grace_s", c.rollup_grace_s);
+  c.rollup_flush_interval_ms =
+      get("rollup_flush_interval_ms", c.rollup_flush_interval_ms);
+  c.rollup_max_groups = get("rollup_max_groups", c.rollup_max_groups);
   c.redis_enabled = get("redis_enabled", c.redis_enabled);
   c.redis_host = get("redis_host", c.redis_host);
   c.redis_port = get("redis_port", c.redis_port);
+  c.redis_flush_interval_ms =
+      get("redis_flush_interval_ms", c.redis_flush_interval_ms);
+  c.redis_max_pending = get("redis_max_pending", c.redis_max_pending);
 
   return c;
 }
@@ -65,8 +156,34 @@ int main(int argc, char **argv) {
   }
 
   auto cfg = load_config(cfg_path);
+  sensors::g_symbols.set_limit(cfg.intern_max_symbols);
 
-  sensors::ThreadSafeQueue<sensors::EnqueuedTask> queue(cfg.queue_capacity);
+  std::unique_ptr<sensors::TaskQueue> queue_ptr;
+  try {
+    queue_ptr = sensors::make_task_queue(cfg);
+  } catch (const std::exception &e) {
+    std::cerr << "[FATAL] config error: " << e.what() << std::endl;
+    return 1;
+  }
+  auto &queue = *queue_ptr;
+  const bool io_per_thread = cfg.http_io_model == "per_thread";
+  if (!io_per_thread && cfg.http_io_model != "shared") {
+    std::cerr << "[FATAL] config error: unknown http_io_model '"
+              << cfg.http_io_model << "'" << std::endl;
+    return 1;
+  }
+  if (cfg.http_ack_mode != "request" && cfg.http_ack_mode != "group" &&
+      cfg.http_ack_mode != "immediate") {
+    std::cerr << "[FATAL] config error: unknown http_ack_mode '"
+              << cfg.http_ack_mode << "'" << std::endl;
+    return 1;
+  }
+  try {
+    sensors::ch_endpoints_from_config(cfg); // ch_routing и адреса узлов
+  } catch (const std::exception &e) {
+    std::cerr << "[FATAL] config error: " << e.what() << std::endl;
+    return 1;
+  }
 
   boost::asio::io_context ioc;
 
@@ -84,23 +201,97 @@ int main(int argc, char **argv) {
   };
   tick();
 
-  sensors::HttpServer server(ioc, cfg, queue);
-  sensors::ClickHousePool chpool(cfg, queue);
+  std::unique_ptr<sensors::WriteAheadLog> wal;
+  if (cfg.wal_enabled) {
+    wal = std::make_unique<sensors::WriteAheadLog>(cfg, queue);
+    try {
+      wal->open(); // подхватывает сегменты прошлого запуска
+    } catch (const std::exception &e) {
+      std::cerr << "[FATAL] " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  std::unique_ptr<sensors::LatestCache> latest;
+  if (cfg.latest_enabled)
+    latest = std::make_unique<sensors::LatestCache>();
+  std::unique_ptr<sensors::AdmissionController> admission;
+  if (cfg.admission_enabled || cfg.sensor_rate_limit > 0 ||
+      !cfg.sensor_rate_limits.empty())
+    admission = std::make_unique<sensors::AdmissionController>(
+        cfg, cfg.queue_capacity);
+  std::unique_ptr<sensors::DedupFilter> dedup;
+  if (cfg.dedup_enabled)
+    dedup = std::make_unique<sensors::DedupFilter>(cfg.dedup_capacity,
+                                                   cfg.dedup_window_s);
+  const std::size_t n_threads = std::max<std::size_t>(1, cfg.http_threads);
+  // per_thread: HTTP целиком на пуле однопоточных контекстов, общий ioc
+  // остаётся сигналам, таймеру и бинарному протоколу в главном потоке
+  std::unique_ptr<sensors::IoContextPool> io_pool;
+  std::unique_ptr<sensors::HttpServer> server;
+  try {
+    if (io_per_thread) {
+      io_pool = std::make_unique<sensors::IoContextPool>(n_threads,
+                                                         cfg.http_cpu_affinity);
+      server = std::make_unique<sensors::HttpServer>(
+          *io_pool, cfg, queue, latest.get(), wal.get(), admission.get(),
+          dedup.get());
+      std::cout << "[HTTP] per_thread io: " << n_threads << " contexts, "
+                << (sensors::kHasReusePort ? "SO_REUSEPORT acceptors"
+                                           : "one acceptor, round-robin")
+                << "\n";
+    } else {
+      server = std::make_unique<sensors::HttpServer>(
+          ioc, cfg, queue, latest.get(), wal.get(), admission.get(),
+          dedup.get());
+    }
+  } catch (const std::exception &e) {
+    // ingest_zstd_dictionary не читается
+    std::cerr << "[FATAL] config error: " << e.what() << std::endl;
+    return 1;
+  }
+  std::unique_ptr<sensors::RedisWriter> redis_writer;
+  if (cfg.redis_enabled)
+    redis_writer = std::make_unique<sensors::RedisWriter>(cfg);
+  std::unique_ptr<sensors::RollupWriter> rollup_writer;
+  if (cfg.rollup_enabled)
+    rollup_writer = std::make_unique<sensors::RollupWriter>(cfg);
+  sensors::ClickHousePool chpool(cfg, queue, redis_writer.get(), wal.get(),
+                                 rollup_writer.get(), dedup.get());
+  std::unique_ptr<sensors::BinaryIngestServer> bin_server;
+  if (cfg.bin_enabled)
+    bin_server = std::make_unique<sensors::BinaryIngestServer>(
+        ioc, cfg, queue, wal.get(), latest.get());
+  std::unique_ptr<sensors::UdpIngestServer> udp_server;
+  if (cfg.udp_enabled)
+    udp_server = std::make_unique<sensors::UdpIngestServer>(
+        cfg, queue, wal.get(), latest.get());
 
   try {
-    server.run();   // должен поставить async_accept
+    if (wal)
+      wal->start();
+    server->run();  // должен поставить async_accept
+    if (io_pool)
+      io_pool->start();
+    if (bin_server)
+      bin_server->run();
+    if (udp_server)
+      udp_server->start();
+    if (redis_writer)
+      redis_writer->start();
+    if (rollup_writer)
+      rollup_writer->start(chpool.endpoints());
     chpool.start(); // поднимает воркеры пула
   } catch (const std::exception &e) {
     std::cerr << "[FATAL] startup error: " << e.what() << std::endl;
     return 1;
   }
 
-  const std::size_t n_threads = std::max<std::size_t>(1, cfg.http_threads);
-
   std::vector<std::unique_ptr<boost::thread>> threads;
-  threads.reserve(n_threads > 0 ? n_threads - 1 : 0);
+  const std::size_t n_shared = io_pool ? 1 : n_threads;
+  threads.reserve(n_shared - 1);
 
-  for (std::size_t i = 0; i + 1 < n_threads; ++i) {
+  for (std::size_t i = 0; i + 1 < n_shared; ++i) {
     threads.emplace_back(std::make_unique<boost::thread>([&ioc] {
       std::cout << "[DBG] worker thread: ioc.run() enter\n";
       ioc.run();
@@ -115,6 +306,11 @@ int main(int argc, char **argv) {
   signals.async_wait([&](const boost::system::error_code &, int) {
     std::cout << "[SIG] stopping...\n";
     queue.stop();
+    if (bin_server)
+      bin_server->stop();
+    server->stop();
+    if (io_pool)
+      io_pool->stop();
     guard.reset(); // отпускаем «несгораемую» работу
     ioc.stop();    // будим все потоки, чтобы они вышли из run()
   });
@@ -126,6 +322,16 @@ int main(int argc, char **argv) {
 
   for (auto &t : threads)
     t->join();
+  if (io_pool)
+    io_pool->join();
+  if (udp_server)
+    udp_server->stop();
   chpool.stop();
+  if (wal)
+    wal->stop(); // после остановки очереди: дописывает принятое
+  if (redis_writer)
+    redis_writer->stop(); // финальный сброс после последних вставок
+  if (rollup_writer)
+    rollup_writer->stop(); // сбрасывает и незакрытые окна
   return 0;
 }
@@ -1,6 +1,482 @@
+#include <sensors/intern_table.hpp>
 #include <sensors/metrics_export.hpp>
 
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
 namespace sensors {
 std::atomic<unsigned long long> g_total_received{0ULL};
 std::atomic<unsigned long long> g_queue_size{0ULL};
+std::atomic<unsigned long long> g_queue_dequeued{0ULL};
+std::atomic<unsigned long long> g_queue_drain_rate{0ULL};
+std::atomic<unsigned long long> g_admission_shed{0ULL};
+std::atomic<unsigned long long> g_admission_rate_limited{0ULL};
+std::atomic<unsigned long long> g_dedup_suppressed{0ULL};
+std::atomic<unsigned long long> g_dedup_in_flight{0ULL};
+std::atomic<unsigned long long> g_dedup_rotations{0ULL};
+std::atomic<unsigned long long> g_ack_notices{0ULL};
+std::atomic<unsigned long long> g_ack_timeouts{0ULL};
+std::atomic<unsigned long long> g_http_connections{0ULL};
+std::atomic<unsigned long long> g_http_requests{0ULL};
+std::atomic<unsigned long long> g_stream_requests{0ULL};
+std::atomic<unsigned long long> g_stream_readings{0ULL};
+std::atomic<unsigned long long> g_stream_pauses{0ULL};
+std::atomic<unsigned long long> g_ingest_compressed_bytes{0ULL};
+std::atomic<unsigned long long> g_ingest_decompressed_bytes{0ULL};
+std::atomic<unsigned long long> g_ingest_decode_errors{0ULL};
+std::atomic<unsigned long long> g_bin_frames{0ULL};
+std::atomic<unsigned long long> g_bin_readings{0ULL};
+std::atomic<unsigned long long> g_bin_rejected{0ULL};
+std::atomic<unsigned long long> g_bin_decode_errors{0ULL};
+std::atomic<unsigned long long> g_udp_datagrams{0ULL};
+std::atomic<unsigned long long> g_udp_readings{0ULL};
+std::atomic<unsigned long long> g_udp_dropped{0ULL};
+std::atomic<unsigned long long> g_udp_parse_errors{0ULL};
+std::atomic<unsigned long long> g_udp_receive_errors{0ULL};
+std::atomic<unsigned long long> g_redis_updates{0ULL};
+std::atomic<unsigned long long> g_redis_coalesced{0ULL};
+std::atomic<unsigned long long> g_redis_dropped{0ULL};
+std::atomic<unsigned long long> g_redis_pending{0ULL};
+std::atomic<unsigned long long> g_redis_written{0ULL};
+std::atomic<unsigned long long> g_redis_flushes{0ULL};
+std::atomic<unsigned long long> g_redis_flush_errors{0ULL};
+std::atomic<unsigned long long> g_redis_flush_us{0ULL};
+std::atomic<unsigned long long> g_redis_last_flush_us{0ULL};
+std::atomic<unsigned long long> g_latest_sensors{0ULL};
+std::atomic<unsigned long long> g_latest_reads{0ULL};
+std::atomic<unsigned long long> g_latest_dropped_keys{0ULL};
+std::atomic<unsigned long long> g_wal_appended{0ULL};
+std::atomic<unsigned long long> g_wal_rejected{0ULL};
+std::atomic<unsigned long long> g_wal_replayed{0ULL};
+std::atomic<unsigned long long> g_wal_committed{0ULL};
+std::atomic<unsigned long long> g_wal_bytes{0ULL};
+std::atomic<unsigned long long> g_wal_segments{0ULL};
+std::atomic<unsigned long long> g_wal_written_bytes{0ULL};
+std::atomic<unsigned long long> g_wal_fsyncs{0ULL};
+std::atomic<unsigned long long> g_wal_fsync_us{0ULL};
+std::atomic<unsigned long long> g_wal_write_errors{0ULL};
+std::atomic<unsigned long long> g_wal_corrupt_records{0ULL};
+std::atomic<unsigned long long> g_wal_dead_letter{0ULL};
+std::atomic<unsigned long long> g_rollup_readings{0ULL};
+std::atomic<unsigned long long> g_rollup_late{0ULL};
+std::atomic<unsigned long long> g_rollup_dropped{0ULL};
+std::atomic<unsigned long long> g_rollup_groups{0ULL};
+std::atomic<unsigned long long> g_rollup_rows{0ULL};
+std::atomic<unsigned long long> g_rollup_flush_errors{0ULL};
+
+LatencyHistogram g_lat_parse;
+LatencyHistogram g_lat_wal_sync;
+LatencyHistogram g_lat_queue_wait;
+LatencyHistogram g_lat_batch_wait;
+LatencyHistogram g_lat_ch_insert;
+LatencyHistogram g_lat_redis_flush;
+LatencyHistogram g_lat_rollup_flush;
+LatencyHistogram g_lat_http_write;
+LatencyHistogram g_lat_http_request;
+
+namespace {
+
+void write_metric(std::ostringstream &os, const char *name, const char *type,
+                  const char *help,
+                  const std::atomic<unsigned long long> &value) {
+  os << "# HELP " << name << ' ' << help << "\n";
+  os << "# TYPE " << name << ' ' << type << "\n";
+  os << name << ' ' << value.load(std::memory_order_relaxed) << "\n";
+}
+
+// коды, которые считаем по отдельности; остальные — в "other"
+constexpr int kHttpCodes[] = {200, 202, 400, 404, 413, 429, 500, 503};
+constexpr std::size_t kHttpCodeSlots = std::size(kHttpCodes) + 1;
+std::atomic<unsigned long long> g_http_responses[kHttpCodeSlots];
+
+std::mutex g_workers_m;
+std::deque<ChWorkerStats> g_workers; // deque: ссылки стабильны при росте
+std::deque<QueueShardStats> g_shards;
+std::deque<ChEndpointStats> g_endpoints;
+
+// labels — готовый список меток без скобок: stage="parse"
+void write_histogram(std::ostringstream &os, const char *name,
+                     const std::string &labels, const LatencyHistogram &h) {
+  const auto snap = h.snapshot();
+  std::uint64_t cumulative = 0;
+  for (std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+    cumulative += snap.buckets[i];
+    os << name << "_bucket{" << labels << ",le=\"";
+    if (i + 1 == LatencyHistogram::kBuckets)
+      os << "+Inf";
+    else
+      os << LatencyHistogram::upper_bound_ns(i) / 1e9;
+    os << "\"} " << cumulative << "\n";
+  }
+  os << name << "_sum{" << labels << "} "
+     << static_cast<double>(snap.sum_ns) / 1e9 << "\n";
+  os << name << "_count{" << labels << "} " << cumulative << "\n";
+}
+
+void write_histogram(std::ostringstream &os, const char *stage,
+                     const LatencyHistogram &h) {
+  write_histogram(os, "cpp_sensors_stage_latency_seconds",
+                  std::string("stage=\"") + stage + "\"", h);
+}
+
+} // namespace
+
+void count_http_response(int status) {
+  std::size_t slot = 0;
+  while (slot < std::size(kHttpCodes) && kHttpCodes[slot] != status)
+    ++slot;
+  g_http_responses[slot].fetch_add(1ULL, std::memory_order_relaxed);
+}
+
+ChWorkerStats &ch_worker_stats(std::size_t worker) {
+  std::lock_guard<std::mutex> lk(g_workers_m);
+  while (g_workers.size() <= worker)
+    g_workers.emplace_back();
+  return g_workers[worker];
+}
+
+ChEndpointStats &register_ch_endpoint(std::size_t index, std::string name,
+                                      std::size_t shard) {
+  std::lock_guard<std::mutex> lk(g_workers_m);
+  while (g_endpoints.size() <= index)
+    g_endpoints.emplace_back();
+  g_endpoints[index].name = std::move(name);
+  g_endpoints[index].shard = shard;
+  return g_endpoints[index];
+}
+
+QueueShardStats &queue_shard_stats(std::size_t shard) {
+  std::lock_guard<std::mutex> lk(g_workers_m);
+  while (g_shards.size() <= shard)
+    g_shards.emplace_back();
+  return g_shards[shard];
+}
+
+std::string render_metrics() {
+  std::ostringstream os;
+
+  // gauge: текущий размер очереди
+  write_metric(os, "cpp_sensors_queue_size", "gauge", "Current queue size",
+               g_queue_size);
+  // counter: сколько всего успешно записали пар key/value
+  write_metric(os, "cpp_sensors_total_received", "counter",
+               "Total successfully written metrics", g_total_received);
+  write_metric(os, "cpp_sensors_queue_dequeued_total", "counter",
+               "Tasks taken from the queue by ClickHouse workers",
+               g_queue_dequeued);
+  write_metric(os, "cpp_sensors_queue_drain_rate", "gauge",
+               "Smoothed queue drain rate, tasks per second",
+               g_queue_drain_rate);
+
+  // контроль приёма (429)
+  write_metric(os, "cpp_sensors_admission_shed_total", "counter",
+               "Ingest requests shed early because of queue fill",
+               g_admission_shed);
+  write_metric(os, "cpp_sensors_admission_rate_limited_total", "counter",
+               "Readings rejected by per-sensor rate limits",
+               g_admission_rate_limited);
+
+  // идемпотентность приёма
+  write_metric(os, "cpp_sensors_dedup_suppressed_total", "counter",
+               "Duplicate ingest requests or readings not enqueued again",
+               g_dedup_suppressed);
+  write_metric(os, "cpp_sensors_dedup_in_flight_total", "counter",
+               "Repeats of ingest requests or readings still being written",
+               g_dedup_in_flight);
+  write_metric(os, "cpp_sensors_dedup_rotations_total", "counter",
+               "Idempotency key generation rotations", g_dedup_rotations);
+
+  // групповые подтверждения (http_ack_mode = "group")
+  write_metric(os, "cpp_sensors_ack_notices_total", "counter",
+               "Group-commit notices posted by workers to io threads",
+               g_ack_notices);
+  write_metric(os, "cpp_sensors_ack_timeouts_total", "counter",
+               "Requests answered 202 by the ack timer wheel", g_ack_timeouts);
+
+  // counters: принятые соединения и обработанные запросы (keep-alive)
+  write_metric(os, "cpp_sensors_http_connections_total", "counter",
+               "Accepted HTTP connections", g_http_connections);
+  write_metric(os, "cpp_sensors_http_requests_total", "counter",
+               "Parsed HTTP requests", g_http_requests);
+  write_metric(os, "cpp_sensors_stream_requests_total", "counter",
+               "Streaming NDJSON ingest requests", g_stream_requests);
+  write_metric(os, "cpp_sensors_stream_readings_total", "counter",
+               "Readings enqueued from streaming ingest", g_stream_readings);
+  write_metric(os, "cpp_sensors_stream_pauses_total", "counter",
+               "Streaming reads paused because the queue was full",
+               g_stream_pauses);
+  write_metric(os, "cpp_sensors_ingest_compressed_bytes_total", "counter",
+               "Compressed ingest body bytes received", g_ingest_compressed_bytes);
+  write_metric(os, "cpp_sensors_ingest_decompressed_bytes_total", "counter",
+               "Ingest body bytes after decompression",
+               g_ingest_decompressed_bytes);
+  write_metric(os, "cpp_sensors_ingest_decode_errors_total", "counter",
+               "Compressed ingest bodies rejected as corrupt or too large",
+               g_ingest_decode_errors);
+
+  // бинарный листенер
+  write_metric(os, "cpp_sensors_bin_frames_total", "counter",
+               "Decoded binary ingest frames", g_bin_frames);
+  write_metric(os, "cpp_sensors_bin_readings_total", "counter",
+               "Readings accepted via binary ingest", g_bin_readings);
+  write_metric(os, "cpp_sensors_bin_rejected_total", "counter",
+               "Binary readings rejected because the queue was full",
+               g_bin_rejected);
+  write_metric(os, "cpp_sensors_bin_decode_errors_total", "counter",
+               "Binary connections closed on malformed frames",
+               g_bin_decode_errors);
+
+  // UDP-приём
+  write_metric(os, "cpp_sensors_udp_datagrams_total", "counter",
+               "Received UDP datagrams", g_udp_datagrams);
+  write_metric(os, "cpp_sensors_udp_readings_total", "counter",
+               "Readings accepted via UDP", g_udp_readings);
+  write_metric(os, "cpp_sensors_udp_dropped_total", "counter",
+               "UDP readings dropped because the queue was full",
+               g_udp_dropped);
+  write_metric(os, "cpp_sensors_udp_parse_errors_total", "counter",
+               "UDP datagrams that failed to parse or were truncated",
+               g_udp_parse_errors);
+  write_metric(os, "cpp_sensors_udp_receive_errors_total", "counter",
+               "Socket errors while receiving UDP datagrams",
+               g_udp_receive_errors);
+
+  // стадия записи последних значений в Redis
+  write_metric(os, "cpp_sensors_redis_updates_total", "counter",
+               "Last-value updates submitted to the Redis writer",
+               g_redis_updates);
+  write_metric(os, "cpp_sensors_redis_coalesced_total", "counter",
+               "Updates superseded within a flush window", g_redis_coalesced);
+  write_metric(os, "cpp_sensors_redis_dropped_total", "counter",
+               "Updates dropped because the pending buffer was full",
+               g_redis_dropped);
+  write_metric(os, "cpp_sensors_redis_pending", "gauge",
+               "Sensor/key pairs waiting for the next flush", g_redis_pending);
+  write_metric(os, "cpp_sensors_redis_written_total", "counter",
+               "Sensor/key pairs written to Redis", g_redis_written);
+  write_metric(os, "cpp_sensors_redis_flush_errors_total", "counter",
+               "Failed Redis flushes (pairs are retried)",
+               g_redis_flush_errors);
+  // summary без квантилей: сумма и число успешных сбросов
+  const double flush_sum =
+      static_cast<double>(g_redis_flush_us.load(std::memory_order_relaxed)) /
+      1e6;
+  os << "# HELP cpp_sensors_redis_flush_seconds Duration of pipelined Redis "
+        "flushes\n";
+  os << "# TYPE cpp_sensors_redis_flush_seconds summary\n";
+  os << "cpp_sensors_redis_flush_seconds_sum " << flush_sum << "\n";
+  os << "cpp_sensors_redis_flush_seconds_count "
+     << g_redis_flushes.load(std::memory_order_relaxed) << "\n";
+  os << "# HELP cpp_sensors_redis_last_flush_seconds Duration of the last "
+        "Redis flush\n";
+  os << "# TYPE cpp_sensors_redis_last_flush_seconds gauge\n";
+  os << "cpp_sensors_redis_last_flush_seconds "
+     << static_cast<double>(
+            g_redis_last_flush_us.load(std::memory_order_relaxed)) /
+            1e6
+     << "\n";
+
+  // кэш последних значений (GET /latest)
+  write_metric(os, "cpp_sensors_latest_sensors", "gauge",
+               "Sensors present in the in-process last-value cache",
+               g_latest_sensors);
+  write_metric(os, "cpp_sensors_latest_reads_total", "counter",
+               "Served GET /latest requests", g_latest_reads);
+  write_metric(os, "cpp_sensors_latest_dropped_keys_total", "counter",
+               "Metric keys not cached because a sensor hit the key limit",
+               g_latest_dropped_keys);
+
+  // журнал на диске
+  write_metric(os, "cpp_sensors_wal_appended_total", "counter",
+               "Readings accepted into the write-ahead log",
+               g_wal_appended);
+  write_metric(os, "cpp_sensors_wal_rejected_total", "counter",
+               "Readings rejected because the write-ahead log was full",
+               g_wal_rejected);
+  write_metric(os, "cpp_sensors_wal_replayed_total", "counter",
+               "Readings fed from the write-ahead log into the queue",
+               g_wal_replayed);
+  write_metric(os, "cpp_sensors_wal_committed_total", "counter",
+               "Readings from the write-ahead log inserted into ClickHouse",
+               g_wal_committed);
+  write_metric(os, "cpp_sensors_wal_bytes", "gauge",
+               "Bytes held in write-ahead log segments", g_wal_bytes);
+  write_metric(os, "cpp_sensors_wal_segments", "gauge",
+               "Write-ahead log segments on disk", g_wal_segments);
+  write_metric(os, "cpp_sensors_wal_written_bytes_total", "counter",
+               "Bytes written to write-ahead log segments",
+               g_wal_written_bytes);
+  write_metric(os, "cpp_sensors_wal_write_errors_total", "counter",
+               "Failed write-ahead log writes (readings answered 500)",
+               g_wal_write_errors);
+  write_metric(os, "cpp_sensors_wal_corrupt_records_total", "counter",
+               "Damaged or torn write-ahead log records skipped on replay",
+               g_wal_corrupt_records);
+  write_metric(os, "cpp_sensors_wal_dead_letter_total", "counter",
+               "Readings rejected by ClickHouse and moved out of the "
+               "write-ahead log",
+               g_wal_dead_letter);
+  os << "# HELP cpp_sensors_wal_fsync_seconds Duration of group-commit "
+        "writes including fdatasync\n";
+  os << "# TYPE cpp_sensors_wal_fsync_seconds summary\n";
+  os << "cpp_sensors_wal_fsync_seconds_sum "
+     << static_cast<double>(g_wal_fsync_us.load(std::memory_order_relaxed)) /
+            1e6
+     << "\n";
+  os << "cpp_sensors_wal_fsync_seconds_count "
+     << g_wal_fsyncs.load(std::memory_order_relaxed) << "\n";
+
+  // предагрегация в rollup-таблицы
+  write_metric(os, "cpp_sensors_rollup_readings_total", "counter",
+               "Readings passed to the rollup stage", g_rollup_readings);
+  write_metric(os, "cpp_sensors_rollup_late_total", "counter",
+               "Readings that arrived after their window closed (per window)",
+               g_rollup_late);
+  write_metric(os, "cpp_sensors_rollup_dropped_total", "counter",
+               "Readings not aggregated because rollup_max_groups was reached",
+               g_rollup_dropped);
+  write_metric(os, "cpp_sensors_rollup_groups", "gauge",
+               "Open sensor/key/window aggregation groups", g_rollup_groups);
+  write_metric(os, "cpp_sensors_rollup_rows_total", "counter",
+               "Aggregate rows inserted into rollup tables", g_rollup_rows);
+  write_metric(os, "cpp_sensors_rollup_flush_errors_total", "counter",
+               "Failed rollup table inserts (rows are retried)",
+               g_rollup_flush_errors);
+
+  // HTTP-ответы по кодам
+  os << "# HELP cpp_sensors_http_responses_total HTTP responses by status "
+        "code\n";
+  os << "# TYPE cpp_sensors_http_responses_total counter\n";
+  for (std::size_t i = 0; i < kHttpCodeSlots; ++i) {
+    os << "cpp_sensors_http_responses_total{code=\"";
+    if (i < std::size(kHttpCodes))
+      os << kHttpCodes[i];
+    else
+      os << "other";
+    os << "\"} " << g_http_responses[i].load(std::memory_order_relaxed)
+       << "\n";
+  }
+
+  // воркеры ClickHouse
+  {
+    std::lock_guard<std::mutex> lk(g_workers_m);
+    const struct {
+      const char *name;
+      const char *help;
+      std::atomic<unsigned long long> ChWorkerStats::*field;
+    } series[] = {
+        {"cpp_sensors_ch_worker_inserts_total",
+         "Successful ClickHouse inserts (batches) per worker",
+         &ChWorkerStats::inserts},
+        {"cpp_sensors_ch_worker_rows_total",
+         "Rows inserted into ClickHouse per worker", &ChWorkerStats::rows},
+        {"cpp_sensors_ch_worker_insert_errors_total",
+         "Failed ClickHouse inserts per worker", &ChWorkerStats::errors},
+        {"cpp_sensors_ch_worker_reconnects_total",
+         "ClickHouse reconnects after connection or insert errors per worker",
+         &ChWorkerStats::reconnects},
+    };
+    for (const auto &m : series) {
+      os << "# HELP " << m.name << ' ' << m.help << "\n";
+      os << "# TYPE " << m.name << " counter\n";
+      for (std::size_t w = 0; w < g_workers.size(); ++w)
+        os << m.name << "{worker=\"" << w << "\"} "
+           << (g_workers[w].*m.field).load(std::memory_order_relaxed) << "\n";
+    }
+  }
+
+  // узлы ClickHouse
+  {
+    std::lock_guard<std::mutex> lk(g_workers_m);
+    if (!g_endpoints.empty()) {
+      const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        std::atomic<unsigned long long> ChEndpointStats::*field;
+      } series[] = {
+          {"cpp_sensors_ch_endpoint_up", "gauge",
+           "ClickHouse endpoint is healthy and eligible for inserts",
+           &ChEndpointStats::up},
+          {"cpp_sensors_ch_endpoint_inserts_total", "counter",
+           "Successful ClickHouse inserts (batches) per endpoint",
+           &ChEndpointStats::inserts},
+          {"cpp_sensors_ch_endpoint_rows_total", "counter",
+           "Rows inserted into ClickHouse per endpoint",
+           &ChEndpointStats::rows},
+          {"cpp_sensors_ch_endpoint_insert_errors_total", "counter",
+           "Failed ClickHouse inserts and connects per endpoint",
+           &ChEndpointStats::errors},
+          {"cpp_sensors_ch_endpoint_probe_failures_total", "counter",
+           "Failed ClickHouse health-check pings per endpoint",
+           &ChEndpointStats::probe_failures},
+          {"cpp_sensors_ch_endpoint_score_microseconds", "gauge",
+           "Smoothed latency estimate used to pick an endpoint",
+           &ChEndpointStats::score_us},
+      };
+      std::vector<std::string> labels;
+      for (const auto &e : g_endpoints)
+        labels.push_back("endpoint=\"" + e.name + "\",shard=\"" +
+                         std::to_string(e.shard) + "\"");
+      for (const auto &m : series) {
+        os << "# HELP " << m.name << ' ' << m.help << "\n";
+        os << "# TYPE " << m.name << ' ' << m.type << "\n";
+        for (std::size_t i = 0; i < g_endpoints.size(); ++i)
+          os << m.name << '{' << labels[i] << "} "
+             << (g_endpoints[i].*m.field).load(std::memory_order_relaxed)
+             << "\n";
+      }
+      os << "# HELP cpp_sensors_ch_endpoint_insert_seconds Duration of "
+            "ClickHouse inserts per endpoint\n";
+      os << "# TYPE cpp_sensors_ch_endpoint_insert_seconds histogram\n";
+      for (std::size_t i = 0; i < g_endpoints.size(); ++i)
+        write_histogram(os, "cpp_sensors_ch_endpoint_insert_seconds",
+                        labels[i], g_endpoints[i].insert_latency);
+    }
+  }
+
+  // шарды очереди
+  {
+    std::lock_guard<std::mutex> lk(g_workers_m);
+    if (!g_shards.empty()) {
+      os << "# HELP cpp_sensors_queue_shard_depth Tasks waiting in a queue "
+            "shard\n";
+      os << "# TYPE cpp_sensors_queue_shard_depth gauge\n";
+      for (std::size_t i = 0; i < g_shards.size(); ++i)
+        os << "cpp_sensors_queue_shard_depth{shard=\"" << i << "\"} "
+           << g_shards[i].depth.load(std::memory_order_relaxed) << "\n";
+      os << "# HELP cpp_sensors_queue_shard_steals_total Batches taken from a "
+            "shard by a worker it is not home to\n";
+      os << "# TYPE cpp_sensors_queue_shard_steals_total counter\n";
+      for (std::size_t i = 0; i < g_shards.size(); ++i)
+        os << "cpp_sensors_queue_shard_steals_total{shard=\"" << i << "\"} "
+           << g_shards[i].steals.load(std::memory_order_relaxed) << "\n";
+    }
+  }
+
+  // задержки по стадиям
+  os << "# HELP cpp_sensors_stage_latency_seconds Latency of ingest pipeline "
+        "stages\n";
+  os << "# TYPE cpp_sensors_stage_latency_seconds histogram\n";
+  write_histogram(os, "parse", g_lat_parse);
+  write_histogram(os, "wal_sync", g_lat_wal_sync);
+  write_histogram(os, "queue_wait", g_lat_queue_wait);
+  write_histogram(os, "batch_wait", g_lat_batch_wait);
+  write_histogram(os, "ch_insert", g_lat_ch_insert);
+  write_histogram(os, "redis_flush", g_lat_redis_flush);
+  write_histogram(os, "rollup_flush", g_lat_rollup_flush);
+  write_histogram(os, "http_write", g_lat_http_write);
+  write_histogram(os, "http_request", g_lat_http_request);
+
+  // gauge: размер таблицы интернирования sensor_id и ключей метрик
+  os << "# HELP cpp_sensors_interned_symbols Distinct interned sensor ids and "
+        "metric keys\n";
+  os << "# TYPE cpp_sensors_interned_symbols gauge\n";
+  os << "cpp_sensors_interned_symbols " << g_symbols.size() << "\n";
+
+  return os.str();
+}
+
 } // namespace sensors
@@ -28,22 +28,20 @@ RedisClient::RedisClient(const RedisConfig &cfg) {
 
 RedisClient::~RedisClient() = default;
 
-void RedisClient::save_metric(const std::string &sensor_id,
-                              const std::string &key, double value,
-                              std::int64_t ts) {
+bool RedisClient::hset_pipelined(const std::vector<Hash> &hashes) {
   if (!enabled_ || !redis_) {
-    return;
+    return false;
   }
 
   try {
-    const std::string redis_key = "sensor:" + sensor_id;
-    const std::string field_value = key;
-    const std::string field_ts = key + ":ts";
-
-    redis_->hset(redis_key, field_value, std::to_string(value));
-    redis_->hset(redis_key, field_ts, std::to_string(ts));
+    // соединение берём из пула клиента, а не открываем новое на каждый сброс
+    auto pipe = redis_->pipeline(false);
+    for (const auto &h : hashes)
+      pipe.hset(h.key, h.fields.begin(), h.fields.end());
+    pipe.exec();
+    return true;
   } catch (...) {
-    // на первом шаге просто молчим при ошибках Redis
+    return false;
   }
 }
 
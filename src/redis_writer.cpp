@@ -0,0 +1,188 @@
+#include "sensors/redis_writer.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/redis_client.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace sensors {
+
+namespace {
+
+inline void log_err(const char *tag, const std::string &msg) {
+  std::fprintf(stderr, "[%s] %s\n", tag, msg.c_str());
+  std::fflush(stderr);
+}
+
+// entries сгруппированы по датчику: на каждый датчик один HSET с полями
+// <key> и <key>:ts (формат значений прежний — std::to_string)
+std::vector<RedisClient::Hash>
+build_hashes(const std::vector<LastValueBuffer::Entry> &entries) {
+  std::vector<RedisClient::Hash> hashes;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const auto &e = entries[i];
+    if (i == 0 || entries[i - 1].sensor != e.sensor)
+      hashes.push_back({"sensor:" + std::string(g_symbols.view(e.sensor)), {}});
+    const std::string field(g_symbols.view(e.key));
+    auto &fields = hashes.back().fields;
+    fields.emplace_back(field, std::to_string(e.value));
+    fields.emplace_back(field + ":ts", std::to_string(e.ts));
+  }
+  return hashes;
+}
+
+// сброс через RedisClient: соединение создаётся при первом сбросе и после
+// обрыва, попытки подключиться — не чаще раза в reconnect_delay
+RedisWriter::Flush connect_flush(const Config &cfg) {
+  struct State {
+    RedisConfig rcfg;
+    std::unique_ptr<RedisClient> client;
+    std::chrono::steady_clock::time_point next_connect;
+  };
+  auto st = std::make_shared<State>();
+  st->rcfg.redis_enabled = true;
+  st->rcfg.redis_host = cfg.redis_host;
+  st->rcfg.redis_port = cfg.redis_port;
+  return [st](const std::vector<RedisClient::Hash> &hashes) {
+    const auto reconnect_delay = std::chrono::milliseconds(3000);
+    const auto now = std::chrono::steady_clock::now();
+    if ((!st->client || !st->client->is_enabled()) && now >= st->next_connect) {
+      st->client = std::make_unique<RedisClient>(st->rcfg);
+      if (!st->client->is_enabled()) {
+        log_err("REDIS", "connect failed: host=" + st->rcfg.redis_host +
+                             " port=" + std::to_string(st->rcfg.redis_port) +
+                             " — retry in " +
+                             std::to_string(reconnect_delay.count()) + "ms");
+        st->next_connect = now + reconnect_delay;
+      }
+    }
+    return st->client && st->client->is_enabled() &&
+           st->client->hset_pipelined(hashes);
+  };
+}
+
+} // namespace
+
+RedisWriter::RedisWriter(const Config &cfg)
+    : RedisWriter(cfg, connect_flush(cfg)) {}
+
+RedisWriter::RedisWriter(const Config &cfg, Flush flush)
+    : cfg_(cfg), flush_(std::move(flush)) {}
+
+RedisWriter::~RedisWriter() { stop(); }
+
+void RedisWriter::start() {
+  if (running_.exchange(true))
+    return;
+  thread_ = std::make_unique<boost::thread>([this] {
+    try {
+      run();
+    } catch (const std::exception &e) {
+      log_err("ERR", std::string("Redis writer fatal: ") + e.what());
+    }
+  });
+}
+
+void RedisWriter::stop() {
+  {
+    boost::lock_guard<boost::mutex> lk(m_);
+    if (!running_.exchange(false))
+      return;
+  }
+  cv_.notify_all();
+  if (thread_ && thread_->joinable())
+    thread_->join();
+  thread_.reset();
+}
+
+void RedisWriter::submit(const std::vector<EnqueuedTask> &batch) {
+  unsigned long long updates = 0, coalesced = 0, dropped = 0;
+  {
+    boost::lock_guard<boost::mutex> lk(m_);
+    for (const auto &t : batch) {
+      for (const auto &kv : t.kv) {
+        ++updates;
+        if (buffer_.size() >= cfg_.redis_max_pending &&
+            !buffer_.contains(t.sensor, kv.first)) {
+          ++dropped; // Redis не успевает/лежит — новые пары не копим
+          continue;
+        }
+        if (!buffer_.put(t.sensor, kv.first, kv.second, t.ts))
+          ++coalesced;
+      }
+    }
+    g_redis_pending.store(buffer_.size(), std::memory_order_relaxed);
+  }
+  g_redis_updates.fetch_add(updates, std::memory_order_relaxed);
+  g_redis_coalesced.fetch_add(coalesced, std::memory_order_relaxed);
+  if (dropped)
+    g_redis_dropped.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+// неудачный сброс возвращаем в буфер, если пару ещё не обновили заново;
+// предел тот же, что у submit: пока Redis лежит, буфер не растёт
+void RedisWriter::requeue(const std::vector<LastValueBuffer::Entry> &entries) {
+  unsigned long long dropped = 0;
+  {
+    boost::lock_guard<boost::mutex> lk(m_);
+    for (const auto &e : entries) {
+      if (buffer_.contains(e.sensor, e.key))
+        continue;
+      if (buffer_.size() >= cfg_.redis_max_pending) {
+        ++dropped;
+        continue;
+      }
+      buffer_.put(e.sensor, e.key, e.value, e.ts);
+    }
+    g_redis_pending.store(buffer_.size(), std::memory_order_relaxed);
+  }
+  if (dropped)
+    g_redis_dropped.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+void RedisWriter::run() {
+  const auto interval = boost::chrono::milliseconds(
+      cfg_.redis_flush_interval_ms > 0 ? cfg_.redis_flush_interval_ms : 1);
+  std::vector<LastValueBuffer::Entry> entries;
+
+  boost::unique_lock<boost::mutex> lk(m_);
+  for (;;) {
+    cv_.wait_for(lk, interval, [&] { return !running_.load(); });
+    const bool last = !running_.load();
+    buffer_.drain(entries);
+    g_redis_pending.store(0, std::memory_order_relaxed);
+    lk.unlock();
+
+    if (!entries.empty()) {
+      const auto t0 = std::chrono::steady_clock::now();
+      const bool ok = flush_(build_hashes(entries));
+      const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count();
+      if (ok) {
+        g_redis_flushes.fetch_add(1ULL, std::memory_order_relaxed);
+        g_lat_redis_flush.observe_us(us);
+        g_redis_flush_us.fetch_add(static_cast<unsigned long long>(us),
+                                   std::memory_order_relaxed);
+        g_redis_last_flush_us.store(static_cast<unsigned long long>(us),
+                                    std::memory_order_relaxed);
+        g_redis_written.fetch_add(entries.size(), std::memory_order_relaxed);
+      } else {
+        g_redis_flush_errors.fetch_add(1ULL, std::memory_order_relaxed);
+        if (!last)
+          requeue(entries);
+      }
+      entries.clear();
+    }
+
+    if (last)
+      return;
+    lk.lock();
+  }
+}
+
+} // namespace sensors
@@ -0,0 +1,221 @@
+#include "sensors/rollup_writer.hpp"
+#include "sensors/ch_block.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/time_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <clickhouse/client.h>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+namespace sensors {
+
+namespace {
+
+inline void log_err(const char *tag, const std::string &msg) {
+  std::fprintf(stderr, "[%s] %s\n", tag, msg.c_str());
+  std::fflush(stderr);
+}
+
+} // namespace
+
+RollupWriter::RollupWriter(const Config &cfg) : cfg_(cfg) {
+  // окна по возрастанию размера — порядок вставки по таблицам стабилен
+  std::vector<std::pair<std::string, int>> windows(cfg.rollup_windows.begin(),
+                                                   cfg.rollup_windows.end());
+  std::sort(windows.begin(), windows.end(),
+            [](const auto &a, const auto &b) { return a.second < b.second; });
+  for (const auto &[table, seconds] : windows) {
+    if (seconds <= 0)
+      continue;
+    windows_.push_back({table, RollupBuffer(seconds, cfg.rollup_grace_s,
+                                            cfg.rollup_max_groups)});
+  }
+}
+
+RollupWriter::~RollupWriter() { stop(); }
+
+void RollupWriter::start(ChEndpointSet &endpoints) {
+  if (windows_.empty() || running_.exchange(true))
+    return;
+  endpoints_ = &endpoints;
+  thread_ = std::make_unique<boost::thread>([this] {
+    try {
+      run();
+    } catch (const std::exception &e) {
+      log_err("ERR", std::string("rollup writer fatal: ") + e.what());
+    }
+  });
+}
+
+void RollupWriter::stop() {
+  {
+    boost::lock_guard<boost::mutex> lk(m_);
+    if (!running_.exchange(false))
+      return;
+  }
+  cv_.notify_all();
+  if (thread_ && thread_->joinable())
+    thread_->join();
+  thread_.reset();
+}
+
+std::size_t RollupWriter::open_groups() const {
+  std::size_t n = 0;
+  for (const auto &w : windows_)
+    n += w.buffer.size();
+  return n;
+}
+
+void RollupWriter::submit(const std::vector<EnqueuedTask> &batch) {
+  if (windows_.empty())
+    return;
+  const std::int64_t now = unix_now_s();
+  unsigned long long readings = 0, late = 0, dropped = 0;
+  {
+    boost::lock_guard<boost::mutex> lk(m_);
+    for (const auto &t : batch) {
+      const std::int64_t ts = to_time_t_seconds(static_cast<int64_t>(t.ts));
+      const std::int64_t received = t.received_s ? t.received_s : now;
+      for (const auto &kv : t.kv) {
+        ++readings;
+        for (auto &w : windows_) {
+          switch (w.buffer.put(t.sensor, kv.first, kv.second, ts, received)) {
+          case RollupBuffer::Put::late:
+            ++late;
+            break;
+          case RollupBuffer::Put::full:
+            ++dropped; // ClickHouse не успевает/лежит — новые группы не копим
+            break;
+          default:
+            break;
+          }
+        }
+      }
+    }
+    g_rollup_groups.store(open_groups(), std::memory_order_relaxed);
+  }
+  g_rollup_readings.fetch_add(readings, std::memory_order_relaxed);
+  if (late)
+    g_rollup_late.fetch_add(late, std::memory_order_relaxed);
+  if (dropped)
+    g_rollup_dropped.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+void RollupWriter::run() {
+  const auto interval = boost::chrono::milliseconds(
+      cfg_.rollup_flush_interval_ms > 0 ? cfg_.rollup_flush_interval_ms : 1);
+  const std::size_t shards = endpoints_->shards();
+
+  // соединение с узлом шарда; узел выбирается заново после ошибки или
+  // когда проверка здоровья пула его выключила
+  struct Conn {
+    std::size_t node{ChEndpointSet::npos};
+    std::unique_ptr<clickhouse::Client> client;
+  };
+  std::vector<Conn> conns(shards);
+  std::vector<std::vector<RollupBuffer::Row>> rows(windows_.size());
+  std::vector<std::vector<RollupBuffer::Row>> parts(shards);
+
+  // false — строки не вставлены (нет живого узла, ошибка соединения или
+  // вставки)
+  auto insert = [&](std::size_t shard, const std::string &table,
+                    const std::vector<RollupBuffer::Row> &part) {
+    Conn &c = conns[shard];
+    if (c.client && !endpoints_->healthy(c.node))
+      c.client.reset();
+    if (!c.client) {
+      const std::size_t node = endpoints_->pick(shard, 0);
+      if (node == ChEndpointSet::npos)
+        return false;
+      const ChEndpoint &ep = endpoints_->endpoint(node);
+      try {
+        clickhouse::ClientOptions opts;
+        opts.SetHost(ep.host)
+            .SetPort(ep.port)
+            .SetDefaultDatabase(cfg_.ch_database)
+            .SetConnectionConnectTimeout(std::chrono::milliseconds(
+                std::max(1, cfg_.ch_connect_timeout_ms)));
+        if (cfg_.ch_insert_timeout_ms > 0) {
+          const std::chrono::milliseconds timeout(cfg_.ch_insert_timeout_ms);
+          opts.SetConnectionRecvTimeout(timeout).SetConnectionSendTimeout(
+              timeout);
+        }
+        if (!cfg_.ch_user.empty())
+          opts.SetUser(cfg_.ch_user);
+        if (!cfg_.ch_password.empty())
+          opts.SetPassword(cfg_.ch_password);
+        c.client = std::make_unique<clickhouse::Client>(opts);
+        c.node = node;
+      } catch (const std::exception &e) {
+        endpoints_->on_failure(node, true);
+        log_err("ROLLUP", "connect to " + ep.name() + " failed: " + e.what());
+        return false;
+      }
+    }
+    const std::int64_t t0 = mono_ns();
+    try {
+      c.client->Insert(table,
+                       build_rollup_block(part, cfg_.ch_low_cardinality));
+      g_lat_rollup_flush.observe_since(t0);
+      g_rollup_rows.fetch_add(part.size(), std::memory_order_relaxed);
+      return true;
+    } catch (const std::exception &e) {
+      // отказ сервера — узел жив; прочее — сеть или таймаут, узел
+      // выключается
+      const bool down =
+          dynamic_cast<const clickhouse::ServerException *>(&e) == nullptr;
+      endpoints_->on_failure(c.node, down);
+      log_err("ROLLUP", "insert into " + table + " on " +
+                            endpoints_->endpoint(c.node).name() +
+                            " failed: " + e.what());
+      c.client.reset(); // переподключимся на следующем сбросе
+      return false;
+    }
+  };
+
+  boost::unique_lock<boost::mutex> lk(m_);
+  for (;;) {
+    cv_.wait_for(lk, interval, [&] { return !running_.load(); });
+    const bool last = !running_.load();
+    const std::int64_t now = unix_now_s();
+    for (std::size_t i = 0; i < windows_.size(); ++i)
+      windows_[i].buffer.drain_closed(now, rows[i], last);
+    g_rollup_groups.store(open_groups(), std::memory_order_relaxed);
+    lk.unlock();
+
+    for (std::size_t i = 0; i < windows_.size(); ++i) {
+      if (rows[i].empty())
+        continue;
+      // по шардам ClickHouse, как и сырые строки: хэш sensor_id
+      if (shards == 1) {
+        parts[0].swap(rows[i]);
+      } else {
+        for (const auto &row : rows[i])
+          parts[ch_shard_of(g_symbols.view(row.sensor), shards)].push_back(
+              row);
+      }
+      rows[i].clear();
+      for (std::size_t s = 0; s < shards; ++s) {
+        if (parts[s].empty())
+          continue;
+        if (!insert(s, windows_[i].table, parts[s])) {
+          g_rollup_flush_errors.fetch_add(1ULL, std::memory_order_relaxed);
+          if (!last) {
+            boost::lock_guard<boost::mutex> relk(m_);
+            windows_[i].buffer.restore(parts[s]);
+          }
+        }
+        parts[s].clear();
+      }
+    }
+
+    if (last)
+      return;
+    lk.lock();
+  }
+}
+
+} // namespace sensors
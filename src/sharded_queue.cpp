@@ -0,0 +1,386 @@
+#include "sensors/sharded_queue.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/mpmc_ring_queue.hpp"
+#include "sensors/threadsafe_queue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace sensors {
+
+struct ShardedTaskQueue::Shard {
+  std::unique_ptr<BoundedQueue<EnqueuedTask>> q;
+  // занято местом: растёт до push (резерв), уменьшается после pop,
+  // поэтому во вложенной очереди всегда есть место под резерв
+  std::atomic<std::size_t> depth{0};
+  std::atomic<bool> claimed{false};
+  QueueShardStats *stats{nullptr};
+};
+
+ShardedTaskQueue::ShardedTaskQueue(std::size_t shards,
+                                   std::size_t capacity_per_shard,
+                                   const std::string &impl,
+                                   std::size_t workers,
+                                   std::size_t steal_min_depth)
+    : capacity_(std::max<std::size_t>(capacity_per_shard, 1)),
+      workers_(std::max<std::size_t>(workers, 1)),
+      steal_min_depth_(std::max<std::size_t>(steal_min_depth, 1)) {
+  if (impl != "mutex" && impl != "mpmc")
+    throw std::invalid_argument("unknown queue_impl: " + impl +
+                                " (expected \"mutex\" or \"mpmc\")");
+  shards_.reserve(std::max<std::size_t>(shards, 1));
+  for (std::size_t i = 0; i < std::max<std::size_t>(shards, 1); ++i) {
+    auto s = std::make_unique<Shard>();
+    if (impl == "mutex")
+      s->q = std::make_unique<ThreadSafeQueue<EnqueuedTask>>(capacity_);
+    else
+      s->q = std::make_unique<MpmcRingQueue<EnqueuedTask>>(capacity_);
+    s->stats = &queue_shard_stats(i);
+    shards_.push_back(std::move(s));
+  }
+}
+
+ShardedTaskQueue::~ShardedTaskQueue() {
+  // задачи, оставшиеся в шардах, уходят вместе с очередью
+  for (auto &s : shards_)
+    s->stats->depth.fetch_sub(s->depth.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+}
+
+std::size_t ShardedTaskQueue::shard_of(SymbolId sensor) const noexcept {
+  // id интернированы подряд; перемешиваем, чтобы соседние датчики
+  // не ложились в соседние шарды одной волной
+  const std::uint64_t h =
+      static_cast<std::uint64_t>(sensor) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<std::size_t>((h >> 32) % shards_.size());
+}
+
+std::size_t ShardedTaskQueue::depth(std::size_t shard) const noexcept {
+  return shards_[shard]->depth.load(std::memory_order_acquire);
+}
+
+bool ShardedTaskQueue::reserve(Shard &s, std::size_t n) {
+  std::size_t cur = s.depth.load(std::memory_order_relaxed);
+  do {
+    if (cur + n > capacity_)
+      return false;
+  } while (!s.depth.compare_exchange_weak(cur, cur + n,
+                                          std::memory_order_seq_cst));
+  s.stats->depth.fetch_add(n, std::memory_order_relaxed);
+  return true;
+}
+
+void ShardedTaskQueue::unreserve(Shard &s, std::size_t n) {
+  s.depth.fetch_sub(n, std::memory_order_seq_cst);
+  s.stats->depth.fetch_sub(n, std::memory_order_relaxed);
+  notify_producers();
+}
+
+// Счётчик спящих увеличивается до проверки предиката под мьютексом, а
+// будящая сторона после изменения depth (seq_cst) читает счётчик — так
+// либо спящий увидит изменение, либо будящий увидит спящего. Будим всех:
+// предикат у воркеров разный (свои шарды / кража), и notify_one мог бы
+// разбудить не того.
+void ShardedTaskQueue::notify_consumers() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (consumers_parked_.load(std::memory_order_relaxed) == 0)
+    return;
+  {
+    boost::lock_guard<boost::mutex> lk(park_m_);
+  }
+  cv_items_.notify_all();
+}
+
+void ShardedTaskQueue::notify_producers() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (producers_parked_.load(std::memory_order_relaxed) == 0)
+    return;
+  {
+    boost::lock_guard<boost::mutex> lk(park_m_);
+  }
+  cv_space_.notify_all();
+}
+
+template <class Pred>
+bool ShardedTaskQueue::wait(std::atomic<int> &waiters,
+                            boost::condition_variable &cv,
+                            std::chrono::steady_clock::time_point deadline,
+                            Pred pred) {
+  waiters.fetch_add(1, std::memory_order_seq_cst);
+  bool ok = false;
+  {
+    boost::unique_lock<boost::mutex> lk(park_m_);
+    for (;;) {
+      if (pred()) {
+        ok = true;
+        break;
+      }
+      const auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= std::chrono::steady_clock::duration::zero())
+        break;
+      cv.wait_for(lk, boost::chrono::nanoseconds(
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              left)
+                              .count()));
+    }
+  }
+  waiters.fetch_sub(1, std::memory_order_relaxed);
+  return ok;
+}
+
+template <class U> bool ShardedTaskQueue::push_one(U &&v, bool block) {
+  Shard &s = *shards_[shard_of(v.sensor)];
+  for (;;) {
+    if (stopped_.load(std::memory_order_acquire))
+      return false;
+    if (reserve(s, 1)) {
+      if (!s.q->try_push(std::forward<U>(v))) {
+        unreserve(s, 1); // остановлена между проверкой и push
+        return false;
+      }
+      notify_consumers();
+      return true;
+    }
+    if (!block)
+      return false;
+    wait(producers_parked_, cv_space_,
+         std::chrono::steady_clock::now() + std::chrono::milliseconds(100),
+         [&] {
+           return stopped_.load(std::memory_order_relaxed) ||
+                  s.depth.load(std::memory_order_relaxed) < capacity_;
+         });
+  }
+}
+
+bool ShardedTaskQueue::push(const EnqueuedTask &v) { return push_one(v, true); }
+bool ShardedTaskQueue::push(EnqueuedTask &&v) {
+  return push_one(std::move(v), true);
+}
+bool ShardedTaskQueue::try_push(const EnqueuedTask &v) {
+  return push_one(v, false);
+}
+bool ShardedTaskQueue::try_push(EnqueuedTask &&v) {
+  return push_one(std::move(v), false);
+}
+
+bool ShardedTaskQueue::try_push_bulk(std::vector<EnqueuedTask> &items) {
+  if (items.empty())
+    return true;
+  if (stopped_.load(std::memory_order_acquire))
+    return false;
+
+  std::vector<std::size_t> count(shards_.size(), 0);
+  for (const auto &t : items)
+    ++count[shard_of(t.sensor)];
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    if (count[i] && !reserve(*shards_[i], count[i])) {
+      for (std::size_t j = 0; j < i; ++j)
+        if (count[j])
+          unreserve(*shards_[j], count[j]);
+      return false;
+    }
+  }
+
+  // место зарезервировано: раскладываем с сохранением порядка внутри шарда
+  std::vector<std::vector<EnqueuedTask>> groups(shards_.size());
+  for (std::size_t i = 0; i < shards_.size(); ++i)
+    if (count[i])
+      groups[i].reserve(count[i]);
+  for (auto &t : items)
+    groups[shard_of(t.sensor)].push_back(std::move(t));
+  items.clear();
+  bool ok = true;
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    if (!count[i] || shards_[i]->q->try_push_bulk(groups[i]))
+      continue;
+    // вложенную очередь остановили посреди раскладки: часть пачки уже
+    // в шардах, не легшие задачи возвращаем в items
+    unreserve(*shards_[i], count[i]);
+    for (auto &t : groups[i])
+      items.push_back(std::move(t));
+    ok = false;
+  }
+  notify_consumers();
+  return ok;
+}
+
+std::size_t ShardedTaskQueue::take(Shard &s, std::vector<EnqueuedTask> &out,
+                                   std::size_t max) {
+  const std::size_t n = s.q->pop_bulk(out, max);
+  if (n)
+    unreserve(s, n);
+  return n;
+}
+
+bool ShardedTaskQueue::claim(Shard &s) {
+  bool expected = false;
+  return s.claimed.compare_exchange_strong(expected, true,
+                                           std::memory_order_acq_rel);
+}
+
+std::size_t ShardedTaskQueue::try_acquire(std::size_t worker) {
+  const std::size_t home = worker % workers_;
+  // сначала свои шарды (любой непустой), затем кража у перегруженных
+  for (const bool own : {true, false}) {
+    for (int attempt = 0; attempt < 4; ++attempt) {
+      std::size_t best = npos;
+      std::size_t best_depth = own ? 0 : steal_min_depth_ - 1;
+      for (std::size_t i = 0; i < shards_.size(); ++i) {
+        if ((i % workers_ == home) != own)
+          continue;
+        const Shard &s = *shards_[i];
+        const std::size_t d = s.depth.load(std::memory_order_relaxed);
+        if (d > best_depth && !s.claimed.load(std::memory_order_relaxed)) {
+          best = i;
+          best_depth = d;
+        }
+      }
+      if (best == npos)
+        break;
+      if (claim(*shards_[best])) {
+        if (!own)
+          shards_[best]->stats->steals.fetch_add(1, std::memory_order_relaxed);
+        return best;
+      }
+    }
+  }
+  return npos;
+}
+
+std::size_t ShardedTaskQueue::acquire(std::size_t worker,
+                                      std::vector<EnqueuedTask> &out,
+                                      std::size_t max,
+                                      std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const std::size_t home = worker % workers_;
+  auto available = [&] {
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      const Shard &s = *shards_[i];
+      const std::size_t need = i % workers_ == home ? 1 : steal_min_depth_;
+      if (s.depth.load(std::memory_order_relaxed) >= need &&
+          !s.claimed.load(std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  };
+  for (;;) {
+    const std::size_t s = try_acquire(worker);
+    if (s != npos) {
+      if (take(*shards_[s], out, max))
+        return s;
+      // резерв уже есть, а задача ещё не легла во вложенную очередь
+      release(s);
+      continue;
+    }
+    if (stopped_.load(std::memory_order_acquire))
+      return npos;
+    if (!wait(consumers_parked_, cv_items_, deadline, [&] {
+          return stopped_.load(std::memory_order_relaxed) || available();
+        }))
+      return npos;
+  }
+}
+
+std::size_t ShardedTaskQueue::pop_bulk_from(std::size_t shard,
+                                            std::vector<EnqueuedTask> &out,
+                                            std::size_t max) {
+  return take(*shards_[shard], out, max);
+}
+
+std::size_t ShardedTaskQueue::pop_for_from(std::size_t shard,
+                                           std::vector<EnqueuedTask> &out,
+                                           std::size_t max,
+                                           std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  Shard &s = *shards_[shard];
+  for (;;) {
+    if (const std::size_t n = take(s, out, max))
+      return n;
+    if (stopped_.load(std::memory_order_acquire))
+      return 0;
+    if (!wait(consumers_parked_, cv_items_, deadline, [&] {
+          return stopped_.load(std::memory_order_relaxed) ||
+                 s.depth.load(std::memory_order_relaxed) > 0;
+        }))
+      return take(s, out, max);
+  }
+}
+
+void ShardedTaskQueue::release(std::size_t shard) {
+  Shard &s = *shards_[shard];
+  s.claimed.store(false, std::memory_order_seq_cst);
+  // в шарде остались задачи — пусть их заберёт кто-то свободный
+  if (s.depth.load(std::memory_order_relaxed) > 0)
+    notify_consumers();
+}
+
+std::size_t ShardedTaskQueue::pop_bulk(std::vector<EnqueuedTask> &out,
+                                       std::size_t max) {
+  if (max == 0)
+    return 0;
+  const std::size_t start = rr_.fetch_add(1, std::memory_order_relaxed);
+  for (std::size_t k = 0; k < shards_.size(); ++k) {
+    const std::size_t i = (start + k) % shards_.size();
+    Shard &s = *shards_[i];
+    if (s.depth.load(std::memory_order_relaxed) == 0 || !claim(s))
+      continue;
+    const std::size_t n = take(s, out, max);
+    release(i);
+    if (n)
+      return n;
+  }
+  return 0;
+}
+
+std::optional<EnqueuedTask> ShardedTaskQueue::pop_for(
+    std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::vector<EnqueuedTask> one;
+  for (;;) {
+    if (pop_bulk(one, 1))
+      return std::move(one.front());
+    if (stopped_.load(std::memory_order_acquire)) {
+      if (pop_bulk(one, 1))
+        return std::move(one.front());
+      return std::nullopt;
+    }
+    // захваченные шарды не в счёт, иначе при занятых воркерами шардах
+    // ожидание сразу возвращается и цикл крутится вхолостую; release()
+    // непустого шарда будит ждущих
+    if (!wait(consumers_parked_, cv_items_, deadline, [&] {
+          if (stopped_.load(std::memory_order_relaxed))
+            return true;
+          for (const auto &s : shards_)
+            if (s->depth.load(std::memory_order_relaxed) > 0 &&
+                !s->claimed.load(std::memory_order_relaxed))
+              return true;
+          return false;
+        }))
+      return pop_bulk(one, 1) ? std::optional<EnqueuedTask>(
+                                    std::move(one.front()))
+                              : std::nullopt;
+  }
+}
+
+std::optional<EnqueuedTask> ShardedTaskQueue::pop() {
+  for (;;) {
+    if (auto v = pop_for(std::chrono::milliseconds(100)))
+      return v;
+    if (stopped_.load(std::memory_order_acquire))
+      return std::nullopt;
+  }
+}
+
+void ShardedTaskQueue::stop() {
+  stopped_.store(true, std::memory_order_seq_cst);
+  for (auto &s : shards_)
+    s->q->stop();
+  {
+    boost::lock_guard<boost::mutex> lk(park_m_);
+  }
+  cv_items_.notify_all();
+  cv_space_.notify_all();
+}
+
+} // namespace sensors
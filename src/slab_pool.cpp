@@ -0,0 +1,161 @@
+#include "sensors/slab_pool.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace sensors::slab {
+
+namespace {
+
+constexpr std::size_t kMinBlock = 64;
+constexpr std::size_t kClasses = 6; // 64, 128, ..., 2048
+constexpr std::size_t kBatch = 64;  // блоков в пачке для обмена с хранилищем
+constexpr std::size_t kDepotBytesPerClass = 16 * 1024 * 1024;
+
+static_assert(kMinBlock << (kClasses - 1) == kMaxBlock);
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+struct Chain {
+  FreeBlock *head{nullptr};
+  std::size_t count{0};
+};
+
+constexpr std::size_t class_size(std::size_t cls) { return kMinBlock << cls; }
+
+inline std::size_t class_of(std::size_t bytes) {
+  std::size_t cls = 0;
+  while (class_size(cls) < bytes)
+    ++cls;
+  return cls;
+}
+
+void free_chain(Chain c, std::size_t cls) {
+  while (c.head) {
+    FreeBlock *next = c.head->next;
+    ::operator delete(static_cast<void *>(c.head), class_size(cls));
+    c.head = next;
+  }
+}
+
+// Общее хранилище: пачки свободных блоков по классам размеров
+class Depot {
+public:
+  ~Depot() {
+    for (std::size_t cls = 0; cls < kClasses; ++cls)
+      for (auto &c : classes_[cls].chains)
+        free_chain(c, cls);
+  }
+
+  bool take(std::size_t cls, Chain &out) {
+    auto &pc = classes_[cls];
+    std::lock_guard<std::mutex> lk(pc.m);
+    if (pc.chains.empty())
+      return false;
+    out = pc.chains.back();
+    pc.chains.pop_back();
+    pc.blocks -= out.count;
+    return true;
+  }
+
+  void give(std::size_t cls, Chain c) {
+    auto &pc = classes_[cls];
+    {
+      std::lock_guard<std::mutex> lk(pc.m);
+      if ((pc.blocks + c.count) * class_size(cls) <= kDepotBytesPerClass) {
+        pc.blocks += c.count;
+        pc.chains.push_back(c);
+        return;
+      }
+    }
+    free_chain(c, cls); // хранилище заполнено — память возвращаем системе
+  }
+
+private:
+  struct PerClass {
+    std::mutex m;
+    std::vector<Chain> chains;
+    std::size_t blocks{0};
+  };
+  PerClass classes_[kClasses];
+};
+
+Depot &depot() {
+  static Depot d;
+  return d;
+}
+
+// после разрушения кэша потока (выход потока) работаем мимо пула
+thread_local bool t_cache_gone = false;
+
+struct ThreadCache {
+  Chain lists[kClasses];
+
+  ~ThreadCache() {
+    t_cache_gone = true;
+    for (std::size_t cls = 0; cls < kClasses; ++cls)
+      if (lists[cls].count)
+        depot().give(cls, lists[cls]);
+  }
+};
+
+thread_local ThreadCache t_cache;
+
+} // namespace
+
+void *allocate(std::size_t bytes) {
+  if (bytes > kMaxBlock)
+    return ::operator new(bytes);
+
+  // блок всегда полного размера класса: освобождать его может другой поток
+  const std::size_t cls = class_of(bytes);
+  if (t_cache_gone)
+    return ::operator new(class_size(cls));
+
+  Chain &local = t_cache.lists[cls];
+  if (!local.head && !depot().take(cls, local))
+    return ::operator new(class_size(cls));
+
+  FreeBlock *b = local.head;
+  local.head = b->next;
+  --local.count;
+  return b;
+}
+
+void deallocate(void *p, std::size_t bytes) noexcept {
+  if (!p)
+    return;
+  if (bytes > kMaxBlock) {
+    ::operator delete(p, bytes);
+    return;
+  }
+  const std::size_t cls = class_of(bytes);
+  if (t_cache_gone) {
+    ::operator delete(p, class_size(cls));
+    return;
+  }
+
+  Chain &local = t_cache.lists[cls];
+  auto *b = static_cast<FreeBlock *>(p);
+  b->next = local.head;
+  local.head = b;
+  ++local.count;
+
+  // излишки потока-потребителя отдаём пачкой в общее хранилище
+  if (local.count >= 2 * kBatch) {
+    Chain out;
+    out.head = local.head;
+    FreeBlock *tail = local.head;
+    for (std::size_t i = 1; i < kBatch; ++i)
+      tail = tail->next;
+    local.head = tail->next;
+    tail->next = nullptr;
+    out.count = kBatch;
+    local.count -= kBatch;
+    depot().give(cls, out);
+  }
+}
+
+} // namespace sensors::slab
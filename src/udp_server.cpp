@@ -0,0 +1,294 @@
+#include "sensors/udp_server.hpp"
+#include "sensors/binary_protocol.hpp"
+#include "sensors/ingest_json.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/time_utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+
+namespace net = boost::asio;
+using udp = net::ip::udp;
+
+namespace sensors {
+
+namespace {
+
+// таймаут приёма: поток просыпается и проверяет running_ даже без трафика
+constexpr int kReceiveTimeoutMs = 200;
+
+void set_receive_timeout(udp::socket &socket) {
+#ifdef _WIN32
+  const DWORD ms = kReceiveTimeoutMs;
+  ::setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO,
+               reinterpret_cast<const char *>(&ms), sizeof(ms));
+#else
+  timeval tv{0, kReceiveTimeoutMs * 1000};
+  ::setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv,
+               sizeof(tv));
+#endif
+}
+
+enum class RecvError {
+  idle,      // таймаут, прерывание — просто ждём дальше
+  truncated, // датаграмма длиннее буфера (Windows)
+  transient, // ICMP от прошлой отправки и прочее — повтор с паузой
+  fatal,     // сокет закрыт или негоден — выходим из цикла
+};
+
+RecvError last_recv_error() {
+#ifdef _WIN32
+  switch (::WSAGetLastError()) {
+  case WSAETIMEDOUT:
+  case WSAEINTR:
+  case WSAEWOULDBLOCK:
+    return RecvError::idle;
+  case WSAEMSGSIZE:
+    return RecvError::truncated;
+  case WSAENOTSOCK:
+  case WSAEBADF:
+  case WSAESHUTDOWN:
+  case WSAEINVAL:
+  case WSANOTINITIALISED:
+    return RecvError::fatal;
+  default:
+    return RecvError::transient;
+  }
+#else
+  switch (errno) {
+  case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+  case EWOULDBLOCK:
+#endif
+  case EINTR:
+    return RecvError::idle;
+  case EBADF:
+  case ENOTSOCK:
+  case EINVAL:
+  case EFAULT:
+    return RecvError::fatal;
+  default:
+    return RecvError::transient;
+  }
+#endif
+}
+
+// Разбор одной датаграммы: JSON-объект или бинарный кадр READINGS
+bool parse_datagram(const std::uint8_t *p, std::size_t n,
+                    binproto::Decoder &decoder, std::vector<EnqueuedTask> &out,
+                    std::string &err, bool fast_json) {
+  std::size_t i = 0;
+  while (i < n && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r' || p[i] == '\n'))
+    ++i;
+  if (i < n && p[i] == '{') {
+    EnqueuedTask t;
+    if (!parse_reading(std::string_view(reinterpret_cast<const char *>(p + i),
+                                        n - i),
+                       t, err, fast_json))
+      return false;
+    out.push_back(std::move(t));
+    return true;
+  }
+  // словарь строк действует в пределах одной датаграммы
+  decoder.reset();
+  std::uint32_t seq = 0;
+  return decoder.decode(p, n, out, seq, err);
+}
+
+} // namespace
+
+UdpIngestServer::UdpIngestServer(const Config &cfg, TaskQueue &queue,
+                                 WriteAheadLog *wal, LatestCache *latest)
+    : cfg_(cfg), queue_(queue), wal_(wal), latest_(latest), socket_(ioc_) {}
+
+UdpIngestServer::~UdpIngestServer() { stop(); }
+
+void UdpIngestServer::start() {
+  if (running_.exchange(true))
+    return;
+
+  udp::endpoint ep{net::ip::make_address(cfg_.host), cfg_.udp_port};
+  boost::system::error_code ec;
+  socket_.open(ep.protocol(), ec);
+  if (!ec)
+    socket_.bind(ep, ec);
+  if (ec) {
+    running_ = false;
+    throw std::runtime_error("udp listener: cannot bind port " +
+                             std::to_string(cfg_.udp_port) + ": " +
+                             ec.message());
+  }
+  if (cfg_.udp_rcvbuf_bytes > 0) {
+    socket_.set_option(
+        net::socket_base::receive_buffer_size(cfg_.udp_rcvbuf_bytes), ec);
+  }
+  // shutdown() в stop() будит recv только на Linux, на остальных
+  // платформах поток выходит по таймауту приёма
+  set_receive_timeout(socket_);
+
+  thread_ = std::make_unique<boost::thread>([this] {
+    try {
+      receive_loop();
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "[UDP] receive loop fatal: %s\n", e.what());
+      std::fflush(stderr);
+    }
+  });
+}
+
+void UdpIngestServer::stop() {
+  if (!running_.exchange(false))
+    return;
+  boost::system::error_code ec;
+  socket_.shutdown(udp::socket::shutdown_receive, ec);
+  if (thread_ && thread_->joinable())
+    thread_->join();
+  socket_.close(ec);
+  thread_.reset();
+}
+
+void UdpIngestServer::receive_loop() {
+  const std::size_t batch = cfg_.udp_batch ? cfg_.udp_batch : 1;
+  const std::size_t dgram = cfg_.udp_max_datagram;
+  std::vector<std::uint8_t> storage(batch * dgram);
+  std::vector<std::size_t> lengths(batch);
+  std::vector<EnqueuedTask> tasks;
+  binproto::Decoder decoder;
+  std::string err;
+
+#ifdef __linux__
+  std::vector<mmsghdr> msgs(batch);
+  std::vector<iovec> iovs(batch);
+#endif
+
+  // подряд идущие ошибки сокета: пауза растёт, чтобы не крутить цикл
+  int failures = 0;
+  auto backoff = [&failures] {
+    g_udp_receive_errors.fetch_add(1ULL, std::memory_order_relaxed);
+    const int shift = std::min(failures++, 6);
+    std::this_thread::sleep_for(std::chrono::milliseconds(
+        std::min(kReceiveTimeoutMs, 5 << shift)));
+  };
+
+  while (running_) {
+    std::size_t got = 0;
+#ifdef __linux__
+    for (std::size_t i = 0; i < batch; ++i) {
+      iovs[i].iov_base = storage.data() + i * dgram;
+      iovs[i].iov_len = dgram;
+      std::memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    // ждём первую датаграмму (с таймаутом), остальные — сколько уже есть
+    const int n = ::recvmmsg(socket_.native_handle(), msgs.data(),
+                             static_cast<unsigned int>(batch), MSG_WAITFORONE,
+                             nullptr);
+    if (n <= 0) {
+      if (n == 0 || !running_)
+        continue; // сокет закрыт при остановке
+      const RecvError e = last_recv_error();
+      if (e == RecvError::fatal) {
+        std::fprintf(stderr, "[UDP] socket unusable, receive loop stopped\n");
+        break;
+      }
+      if (e != RecvError::idle)
+        backoff();
+      continue;
+    }
+    got = static_cast<std::size_t>(n);
+    for (std::size_t i = 0; i < got; ++i) {
+      lengths[i] = msgs[i].msg_len;
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        lengths[i] = 0; // обрезанная датаграмма — не разбираем
+    }
+#else
+    // напрямую, а не через socket_.receive_from: asio после EAGAIN от
+    // SO_RCVTIMEO ждёт готовности сокета без таймаута
+    const auto n = ::recvfrom(socket_.native_handle(),
+                              reinterpret_cast<char *>(storage.data()),
+                              static_cast<int>(dgram), 0, nullptr, nullptr);
+    if (n < 0) {
+      if (!running_)
+        break;
+      const RecvError e = last_recv_error();
+      if (e == RecvError::fatal) {
+        std::fprintf(stderr, "[UDP] socket unusable, receive loop stopped\n");
+        break;
+      }
+      if (e == RecvError::truncated) {
+        g_udp_datagrams.fetch_add(1ULL, std::memory_order_relaxed);
+        g_udp_parse_errors.fetch_add(1ULL, std::memory_order_relaxed);
+      } else if (e == RecvError::transient) {
+        backoff();
+      }
+      continue;
+    }
+    got = 1;
+    lengths[0] = static_cast<std::size_t>(n);
+#endif
+    failures = 0;
+
+    if (!running_)
+      break;
+
+    g_udp_datagrams.fetch_add(got, std::memory_order_relaxed);
+    tasks.clear();
+    const std::int64_t parse_start = mono_ns();
+    for (std::size_t i = 0; i < got; ++i) {
+      if (lengths[i] == 0 ||
+          !parse_datagram(storage.data() + i * dgram, lengths[i], decoder,
+                          tasks, err, cfg_.ingest_fast_parser))
+        g_udp_parse_errors.fetch_add(1ULL, std::memory_order_relaxed);
+    }
+    const std::int64_t now = mono_ns();
+    g_lat_parse.observe_ns(now - parse_start);
+    if (tasks.empty())
+      continue;
+    if (latest_)
+      latest_->update(tasks);
+
+    if (wal_) {
+      // ответа нет, ждать fdatasync некому
+      const std::size_t n = tasks.size();
+      if (wal_->append(tasks, nullptr))
+        g_udp_readings.fetch_add(n, std::memory_order_relaxed);
+      else
+        g_udp_dropped.fetch_add(n, std::memory_order_relaxed);
+      continue;
+    }
+
+    // сначала пробуем всей пачкой; если места на всё нет — по одной,
+    // остаток считаем потерянным
+    const std::int64_t received = unix_now_s();
+    for (auto &t : tasks) {
+      t.enqueue_ns = now;
+      t.received_s = received;
+    }
+    std::size_t pushed = 0;
+    if (queue_.try_push_bulk(tasks)) {
+      pushed = tasks.size();
+    } else {
+      while (pushed < tasks.size() && queue_.try_push(std::move(tasks[pushed])))
+        ++pushed;
+    }
+    g_queue_size.fetch_add(pushed, std::memory_order_relaxed);
+    g_udp_readings.fetch_add(pushed, std::memory_order_relaxed);
+    if (pushed < tasks.size())
+      g_udp_dropped.fetch_add(tasks.size() - pushed, std::memory_order_relaxed);
+  }
+}
+
+} // namespace sensors
@@ -0,0 +1,643 @@
+#include "sensors/wal.hpp"
+#include "sensors/metrics_export.hpp"
+#include "sensors/time_utils.hpp"
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <boost/endian/conversion.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sensors {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t kCrcBytes = 4;
+constexpr std::size_t kRecordHeader = kCrcBytes + binproto::kLenPrefix;
+// в кадре READINGS число показаний и число пар в показании — u16
+constexpr std::size_t kMaxFrameTasks = 0xFFFF;
+constexpr std::size_t kMaxReadingKv = 0xFFFF;
+
+constexpr const char *kDeadLetterFile = "dead-letter.ndjson";
+
+constexpr const char *kAccepted = R"({"status":"accepted"})";
+constexpr const char *kWriteFailed =
+    R"({"status":"error","msg":"wal write failed"})";
+
+inline void log_err(const char *tag, const std::string &msg) {
+  std::fprintf(stderr, "[%s] %s\n", tag, msg.c_str());
+  std::fflush(stderr);
+}
+
+std::uint32_t crc32(const std::uint8_t *p, std::size_t n) {
+  boost::crc_32_type crc;
+  crc.process_bytes(p, n);
+  return crc.checksum();
+}
+
+// данные файла на диск (на Linux — без лишнего сброса метаданных)
+bool sync_file(std::FILE *f) {
+  if (std::fflush(f) != 0)
+    return false;
+#if defined(_WIN32)
+  return _commit(_fileno(f)) == 0;
+#elif defined(__linux__)
+  return ::fdatasync(fileno(f)) == 0;
+#else
+  return ::fsync(fileno(f)) == 0;
+#endif
+}
+
+// позиция в сегменте: long на Windows 32-битный, сегмент может быть
+// больше 2 ГБ
+bool seek_to(std::FILE *f, std::uint64_t off) {
+#ifdef _WIN32
+  return _fseeki64(f, static_cast<__int64>(off), SEEK_SET) == 0;
+#else
+  return ::fseeko(f, static_cast<off_t>(off), SEEK_SET) == 0;
+#endif
+}
+
+// запись о новом файле в каталоге тоже должна пережить сбой питания
+void sync_dir(const fs::path &dir) {
+#ifndef _WIN32
+  const int fd = ::open(dir.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#else
+  (void)dir; // NTFS журналирует метаданные сама
+#endif
+}
+
+bool parse_segment_name(const fs::path &p, std::uint32_t &id) {
+  if (p.extension() != ".wal")
+    return false;
+  const std::string stem = p.stem().string();
+  if (stem.empty() || stem.size() > 10 ||
+      !std::all_of(stem.begin(), stem.end(),
+                   [](char c) { return c >= '0' && c <= '9'; }))
+    return false;
+  const unsigned long long v = std::stoull(stem);
+  if (v == 0 || v > 0xFFFFFFFFULL)
+    return false;
+  id = static_cast<std::uint32_t>(v);
+  return true;
+}
+
+// показание с числом пар больше u16 делится на несколько с теми же
+// sensor/ts — в таблице это те же строки
+void split_oversized(std::vector<EnqueuedTask> &tasks) {
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    if (tasks[i].kv.size() <= kMaxReadingKv)
+      continue;
+    EnqueuedTask tail;
+    tail.request_id = tasks[i].request_id;
+    tail.sensor = tasks[i].sensor;
+    tail.ts = tasks[i].ts;
+    tail.kv.assign(tasks[i].kv.begin() + kMaxReadingKv, tasks[i].kv.end());
+    tasks[i].kv.resize(kMaxReadingKv);
+    tasks.push_back(std::move(tail));
+  }
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const Config &cfg, TaskQueue &queue)
+    : cfg_(cfg), queue_(queue) {}
+
+WriteAheadLog::~WriteAheadLog() {
+  stop();
+  if (file_)
+    std::fclose(file_);
+}
+
+fs::path WriteAheadLog::segment_path(std::uint32_t id) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%010u.wal", static_cast<unsigned>(id));
+  return fs::path(cfg_.wal_dir) / name;
+}
+
+void WriteAheadLog::open() {
+  const fs::path dir(cfg_.wal_dir);
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  if (ec)
+    throw std::runtime_error("wal: cannot create " + cfg_.wal_dir + ": " +
+                             ec.message());
+
+  std::lock_guard<std::mutex> lk(m_);
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    std::uint32_t id = 0;
+    if (!it->is_regular_file() || !parse_segment_name(it->path(), id))
+      continue;
+    Segment s;
+    s.bytes = it->file_size();
+    s.sealed = true; // хвост прошлого запуска больше не дописываем
+    disk_bytes_ += s.bytes;
+    segments_[id] = s;
+    next_id_ = std::max(next_id_, id + 1);
+  }
+  if (ec)
+    throw std::runtime_error("wal: cannot list " + cfg_.wal_dir + ": " +
+                             ec.message());
+  publish_gauges();
+  if (!segments_.empty())
+    log_err("WAL", "replaying " + std::to_string(segments_.size()) +
+                       " segment(s), " + std::to_string(disk_bytes_) +
+                       " bytes from " + cfg_.wal_dir);
+}
+
+void WriteAheadLog::start() {
+  if (running_.exchange(true))
+    return;
+  writer_ = std::make_unique<boost::thread>([this] {
+    try {
+      write_loop();
+    } catch (const std::exception &e) {
+      log_err("ERR", std::string("WAL writer fatal: ") + e.what());
+    }
+  });
+  feeder_ = std::make_unique<boost::thread>([this] {
+    try {
+      feed_loop();
+    } catch (const std::exception &e) {
+      log_err("ERR", std::string("WAL feeder fatal: ") + e.what());
+    }
+  });
+}
+
+void WriteAheadLog::stop() {
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    if (!running_.exchange(false))
+      return;
+  }
+  write_cv_.notify_all();
+  feed_cv_.notify_all();
+  for (auto *t : {&writer_, &feeder_}) {
+    if (*t && (*t)->joinable())
+      (*t)->join();
+    t->reset();
+  }
+
+  // последний сегмент писатель закрывает уже при остановке: если его
+  // успели дочитать и вставить, удаляем сразу, а не переигрываем повторно
+  std::lock_guard<std::mutex> lk(m_);
+  if (auto it = segments_.find(feed_id_);
+      it != segments_.end() && it->second.sealed &&
+      feed_off_ >= it->second.bytes) {
+    it->second.read_done = true;
+    maybe_drop(feed_id_);
+  }
+}
+
+bool WriteAheadLog::append(std::vector<EnqueuedTask> &tasks,
+                           std::shared_ptr<ReplyHandle> reply) {
+  std::size_t n = 0;
+  const std::int64_t now = mono_ns();
+  const std::int64_t received = unix_now_s();
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    if (!running_ || disk_bytes_ >= cfg_.wal_max_bytes) {
+      g_wal_rejected.fetch_add(tasks.size(), std::memory_order_relaxed);
+      return false;
+    }
+    split_oversized(tasks);
+    n = tasks.size();
+    // большие пачки режем по кадрам; группа пишется целиком, поэтому
+    // ответ достаточно повесить на последний кусок
+    std::size_t i = 0;
+    for (; n - i > kMaxFrameTasks; i += kMaxFrameTasks) {
+      Frame f;
+      f.tasks.assign(std::make_move_iterator(tasks.begin() + i),
+                     std::make_move_iterator(tasks.begin() + i + kMaxFrameTasks));
+      f.appended_ns = now;
+      f.received_s = received;
+      pending_.push_back(std::move(f));
+    }
+    if (i == 0) {
+      pending_.push_back({std::move(tasks), std::move(reply), now, received});
+    } else {
+      Frame f;
+      f.tasks.assign(std::make_move_iterator(tasks.begin() + i),
+                     std::make_move_iterator(tasks.end()));
+      f.reply = std::move(reply);
+      f.appended_ns = now;
+      f.received_s = received;
+      pending_.push_back(std::move(f));
+    }
+    tasks.clear();
+  }
+  write_cv_.notify_one();
+  g_wal_appended.fetch_add(n, std::memory_order_relaxed);
+  return true;
+}
+
+void WriteAheadLog::commit(const std::vector<EnqueuedTask> &batch) {
+  unsigned long long total = 0;
+  std::lock_guard<std::mutex> lk(m_);
+  // батч — подряд идущие задачи одного-двух сегментов
+  for (std::size_t i = 0; i < batch.size();) {
+    const std::uint32_t id = batch[i].wal_segment;
+    std::size_t j = i;
+    while (j < batch.size() && batch[j].wal_segment == id)
+      ++j;
+    if (id != 0) {
+      total += j - i;
+      if (auto it = segments_.find(id); it != segments_.end()) {
+        it->second.committed += j - i;
+        maybe_drop(id);
+      }
+    }
+    i = j;
+  }
+  g_wal_committed.fetch_add(total, std::memory_order_relaxed);
+}
+
+void WriteAheadLog::dead_letter(const std::vector<EnqueuedTask> &batch,
+                                const std::string &reason) {
+  g_wal_dead_letter.fetch_add(batch.size(), std::memory_order_relaxed);
+  std::string lines;
+  for (const auto &t : batch) {
+    nlohmann::json j;
+    j["sensor_id"] = g_symbols.view(t.sensor);
+    j["ts"] = t.ts;
+    auto &metrics = j["metrics"] = nlohmann::json::object();
+    for (const auto &[k, v] : t.kv)
+      metrics[std::string(g_symbols.view(k))] = v;
+    // id из бинарного протокола может быть не UTF-8
+    lines += j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    lines += '\n';
+  }
+
+  const fs::path path = fs::path(cfg_.wal_dir) / kDeadLetterFile;
+  bool written = false;
+  {
+    std::lock_guard<std::mutex> lk(dead_m_);
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    if (ec || size + lines.size() <= cfg_.wal_max_bytes) {
+      if (std::FILE *f = std::fopen(path.string().c_str(), "ab")) {
+        written = std::fwrite(lines.data(), 1, lines.size(), f) ==
+                      lines.size() &&
+                  sync_file(f);
+        std::fclose(f);
+      }
+    }
+  }
+  log_err("WAL", std::to_string(batch.size()) + " reading(s) " +
+                     (written ? "moved to " + path.string()
+                              : std::string("dropped (dead-letter file "
+                                            "full or not writable)")) +
+                     ": " + reason);
+  commit(batch);
+}
+
+void WriteAheadLog::write_loop() {
+  const std::chrono::milliseconds interval(
+      std::max(0, cfg_.wal_fsync_interval_ms));
+  auto next_sync = std::chrono::steady_clock::now();
+  std::vector<Frame> group;
+
+  std::unique_lock<std::mutex> lk(m_);
+  for (;;) {
+    write_cv_.wait(lk, [&] { return !running_ || !pending_.empty(); });
+    if (pending_.empty())
+      break; // остановка, всё дописано
+    // group commit: не чаще одного fdatasync за interval, всё пришедшее
+    // за это время уходит той же записью
+    if (running_)
+      write_cv_.wait_until(lk, next_sync, [&] { return !running_.load(); });
+    group.swap(pending_);
+    lk.unlock();
+
+    next_sync = std::chrono::steady_clock::now() + interval;
+    const bool ok = write_group(group);
+    const std::int64_t synced = mono_ns();
+    for (auto &f : group) {
+      // append → запись на диске: ожидание группы, write и fdatasync
+      if (ok)
+        g_lat_wal_sync.observe_ns(synced - f.appended_ns);
+      if (f.reply)
+        f.reply->respond(ok ? 202 : 500, ok ? kAccepted : kWriteFailed);
+    }
+    group.clear();
+    lk.lock();
+  }
+  lk.unlock();
+  seal_segment();
+}
+
+bool WriteAheadLog::write_group(std::vector<Frame> &group) {
+  for (;;) {
+    const auto written = write_group_once(group);
+    if (written != Written::lost)
+      return written == Written::ok;
+    // поток подачи бросил сегмент, пока группа писалась: за битой записью
+    // её никто не прочтёт, а подтвердить её ещё не успели — пишем заново
+    // в новый сегмент
+    log_err("WAL", "segment " + std::to_string(active_) +
+                       " was damaged during write, group rewritten");
+  }
+}
+
+WriteAheadLog::Written
+WriteAheadLog::write_group_once(const std::vector<Frame> &group) {
+  bool roll = false;
+  if (active_) {
+    std::lock_guard<std::mutex> lk(m_);
+    const Segment &s = segments_[active_];
+    roll = s.bytes >= cfg_.wal_segment_bytes || s.damaged;
+  }
+  if (roll)
+    seal_segment();
+  if (!file_ && !open_segment()) {
+    g_wal_write_errors.fetch_add(1ULL, std::memory_order_relaxed);
+    return Written::failed;
+  }
+
+  buf_.clear();
+  for (const auto &f : group) {
+    const std::size_t at = buf_.size();
+    buf_.resize(at + kCrcBytes);
+    // seq записи — время приёма: по нему rollup судит об опоздании
+    // показаний, переигранных после простоя
+    encoder_.encode(static_cast<std::uint32_t>(f.received_s), f.tasks, buf_);
+    boost::endian::store_little_u32(
+        buf_.data() + at, crc32(buf_.data() + at + kRecordHeader,
+                                buf_.size() - at - kRecordHeader));
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  const bool ok =
+      std::fwrite(buf_.data(), 1, buf_.size(), file_) == buf_.size() &&
+      sync_file(file_);
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+
+  if (!ok) {
+    g_wal_write_errors.fetch_add(1ULL, std::memory_order_relaxed);
+    log_err("WAL", "write to " + segment_path(active_).string() +
+                       " failed: " + std::strerror(errno));
+    // недописанную группу срезаем по последней сброшенной границе; словарь
+    // кодировщика уже ушёл вперёд, поэтому дальше пишем в новый сегмент
+    std::fclose(file_);
+    file_ = nullptr;
+    std::uint64_t durable = 0;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      durable = segments_[active_].bytes;
+    }
+    std::error_code ec;
+    fs::resize_file(segment_path(active_), durable, ec);
+    seal_segment();
+    return Written::failed;
+  }
+
+  g_wal_fsyncs.fetch_add(1ULL, std::memory_order_relaxed);
+  g_wal_written_bytes.fetch_add(buf_.size(), std::memory_order_relaxed);
+  g_wal_fsync_us.fetch_add(static_cast<unsigned long long>(us),
+                           std::memory_order_relaxed);
+  bool lost = false;
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    Segment &s = segments_[active_];
+    s.bytes += buf_.size();
+    disk_bytes_ += buf_.size();
+    // damaged ставит поток подачи под этим же мьютексом. Группа, записанная
+    // до того, пропадёт вместе с остатком сегмента (словарь за битой
+    // записью не восстановить), но после этой проверки не подтверждается
+    // ни одна группа, которую поток подачи уже не прочтёт
+    lost = s.damaged;
+    ++progress_;
+    publish_gauges();
+  }
+  feed_cv_.notify_all();
+  return lost ? Written::lost : Written::ok;
+}
+
+bool WriteAheadLog::open_segment() {
+  std::uint32_t id = 0;
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    id = next_id_++;
+  }
+  const fs::path path = segment_path(id);
+  file_ = std::fopen(path.string().c_str(), "wb");
+  if (!file_) {
+    log_err("WAL", "cannot create " + path.string() + ": " +
+                       std::strerror(errno));
+    return false;
+  }
+  sync_dir(path.parent_path());
+  active_ = id;
+  encoder_.reset(); // словарь строк у каждого сегмента свой
+
+  std::lock_guard<std::mutex> lk(m_);
+  segments_[id] = Segment{};
+  ++progress_;
+  publish_gauges();
+  return true;
+}
+
+void WriteAheadLog::seal_segment() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  if (!active_)
+    return;
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    if (auto it = segments_.find(active_); it != segments_.end()) {
+      it->second.sealed = true;
+      ++progress_;
+      maybe_drop(active_);
+    }
+  }
+  feed_cv_.notify_all();
+  active_ = 0;
+}
+
+void WriteAheadLog::maybe_drop(std::uint32_t id) {
+  const auto it = segments_.find(id);
+  if (it == segments_.end())
+    return;
+  const Segment &s = it->second;
+  if (!s.sealed || !s.read_done || s.committed < s.fed)
+    return;
+  std::error_code ec;
+  fs::remove(segment_path(id), ec);
+  if (ec) // файл переиграется при следующем запуске
+    log_err("WAL", "cannot remove " + segment_path(id).string() + ": " +
+                       ec.message());
+  disk_bytes_ -= s.bytes;
+  segments_.erase(it);
+  publish_gauges();
+}
+
+void WriteAheadLog::publish_gauges() {
+  g_wal_bytes.store(disk_bytes_, std::memory_order_relaxed);
+  g_wal_segments.store(segments_.size(), std::memory_order_relaxed);
+}
+
+void WriteAheadLog::feed_loop() {
+  binproto::Decoder decoder;
+  std::vector<std::uint8_t> record;
+  std::vector<EnqueuedTask> tasks;
+  std::string err;
+  std::FILE *f = nullptr;
+  std::uint32_t id = 0; // читаемый сегмент
+  std::uint64_t off = 0;
+
+  auto close_file = [&] {
+    if (f) {
+      std::fclose(f);
+      f = nullptr;
+    }
+  };
+  auto switch_to = [&](std::uint32_t next) {
+    close_file();
+    id = next;
+    off = 0;
+    decoder.reset(); // словарь строк у каждого сегмента свой
+  };
+
+  std::unique_lock<std::mutex> lk(m_);
+  while (running_) {
+    auto it = segments_.lower_bound(id);
+    if (it == segments_.end() ||
+        (it->first == id && off >= it->second.bytes && !it->second.sealed)) {
+      // всё сброшенное прочитано: ждём следующей группы или сегмента
+      const std::uint64_t seen = progress_;
+      feed_cv_.wait(lk, [&] { return !running_ || progress_ != seen; });
+      continue;
+    }
+    if (it->first != id)
+      switch_to(it->first);
+    if (off >= it->second.bytes) {
+      // закрытый сегмент дочитан; файл закрываем до удаления (Windows)
+      close_file();
+      it->second.read_done = true;
+      maybe_drop(id);
+      switch_to(id + 1);
+      continue;
+    }
+    const std::uint64_t limit = it->second.bytes;
+    const bool sealed = it->second.sealed;
+    lk.unlock();
+
+    std::uint64_t fed = 0;
+    bool broken = false;
+    bool stopped = false;
+    if (!f)
+      f = std::fopen(segment_path(id).string().c_str(), "rb");
+    // seek заодно сбрасывает EOF и буфер после прошлого дочитывания
+    if (!f || !seek_to(f, off))
+      broken = true;
+    while (!broken && !stopped && off < limit) {
+      std::uint8_t hdr[kRecordHeader];
+      if (limit - off < kRecordHeader ||
+          std::fread(hdr, 1, kRecordHeader, f) != kRecordHeader) {
+        broken = true;
+        break;
+      }
+      const std::uint32_t crc = boost::endian::load_little_u32(hdr);
+      const std::uint32_t len =
+          boost::endian::load_little_u32(hdr + kCrcBytes);
+      if (len == 0 || len > limit - off - kRecordHeader) {
+        broken = true;
+        break;
+      }
+      record.resize(len);
+      if (std::fread(record.data(), 1, len, f) != len ||
+          crc32(record.data(), len) != crc) {
+        broken = true;
+        break;
+      }
+      off += kRecordHeader + len;
+
+      tasks.clear();
+      std::uint32_t seq = 0;
+      if (!decoder.decode(record.data(), len, tasks, seq, err)) {
+        // граница записи цела — пропускаем только её
+        g_wal_corrupt_records.fetch_add(1ULL, std::memory_order_relaxed);
+        log_err("WAL", "segment " + std::to_string(id) +
+                           ": undecodable record skipped: " + err);
+        continue;
+      }
+      for (auto &t : tasks) {
+        t.wal_segment = id;
+        t.enqueue_ns = mono_ns();
+        t.received_s = seq;
+        // ждём места в очереди: при лежащем ClickHouse подача стоит,
+        // а показания копятся на диске
+        if (!queue_.push(std::move(t))) {
+          stopped = true;
+          break;
+        }
+        ++fed;
+        g_queue_size.fetch_add(1ULL, std::memory_order_relaxed);
+      }
+    }
+    g_wal_replayed.fetch_add(fed, std::memory_order_relaxed);
+
+    lk.lock();
+    // недочитанный сегмент не удаляется, но проверяем, как и везде
+    auto cur = segments_.find(id);
+    if (cur != segments_.end())
+      cur->second.fed += fed;
+    if (stopped)
+      break; // запись, на которой встали, отдана не целиком
+    if (cur == segments_.end()) {
+      log_err("WAL", "segment " + std::to_string(id) +
+                         " disappeared while being read");
+      switch_to(id + 1);
+      continue;
+    }
+    feed_id_ = id;
+    feed_off_ = off;
+    if (broken) {
+      // после сбоя так выглядит оборванная последняя запись
+      g_wal_corrupt_records.fetch_add(1ULL, std::memory_order_relaxed);
+      log_err("WAL", "segment " + std::to_string(id) +
+                         ": damaged or torn record at offset " +
+                         std::to_string(off) + ", rest of segment skipped (" +
+                         std::to_string(cur->second.bytes - off) + " bytes)");
+      close_file();
+      off = limit;
+      if (!sealed) {
+        // словарь декодера потерян: сегмент бросаем. Писатель видит damaged
+        // под m_ — группу, которую пишет сейчас, он повторит в новом
+        // сегменте, а этот закроет — тогда он и удалится
+        cur->second.damaged = true;
+        cur->second.read_done = true;
+        switch_to(id + 1);
+      }
+    }
+  }
+  lk.unlock();
+  close_file();
+}
+
+} // namespace sensors
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <sensors/ack_hub.hpp>
+#include <sensors/metrics_export.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using sensors::AckHub;
+using sensors::AckTarget;
+using sensors::EnqueuedTask;
+namespace net = boost::asio;
+
+namespace {
+
+struct Recorder final : AckTarget {
+  struct Ack {
+    std::uint64_t seq;
+    int status;
+    std::size_t failed;
+    std::string error;
+  };
+  std::vector<Ack> acks;
+  std::vector<std::uint64_t> timeouts;
+
+  void on_ack(std::uint64_t seq, int status, std::size_t failed,
+              const std::string &error) override {
+    acks.push_back({seq, status, failed, error});
+  }
+  void on_ack_timeout(std::uint64_t seq) override { timeouts.push_back(seq); }
+};
+
+} // namespace
+
+TEST(AckHub, AnswersOnceAllTasksReported) {
+  net::io_context ioc;
+  AckHub hub(ioc.get_executor(), 1000);
+  auto rec = std::make_shared<Recorder>();
+  const auto t = hub.add(rec, 7, 3);
+  hub.notify({t, t}, 200, {});
+  ioc.poll();
+  EXPECT_TRUE(rec->acks.empty());
+  hub.notify({t}, 500, "boom");
+  ioc.poll();
+  ASSERT_EQ(rec->acks.size(), 1u);
+  EXPECT_EQ(rec->acks[0].seq, 7u);
+  EXPECT_EQ(rec->acks[0].status, 500);
+  EXPECT_EQ(rec->acks[0].failed, 1u);
+  EXPECT_EQ(rec->acks[0].error, "boom");
+  EXPECT_EQ(hub.pending(), 0u);
+}
+
+TEST(AckHub, WheelAnswers202AfterTimeout) {
+  net::io_context ioc;
+  AckHub hub(ioc.get_executor(), 40);
+  auto rec = std::make_shared<Recorder>();
+  const auto t = hub.add(rec, 1, 1);
+  ioc.run_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(rec->timeouts.empty()); // раньше таймаута не отвечаем
+  ioc.run_for(std::chrono::milliseconds(80));
+  ASSERT_EQ(rec->timeouts.size(), 1u);
+  EXPECT_EQ(rec->timeouts[0], 1u);
+  // поздний итог воркера после 202 отбрасывается
+  hub.notify({t}, 200, {});
+  ioc.restart();
+  ioc.poll();
+  EXPECT_TRUE(rec->acks.empty());
+}
+
+TEST(AckHub, CancelledTicketIsIgnoredAndSlotReused) {
+  net::io_context ioc;
+  AckHub hub(ioc.get_executor(), 1000);
+  auto rec = std::make_shared<Recorder>();
+  const auto old = hub.add(rec, 1, 1);
+  hub.cancel(old);
+  EXPECT_EQ(hub.pending(), 0u);
+  const auto fresh = hub.add(rec, 2, 1);
+  EXPECT_NE(fresh, old); // та же ячейка, другое поколение
+  hub.notify({old}, 200, {});
+  ioc.poll();
+  EXPECT_TRUE(rec->acks.empty());
+  hub.notify({fresh}, 200, {});
+  ioc.poll();
+  ASSERT_EQ(rec->acks.size(), 1u);
+  EXPECT_EQ(rec->acks[0].seq, 2u);
+}
+
+TEST(AckHub, AckBatchPostsOneNoticePerHub) {
+  net::io_context ioc;
+  AckHub a(ioc.get_executor(), 1000), b(ioc.get_executor(), 1000);
+  auto rec = std::make_shared<Recorder>();
+  std::vector<EnqueuedTask> batch(5);
+  const auto ta = a.add(rec, 1, 3);
+  const auto tb = b.add(rec, 2, 2);
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    batch[i].ack_hub = i < 3 ? &a : &b;
+    batch[i].ack_ticket = i < 3 ? ta : tb;
+  }
+  const auto before = sensors::g_ack_notices.load();
+  sensors::ack_batch(batch, 200, R"({"status":"ok"})");
+  EXPECT_EQ(sensors::g_ack_notices.load() - before, 2u);
+  ioc.poll();
+  ASSERT_EQ(rec->acks.size(), 2u);
+  EXPECT_EQ(rec->acks[0].status, 200);
+  EXPECT_EQ(rec->acks[1].status, 200);
+}
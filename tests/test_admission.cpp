@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <sensors/admission.hpp>
+#include <sensors/metrics_export.hpp>
+
+using sensors::AdmissionController;
+using sensors::Config;
+using sensors::g_queue_dequeued;
+using sensors::g_queue_size;
+
+namespace {
+
+constexpr std::int64_t kMs = 1'000'000;
+// отметки времени позже создания контроллера в тестах
+const std::int64_t kStart = sensors::mono_ns() + 1000 * kMs;
+
+Config rate_config(double rate, double burst_s) {
+  Config c;
+  c.sensor_rate_limit = rate;
+  c.sensor_rate_burst_s = burst_s;
+  return c;
+}
+
+} // namespace
+
+TEST(Admission, DropProbabilityIsLinearBetweenThresholds) {
+  Config c;
+  c.admission_enabled = true;
+  c.admission_min_fill = 0.5;
+  c.admission_max_fill = 0.9;
+  AdmissionController ac(c, 1000);
+  EXPECT_DOUBLE_EQ(ac.drop_probability(0), 0.0);
+  EXPECT_DOUBLE_EQ(ac.drop_probability(499), 0.0);
+  EXPECT_NEAR(ac.drop_probability(700), 0.5, 1e-9);
+  EXPECT_DOUBLE_EQ(ac.drop_probability(900), 1.0);
+  EXPECT_DOUBLE_EQ(ac.drop_probability(5000), 1.0);
+}
+
+TEST(Admission, ShedsAboveMaxFillWithRetryAfterFromDrainRate) {
+  Config c;
+  c.admission_enabled = true;
+  c.admission_retry_after_max_s = 60;
+  AdmissionController ac(c, 1000);
+  const auto size0 = g_queue_size.load();
+  int retry = 0;
+
+  // скорость разбора: 100 задач за 100 мс = 1000 в секунду
+  EXPECT_FALSE(ac.shed(retry, kStart));
+  g_queue_dequeued += 100;
+  EXPECT_FALSE(ac.shed(retry, kStart + 100 * kMs));
+  EXPECT_NEAR(ac.drain_rate(), 1000.0, 1.0);
+
+  g_queue_size = 3500; // 3000 сверх порога 500 — 3 секунды разбора
+  EXPECT_TRUE(ac.shed(retry, kStart + 150 * kMs));
+  EXPECT_EQ(retry, 3);
+  g_queue_size = size0;
+  EXPECT_FALSE(ac.shed(retry, kStart + 160 * kMs));
+}
+
+TEST(Admission, TokenBucketLimitsAndRefills) {
+  AdmissionController ac(rate_config(10, 0.5), 1000); // запас 5 показаний
+  int retry = 0;
+  for (int i = 0; i < 5; ++i)
+    EXPECT_TRUE(ac.allow(7, retry, 1, kStart));
+  EXPECT_FALSE(ac.allow(7, retry, 1, kStart));
+  EXPECT_EQ(retry, 1);
+  // другой датчик не затронут
+  EXPECT_TRUE(ac.allow(8, retry, 1, kStart));
+  // 10 в секунду: через 100 мс — ровно одно показание
+  EXPECT_TRUE(ac.allow(7, retry, 1, kStart + 100 * kMs));
+  EXPECT_FALSE(ac.allow(7, retry, 1, kStart + 100 * kMs));
+  // долгий простой не копит больше запаса
+  EXPECT_TRUE(ac.allow(7, retry, 5, kStart + 10'000 * kMs));
+  EXPECT_FALSE(ac.allow(7, retry, 1, kStart + 10'000 * kMs));
+}
+
+TEST(Admission, SlowRefillIsNotLostBetweenCalls) {
+  AdmissionController ac(rate_config(0.5, 2), 1000); // 1 показание в 2 с
+  int retry = 0;
+  EXPECT_TRUE(ac.allow(3, retry, 1, kStart));
+  EXPECT_FALSE(ac.allow(3, retry, 1, kStart));
+  EXPECT_EQ(retry, 2);
+  // частые попытки по 1 мс не должны обнулять накопленное пополнение
+  std::int64_t t = kStart;
+  for (int i = 0; i < 1999; ++i)
+    EXPECT_FALSE(ac.allow(3, retry, 1, t += kMs));
+  EXPECT_TRUE(ac.allow(3, retry, 1, t + kMs));
+}
+
+TEST(Admission, PerSensorOverrides) {
+  Config c = rate_config(1, 1);
+  c.sensor_rate_limits = {{"admission-test-vip", 0}, {"admission-test-slow", 2}};
+  AdmissionController ac(c, 1000);
+  const auto vip = sensors::g_symbols.intern("admission-test-vip");
+  const auto slow = sensors::g_symbols.intern("admission-test-slow");
+  int retry = 0;
+  for (int i = 0; i < 100; ++i)
+    EXPECT_TRUE(ac.allow(vip, retry, 1, kStart));
+  EXPECT_TRUE(ac.allow(slow, retry, 2, kStart));
+  EXPECT_FALSE(ac.allow(slow, retry, 1, kStart));
+}
+
+TEST(Admission, WithWalShedsOnJournalBacklogNotQueueDepth) {
+  Config c;
+  c.admission_enabled = true;
+  c.admission_retry_after_max_s = 60;
+  c.wal_enabled = true;
+  c.wal_max_bytes = 1'000'000;
+  AdmissionController ac(c, 1000);
+  const auto size0 = g_queue_size.load();
+  const auto wal_bytes0 = sensors::g_wal_bytes.load();
+  sensors::g_wal_bytes = 0;
+  int retry = 0;
+
+  // ClickHouse лежит: очередь стоит полной, но запас держит журнал
+  g_queue_size = 100'000;
+  EXPECT_FALSE(ac.shed(retry, kStart));
+  // разбор 1000 показаний в секунду, 20 байт журнала на показание
+  g_queue_dequeued += 100;
+  sensors::g_wal_appended += 100;
+  sensors::g_wal_written_bytes += 2000;
+  EXPECT_FALSE(ac.shed(retry, kStart + 100 * kMs));
+
+  // журнал заполнен на 96%: 460000 байт сверх порога — 23 секунды разбора
+  sensors::g_wal_bytes = 960'000;
+  EXPECT_TRUE(ac.shed(retry, kStart + 150 * kMs));
+  EXPECT_EQ(retry, 23);
+  sensors::g_wal_bytes = wal_bytes0;
+  g_queue_size = size0;
+}
+
+TEST(Admission, ShardedQueueShedsOnFullestShard) {
+  Config c;
+  c.admission_enabled = true;
+  c.admission_min_fill = 0.5;
+  c.admission_max_fill = 0.9;
+  c.queue_shards = 4;
+  AdmissionController ac(c, 1000); // 250 задач на шард
+  auto &hot = sensors::queue_shard_stats(2);
+  const auto size0 = g_queue_size.load();
+  const auto hot0 = hot.depth.load();
+  int retry = 0;
+
+  // в очереди всего четверть ёмкости, но горячий шард полон
+  g_queue_size = 250;
+  hot.depth = 250;
+  EXPECT_DOUBLE_EQ(ac.drop_probability(250), 1.0);
+  EXPECT_TRUE(ac.shed(retry, kStart));
+  // общая очередь заполнена больше, но все шарды ниже порога
+  g_queue_size = 480;
+  hot.depth = 120;
+  EXPECT_FALSE(ac.shed(retry, kStart + 10 * kMs));
+  hot.depth = hot0;
+  g_queue_size = size0;
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <sensors/binary_protocol.hpp>
+
+#include <boost/endian/conversion.hpp>
+
+using namespace sensors;
+
+namespace {
+
+EnqueuedTask reading(const std::string &sensor, std::int64_t ts,
+                     std::vector<std::pair<std::string, double>> kv) {
+  EnqueuedTask t;
+  t.sensor = g_symbols.intern(sensor);
+  t.ts = ts;
+  for (const auto &[k, v] : kv)
+    t.kv.emplace_back(g_symbols.intern(k), v);
+  return t;
+}
+
+// тело кадра без префикса длины
+const std::uint8_t *body(const std::vector<std::uint8_t> &frame) {
+  return frame.data() + binproto::kLenPrefix;
+}
+
+} // namespace
+
+TEST(BinaryProtocol, RoundTripWithDictionaryRefs) {
+  binproto::Encoder enc;
+  std::vector<std::uint8_t> f1, f2;
+  enc.encode(7, {reading("s1", 1'730'000'000, {{"temp", 21.5}, {"hum", 40}})},
+             f1);
+  // второй кадр ссылается на строки из первого
+  enc.encode(8, {reading("s1", 1'730'000'001, {{"temp", -3.25}})}, f2);
+  EXPECT_LT(f2.size(), f1.size());
+  EXPECT_EQ(boost::endian::load_little_u32(f1.data()),
+            f1.size() - binproto::kLenPrefix);
+
+  binproto::Decoder dec;
+  std::vector<EnqueuedTask> out;
+  std::uint32_t seq = 0;
+  std::string err;
+  ASSERT_TRUE(dec.decode(body(f1), f1.size() - 4, out, seq, err)) << err;
+  EXPECT_EQ(seq, 7u);
+  ASSERT_TRUE(dec.decode(body(f2), f2.size() - 4, out, seq, err)) << err;
+  EXPECT_EQ(seq, 8u);
+
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(g_symbols.view(out[0].sensor), "s1");
+  EXPECT_EQ(out[0].ts, 1'730'000'000);
+  ASSERT_EQ(out[0].kv.size(), 2u);
+  EXPECT_EQ(g_symbols.view(out[0].kv[1].first), "hum");
+  EXPECT_DOUBLE_EQ(out[0].kv[1].second, 40.0);
+  EXPECT_EQ(out[1].sensor, out[0].sensor);
+  EXPECT_EQ(g_symbols.view(out[1].kv[0].first), "temp");
+  EXPECT_DOUBLE_EQ(out[1].kv[0].second, -3.25);
+}
+
+TEST(BinaryProtocol, TruncatedFrameRollsBackOutput) {
+  binproto::Encoder enc;
+  std::vector<std::uint8_t> f;
+  enc.encode(1, {reading("a", 1, {{"k", 1}}), reading("b", 2, {{"k", 2}})}, f);
+
+  binproto::Decoder dec;
+  std::vector<EnqueuedTask> out(1); // уже лежащее в out не трогаем
+  std::uint32_t seq = 0;
+  std::string err;
+  EXPECT_FALSE(dec.decode(body(f), f.size() - 4 - 3, out, seq, err));
+  EXPECT_EQ(out.size(), 1u);
+  EXPECT_FALSE(err.empty());
+}
+
+TEST(BinaryProtocol, UnknownRefIsRejected) {
+  // type | seq | count=1 | strref(ref id=5)
+  const std::uint8_t frame[] = {binproto::kFrameReadings, 1, 0, 0, 0, 1, 0,
+                                binproto::kStrRef,        5, 0};
+  binproto::Decoder dec;
+  std::vector<EnqueuedTask> out;
+  std::uint32_t seq = 0;
+  std::string err;
+  EXPECT_FALSE(dec.decode(frame, sizeof(frame), out, seq, err));
+}
+
+TEST(BinaryProtocol, AckRoundTrip) {
+  std::vector<std::uint8_t> f;
+  binproto::encode_ack({42, 3, 100, 2}, f);
+  binproto::Ack ack;
+  ASSERT_TRUE(binproto::decode_ack(body(f), f.size() - 4, ack));
+  EXPECT_EQ(ack.last_seq, 42u);
+  EXPECT_EQ(ack.frames, 3u);
+  EXPECT_EQ(ack.accepted, 100u);
+  EXPECT_EQ(ack.rejected, 2u);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <sensors/body_codec.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <lz4frame.h>
+#include <zdict.h>
+#include <zstd.h>
+
+using sensors::BodyDecoder;
+using sensors::ContentEncoding;
+
+namespace {
+
+std::string ndjson(std::size_t n) {
+  std::string out;
+  char line[160];
+  for (std::size_t i = 0; i < n; ++i) {
+    const int len = std::snprintf(
+        line, sizeof(line),
+        R"({"sensor_id":"lg-%zu","ts":%zu,"metrics":{"temperature":%.2f}})"
+        "\n",
+        i % 97, 1700000000000 + i, 20.0 + static_cast<double>(i % 50) / 10);
+    out.append(line, static_cast<std::size_t>(len));
+  }
+  return out;
+}
+
+std::string zstd_frame(const std::string &src) {
+  std::string out(ZSTD_compressBound(src.size()), '\0');
+  out.resize(ZSTD_compress(out.data(), out.size(), src.data(), src.size(), 3));
+  return out;
+}
+
+std::string lz4_frame(const std::string &src) {
+  std::string out(LZ4F_compressFrameBound(src.size(), nullptr), '\0');
+  out.resize(LZ4F_compressFrame(out.data(), out.size(), src.data(),
+                                src.size(), nullptr));
+  return out;
+}
+
+} // namespace
+
+TEST(BodyCodec, ParsesContentEncoding) {
+  EXPECT_EQ(sensors::parse_content_encoding(""), ContentEncoding::identity);
+  EXPECT_EQ(sensors::parse_content_encoding(" ZSTD"), ContentEncoding::zstd);
+  EXPECT_EQ(sensors::parse_content_encoding("lz4"), ContentEncoding::lz4);
+  EXPECT_EQ(sensors::parse_content_encoding("gzip"),
+            ContentEncoding::unsupported);
+}
+
+TEST(BodyCodec, RoundTripsZstdAndLz4ReusingBuffer) {
+  BodyDecoder dec;
+  std::string out;
+  const std::string body = ndjson(500);
+  ASSERT_EQ(dec.decode(ContentEncoding::zstd, zstd_frame(body), out, 1 << 20),
+            BodyDecoder::Status::ok);
+  EXPECT_EQ(out, body);
+  ASSERT_EQ(dec.decode(ContentEncoding::lz4, lz4_frame(body), out, 1 << 20),
+            BodyDecoder::Status::ok);
+  EXPECT_EQ(out, body);
+  // второе тело тем же контекстом и в тот же буфер
+  const std::string small = ndjson(3);
+  ASSERT_EQ(dec.decode(ContentEncoding::zstd, zstd_frame(small), out, 1 << 20),
+            BodyDecoder::Status::ok);
+  EXPECT_EQ(out, small);
+}
+
+TEST(BodyCodec, EnforcesDecompressedCapAndRejectsCorruptFrames) {
+  BodyDecoder dec;
+  std::string out;
+  const std::string body = ndjson(500);
+  EXPECT_EQ(dec.decode(ContentEncoding::zstd, zstd_frame(body), out, 1000),
+            BodyDecoder::Status::too_large);
+  EXPECT_EQ(dec.decode(ContentEncoding::lz4, lz4_frame(body), out, 1000),
+            BodyDecoder::Status::too_large);
+  const std::string frame = zstd_frame(body);
+  EXPECT_EQ(dec.decode(ContentEncoding::zstd, frame.substr(0, frame.size() / 2),
+                       out, 1 << 20),
+            BodyDecoder::Status::corrupt);
+  EXPECT_EQ(dec.decode(ContentEncoding::lz4, "not an lz4 frame", out, 1 << 20),
+            BodyDecoder::Status::corrupt);
+  // после ошибки контекст снова годен
+  EXPECT_EQ(dec.decode(ContentEncoding::zstd, frame, out, 1 << 20),
+            BodyDecoder::Status::ok);
+}
+
+TEST(BodyCodec, DecodesWithPreSharedDictionary) {
+  std::string samples;
+  std::vector<std::size_t> sizes;
+  for (std::size_t i = 0; i < 2000; ++i) {
+    const std::string line = ndjson(i % 7 + 1).substr(0, 90 + i % 20);
+    samples += line;
+    sizes.push_back(line.size());
+  }
+  std::string dict(4096, '\0');
+  const std::size_t n =
+      ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(),
+                            sizes.data(), static_cast<unsigned>(sizes.size()));
+  ASSERT_FALSE(ZDICT_isError(n));
+  dict.resize(n);
+  const auto path =
+      std::filesystem::temp_directory_path() / "sensors_test_dict.zstd";
+  std::ofstream(path, std::ios::binary) << dict;
+
+  const auto loaded = sensors::ZstdDictionary::load(path.string());
+  EXPECT_NE(loaded->id(), 0u);
+  const std::string body = ndjson(1);
+  std::string frame(ZSTD_compressBound(body.size()), '\0');
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  frame.resize(ZSTD_compress_usingDict(cctx, frame.data(), frame.size(),
+                                       body.data(), body.size(), dict.data(),
+                                       dict.size(), 3));
+  ZSTD_freeCCtx(cctx);
+
+  BodyDecoder with(loaded.get()), without;
+  std::string out;
+  ASSERT_EQ(with.decode(ContentEncoding::zstd, frame, out, 1 << 20),
+            BodyDecoder::Status::ok);
+  EXPECT_EQ(out, body);
+  EXPECT_EQ(without.decode(ContentEncoding::zstd, frame, out, 1 << 20),
+            BodyDecoder::Status::corrupt);
+  // обычные кадры словарь не мешает распаковывать
+  EXPECT_EQ(with.decode(ContentEncoding::zstd, zstd_frame(body), out, 1 << 20),
+            BodyDecoder::Status::ok);
+  EXPECT_THROW(sensors::ZstdDictionary::load("/nonexistent/dict"),
+               std::runtime_error);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <sensors/ch_endpoints.hpp>
+
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using sensors::ChEndpoint;
+using sensors::ChEndpointSet;
+
+namespace {
+
+constexpr std::int64_t kMs = 1000000;
+
+std::vector<ChEndpoint> replicas(std::size_t n) {
+  std::vector<ChEndpoint> out;
+  for (std::size_t i = 0; i < n; ++i)
+    out.push_back({"ch" + std::to_string(i), 9000, 0});
+  return out;
+}
+
+} // namespace
+
+TEST(ChEndpoints, ParsesRoutingConfig) {
+  sensors::Config cfg;
+  cfg.ch_host = "db";
+  cfg.ch_port = 9440;
+  auto eps = sensors::ch_endpoints_from_config(cfg);
+  ASSERT_EQ(eps.size(), 1u);
+  EXPECT_EQ(eps[0].name(), "db:9440");
+
+  cfg.ch_endpoints = {"a:9001", "b", "[::1]:9002"};
+  eps = sensors::ch_endpoints_from_config(cfg);
+  ASSERT_EQ(eps.size(), 3u);
+  EXPECT_EQ(eps[0].name(), "a:9001");
+  EXPECT_EQ(eps[1].name(), "b:9440");
+  EXPECT_EQ(eps[2].host, "::1");
+  EXPECT_EQ(eps[2].port, 9002);
+
+  cfg.ch_routing = "sharded";
+  EXPECT_THROW(sensors::ch_endpoints_from_config(cfg), std::invalid_argument);
+  cfg.ch_shards = {{"a:9000", "b:9000"}, {"c:9000"}};
+  eps = sensors::ch_endpoints_from_config(cfg);
+  ASSERT_EQ(eps.size(), 3u);
+  EXPECT_EQ(eps[2].shard, 1u);
+
+  cfg.ch_shards = {{"a:99999"}};
+  EXPECT_THROW(sensors::ch_endpoints_from_config(cfg), std::invalid_argument);
+  cfg.ch_routing = "random";
+  EXPECT_THROW(sensors::ch_endpoints_from_config(cfg), std::invalid_argument);
+}
+
+TEST(ChEndpoints, PicksFastestAndSpreadsNearEqual) {
+  ChEndpointSet set(replicas(3));
+  set.on_insert(0, 10 * kMs, 100);
+  set.on_insert(1, 12 * kMs, 100);
+  set.on_insert(2, 40 * kMs, 100);
+  EXPECT_EQ(set.pick(0, 0), 0u);
+  EXPECT_EQ(set.pick(0, 1), 1u);
+  EXPECT_EQ(set.pick(0, 2), 0u);
+  EXPECT_TRUE(set.should_leave(2, 0));
+  EXPECT_FALSE(set.should_leave(0, 0));
+  EXPECT_FALSE(set.should_leave(1, 1));
+}
+
+TEST(ChEndpoints, FailsOverAndReturnsAfterProbes) {
+  ChEndpointSet set(replicas(2));
+  set.on_insert(0, 5 * kMs, 10);
+  set.on_insert(1, 5 * kMs, 10);
+  set.on_failure(1, false); // отказ сервера: узел остаётся
+  EXPECT_TRUE(set.healthy(1));
+  set.on_failure(0, true);
+  EXPECT_FALSE(set.healthy(0));
+  EXPECT_TRUE(set.should_leave(0, 0));
+  EXPECT_EQ(set.pick(0, 0), 1u);
+  EXPECT_EQ(set.pick(0, 1), 1u);
+
+  set.on_failure(1, true);
+  EXPECT_EQ(set.pick(0, 0), ChEndpointSet::npos);
+  EXPECT_FALSE(set.wait_healthy(0, std::chrono::milliseconds(5)));
+
+  set.on_probe(0, true, kMs / 2);
+  EXPECT_FALSE(set.healthy(0)); // одного ping мало
+  set.on_probe(0, true, kMs / 2);
+  EXPECT_TRUE(set.wait_healthy(0, std::chrono::milliseconds(5)));
+  EXPECT_EQ(set.pick(0, 1), 0u);
+}
+
+TEST(ChEndpoints, IdleSlowNodeIsRetriedEventually) {
+  ChEndpointSet set(replicas(2));
+  set.on_insert(0, 10 * kMs, 10);
+  set.on_insert(1, 200 * kMs, 10);
+  EXPECT_TRUE(set.should_leave(1, 1));
+  for (int i = 0; i < 30; ++i) {
+    set.on_insert(0, 10 * kMs, 10);
+    set.on_probe(1, true, kMs / 2);
+  }
+  EXPECT_FALSE(set.should_leave(1, 1));
+  EXPECT_EQ(set.pick(0, 1), 1u);
+}
+
+TEST(ChEndpoints, ShardOfIsStableAndCoversAllShards) {
+  EXPECT_EQ(sensors::ch_shard_of("sensor-42", 1), 0u);
+  EXPECT_EQ(sensors::ch_shard_of("sensor-42", 4),
+            sensors::ch_shard_of(std::string("sensor-") + "42", 4));
+  std::set<std::size_t> seen;
+  for (int i = 0; i < 1000; ++i) {
+    const auto s = sensors::ch_shard_of("s" + std::to_string(i), 4);
+    ASSERT_LT(s, 4u);
+    seen.insert(s);
+  }
+  EXPECT_EQ(seen.size(), 4u);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <sensors/dedup_filter.hpp>
+
+#include <cstdint>
+
+using sensors::DedupFilter;
+using sensors::EnqueuedTask;
+using sensors::idempotency_key;
+using Claim = sensors::DedupFilter::Claim;
+
+namespace {
+constexpr std::int64_t kSec = 1'000'000'000;
+const std::int64_t kStart = sensors::mono_ns();
+
+// приём и успешная запись: true — ключ новый
+bool insert(DedupFilter &f, std::uint64_t key, std::int64_t now_ns) {
+  if (f.claim(key, now_ns) != Claim::fresh)
+    return false;
+  f.commit(key, now_ns);
+  return true;
+}
+} // namespace
+
+TEST(DedupFilter, SuppressesRepeatsWithinWindow) {
+  DedupFilter f(1024, 10);
+  EXPECT_TRUE(insert(f, 42, kStart));
+  EXPECT_FALSE(insert(f, 42, kStart + 1 * kSec));
+  EXPECT_TRUE(insert(f, 43, kStart + 1 * kSec));
+  // после одной смены поколения ключ ещё помнится
+  EXPECT_FALSE(insert(f, 42, kStart + 12 * kSec));
+  // после второй — забыт
+  EXPECT_TRUE(insert(f, 42, kStart + 23 * kSec));
+}
+
+TEST(DedupFilter, LongIdleForgetsBothGenerations) {
+  DedupFilter f(1024, 10);
+  EXPECT_TRUE(insert(f, 7, kStart));
+  EXPECT_TRUE(insert(f, 7, kStart + 25 * kSec));
+}
+
+TEST(DedupFilter, ForgetAllowsRetry) {
+  DedupFilter f(1024, 10);
+  EXPECT_EQ(f.claim(5, kStart), Claim::fresh);
+  f.forget(5);
+  EXPECT_TRUE(insert(f, 5, kStart));
+  EXPECT_FALSE(insert(f, 5, kStart));
+  // 0 и 1 — служебные значения слотов, но как ключи тоже работают
+  EXPECT_TRUE(insert(f, 0, kStart));
+  EXPECT_FALSE(insert(f, 0, kStart));
+}
+
+TEST(DedupFilter, InFlightUntilCommitOrForget) {
+  DedupFilter f(1024, 10);
+  EXPECT_EQ(f.claim(9, kStart), Claim::fresh);
+  // исходный запрос ещё пишется: повтор не считается записанным
+  EXPECT_EQ(f.claim(9, kStart), Claim::in_flight);
+  f.forget(9); // запись не удалась
+  EXPECT_EQ(f.claim(9, kStart), Claim::fresh);
+  f.commit(9, kStart);
+  EXPECT_EQ(f.claim(9, kStart), Claim::duplicate);
+}
+
+TEST(DedupFilter, LostInFlightKeyExpires) {
+  DedupFilter f(1024, 10);
+  EXPECT_EQ(f.claim(11, kStart), Claim::fresh);
+  EXPECT_EQ(f.claim(11, kStart + 12 * kSec), Claim::in_flight);
+  EXPECT_EQ(f.claim(11, kStart + 23 * kSec), Claim::fresh);
+}
+
+TEST(DedupFilter, StaysBoundedWhenFull) {
+  DedupFilter f(16 * 64, 3600); // 64 ключа на полосу
+  for (std::uint64_t i = 0; i < 100000; ++i)
+    insert(f, idempotency_key(std::to_string(i)), kStart);
+  EXPECT_LE(f.size(), 2u * 16 * 64);
+  // самые свежие ключи помнятся
+  EXPECT_FALSE(insert(f, idempotency_key("99999"), kStart));
+}
+
+TEST(DedupFilter, ReadingKeyDependsOnContent) {
+  EnqueuedTask a;
+  a.sensor = 1;
+  a.ts = 100;
+  a.kv.emplace_back(2, 1.5);
+  EnqueuedTask b;
+  b.sensor = 1;
+  b.ts = 100;
+  b.kv.emplace_back(2, 1.5);
+  EXPECT_EQ(idempotency_key(a), idempotency_key(b));
+  b.kv[0].second = 1.6;
+  EXPECT_NE(idempotency_key(a), idempotency_key(b));
+  b.kv[0].second = 1.5;
+  b.ts = 101;
+  EXPECT_NE(idempotency_key(a), idempotency_key(b));
+  EXPECT_NE(idempotency_key("abc"), idempotency_key("abd"));
+  // показания пачки с Idempotency-Key
+  const std::uint64_t batch = idempotency_key("batch-1");
+  EXPECT_EQ(idempotency_key(batch, 0), idempotency_key(batch, 0));
+  EXPECT_NE(idempotency_key(batch, 0), idempotency_key(batch, 1));
+  EXPECT_NE(idempotency_key(batch, 0), batch);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <sensors/fast_ingest_parser.hpp>
+#include <sensors/ingest_json.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using sensors::EnqueuedTask;
+using sensors::g_symbols;
+using sensors::FastParseResult;
+using sensors::parse_reading_fast;
+
+namespace {
+
+FastParseResult fast(const std::string &text, EnqueuedTask &t) {
+  std::string err;
+  return parse_reading_fast(text, t, err);
+}
+
+} // namespace
+
+TEST(FastParser, ParsesKnownShape) {
+  EnqueuedTask t;
+  ASSERT_EQ(fast(R"({"sensor_id":"dev-1","ts":1730000000,
+                     "metrics":{"temp":21.5,"hum":40,"p":-1e3}})",
+                 t),
+            FastParseResult::ok);
+  EXPECT_EQ(g_symbols.view(t.sensor), "dev-1");
+  EXPECT_EQ(t.ts, 1730000000);
+  ASSERT_EQ(t.kv.size(), 3u);
+  EXPECT_EQ(g_symbols.view(t.kv[0].first), "temp");
+  EXPECT_DOUBLE_EQ(t.kv[0].second, 21.5);
+  EXPECT_DOUBLE_EQ(t.kv[2].second, -1000.0);
+}
+
+TEST(FastParser, AnyFieldOrderAndUnknownFieldsSkipped) {
+  EnqueuedTask t;
+  ASSERT_EQ(fast(R"( { "metrics" : { "a" : 1 } , "extra" : {"x":[1,{"y":null}]},
+                      "ts" : 5 , "flag": true, "sensor_id" : "s" } )",
+                 t),
+            FastParseResult::ok);
+  EXPECT_EQ(g_symbols.view(t.sensor), "s");
+  EXPECT_EQ(t.ts, 5);
+  ASSERT_EQ(t.kv.size(), 1u);
+}
+
+TEST(FastParser, DuplicateMetricKeyKeepsLastValue) {
+  EnqueuedTask t;
+  ASSERT_EQ(fast(R"({"sensor_id":"s","ts":1,"metrics":{"a":1,"a":2}})", t),
+            FastParseResult::ok);
+  ASSERT_EQ(t.kv.size(), 1u);
+  EXPECT_DOUBLE_EQ(t.kv[0].second, 2.0);
+}
+
+TEST(FastParser, RejectsMalformedInput) {
+  EnqueuedTask t;
+  for (const char *bad : {
+           R"({"sensor_id":"s","ts":1})",                          // нет metrics
+           R"({"sensor_id":"s","ts":1,"metrics":{"a":-inf}})",     // не JSON
+           R"({"sensor_id":"s","ts":01,"metrics":{}})",            // ведущий 0
+           R"({"sensor_id":"s","ts":1,"metrics":{"a":1.}})",       // "1."
+           R"({"sensor_id":"s","ts":1,"metrics":{}} trailing)",    // мусор
+           R"({"sensor_id":"s" "ts":1,"metrics":{}})",             // нет ','
+           R"({"sensor_id":"s","ts":1,"metrics":{},"x":[1,2}})",   // скобки
+           "{\"sensor_id\":\"\xC0\xAF\",\"ts\":1,\"metrics\":{}}", // overlong
+           R"([1,2])",
+           "",
+       }) {
+    EXPECT_EQ(fast(bad, t), FastParseResult::error) << bad;
+  }
+}
+
+TEST(FastParser, EscapesAndFractionalTsFallBack) {
+  EnqueuedTask t;
+  EXPECT_EQ(fast(R"({"sensor_id":"a\"b","ts":1,"metrics":{}})", t),
+            FastParseResult::fallback);
+  EXPECT_EQ(fast(R"({"sensor_id":"s","ts":1.5,"metrics":{}})", t),
+            FastParseResult::fallback);
+  // не тот тип поля решает полный парсер: поле может повториться
+  EXPECT_EQ(fast(R"({"sensor_id":1,"ts":1,"metrics":{}})", t),
+            FastParseResult::fallback);
+  EXPECT_EQ(fast(R"({"sensor_id":"s","ts":"1","metrics":{}})", t),
+            FastParseResult::fallback);
+  EXPECT_EQ(fast(R"({"sensor_id":"s","ts":1,"metrics":{"a":true}})", t),
+            FastParseResult::fallback);
+}
+
+// быстрый путь принимает и отвергает те же входы, что nlohmann, и даёт
+// тот же результат (порядок kv у nlohmann — по имени ключа)
+TEST(FastParser, AcceptsExactlyWhatJsonPathAccepts) {
+  const std::string deep = std::string(40, '[') + std::string(40, ']');
+  const std::vector<std::string> metrics = {
+      "0", "-0", "-0.0", "01", "1.", ".5", "+1", "-", "1e", "1e+", "1.5e+3",
+      "2E-2", "1e400", "1e-400", "18446744073709551616", "-9223372036854775808",
+      "true", "false", "null", "tru", "\"1\"", "[1]", "{}", "1 2", "NaN"};
+  const std::vector<std::string> extras = {
+      "[1,2]", "[1,2}", "{\"a\":1]", "[1,]", "{\"a\":}", "{}", "[]",
+      "[[]", "\"\xE2\x82\xAC\"", "\"\xF0\x9F\x98\x80\"",
+      "\"\xED\xA0\x80\"", "\"\xF4\x90\x80\x80\"", "\"\x80\"",
+      "\"\xE2\x82\"", "\"\x7F\"", "\"a\tb\"", "\"a\\u0041\"",
+      "\"a\\x\"", deep, "[" + deep, "nul", "true", "-01"};
+  std::vector<std::string> inputs;
+  for (const auto &m : metrics) {
+    inputs.push_back(R"({"sensor_id":"s","ts":7,"metrics":{"m":)" + m + "}}");
+    inputs.push_back(R"({"sensor_id":"s","ts":)" + m + R"(,"metrics":{}})");
+  }
+  for (const auto &x : extras)
+    inputs.push_back(R"({"sensor_id":"s","ts":7,"metrics":{},"x":)" + x + "}");
+  for (const char *raw : {
+           "\xEF\xBB\xBF{\"sensor_id\":\"s\",\"ts\":1,\"metrics\":{}}",
+           "\xEF\xBB{\"sensor_id\":\"s\",\"ts\":1,\"metrics\":{}}",
+           R"({"sensor_id":1,"sensor_id":"s","ts":1,"metrics":{}})",
+           R"({"sensor_id":"s","ts":"x","ts":2,"metrics":{}})",
+           R"({"sensor_id":"s","ts":1,"metrics":{"a":"x","a":1}})",
+           R"({"sensor_id":"s","ts":1,"metrics":{"b":1,"a":2},"metrics":{}})",
+           R"({"sensor_id":"s","ts":1,"metrics":{"b":1,"a":2,}})",
+           R"({"sensor_id":"s","ts":1,"metrics":{"b":1,"a":2}})",
+           "{\"sensor_id\":\"\xD0\xB4\",\"ts\":1,\"metrics\":{}}",
+           "{\"sensor_id\":\"a\x01\",\"ts\":1,\"metrics\":{}}",
+           "{\"sensor_id\":\"s\",\"ts\":1,\"metrics\":{\"\xFF\":1}}",
+           " \r\n{\"sensor_id\":\"s\",\"ts\":1,\"metrics\":{}}\t",
+       })
+    inputs.push_back(raw);
+
+  auto sorted_kv = [](const EnqueuedTask &t) {
+    std::vector<std::pair<std::string, double>> kv;
+    for (const auto &[k, v] : t.kv)
+      kv.emplace_back(g_symbols.view(k), v);
+    std::sort(kv.begin(), kv.end());
+    return kv;
+  };
+  for (const auto &text : inputs) {
+    EnqueuedTask fast_t, slow_t;
+    std::string err;
+    const bool fast_ok = sensors::parse_reading(text, fast_t, err, true);
+    const bool slow_ok = sensors::parse_reading(text, slow_t, err, false);
+    ASSERT_EQ(fast_ok, slow_ok) << text;
+    if (!fast_ok)
+      continue;
+    EXPECT_EQ(fast_t.sensor, slow_t.sensor) << text;
+    EXPECT_EQ(fast_t.ts, slow_t.ts) << text;
+    const auto a = sorted_kv(fast_t), b = sorted_kv(slow_t);
+    ASSERT_EQ(a.size(), b.size()) << text;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      EXPECT_EQ(a[i].first, b[i].first) << text;
+      // сравнение по битам: -0.0 и 0.0 различаются
+      EXPECT_EQ(std::memcmp(&a[i].second, &b[i].second, sizeof(double)), 0)
+          << text << " " << a[i].second << " vs " << b[i].second;
+    }
+  }
+}
+
+TEST(FastParser, MatchesJsonPathThroughParseReading) {
+  const std::string text =
+      R"({"sensor_id":"aBc","ts":1730000000123,"metrics":{"t":1.25}})";
+  EnqueuedTask fast_t, slow_t;
+  std::string err;
+  ASSERT_TRUE(sensors::parse_reading(text, fast_t, err, true)) << err;
+  ASSERT_TRUE(sensors::parse_reading(text, slow_t, err, false)) << err;
+  EXPECT_EQ(g_symbols.view(fast_t.sensor), "aBc");
+  EXPECT_EQ(fast_t.sensor, slow_t.sensor);
+  EXPECT_EQ(fast_t.ts, slow_t.ts);
+  EXPECT_EQ(fast_t.kv, slow_t.kv);
+}
+
+TEST(FastParser, RejectedReadingDoesNotInternNames) {
+  const std::size_t before = g_symbols.size();
+  for (const char *bad : {
+           R"({"sensor_id":"rej-1","metrics":{"rej-k1":1}})",
+           R"({"sensor_id":"rej-2","ts":1,"metrics":{"rej-k2":"x"}})",
+           R"({"sensor_id":"rej-3","ts":1,"metrics":{"rej-k3":1}} junk)",
+           R"({"sensor_id":"rej-4","ts":"1","metrics":{"rej-k4":1}})",
+           R"({"sensor_id":"rej-5","ts":1,"metrics":{"rej-k5":1,"rej-k6":}})",
+           R"({"metrics":{"rej-k7":1},"ts":1})",
+       }) {
+    for (const bool fast_path : {true, false}) {
+      EnqueuedTask t;
+      std::string err;
+      EXPECT_FALSE(sensors::parse_reading(bad, t, err, fast_path)) << bad;
+    }
+  }
+  EXPECT_EQ(g_symbols.size(), before);
+}
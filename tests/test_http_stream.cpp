@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <sensors/http_server.hpp>
+#include <sensors/metrics_export.hpp>
+#include <sensors/threadsafe_queue.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <zstd.h>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using net::ip::tcp;
+using sensors::Config;
+using sensors::EnqueuedTask;
+using sensors::HttpServer;
+using sensors::ThreadSafeQueue;
+
+namespace {
+
+unsigned short free_port() {
+  net::io_context ioc;
+  tcp::acceptor a(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+  return a.local_endpoint().port();
+}
+
+std::string zstd_frame(const std::string &src) {
+  std::string out(ZSTD_compressBound(src.size()), '\0');
+  out.resize(ZSTD_compress(out.data(), out.size(), src.data(), src.size(), 3));
+  return out;
+}
+
+} // namespace
+
+// Маленький сжатый кадр с огромным коэффициентом не должен распаковываться
+// целиком, пока очередь полна: разобранных задач не больше
+// ingest_batch_max_items сверх того, что приняла очередь
+TEST(HttpStream, CompressedBodyUnpacksOnlyWhatQueueTakes) {
+  constexpr std::size_t kLines = 200000;
+  constexpr std::size_t kQueue = 1000;
+  const std::string line =
+      R"({"sensor_id":"bomb","ts":1700000000000,"metrics":{"t":1.5}})"
+      "\n";
+  std::string plain;
+  plain.reserve(line.size() * kLines);
+  for (std::size_t i = 0; i < kLines; ++i)
+    plain += line;
+  const std::string body = zstd_frame(plain);
+  ASSERT_LT(body.size() * 100, plain.size());
+
+  Config cfg;
+  cfg.host = "127.0.0.1";
+  cfg.port = free_port();
+  cfg.ingest_batch_max_items = 100;
+  cfg.ingest_stream_buffer_bytes = 4096;
+  cfg.ingest_stream_ack_interval_ms = 50;
+  cfg.ingest_stream_pause_ms = 1;
+
+  ThreadSafeQueue<EnqueuedTask> queue(kQueue);
+  net::io_context ioc;
+  HttpServer server(ioc, cfg, queue);
+  server.run();
+  std::thread io([&] { ioc.run(); });
+
+  const auto decompressed0 = sensors::g_ingest_decompressed_bytes.load();
+  const auto pauses0 = sensors::g_stream_pauses.load();
+
+  net::io_context cli;
+  boost::beast::tcp_stream conn(cli);
+  conn.connect(tcp::endpoint(net::ip::make_address(cfg.host), cfg.port));
+  http::request<http::string_body> req{http::verb::post, "/ingest/stream", 11};
+  req.set(http::field::host, cfg.host);
+  req.set(http::field::content_type, "application/x-ndjson");
+  req.set(http::field::content_encoding, "zstd");
+  req.body() = body;
+  req.prepare_payload();
+  http::write(conn, req);
+
+  // ждём, пока очередь заполнится и поток встанет на паузу
+  for (int i = 0; i < 500 && sensors::g_stream_pauses.load() == pauses0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_GT(sensors::g_stream_pauses.load(), pauses0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const auto unpacked =
+      sensors::g_ingest_decompressed_bytes.load() - decompressed0;
+  EXPECT_LE(unpacked, (kQueue + cfg.ingest_batch_max_items) * line.size() +
+                          2 * cfg.ingest_stream_buffer_bytes);
+
+  std::atomic<bool> done{false};
+  std::size_t drained = 0;
+  std::thread consumer([&] {
+    while (!done.load())
+      if (queue.pop_for(std::chrono::milliseconds(10)))
+        ++drained;
+  });
+
+  boost::beast::flat_buffer buf;
+  http::response_parser<http::string_body> res;
+  res.body_limit(16 * 1024 * 1024);
+  boost::beast::error_code ec;
+  conn.expires_after(std::chrono::seconds(30));
+  http::async_read(conn, buf, res,
+                   [&](boost::beast::error_code e, std::size_t) { ec = e; });
+  cli.run();
+  done = true;
+  consumer.join();
+  EXPECT_FALSE(ec) << ec.message();
+  while (queue.pop_for(std::chrono::milliseconds(0)))
+    ++drained;
+  EXPECT_EQ(drained, kLines);
+
+  EXPECT_EQ(res.get().result_int(), 200);
+  const std::string &out = res.get().body();
+  EXPECT_NE(out.find(R"({"accepted":200000,"rejected":0,"duplicates":0,)"
+                     R"("done":true})"),
+            std::string::npos)
+      << out.substr(out.size() > 200 ? out.size() - 200 : 0);
+  EXPECT_EQ(sensors::g_ingest_decompressed_bytes.load() - decompressed0,
+            plain.size());
+
+  conn.close();
+  server.stop();
+  queue.stop();
+  ioc.stop();
+  io.join();
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <sensors/intern_table.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using sensors::InternTable;
+using sensors::kInvalidSymbol;
+using sensors::SymbolId;
+
+TEST(InternTable, SameStringSameId) {
+  InternTable t;
+  const SymbolId a = t.intern("temperature");
+  const SymbolId b = t.intern("humidity");
+  EXPECT_NE(a, b);
+  EXPECT_EQ(t.intern(std::string("temperature")), a);
+  EXPECT_EQ(t.view(a), "temperature");
+  EXPECT_EQ(t.view(b), "humidity");
+  EXPECT_EQ(t.size(), 2u);
+}
+
+TEST(InternTable, LimitRejectsNewStrings) {
+  InternTable t(2);
+  ASSERT_NE(t.intern("a"), kInvalidSymbol);
+  ASSERT_NE(t.intern("b"), kInvalidSymbol);
+  EXPECT_EQ(t.intern("c"), kInvalidSymbol);
+  EXPECT_NE(t.intern("a"), kInvalidSymbol); // уже известные — по-прежнему
+}
+
+TEST(InternTable, ConcurrentInternAgrees) {
+  InternTable t;
+  constexpr int kThreads = 4;
+  constexpr int kStrings = 5000;
+  std::vector<std::vector<SymbolId>> ids(kThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int s = 0; s < kStrings; ++s)
+        ids[i].push_back(t.intern("sensor-" + std::to_string(s)));
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+
+  EXPECT_EQ(t.size(), static_cast<std::size_t>(kStrings));
+  for (int s = 0; s < kStrings; ++s) {
+    for (int i = 1; i < kThreads; ++i)
+      ASSERT_EQ(ids[i][s], ids[0][s]);
+    EXPECT_EQ(t.view(ids[0][s]), "sensor-" + std::to_string(s));
+  }
+}
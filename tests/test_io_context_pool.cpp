@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <sensors/io_context_pool.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using sensors::affinity_cpu;
+using sensors::IoContextPool;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+TEST(IoContextPool, AffinityListWrapsAround) {
+  EXPECT_EQ(affinity_cpu({}, 3), -1);
+  EXPECT_EQ(affinity_cpu({2, 5}, 0), 2);
+  EXPECT_EQ(affinity_cpu({2, 5}, 3), 5);
+}
+
+TEST(IoContextPool, EachContextRunsOnItsOwnThread) {
+  IoContextPool pool(3);
+  pool.start();
+  std::mutex mu;
+  std::vector<std::set<std::thread::id>> seen(pool.size());
+  std::atomic<int> done{0};
+  for (int round = 0; round < 10; ++round)
+    for (std::size_t i = 0; i < pool.size(); ++i)
+      net::post(pool.get(i), [&, i] {
+        std::lock_guard<std::mutex> lk(mu);
+        seen[i].insert(std::this_thread::get_id());
+        ++done;
+      });
+  while (done.load() < 30)
+    std::this_thread::yield();
+  pool.stop();
+  pool.join();
+
+  std::set<std::thread::id> all;
+  for (const auto &s : seen) {
+    EXPECT_EQ(s.size(), 1u); // контекст не прыгает между потоками
+    all.insert(s.begin(), s.end());
+  }
+  EXPECT_EQ(all.size(), pool.size());
+}
+
+TEST(IoContextPool, PinsToFirstCpu) {
+  EXPECT_FALSE(sensors::pin_current_thread(-1));
+#ifdef __linux__
+  // процессу может быть доступно не ядро 0 (taskset, cpuset контейнера)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int first = -1;
+  for (int c = 0; c < CPU_SETSIZE && first < 0; ++c)
+    if (CPU_ISSET(c, &allowed))
+      first = c;
+  ASSERT_GE(first, 0);
+
+  bool pinned = false;
+  int count = 0;
+  bool on_first = false;
+  std::thread([&] {
+    pinned = sensors::pin_current_thread(first);
+    cpu_set_t now;
+    CPU_ZERO(&now);
+    if (pinned && sched_getaffinity(0, sizeof(now), &now) == 0) {
+      count = CPU_COUNT(&now);
+      on_first = CPU_ISSET(first, &now);
+    }
+  }).join();
+  if (!pinned)
+    GTEST_SKIP() << "pinning to cpu " << first << " is not permitted";
+  EXPECT_EQ(count, 1);
+  EXPECT_TRUE(on_first);
+#endif
+}
+
+TEST(IoContextPool, ReusePortAllowsSeveralListeners) {
+  if (!sensors::kHasReusePort)
+    GTEST_SKIP() << "no SO_REUSEPORT";
+  net::io_context ioc;
+  tcp::acceptor a(ioc), b(ioc);
+  ASSERT_FALSE(sensors::listen_on(
+      a, {net::ip::make_address("127.0.0.1"), 0}, true));
+  const auto ep = a.local_endpoint();
+  EXPECT_FALSE(sensors::listen_on(b, ep, true));
+  // без SO_REUSEPORT порт занят
+  tcp::acceptor c(ioc);
+  EXPECT_TRUE(sensors::listen_on(c, ep, false));
+}
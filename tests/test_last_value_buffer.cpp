@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <sensors/last_value_buffer.hpp>
+
+#include <vector>
+
+using sensors::LastValueBuffer;
+
+TEST(LastValueBuffer, CoalescesToNewestValuePerPair) {
+  LastValueBuffer buf;
+  EXPECT_TRUE(buf.put(1, 10, 1.0, 100));
+  EXPECT_FALSE(buf.put(1, 10, 2.0, 101));
+  EXPECT_FALSE(buf.put(1, 10, 0.5, 99)); // запоздавшее старое — игнор
+  EXPECT_TRUE(buf.put(1, 11, 3.0, 100));
+  EXPECT_EQ(buf.size(), 2u);
+
+  std::vector<LastValueBuffer::Entry> out;
+  buf.drain(out);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].key, 10u);
+  EXPECT_DOUBLE_EQ(out[0].value, 2.0);
+  EXPECT_EQ(out[0].ts, 101);
+  EXPECT_EQ(buf.size(), 0u);
+  EXPECT_FALSE(buf.contains(1, 10));
+}
+
+TEST(LastValueBuffer, DrainGroupsBySensor) {
+  LastValueBuffer buf;
+  buf.put(3, 1, 1, 1);
+  buf.put(1, 1, 1, 1);
+  buf.put(3, 2, 1, 1);
+  buf.put(2, 1, 1, 1);
+  buf.put(1, 2, 1, 1);
+
+  std::vector<LastValueBuffer::Entry> out;
+  buf.drain(out);
+  ASSERT_EQ(out.size(), 5u);
+  for (std::size_t i = 1; i < out.size(); ++i)
+    EXPECT_LE(out[i - 1].sensor, out[i].sensor);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <sensors/latency_histogram.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using sensors::LatencyHistogram;
+
+TEST(LatencyHistogram, BucketBoundsAreInclusive) {
+  EXPECT_EQ(LatencyHistogram::bucket_for(0), 0u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1024), 0u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1025), 1u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1536), 1u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1537), 2u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(2048), 2u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(2049), 3u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(std::uint64_t{1} << 40),
+            LatencyHistogram::kBuckets - 1);
+
+  // каждое значение не больше верхней границы своей корзины и больше
+  // границы предыдущей
+  for (std::uint64_t ns = 1; ns < (std::uint64_t{1} << 36); ns = ns * 3 / 2 + 7) {
+    const std::size_t i = LatencyHistogram::bucket_for(ns);
+    ASSERT_LT(i, LatencyHistogram::kBuckets - 1) << ns;
+    EXPECT_LE(static_cast<double>(ns), LatencyHistogram::upper_bound_ns(i));
+    if (i > 0) {
+      EXPECT_GT(static_cast<double>(ns),
+                LatencyHistogram::upper_bound_ns(i - 1));
+    }
+  }
+}
+
+TEST(LatencyHistogram, SnapshotCountsAndSums) {
+  LatencyHistogram h;
+  h.observe_ns(500);
+  h.observe_us(3);
+  h.observe_ns(-5); // часы не монотонны между потоками — считаем нулём
+  const auto s = h.snapshot();
+  EXPECT_EQ(s.count, 3u);
+  EXPECT_EQ(s.sum_ns, 3500u);
+  EXPECT_EQ(s.buckets[0], 2u);
+  EXPECT_EQ(s.buckets[LatencyHistogram::bucket_for(3000)], 1u);
+}
+
+TEST(LatencyHistogram, ConcurrentObserve) {
+  LatencyHistogram h;
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t)
+    threads.emplace_back([&] {
+      for (int i = 0; i < kPerThread; ++i)
+        h.observe_ns(i);
+    });
+  for (auto &t : threads)
+    t.join();
+  const auto s = h.snapshot();
+  EXPECT_EQ(s.count, static_cast<std::uint64_t>(kThreads) * kPerThread);
+  EXPECT_EQ(s.sum_ns, static_cast<std::uint64_t>(kThreads) * kPerThread *
+                          (kPerThread - 1) / 2);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <sensors/latest_cache.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using sensors::KvBuffer;
+using sensors::LatestCache;
+
+TEST(LatestCache, KeepsNewestValuePerKey) {
+  LatestCache cache;
+  std::vector<LatestCache::Value> out;
+  EXPECT_FALSE(cache.read(5, out));
+
+  cache.update(5, KvBuffer{{1, 10.0}, {2, 20.0}}, 100);
+  cache.update(5, KvBuffer{{1, 11.0}}, 101);
+  cache.update(5, KvBuffer{{2, 0.0}}, 99); // запоздавшее — не затирает
+
+  ASSERT_TRUE(cache.read(5, out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].key, 1u);
+  EXPECT_DOUBLE_EQ(out[0].value, 11.0);
+  EXPECT_EQ(out[0].ts, 101);
+  EXPECT_DOUBLE_EQ(out[1].value, 20.0);
+  EXPECT_FALSE(cache.read(6, out));
+}
+
+TEST(LatestCache, GrowsPastInitialCapacity) {
+  LatestCache cache;
+  for (sensors::SymbolId k = 0; k < 40; ++k)
+    cache.update(1, KvBuffer{{k, 1.0 * k}}, 1);
+  std::vector<LatestCache::Value> out;
+  ASSERT_TRUE(cache.read(1, out));
+  ASSERT_EQ(out.size(), 40u);
+  EXPECT_DOUBLE_EQ(out[39].value, 39.0);
+}
+
+TEST(LatestCache, ReadersSeeConsistentSnapshots) {
+  // писатели пишут во все ключи одно и то же значение, равное ts:
+  // разнобой внутри снимка означал бы разорванное чтение
+  LatestCache cache;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> writers;
+  for (int w = 0; w < 2; ++w) {
+    writers.emplace_back([&, w] {
+      for (std::int64_t ts = 1; ts < 20000; ++ts) {
+        KvBuffer kv;
+        for (sensors::SymbolId k = 0; k < 12; ++k)
+          kv.emplace_back(k, static_cast<double>(ts));
+        cache.update(7, kv, ts * 2 + w);
+      }
+    });
+  }
+  std::thread reader([&] {
+    std::vector<LatestCache::Value> out;
+    while (!done.load()) {
+      if (!cache.read(7, out))
+        continue;
+      for (const auto &v : out)
+        ASSERT_DOUBLE_EQ(v.value, out[0].value);
+    }
+  });
+  for (auto &t : writers)
+    t.join();
+  done = true;
+  reader.join();
+}
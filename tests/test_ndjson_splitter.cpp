@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <sensors/ingest_json.hpp>
+
+#include <string>
+#include <vector>
+
+using sensors::NdjsonSplitter;
+
+namespace {
+
+struct Collect {
+  std::vector<std::string> *out;
+  void operator()(std::string_view line) const { out->emplace_back(line); }
+};
+
+std::size_t feed(NdjsonSplitter &s, std::string_view chunk,
+                 std::vector<std::string> &out) {
+  return s.feed(chunk.data(), chunk.size(), Collect{&out});
+}
+
+} // namespace
+
+TEST(NdjsonSplitter, LinesAcrossChunkBoundaries) {
+  NdjsonSplitter s(64);
+  std::vector<std::string> lines;
+  EXPECT_EQ(feed(s, "a1\nb", lines), 0u);
+  EXPECT_EQ(feed(s, "2", lines), 0u);
+  EXPECT_EQ(feed(s, "2\nc3\n\nd4", lines), 0u);
+  EXPECT_EQ(s.pending(), 2u);
+  s.finish(Collect{&lines});
+  EXPECT_EQ(lines, (std::vector<std::string>{"a1", "b22", "c3", "", "d4"}));
+  EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(NdjsonSplitter, OverlongLineIsDroppedWhole) {
+  NdjsonSplitter s(4);
+  std::vector<std::string> lines;
+  // целиком в одном куске
+  EXPECT_EQ(feed(s, "ok\n123456\nok2\n", lines), 1u);
+  // растёт через несколько кусков: отбрасывается один раз, до '\n'
+  EXPECT_EQ(feed(s, "abc", lines), 0u);
+  EXPECT_EQ(feed(s, "def", lines), 1u);
+  EXPECT_EQ(feed(s, "ghi", lines), 0u);
+  EXPECT_EQ(s.pending(), 0u); // память не копится
+  EXPECT_EQ(feed(s, "jk\nlast", lines), 0u);
+  s.finish(Collect{&lines});
+  EXPECT_EQ(lines, (std::vector<std::string>{"ok", "ok2", "last"}));
+}
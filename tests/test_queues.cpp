@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <sensors/mpmc_ring_queue.hpp>
+#include <sensors/threadsafe_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using sensors::BoundedQueue;
+using sensors::MpmcRingQueue;
+using sensors::ThreadSafeQueue;
+
+template <class Q>
+class QueueTest : public ::testing::Test {};
+
+using QueueImpls = ::testing::Types<ThreadSafeQueue<int>, MpmcRingQueue<int>>;
+TYPED_TEST_SUITE(QueueTest, QueueImpls);
+
+TYPED_TEST(QueueTest, FifoSingleThread) {
+  TypeParam q(8);
+  for (int i = 0; i < 5; ++i)
+    EXPECT_TRUE(q.try_push(i));
+  for (int i = 0; i < 5; ++i)
+    EXPECT_EQ(q.pop(), i);
+}
+
+TYPED_TEST(QueueTest, TryPushFailsWhenFull) {
+  TypeParam q(4); // у MpmcRingQueue 4 — уже степень двойки
+  for (int i = 0; i < 4; ++i)
+    EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(100));
+  EXPECT_EQ(q.pop(), 0);
+  EXPECT_TRUE(q.try_push(100));
+}
+
+TYPED_TEST(QueueTest, PopForTimesOutOnEmpty) {
+  TypeParam q(4);
+  const auto t0 = std::chrono::steady_clock::now();
+  EXPECT_FALSE(q.pop_for(std::chrono::milliseconds(20)).has_value());
+  EXPECT_GE(std::chrono::steady_clock::now() - t0,
+            std::chrono::milliseconds(15));
+}
+
+TYPED_TEST(QueueTest, PopBulkDrainsUpToMax) {
+  TypeParam q(16);
+  for (int i = 0; i < 10; ++i)
+    q.try_push(i);
+  std::vector<int> out;
+  EXPECT_EQ(q.pop_bulk(out, 4), 4u);
+  EXPECT_EQ(q.pop_bulk(out, 100), 6u);
+  EXPECT_EQ(q.pop_bulk(out, 100), 0u);
+  ASSERT_EQ(out.size(), 10u);
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(out[i], i);
+}
+
+TYPED_TEST(QueueTest, TryPushBulkIsAllOrNothing) {
+  TypeParam q(8);
+  std::vector<int> first{1, 2, 3, 4, 5};
+  EXPECT_TRUE(q.try_push_bulk(first));
+  std::vector<int> second{6, 7, 8, 9};
+  EXPECT_FALSE(q.try_push_bulk(second)); // 5 + 4 > 8
+  EXPECT_EQ(second.size(), 4u);
+  std::vector<int> third{6, 7, 8};
+  EXPECT_TRUE(q.try_push_bulk(third));
+
+  std::vector<int> out;
+  EXPECT_EQ(q.pop_bulk(out, 100), 8u);
+  EXPECT_EQ(out, (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8}));
+}
+
+TYPED_TEST(QueueTest, StopWakesBlockedConsumerAndDrains) {
+  TypeParam q(4);
+  q.try_push(7);
+  EXPECT_EQ(q.pop(), 7);
+
+  std::thread consumer([&] { EXPECT_FALSE(q.pop().has_value()); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  q.stop();
+  consumer.join();
+  EXPECT_FALSE(q.try_push(1));
+}
+
+TYPED_TEST(QueueTest, ManyProducersManyConsumers) {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 4;
+  constexpr int kPerProducer = 20000;
+  TypeParam q(64);
+  std::atomic<long long> sum{0};
+  std::atomic<int> popped{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p)
+    threads.emplace_back([&] {
+      for (int i = 1; i <= kPerProducer; ++i)
+        ASSERT_TRUE(q.push(i));
+    });
+  for (int c = 0; c < kConsumers; ++c)
+    threads.emplace_back([&] {
+      std::vector<int> buf;
+      while (popped.load() < kProducers * kPerProducer) {
+        buf.clear();
+        if (q.pop_bulk(buf, 8) == 0) {
+          if (auto v = q.pop_for(std::chrono::milliseconds(5)))
+            buf.push_back(*v);
+        }
+        for (int v : buf)
+          sum += v;
+        popped += static_cast<int>(buf.size());
+      }
+    });
+  for (auto &t : threads)
+    t.join();
+
+  const long long expected =
+      static_cast<long long>(kProducers) * kPerProducer * (kPerProducer + 1) / 2;
+  EXPECT_EQ(popped.load(), kProducers * kPerProducer);
+  EXPECT_EQ(sum.load(), expected);
+}
+
+TEST(MpmcRingQueue, CapacityRoundsUpToPowerOfTwo) {
+  MpmcRingQueue<int> q(5);
+  EXPECT_EQ(q.capacity(), 8u);
+}
+
+TEST(MpmcRingQueue, DestroysQueuedElements) {
+  auto marker = std::make_shared<int>(1);
+  {
+    MpmcRingQueue<std::shared_ptr<int>> q(4);
+    q.try_push(marker);
+    q.try_push(marker);
+    EXPECT_EQ(marker.use_count(), 3);
+  }
+  EXPECT_EQ(marker.use_count(), 1);
+}
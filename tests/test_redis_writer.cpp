@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <sensors/intern_table.hpp>
+#include <sensors/metrics_export.hpp>
+#include <sensors/redis_writer.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using sensors::Config;
+using sensors::EnqueuedTask;
+using sensors::RedisClient;
+using sensors::RedisWriter;
+
+namespace {
+
+EnqueuedTask reading(const std::string &sensor,
+                     std::initializer_list<std::pair<const char *, double>> kv,
+                     std::int64_t ts) {
+  EnqueuedTask t;
+  t.sensor = sensors::g_symbols.intern(sensor);
+  t.ts = ts;
+  for (const auto &[k, v] : kv)
+    t.kv.emplace_back(sensors::g_symbols.intern(k), v);
+  return t;
+}
+
+// подменённый Redis: запоминает сбросы, отвечает по очереди из results
+// (дальше — true); пока hold, сброс ждёт release()
+struct FakeRedis {
+  std::mutex m;
+  std::condition_variable cv;
+  std::vector<std::vector<RedisClient::Hash>> flushes;
+  std::vector<bool> results;
+  bool hold = false;
+  bool in_flush = false;
+
+  RedisWriter::Flush flush() {
+    return [this](const std::vector<RedisClient::Hash> &hashes) {
+      std::unique_lock<std::mutex> lk(m);
+      in_flush = true;
+      cv.notify_all();
+      cv.wait(lk, [&] { return !hold; });
+      in_flush = false;
+      flushes.push_back(hashes);
+      cv.notify_all();
+      const std::size_t i = flushes.size() - 1;
+      return i < results.size() ? results[i] : true;
+    };
+  }
+
+  // ждёт n-го завершённого сброса
+  bool wait_flushes(std::size_t n) {
+    std::unique_lock<std::mutex> lk(m);
+    return cv.wait_for(lk, std::chrono::seconds(5),
+                       [&] { return flushes.size() >= n; });
+  }
+  // ждёт, пока сброс начнётся (при hold он висит до release)
+  bool wait_in_flush() {
+    std::unique_lock<std::mutex> lk(m);
+    return cv.wait_for(lk, std::chrono::seconds(5), [&] { return in_flush; });
+  }
+  void release() {
+    std::lock_guard<std::mutex> lk(m);
+    hold = false;
+    cv.notify_all();
+  }
+};
+
+std::size_t fields(const std::vector<RedisClient::Hash> &hashes) {
+  std::size_t n = 0;
+  for (const auto &h : hashes)
+    n += h.fields.size() / 2; // <key> и <key>:ts
+  return n;
+}
+
+} // namespace
+
+TEST(RedisWriter, CoalescesWindowIntoOneHsetPerSensor) {
+  Config cfg;
+  cfg.redis_flush_interval_ms = 20;
+  FakeRedis redis;
+  RedisWriter w(cfg, redis.flush());
+  // до start всё попадает в одно окно
+  w.submit({reading("rw-a", {{"t", 1}, {"h", 2}}, 100),
+            reading("rw-b", {{"t", 3}}, 100)});
+  w.submit({reading("rw-a", {{"t", 5}}, 101),
+            reading("rw-a", {{"t", 0}}, 99)}); // старое значение не затирает
+  w.start();
+  ASSERT_TRUE(redis.wait_flushes(1));
+  w.stop();
+
+  std::lock_guard<std::mutex> lk(redis.m);
+  const auto &hashes = redis.flushes[0];
+  ASSERT_EQ(hashes.size(), 2u);
+  const auto &a = hashes[0].key == "sensor:rw-a" ? hashes[0] : hashes[1];
+  ASSERT_EQ(a.key, "sensor:rw-a");
+  ASSERT_EQ(a.fields.size(), 4u);
+  for (std::size_t i = 0; i < a.fields.size(); i += 2) {
+    if (a.fields[i].first == "t") {
+      EXPECT_EQ(a.fields[i].second, std::to_string(5.0));
+      EXPECT_EQ(a.fields[i + 1].first, "t:ts");
+      EXPECT_EQ(a.fields[i + 1].second, "101");
+    }
+  }
+}
+
+TEST(RedisWriter, SubmitDropsNewPairsOverPendingCap) {
+  Config cfg;
+  cfg.redis_flush_interval_ms = 20;
+  cfg.redis_max_pending = 2;
+  FakeRedis redis;
+  RedisWriter w(cfg, redis.flush());
+  const auto dropped0 = sensors::g_redis_dropped.load();
+  w.submit({reading("rw-cap", {{"a", 1}, {"b", 2}, {"c", 3}}, 1)});
+  // уже известная пара обновляется и при полном буфере
+  w.submit({reading("rw-cap", {{"a", 7}}, 2)});
+  EXPECT_EQ(sensors::g_redis_dropped.load() - dropped0, 1u);
+  w.start();
+  ASSERT_TRUE(redis.wait_flushes(1));
+  w.stop();
+  std::lock_guard<std::mutex> lk(redis.m);
+  EXPECT_EQ(fields(redis.flushes[0]), 2u);
+}
+
+TEST(RedisWriter, FailedFlushIsRequeuedWithinPendingCap) {
+  Config cfg;
+  cfg.redis_flush_interval_ms = 10;
+  cfg.redis_max_pending = 3;
+  FakeRedis redis;
+  redis.results = {false};
+  redis.hold = true;
+  RedisWriter w(cfg, redis.flush());
+  const auto dropped0 = sensors::g_redis_dropped.load();
+  const auto errors0 = sensors::g_redis_flush_errors.load();
+
+  w.submit({reading("rw-rq", {{"a", 1}, {"b", 2}}, 1)});
+  w.start();
+  // первый сброс (a, b) висит; тем временем приходят ещё две пары и
+  // новое значение a — места для возврата остаётся на одну пару
+  ASSERT_TRUE(redis.wait_in_flush());
+  w.submit({reading("rw-rq", {{"c", 3}, {"d", 4}, {"a", 9}}, 2)});
+  redis.release();
+  ASSERT_TRUE(redis.wait_flushes(2));
+  w.stop();
+
+  EXPECT_EQ(sensors::g_redis_flush_errors.load() - errors0, 1u);
+  // a уже обновлена — возврат её пропускает; b в буфер с (c, d, a) не влезла
+  EXPECT_EQ(sensors::g_redis_dropped.load() - dropped0, 1u);
+  std::lock_guard<std::mutex> lk(redis.m);
+  ASSERT_EQ(redis.flushes[1].size(), 1u);
+  const auto &h = redis.flushes[1][0];
+  EXPECT_EQ(fields(redis.flushes[1]), 3u);
+  for (std::size_t i = 0; i < h.fields.size(); i += 2) {
+    EXPECT_NE(h.fields[i].first, "b");
+    if (h.fields[i].first == "a") {
+      EXPECT_EQ(h.fields[i].second, std::to_string(9.0));
+    }
+  }
+}
+
+TEST(RedisWriter, FailedFlushIsRetriedWhenThereIsRoom) {
+  Config cfg;
+  cfg.redis_flush_interval_ms = 10;
+  FakeRedis redis;
+  redis.results = {false, false};
+  RedisWriter w(cfg, redis.flush());
+  w.submit({reading("rw-retry", {{"a", 1}, {"b", 2}}, 1)});
+  w.start();
+  ASSERT_TRUE(redis.wait_flushes(3));
+  w.stop();
+  std::lock_guard<std::mutex> lk(redis.m);
+  EXPECT_EQ(fields(redis.flushes[0]), 2u);
+  EXPECT_EQ(fields(redis.flushes[1]), 2u);
+  EXPECT_EQ(fields(redis.flushes[2]), 2u);
+}
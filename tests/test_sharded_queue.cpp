@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+#include <sensors/sharded_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+using sensors::EnqueuedTask;
+using sensors::ShardedTaskQueue;
+using sensors::SymbolId;
+
+namespace {
+
+EnqueuedTask task(SymbolId sensor, std::int64_t ts) {
+  EnqueuedTask t;
+  t.sensor = sensor;
+  t.ts = ts;
+  return t;
+}
+
+// датчик, попадающий в шард shard
+SymbolId sensor_in(const ShardedTaskQueue &q, std::size_t shard,
+                   SymbolId from = 1) {
+  for (SymbolId s = from;; ++s)
+    if (q.shard_of(s) == shard)
+      return s;
+}
+
+constexpr std::chrono::milliseconds kNoWait{0};
+
+std::chrono::nanoseconds thread_cpu_time() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
+TEST(ShardedQueue, SensorOrderPreservedWithinShard) {
+  ShardedTaskQueue q(4, 64, "mpmc", 2, 8);
+  const SymbolId a = 7;
+  for (int i = 0; i < 20; ++i)
+    ASSERT_TRUE(q.try_push(task(a, i)));
+  EXPECT_EQ(q.depth(q.shard_of(a)), 20u);
+
+  std::vector<EnqueuedTask> out;
+  const std::size_t worker = q.shard_of(a) % 2;
+  const std::size_t s = q.acquire(worker, out, 5, kNoWait);
+  ASSERT_EQ(s, q.shard_of(a));
+  q.pop_bulk_from(s, out, 100);
+  q.release(s);
+  ASSERT_EQ(out.size(), 20u);
+  for (int i = 0; i < 20; ++i)
+    EXPECT_EQ(out[i].ts, i);
+}
+
+TEST(ShardedQueue, TryPushBulkIsAllOrNothingAcrossShards) {
+  ShardedTaskQueue q(2, 4, "mutex", 1, 1);
+  const SymbolId a = sensor_in(q, 0);
+  const SymbolId b = sensor_in(q, 1);
+  for (int i = 0; i < 3; ++i)
+    ASSERT_TRUE(q.try_push(task(b, i)));
+
+  // в шарде b осталось одно место, пачка с двумя задачами b не влезает
+  std::vector<EnqueuedTask> items{task(a, 0), task(b, 3), task(b, 4)};
+  EXPECT_FALSE(q.try_push_bulk(items));
+  EXPECT_EQ(items.size(), 3u);
+  EXPECT_EQ(q.depth(0), 0u);
+  EXPECT_EQ(q.depth(1), 3u);
+
+  items = {task(a, 0), task(b, 3)};
+  EXPECT_TRUE(q.try_push_bulk(items));
+  EXPECT_EQ(q.depth(0), 1u);
+  EXPECT_EQ(q.depth(1), 4u);
+}
+
+TEST(ShardedQueue, ClaimedShardIsNotSharedAndStealNeedsDepth) {
+  // 2 шарда, 2 воркера: шард 0 домашний для воркера 0, шард 1 — для 1
+  ShardedTaskQueue q(2, 64, "mpmc", 2, 4);
+  const SymbolId a = sensor_in(q, 0);
+  for (int i = 0; i < 3; ++i)
+    ASSERT_TRUE(q.try_push(task(a, i)));
+
+  std::vector<EnqueuedTask> out;
+  // глубина 3 ниже порога кражи — воркер 1 шард 0 не трогает
+  EXPECT_EQ(q.acquire(1, out, 1, kNoWait), ShardedTaskQueue::npos);
+
+  ASSERT_EQ(q.acquire(0, out, 1, kNoWait), 0u);
+  for (int i = 3; i < 10; ++i)
+    ASSERT_TRUE(q.try_push(task(a, i)));
+  // шард захвачен воркером 0 — красть нельзя даже при большой глубине
+  std::vector<EnqueuedTask> other;
+  EXPECT_EQ(q.acquire(1, other, 100, kNoWait), ShardedTaskQueue::npos);
+  q.release(0);
+
+  // отпущенный глубокий шард воркер 1 забирает
+  EXPECT_EQ(q.acquire(1, other, 100, kNoWait), 0u);
+  q.release(0);
+  ASSERT_EQ(other.size(), 9u);
+  EXPECT_EQ(other.front().ts, 1);
+}
+
+TEST(ShardedQueue, HomeShardPreferredOverDeeperForeign) {
+  ShardedTaskQueue q(2, 64, "mpmc", 2, 1);
+  const SymbolId a = sensor_in(q, 0);
+  const SymbolId b = sensor_in(q, 1);
+  ASSERT_TRUE(q.try_push(task(a, 0)));
+  for (int i = 0; i < 10; ++i)
+    ASSERT_TRUE(q.try_push(task(b, i)));
+
+  std::vector<EnqueuedTask> out;
+  EXPECT_EQ(q.acquire(0, out, 100, kNoWait), 0u);
+  q.release(0);
+  EXPECT_EQ(q.acquire(0, out, 100, kNoWait), 1u);
+  q.release(1);
+  EXPECT_EQ(out.size(), 11u);
+}
+
+// pop_for не должен крутиться, пока все непустые шарды захвачены
+// воркерами, и должен проснуться, когда шард отпустят
+TEST(ShardedQueue, PopForSleepsWhileNonEmptyShardsAreClaimed) {
+  ShardedTaskQueue q(2, 16, "mpmc", 1, 1);
+  const SymbolId a = sensor_in(q, 0);
+  for (int i = 0; i < 3; ++i)
+    ASSERT_TRUE(q.try_push(task(a, i)));
+  std::vector<EnqueuedTask> out;
+  ASSERT_EQ(q.acquire(0, out, 1, kNoWait), 0u);
+
+  const auto cpu0 = thread_cpu_time();
+  EXPECT_FALSE(q.pop_for(std::chrono::milliseconds(200)));
+  EXPECT_LT(thread_cpu_time() - cpu0, std::chrono::milliseconds(50));
+
+  std::thread t([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    q.release(0);
+  });
+  const auto v = q.pop_for(std::chrono::milliseconds(5000));
+  t.join();
+  ASSERT_TRUE(v);
+  EXPECT_EQ(v->ts, 1);
+}
+
+TEST(ShardedQueue, StopWakesWaitingWorker) {
+  ShardedTaskQueue q(4, 16, "mpmc", 1, 1);
+  std::atomic<bool> done{false};
+  std::thread t([&] {
+    std::vector<EnqueuedTask> out;
+    EXPECT_EQ(q.acquire(0, out, 10, std::chrono::milliseconds(10000)),
+              ShardedTaskQueue::npos);
+    done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  q.stop();
+  t.join();
+  EXPECT_TRUE(done);
+  EXPECT_FALSE(q.try_push(task(1, 0)));
+}
+
+TEST(ShardedQueue, WorkersDrainEverythingInSensorOrder) {
+  constexpr int kSensors = 32;
+  constexpr int kPerSensor = 2000;
+  ShardedTaskQueue q(8, 256, "mpmc", 3, 16);
+
+  std::atomic<int> consumed{0};
+  std::vector<std::atomic<std::int64_t>> last(kSensors);
+  for (auto &l : last)
+    l = -1;
+  std::atomic<bool> ordered{true};
+
+  std::vector<std::thread> threads;
+  for (std::size_t w = 0; w < 3; ++w)
+    threads.emplace_back([&, w] {
+      std::vector<EnqueuedTask> batch;
+      while (consumed.load() < kSensors * kPerSensor) {
+        const std::size_t s =
+            q.acquire(w, batch, 64, std::chrono::milliseconds(10));
+        if (s == ShardedTaskQueue::npos)
+          continue;
+        q.pop_bulk_from(s, batch, 64);
+        for (const auto &t : batch) {
+          if (last[t.sensor].exchange(t.ts) >= t.ts)
+            ordered = false;
+        }
+        consumed += static_cast<int>(batch.size());
+        batch.clear();
+        q.release(s);
+      }
+    });
+  std::thread producer([&] {
+    for (int i = 0; i < kPerSensor; ++i)
+      for (int s = 0; s < kSensors; ++s)
+        q.push(task(static_cast<SymbolId>(s), i));
+  });
+  producer.join();
+  for (auto &t : threads)
+    t.join();
+  EXPECT_EQ(consumed.load(), kSensors * kPerSensor);
+  EXPECT_TRUE(ordered);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <sensors/request_context.hpp>
+#include <sensors/slab_pool.hpp>
+
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace sensors;
+
+TEST(SlabPool, FreedBlockIsReusedByTheSameThread) {
+  // свежий поток — пустой кэш, вытеснения в хранилище не будет
+  std::thread([] {
+    void *a = slab::allocate(100);
+    slab::deallocate(a, 100);
+    void *b = slab::allocate(120); // тот же класс 128 байт
+    EXPECT_EQ(a, b);
+    slab::deallocate(b, 120);
+  }).join();
+}
+
+TEST(SlabPool, LargeBlocksBypassThePool) {
+  void *p = slab::allocate(slab::kMaxBlock + 1);
+  ASSERT_NE(p, nullptr);
+  slab::deallocate(p, slab::kMaxBlock + 1);
+}
+
+TEST(SlabPool, BuffersFreedByWorkerFlowBackToProducer) {
+  // производитель выделяет блоки, «воркер» в другом потоке их освобождает
+  // и остаётся жив: без передачи через хранилище блоки осели бы в его
+  // кэше, и повторно производитель получил бы только новую память
+  constexpr std::size_t kBlocks = 512;
+  constexpr std::size_t kBytes = 2000; // класс 2048, в задачах не встречается
+  std::promise<void> freed, done;
+  std::thread worker;
+  std::size_t reused = 0;
+  std::thread([&] {
+    std::vector<void *> blocks;
+    for (std::size_t i = 0; i < kBlocks; ++i)
+      blocks.push_back(slab::allocate(kBytes));
+    const std::set<void *> original(blocks.begin(), blocks.end());
+
+    worker = std::thread([&, moved = std::move(blocks)] {
+      for (void *p : moved)
+        slab::deallocate(p, kBytes);
+      freed.set_value();
+      done.get_future().wait();
+    });
+    freed.get_future().wait();
+
+    std::vector<void *> again;
+    for (std::size_t i = 0; i < kBlocks; ++i) {
+      again.push_back(slab::allocate(kBytes));
+      reused += original.count(again.back());
+    }
+    for (void *p : again)
+      slab::deallocate(p, kBytes);
+  }).join();
+  done.set_value();
+  worker.join();
+
+  // у воркера остаётся меньше двух пачек, остальное вернулось производителю
+  EXPECT_GE(reused, kBlocks / 2);
+
+  KvBuffer kv;
+  kv.emplace_back(7u, 2.5);
+  ASSERT_EQ(kv.size(), 1u);
+  EXPECT_EQ(kv[0].first, 7u);
+}
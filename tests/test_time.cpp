@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <sensors/time_utils.hpp>
 
+#include <vector>
+
+using sensors::normalize_ts;
 using sensors::to_time_t_seconds;
 
 TEST(TimeConv, SecondsPassThrough) {
@@ -21,3 +24,29 @@ TEST(TimeConv, BoundaryNear10B) {
   // +1 — уже эвристика миллисекунд
   EXPECT_EQ(to_time_t_seconds(10'000'000'001LL), 10'000'000'001LL / 1000);
 }
+
+TEST(TimeConv, NormalizeUniformBatch) {
+  const std::vector<std::int64_t> ms{1'730'000'000'123, 1'730'000'001'999,
+                                     10'000'000'001LL};
+  std::vector<std::int64_t> out(ms.size());
+  normalize_ts(ms.data(), out.data(), ms.size());
+  for (std::size_t i = 0; i < ms.size(); ++i)
+    EXPECT_EQ(out[i], to_time_t_seconds(ms[i]));
+
+  const std::vector<std::int64_t> s{0, -5, 1'730'000'000, 10'000'000'000LL};
+  out.resize(s.size());
+  normalize_ts(s.data(), out.data(), s.size());
+  for (std::size_t i = 0; i < s.size(); ++i)
+    EXPECT_EQ(out[i], s[i]);
+}
+
+TEST(TimeConv, NormalizeMixedBatchMatchesScalar) {
+  const std::vector<std::int64_t> in{1'730'000'000, 1'730'000'000'500,
+                                     1'730'000'000'000'700, 10'000'000'001LL,
+                                     10'000'000'000'001LL};
+  std::vector<std::int64_t> out(in.size());
+  normalize_ts(in.data(), out.data(), in.size());
+  for (std::size_t i = 0; i < in.size(); ++i)
+    EXPECT_EQ(out[i], to_time_t_seconds(in[i]));
+  normalize_ts(in.data(), out.data(), 0); // пустой батч
+}
@@ -0,0 +1,309 @@
+#include <gtest/gtest.h>
+#include <sensors/metrics_export.hpp>
+#include <sensors/threadsafe_queue.hpp>
+#include <sensors/time_utils.hpp>
+#include <sensors/wal.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using sensors::EnqueuedTask;
+using sensors::ThreadSafeQueue;
+using sensors::WriteAheadLog;
+
+namespace {
+
+struct WalTest : ::testing::Test {
+  void SetUp() override {
+    dir = fs::temp_directory_path() /
+          ("sensors_wal_" + std::to_string(std::random_device{}()));
+    fs::remove_all(dir);
+    cfg.wal_dir = dir.string();
+    cfg.wal_fsync_interval_ms = 0;
+  }
+  void TearDown() override { fs::remove_all(dir); }
+
+  std::vector<EnqueuedTask> readings(int from, int n) {
+    std::vector<EnqueuedTask> out;
+    for (int i = from; i < from + n; ++i) {
+      EnqueuedTask t;
+      t.sensor = sensors::g_symbols.intern("wal-" + std::to_string(i % 3));
+      t.ts = 1700000000 + i;
+      t.kv.emplace_back(sensors::g_symbols.intern("temp"), i * 0.5);
+      out.push_back(std::move(t));
+    }
+    return out;
+  }
+
+  // ответ на append; ждёт, пока журнал отчитается
+  struct Waiter {
+    std::atomic<int> code{0};
+    std::shared_ptr<sensors::ReplyHandle> handle() {
+      return sensors::make_reply_handle(
+          [this](int c, std::string) { code.store(c); });
+    }
+    int wait() {
+      for (int i = 0; i < 2000 && code.load() == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return code.load();
+    }
+  };
+
+  std::vector<EnqueuedTask> take(ThreadSafeQueue<EnqueuedTask> &q,
+                                 std::size_t n) {
+    std::vector<EnqueuedTask> out;
+    while (out.size() < n) {
+      auto t = q.pop_for(std::chrono::milliseconds(2000));
+      if (!t)
+        break;
+      out.push_back(std::move(*t));
+    }
+    return out;
+  }
+
+  std::size_t segment_files() const {
+    std::size_t n = 0;
+    for (const auto &e : fs::directory_iterator(dir))
+      n += e.path().extension() == ".wal";
+    return n;
+  }
+
+  fs::path dir;
+  sensors::Config cfg;
+};
+
+} // namespace
+
+TEST_F(WalTest, AcksAfterWriteAndFeedsQueue) {
+  ThreadSafeQueue<EnqueuedTask> q(1000);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+
+  Waiter w;
+  auto batch = readings(0, 10);
+  ASSERT_TRUE(wal.append(batch, w.handle()));
+  EXPECT_EQ(w.wait(), 202);
+
+  auto got = take(q, 10);
+  ASSERT_EQ(got.size(), 10u);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(sensors::g_symbols.view(got[i].sensor),
+              "wal-" + std::to_string(i % 3));
+    EXPECT_EQ(got[i].ts, 1700000000 + i);
+    ASSERT_EQ(got[i].kv.size(), 1u);
+    EXPECT_DOUBLE_EQ(got[i].kv[0].second, i * 0.5);
+    EXPECT_NE(got[i].wal_segment, 0u);
+  }
+  q.stop();
+  wal.stop();
+}
+
+TEST_F(WalTest, ReplaysUncommittedAfterRestart) {
+  const std::int64_t before = sensors::unix_now_s();
+  {
+    ThreadSafeQueue<EnqueuedTask> q(1000);
+    WriteAheadLog wal(cfg, q);
+    wal.open();
+    wal.start();
+    for (int i = 0; i < 5; ++i) {
+      Waiter w;
+      auto batch = readings(i * 4, 4);
+      ASSERT_TRUE(wal.append(batch, w.handle()));
+      ASSERT_EQ(w.wait(), 202);
+    }
+    q.stop(); // ClickHouse так ничего и не вставил
+    wal.stop();
+  }
+
+  // оборванная запись в хвосте, как после сбоя посреди записи
+  const fs::path last = [&] {
+    fs::path p;
+    for (const auto &e : fs::directory_iterator(dir))
+      p = std::max(p, e.path());
+    return p;
+  }();
+  {
+    std::ofstream f(last, std::ios::binary | std::ios::app);
+    f.write("\x12\x34\x56\x78\x40\x00\x00\x00\x01", 9);
+  }
+
+  ThreadSafeQueue<EnqueuedTask> q(1000);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+  auto got = take(q, 20);
+  ASSERT_EQ(got.size(), 20u);
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(got[i].ts, 1700000000 + i);
+    // время приёма переживает перезапуск, а не заменяется временем подачи
+    EXPECT_GE(got[i].received_s, before);
+    EXPECT_LE(got[i].received_s, sensors::unix_now_s());
+  }
+  EXPECT_FALSE(q.pop_for(std::chrono::milliseconds(50)).has_value());
+  q.stop();
+  wal.stop();
+}
+
+TEST_F(WalTest, DropsSegmentsOnceCommitted) {
+  cfg.wal_segment_bytes = 1; // каждая группа — новый сегмент
+  ThreadSafeQueue<EnqueuedTask> q(1000);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+  for (int i = 0; i < 4; ++i) {
+    Waiter w;
+    auto batch = readings(i * 3, 3);
+    ASSERT_TRUE(wal.append(batch, w.handle()));
+    ASSERT_EQ(w.wait(), 202);
+  }
+  EXPECT_EQ(segment_files(), 4u);
+
+  auto got = take(q, 12);
+  ASSERT_EQ(got.size(), 12u);
+  wal.commit(got);
+  // закрыты и подтверждены три первых; открытый остаётся
+  for (int i = 0; i < 2000 && segment_files() > 1; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(segment_files(), 1u);
+  q.stop();
+  wal.stop();
+}
+
+TEST_F(WalTest, RejectsWhenFull) {
+  cfg.wal_max_bytes = 1;
+  ThreadSafeQueue<EnqueuedTask> q(1000);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+  Waiter w;
+  auto first = readings(0, 2);
+  ASSERT_TRUE(wal.append(first, w.handle()));
+  ASSERT_EQ(w.wait(), 202);
+
+  auto second = readings(2, 2);
+  EXPECT_FALSE(wal.append(second, nullptr));
+  EXPECT_EQ(second.size(), 2u); // при отказе задачи не тронуты
+  q.stop();
+  wal.stop();
+}
+
+TEST_F(WalTest, DeadLetterWritesNdjsonAndReleasesSegment) {
+  cfg.wal_segment_bytes = 1;
+  ThreadSafeQueue<EnqueuedTask> q(1000);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+  for (int i = 0; i < 2; ++i) {
+    Waiter w;
+    auto batch = readings(i * 3, 3);
+    ASSERT_TRUE(wal.append(batch, w.handle()));
+    ASSERT_EQ(w.wait(), 202);
+  }
+  auto got = take(q, 6);
+  ASSERT_EQ(got.size(), 6u);
+  // сервер отверг батч: он больше не держит журнал
+  wal.dead_letter(got, "schema mismatch");
+  for (int i = 0; i < 2000 && segment_files() > 1; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(segment_files(), 1u);
+
+  std::ifstream f(dir / "dead-letter.ndjson");
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(f, line);)
+    lines.push_back(line);
+  ASSERT_EQ(lines.size(), 6u);
+  EXPECT_EQ(lines[1],
+            R"({"metrics":{"temp":0.5},"sensor_id":"wal-1","ts":1700000001})");
+  q.stop();
+  wal.stop();
+}
+
+TEST_F(WalTest, DamagedActiveSegmentRollsWriterWhileAppendsContinue) {
+  ThreadSafeQueue<EnqueuedTask> q(1);
+  WriteAheadLog wal(cfg, q);
+  wal.open();
+  wal.start();
+  const auto corrupt0 = sensors::g_wal_corrupt_records.load();
+
+  // поток подачи забирает первую запись и встаёт на полной очереди
+  Waiter w0;
+  auto first = readings(0, 2);
+  ASSERT_TRUE(wal.append(first, w0.handle()));
+  ASSERT_EQ(w0.wait(), 202);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // вторую запись портим на диске, пока её никто не прочёл
+  Waiter w1;
+  auto second = readings(2, 1);
+  ASSERT_TRUE(wal.append(second, w1.handle()));
+  ASSERT_EQ(w1.wait(), 202);
+  ASSERT_EQ(segment_files(), 1u);
+  const fs::path seg = fs::directory_iterator(dir)->path();
+  {
+    std::fstream f(seg, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(-1, std::ios::end);
+    const char c = static_cast<char>(f.get() ^ 0x5A);
+    f.seekp(-1, std::ios::end);
+    f.put(c);
+  }
+
+  // запись продолжается; номер первого показания, отправленного уже после
+  // того, как поток подачи заметил порчу
+  constexpr int kFrames = 400;
+  std::atomic<int> after_detect{kFrames};
+  std::atomic<int> appended{0};
+  std::thread writer([&] {
+    for (int i = 3; i < kFrames; ++i) {
+      if (after_detect.load() == kFrames &&
+          sensors::g_wal_corrupt_records.load() != corrupt0)
+        after_detect = i;
+      auto batch = readings(i, 1);
+      Waiter w;
+      ASSERT_TRUE(wal.append(batch, w.handle()));
+      ASSERT_EQ(w.wait(), 202);
+      appended = i;
+    }
+  });
+  // очередь разгружается, когда за битой записью уже есть подтверждённые
+  // группы: поток подачи находит порчу посреди идущей записи
+  for (int i = 0; i < 5000 && appended.load() < 50; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::vector<std::int64_t> seen;
+  for (;;) {
+    auto t = q.pop_for(std::chrono::milliseconds(500));
+    if (!t)
+      break;
+    seen.push_back(t->ts - 1700000000);
+  }
+  writer.join();
+  while (auto t = q.pop_for(std::chrono::milliseconds(0)))
+    seen.push_back(t->ts - 1700000000);
+
+  EXPECT_GT(sensors::g_wal_corrupt_records.load(), corrupt0);
+  ASSERT_LT(after_detect.load(), kFrames);
+  EXPECT_GE(segment_files(), 2u); // писатель ушёл из битого сегмента
+  // пропасть могут только показания, записанные за битой до того, как её
+  // заметили; всё отправленное после — доходит, по порядку и без повторов
+  std::vector<bool> got(kFrames, false);
+  for (const auto ts : seen) {
+    ASSERT_GE(ts, 0);
+    ASSERT_LT(ts, kFrames);
+    EXPECT_FALSE(got[ts]) << ts;
+    got[ts] = true;
+  }
+  EXPECT_TRUE(got[0]);
+  EXPECT_TRUE(got[1]);
+  EXPECT_FALSE(got[2]);
+  for (int i = after_detect.load(); i < kFrames; ++i)
+    EXPECT_TRUE(got[i]) << i;
+  q.stop();
+  wal.stop();
+}
@@ -0,0 +1,753 @@
+// Заглушка ClickHouse для стенда без внешних сервисов: понимает ровно ту
+// часть native-протокола (TCP, порт 9000), которой пользуется clickhouse-cpp
+// в ClickHousePool — Hello, Ping, SELECT 1 и INSERT блоками без сжатия, —
+// и умеет вносить сбои: задержку ответа на INSERT, ошибки, обрывы
+// соединения и периодические «простои».
+//
+// Вставленные данные не хранятся: блоки разбираются по колонкам (чтобы
+// найти границы пакетов и посчитать строки) и отбрасываются. Раз в секунду
+// печатается статистика.
+//
+// Запуск:
+//   fake_clickhouse [--port 9000] [--latency-ms 0] [--jitter-ms 0]
+//                   [--error-rate 0] [--disconnect-rate 0]
+//                   [--outage-period 0 --outage-length 0]
+//                   [--low-cardinality]
+//   --error-rate / --disconnect-rate — доля INSERT, на которые отвечаем
+//     исключением / закрываем соединение без ответа (0..1);
+//   --outage-period P --outage-length L — каждые P секунд L секунд подряд
+//     новые соединения закрываются сразу, а INSERT обрываются;
+//   --low-cardinality — в заголовке INSERT строки как LowCardinality(String).
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/endian/conversion.hpp>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Ревизия протокола, которую объявляем в Hello. Соответствует
+// clickhouse-cpp 2.5 (DBMS_MIN_PROTOCOL_VERSION_WITH_PARAMETERS); с клиентом
+// работаем на min(его ревизия, эта), как настоящий сервер.
+constexpr std::uint64_t kRevision = 54459;
+
+// ревизии, с которых в пакетах появляются поля
+constexpr std::uint64_t kRevBlockInfo = 51903;
+constexpr std::uint64_t kRevTemporaryTables = 50264;
+constexpr std::uint64_t kRevClientInfo = 54032;
+constexpr std::uint64_t kRevServerTimezone = 54058;
+constexpr std::uint64_t kRevQuotaKeyInClientInfo = 54060;
+constexpr std::uint64_t kRevServerDisplayName = 54372;
+constexpr std::uint64_t kRevVersionPatch = 54401;
+constexpr std::uint64_t kRevSettingsAsStrings = 54429;
+constexpr std::uint64_t kRevInterserverSecret = 54441;
+constexpr std::uint64_t kRevOpenTelemetry = 54442;
+constexpr std::uint64_t kRevDistributedDepth = 54448;
+constexpr std::uint64_t kRevQueryStartTime = 54449;
+constexpr std::uint64_t kRevParallelReplicas = 54453;
+constexpr std::uint64_t kRevCustomSerialization = 54454;
+constexpr std::uint64_t kRevAddendum = 54458;
+constexpr std::uint64_t kRevParameters = 54459;
+
+namespace client_code {
+constexpr std::uint64_t kHello = 0;
+constexpr std::uint64_t kQuery = 1;
+constexpr std::uint64_t kData = 2;
+constexpr std::uint64_t kCancel = 3;
+constexpr std::uint64_t kPing = 4;
+} // namespace client_code
+
+namespace server_code {
+constexpr std::uint64_t kHello = 0;
+constexpr std::uint64_t kData = 1;
+constexpr std::uint64_t kException = 2;
+constexpr std::uint64_t kPong = 4;
+constexpr std::uint64_t kEndOfStream = 5;
+} // namespace server_code
+
+struct Options {
+  unsigned short port = 9000;
+  int latency_ms = 0;
+  int jitter_ms = 0;
+  double error_rate = 0;
+  double disconnect_rate = 0;
+  double outage_period_s = 0;
+  double outage_length_s = 0;
+  bool low_cardinality = false;
+};
+
+struct Stats {
+  std::atomic<unsigned long long> connections{0};
+  std::atomic<unsigned long long> active{0};
+  std::atomic<unsigned long long> inserts{0};
+  std::atomic<unsigned long long> rows{0};
+  std::atomic<unsigned long long> bytes{0};
+  std::atomic<unsigned long long> queries{0};
+  std::atomic<unsigned long long> injected_errors{0};
+  std::atomic<unsigned long long> injected_disconnects{0};
+  std::atomic<unsigned long long> protocol_errors{0};
+};
+
+Stats g_stats;
+std::atomic<bool> g_running{true};
+Clock::time_point g_started;
+
+// клиент закрыл соединение или мы решили его оборвать
+struct Disconnected {};
+
+bool in_outage(const Options &o) {
+  if (o.outage_period_s <= 0 || o.outage_length_s <= 0)
+    return false;
+  const double t =
+      std::chrono::duration<double>(Clock::now() - g_started).count();
+  return std::fmod(t, o.outage_period_s) >=
+         o.outage_period_s - o.outage_length_s;
+}
+
+// Буферизованное чтение примитивов native-протокола
+class Reader {
+public:
+  explicit Reader(tcp::socket &s) : sock_(s) {}
+
+  std::uint8_t u8() {
+    fill(1);
+    return buf_[pos_++];
+  }
+  std::uint8_t peek_u8() {
+    fill(1);
+    return buf_[pos_];
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      const std::uint8_t b = u8();
+      v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    throw std::runtime_error("varint too long");
+  }
+
+  template <class T> T fixed() {
+    fill(sizeof(T));
+    T v;
+    std::memcpy(&v, buf_.data() + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return boost::endian::little_to_native(v);
+  }
+
+  std::string str() {
+    const std::uint64_t n = varint();
+    if (n > kMaxString)
+      throw std::runtime_error("string too long");
+    std::string s(static_cast<std::size_t>(n), '\0');
+    read(s.data(), s.size());
+    return s;
+  }
+
+  void skip(std::uint64_t n) {
+    while (n > 0) {
+      fill(1);
+      const auto step = std::min<std::uint64_t>(n, end_ - pos_);
+      pos_ += static_cast<std::size_t>(step);
+      n -= step;
+    }
+  }
+
+  void skip_strings(std::uint64_t count) {
+    for (std::uint64_t i = 0; i < count; ++i)
+      skip(varint());
+  }
+
+  std::uint64_t consumed() const { return consumed_ + pos_; }
+
+private:
+  static constexpr std::uint64_t kMaxString = 1ULL << 30;
+
+  void read(char *out, std::size_t n) {
+    while (n > 0) {
+      fill(1);
+      const std::size_t step = std::min(n, end_ - pos_);
+      std::memcpy(out, buf_.data() + pos_, step);
+      pos_ += step;
+      out += step;
+      n -= step;
+    }
+  }
+
+  void fill(std::size_t need) {
+    if (end_ - pos_ >= need)
+      return;
+    if (pos_ > 0) {
+      std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+      consumed_ += pos_;
+      end_ -= pos_;
+      pos_ = 0;
+    }
+    while (end_ < need) {
+      boost::system::error_code ec;
+      const std::size_t n =
+          sock_.read_some(net::buffer(buf_.data() + end_, buf_.size() - end_), ec);
+      if (ec)
+        throw Disconnected{};
+      end_ += n;
+    }
+  }
+
+  tcp::socket &sock_;
+  std::vector<std::uint8_t> buf_ = std::vector<std::uint8_t>(64 * 1024);
+  std::size_t pos_{0};
+  std::size_t end_{0};
+  std::uint64_t consumed_{0};
+};
+
+class Writer {
+public:
+  void varint(std::uint64_t v) {
+    while (v >= 0x80) {
+      out_.push_back(static_cast<char>((v & 0x7F) | 0x80));
+      v >>= 7;
+    }
+    out_.push_back(static_cast<char>(v));
+  }
+  template <class T> void fixed(T v) {
+    v = boost::endian::native_to_little(v);
+    out_.append(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+  void str(std::string_view s) {
+    varint(s.size());
+    out_.append(s.data(), s.size());
+  }
+  void flush(tcp::socket &s) {
+    boost::system::error_code ec;
+    net::write(s, net::buffer(out_), ec);
+    out_.clear();
+    if (ec)
+      throw Disconnected{};
+  }
+
+private:
+  std::string out_;
+};
+
+// размер значения фиксированной ширины; 0 — тип не фиксированной ширины
+std::size_t fixed_width(std::string_view type) {
+  auto starts = [&](std::string_view p) { return type.substr(0, p.size()) == p; };
+  if (type == "UInt8" || type == "Int8" || type == "Bool" || starts("Enum8("))
+    return 1;
+  if (type == "UInt16" || type == "Int16" || type == "Date" ||
+      starts("Enum16("))
+    return 2;
+  if (type == "UInt32" || type == "Int32" || type == "Float32" ||
+      type == "Date32" || type == "IPv4" || type == "DateTime" ||
+      starts("DateTime("))
+    return 4;
+  if (type == "UInt64" || type == "Int64" || type == "Float64" ||
+      starts("DateTime64("))
+    return 8;
+  if (type == "UUID" || type == "Int128" || type == "UInt128" ||
+      type == "IPv6")
+    return 16;
+  if (starts("FixedString("))
+    return static_cast<std::size_t>(std::atoll(type.data() + 12));
+  return 0;
+}
+
+// тело колонки из rows значений (префикс входит сюда же)
+void skip_column(Reader &in, std::string_view type, std::uint64_t rows) {
+  if (const std::size_t w = fixed_width(type)) {
+    in.skip(rows * w);
+    return;
+  }
+  if (type == "String") {
+    in.skip_strings(rows);
+    return;
+  }
+  if (type.substr(0, 9) == "Nullable(" && type.back() == ')') {
+    in.skip(rows); // карта NULL
+    skip_column(in, type.substr(9, type.size() - 10), rows);
+    return;
+  }
+  if (type == "LowCardinality(String)") {
+    // префикс: версия ключей; тело: тип индекса, словарь, индексы
+    in.fixed<std::uint64_t>();
+    const auto index_type = in.fixed<std::uint64_t>();
+    const std::uint64_t keys = in.fixed<std::uint64_t>();
+    in.skip_strings(keys);
+    const std::uint64_t n = in.fixed<std::uint64_t>();
+    in.skip(n << (index_type & 0xFF));
+    return;
+  }
+  throw std::runtime_error("unsupported column type: " + std::string(type));
+}
+
+struct BlockInfo {
+  std::uint64_t columns{0};
+  std::uint64_t rows{0};
+};
+
+BlockInfo read_block(Reader &in, std::uint64_t rev) {
+  if (rev >= kRevBlockInfo) {
+    for (;;) {
+      const std::uint64_t field = in.varint();
+      if (field == 0)
+        break;
+      if (field == 1)
+        in.u8(); // is_overflows
+      else if (field == 2)
+        in.fixed<std::int32_t>(); // bucket_num
+      else
+        throw std::runtime_error("unknown block info field");
+    }
+  }
+  BlockInfo b;
+  b.columns = in.varint();
+  b.rows = in.varint();
+  for (std::uint64_t c = 0; c < b.columns; ++c) {
+    in.str(); // имя
+    const std::string type = in.str();
+    if (rev >= kRevCustomSerialization && in.u8() != 0)
+      throw std::runtime_error("custom serialization is not supported");
+    if (b.rows)
+      skip_column(in, type, b.rows);
+  }
+  return b;
+}
+
+// пакет Data от клиента (после кода пакета)
+BlockInfo read_data(Reader &in, std::uint64_t rev) {
+  if (rev >= kRevTemporaryTables)
+    in.str(); // имя временной таблицы
+  return read_block(in, rev);
+}
+
+void write_block_header(Writer &out, std::uint64_t rev, std::uint64_t columns,
+                        std::uint64_t rows) {
+  out.varint(server_code::kData);
+  if (rev >= kRevTemporaryTables)
+    out.str("");
+  if (rev >= kRevBlockInfo) {
+    out.varint(1);
+    out.fixed<std::uint8_t>(0);
+    out.varint(2);
+    out.fixed<std::int32_t>(-1);
+    out.varint(0);
+  }
+  out.varint(columns);
+  out.varint(rows);
+}
+
+void write_column_header(Writer &out, std::uint64_t rev, std::string_view name,
+                         std::string_view type) {
+  out.str(name);
+  out.str(type);
+  if (rev >= kRevCustomSerialization)
+    out.fixed<std::uint8_t>(0);
+}
+
+void write_exception(Writer &out, std::int32_t code, std::string_view msg) {
+  out.varint(server_code::kException);
+  out.fixed<std::int32_t>(code);
+  out.str("DB::Exception");
+  out.str(msg);
+  out.str(""); // stack trace
+  out.fixed<std::uint8_t>(0);
+}
+
+// колонки из "INSERT INTO t ( `a`,`b` ) VALUES"
+std::vector<std::string> insert_columns(std::string_view q) {
+  std::vector<std::string> cols;
+  const auto open = q.find('(');
+  const auto close = q.find(')', open == std::string_view::npos ? 0 : open);
+  if (open == std::string_view::npos || close == std::string_view::npos)
+    return cols;
+  std::string cur;
+  for (char c : q.substr(open + 1, close - open - 1)) {
+    if (c == ',') {
+      cols.push_back(std::move(cur));
+      cur.clear();
+    } else if (c != '`' && c != '"' && c != ' ') {
+      cur.push_back(c);
+    }
+  }
+  if (!cur.empty())
+    cols.push_back(std::move(cur));
+  return cols;
+}
+
+// тип колонки в заголовке ответа на INSERT (схема таблицы метрик)
+std::string column_type(const std::string &name, const Options &o) {
+  if (name == "ts")
+    return "DateTime";
+  if (name == "value")
+    return "Float64";
+  return o.low_cardinality ? "LowCardinality(String)" : "String";
+}
+
+bool starts_with_ci(std::string_view s, std::string_view prefix) {
+  const auto first = s.find_first_not_of(" \t\r\n");
+  if (first == std::string_view::npos)
+    return false;
+  s.remove_prefix(first);
+  if (s.size() < prefix.size())
+    return false;
+  for (std::size_t i = 0; i < prefix.size(); ++i)
+    if (std::toupper(static_cast<unsigned char>(s[i])) != prefix[i])
+      return false;
+  return true;
+}
+
+class Session {
+public:
+  Session(tcp::socket s, const Options &o, unsigned seed)
+      : sock_(std::move(s)), in_(sock_), opt_(o), rng_(seed) {}
+
+  void run() {
+    hello();
+    while (g_running) {
+      switch (in_.varint()) {
+      case client_code::kPing:
+        out_.varint(server_code::kPong);
+        out_.flush(sock_);
+        break;
+      case client_code::kQuery:
+        query();
+        break;
+      case client_code::kCancel:
+        break;
+      default:
+        throw std::runtime_error("unexpected client packet");
+      }
+    }
+  }
+
+private:
+  void hello() {
+    if (in_.varint() != client_code::kHello)
+      throw std::runtime_error("expected Hello");
+    in_.str(); // имя клиента
+    in_.varint();
+    in_.varint();
+    rev_ = std::min(in_.varint(), kRevision);
+    in_.str(); // база
+    in_.str(); // пользователь
+    in_.str(); // пароль
+
+    out_.varint(server_code::kHello);
+    out_.str("ClickHouse");
+    out_.varint(23);
+    out_.varint(8);
+    out_.varint(kRevision);
+    if (rev_ >= kRevServerTimezone)
+      out_.str("UTC");
+    if (rev_ >= kRevServerDisplayName)
+      out_.str("fake-clickhouse");
+    if (rev_ >= kRevVersionPatch)
+      out_.varint(1);
+    out_.flush(sock_);
+
+    // addendum: quota key. clickhouse-cpp шлёт пустую строку (байт 0);
+    // не все версии шлют его вообще, а код пакета Hello (0) после
+    // рукопожатия прийти не может, поэтому 0 однозначно — addendum
+    if (rev_ >= kRevAddendum && in_.peek_u8() == 0)
+      in_.u8();
+  }
+
+  void skip_settings() {
+    for (;;) {
+      if (in_.str().empty())
+        break;
+      in_.varint(); // флаги
+      in_.str();    // значение
+    }
+  }
+
+  void query() {
+    g_stats.queries.fetch_add(1, std::memory_order_relaxed);
+    in_.str(); // query_id
+    if (rev_ >= kRevClientInfo && in_.u8() != 0) { // query_kind
+      in_.str(); // initial_user
+      in_.str(); // initial_query_id
+      in_.str(); // initial_address
+      if (rev_ >= kRevQueryStartTime)
+        in_.fixed<std::int64_t>();
+      in_.u8();  // interface
+      in_.str(); // os_user
+      in_.str(); // client_hostname
+      in_.str(); // client_name
+      in_.varint();
+      in_.varint();
+      in_.varint(); // client revision
+      if (rev_ >= kRevQuotaKeyInClientInfo)
+        in_.str();
+      if (rev_ >= kRevDistributedDepth)
+        in_.varint();
+      if (rev_ >= kRevVersionPatch)
+        in_.varint();
+      if (rev_ >= kRevOpenTelemetry && in_.u8() != 0) {
+        in_.skip(16 + 8); // trace_id, span_id
+        in_.str();        // tracestate
+        in_.u8();         // trace_flags
+      }
+      if (rev_ >= kRevParallelReplicas) {
+        in_.varint();
+        in_.varint();
+        in_.varint();
+      }
+    }
+    if (rev_ >= kRevSettingsAsStrings)
+      skip_settings();
+    else
+      throw std::runtime_error("binary settings are not supported");
+    if (rev_ >= kRevInterserverSecret)
+      in_.str();
+    in_.varint(); // stage
+    const std::uint64_t compression = in_.varint();
+    const std::string text = in_.str();
+    if (rev_ >= kRevParameters)
+      skip_settings(); // параметры запроса в том же формате
+
+    // внешние таблицы: до пустого блока
+    for (;;) {
+      if (in_.varint() != client_code::kData)
+        throw std::runtime_error("expected Data after Query");
+      if (read_data(in_, rev_).columns == 0)
+        break;
+    }
+
+    if (compression != 0) {
+      write_exception(out_, 1000, "fake_clickhouse: compression is not supported");
+      out_.flush(sock_);
+      throw Disconnected{};
+    }
+
+    if (starts_with_ci(text, "INSERT"))
+      insert(text);
+    else
+      select(text);
+  }
+
+  void select(const std::string &text) {
+    // SELECT 1 — один столбец UInt8 с одной строкой; прочее (DDL и т.п.)
+    // просто завершаем
+    if (starts_with_ci(text, "SELECT 1")) {
+      write_block_header(out_, rev_, 1, 0);
+      write_column_header(out_, rev_, "1", "UInt8");
+      write_block_header(out_, rev_, 1, 1);
+      write_column_header(out_, rev_, "1", "UInt8");
+      out_.fixed<std::uint8_t>(1);
+    }
+    out_.varint(server_code::kEndOfStream);
+    out_.flush(sock_);
+  }
+
+  void insert(const std::string &text) {
+    // заголовок: структура таблицы, клиент ждёт его перед отправкой данных
+    const auto cols = insert_columns(text);
+    write_block_header(out_, rev_, cols.size(), 0);
+    for (const auto &c : cols)
+      write_column_header(out_, rev_, c, column_type(c, opt_));
+    out_.flush(sock_);
+
+    const std::uint64_t from = in_.consumed();
+    std::uint64_t rows = 0;
+    for (;;) {
+      if (in_.varint() != client_code::kData)
+        throw std::runtime_error("expected Data in INSERT");
+      const BlockInfo b = read_data(in_, rev_);
+      if (b.columns == 0 && b.rows == 0)
+        break;
+      rows += b.rows;
+    }
+
+    if (opt_.latency_ms > 0 || opt_.jitter_ms > 0) {
+      int ms = opt_.latency_ms;
+      if (opt_.jitter_ms > 0)
+        ms += std::uniform_int_distribution<int>(0, opt_.jitter_ms)(rng_);
+      std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    if (in_outage(opt_) ||
+        (opt_.disconnect_rate > 0 && coin(rng_) < opt_.disconnect_rate)) {
+      g_stats.injected_disconnects.fetch_add(1, std::memory_order_relaxed);
+      throw Disconnected{};
+    }
+    if (opt_.error_rate > 0 && coin(rng_) < opt_.error_rate) {
+      g_stats.injected_errors.fetch_add(1, std::memory_order_relaxed);
+      write_exception(out_, 1000, "fake_clickhouse: injected insert error");
+      out_.flush(sock_);
+      return;
+    }
+
+    g_stats.inserts.fetch_add(1, std::memory_order_relaxed);
+    g_stats.rows.fetch_add(rows, std::memory_order_relaxed);
+    g_stats.bytes.fetch_add(in_.consumed() - from, std::memory_order_relaxed);
+    out_.varint(server_code::kEndOfStream);
+    out_.flush(sock_);
+  }
+
+  tcp::socket sock_;
+  Reader in_;
+  Writer out_;
+  const Options &opt_;
+  std::mt19937 rng_;
+  std::uint64_t rev_{0};
+};
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "Usage: %s [--port 9000] [--latency-ms N] [--jitter-ms N]\n"
+               "          [--error-rate P] [--disconnect-rate P]\n"
+               "          [--outage-period S --outage-length S]\n"
+               "          [--low-cardinality]\n",
+               argv0);
+}
+
+bool parse_args(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string key = argv[i];
+    if (key == "--low-cardinality") {
+      o.low_cardinality = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      return false;
+    const char *v = argv[++i];
+    if (key == "--port")
+      o.port = static_cast<unsigned short>(std::atoi(v));
+    else if (key == "--latency-ms")
+      o.latency_ms = std::atoi(v);
+    else if (key == "--jitter-ms")
+      o.jitter_ms = std::atoi(v);
+    else if (key == "--error-rate")
+      o.error_rate = std::atof(v);
+    else if (key == "--disconnect-rate")
+      o.disconnect_rate = std::atof(v);
+    else if (key == "--outage-period")
+      o.outage_period_s = std::atof(v);
+    else if (key == "--outage-length")
+      o.outage_length_s = std::atof(v);
+    else
+      return false;
+  }
+  return true;
+}
+
+void print_stats() {
+  static unsigned long long last_rows = 0;
+  const unsigned long long rows = g_stats.rows.load();
+  std::fprintf(stderr,
+               "[FAKECH] conns %llu/%llu inserts %llu rows %llu (+%llu/s) "
+               "bytes %llu errors %llu disconnects %llu protocol %llu\n",
+               g_stats.active.load(), g_stats.connections.load(),
+               g_stats.inserts.load(), rows, rows - last_rows,
+               g_stats.bytes.load(), g_stats.injected_errors.load(),
+               g_stats.injected_disconnects.load(),
+               g_stats.protocol_errors.load());
+  last_rows = rows;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parse_args(argc, argv, opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+  g_started = Clock::now();
+
+  net::io_context ioc;
+  tcp::acceptor acceptor(ioc);
+  boost::system::error_code ec;
+  const tcp::endpoint ep(net::ip::address_v4::any(), opt.port);
+  acceptor.open(ep.protocol(), ec);
+  if (!ec)
+    acceptor.set_option(net::socket_base::reuse_address(true), ec);
+  if (!ec)
+    acceptor.bind(ep, ec);
+  if (!ec)
+    acceptor.listen(net::socket_base::max_listen_connections, ec);
+  if (ec) {
+    std::fprintf(stderr, "[FAKECH] listen on %u: %s\n", opt.port,
+                 ec.message().c_str());
+    return 1;
+  }
+  std::fprintf(stderr, "[FAKECH] listening on %u\n", opt.port);
+
+  std::thread reporter([] {
+    while (g_running) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      print_stats();
+    }
+  });
+
+  // Ctrl+C: закрываем acceptor, run() возвращается, печатаем итог
+  net::signal_set signals(ioc, SIGINT, SIGTERM);
+  signals.async_wait([&](const boost::system::error_code &, int) {
+    g_running = false;
+    boost::system::error_code ignored;
+    acceptor.close(ignored);
+  });
+
+  unsigned seed = 1;
+  std::function<void()> do_accept = [&] {
+    acceptor.async_accept([&](boost::system::error_code aec, tcp::socket sock) {
+      if (aec) {
+        if (g_running)
+          do_accept();
+        return;
+      }
+      do_accept();
+      if (in_outage(opt)) {
+        sock.close(aec);
+        return;
+      }
+      sock.set_option(tcp::no_delay(true), aec);
+      g_stats.connections.fetch_add(1, std::memory_order_relaxed);
+      // поток на соединение с блокирующим вводом-выводом: соединений у пула
+      // ClickHouse единицы
+      std::thread([s = std::move(sock), &opt, seed = seed++]() mutable {
+        g_stats.active.fetch_add(1, std::memory_order_relaxed);
+        try {
+          Session(std::move(s), opt, seed).run();
+        } catch (const Disconnected &) {
+        } catch (const std::exception &e) {
+          g_stats.protocol_errors.fetch_add(1, std::memory_order_relaxed);
+          std::fprintf(stderr, "[FAKECH] protocol error: %s\n", e.what());
+        }
+        g_stats.active.fetch_sub(1, std::memory_order_relaxed);
+      }).detach();
+    });
+  };
+  do_accept();
+  ioc.run();
+
+  reporter.join();
+  print_stats();
+  return 0;
+}
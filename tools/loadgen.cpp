@@ -0,0 +1,401 @@
+// Нагрузочный генератор HTTP с открытым циклом (open loop).
+//
+// Запросы идут по расписанию с заданной общей частотой независимо от того,
+// как быстро отвечает сервер: соединение i отправляет k-й запрос в момент
+//   start + (k * connections + i) / rate.
+// Если ответ на предыдущий запрос задержался, следующий уходит сразу, а
+// задержка считается от запланированного момента, а не от фактической
+// отправки — поправка на coordinated omission (как в wrk2): иначе
+// замедлившийся сервер сам «прореживает» нагрузку и хвосты пропадают из
+// статистики. Время обслуживания (от фактической отправки) печатается
+// рядом для сравнения.
+//
+// Запуск:
+//   sensors_loadgen --rate 20000 [--host 127.0.0.1] [--port 8080]
+//                   [--path /ingest] [--connections 64] [--threads 2]
+//                   [--duration 30] [--warmup 2] [--sensors 1000]
+//                   [--batch 1] [--timeout 5000]
+// --batch N > 1 шлёт в --path NDJSON из N показаний (для /ingest/batch).
+// --timeout — предел в мс на соединение и на запрос с ответом (0 — без
+// предела): зависший запрос считается отдельно от ошибок ввода-вывода,
+// соединение переустанавливается, расписание идёт дальше.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  unsigned short port = 8080;
+  std::string path = "/ingest";
+  double rate = 0;          // запросов в секунду на все соединения
+  std::size_t connections = 64;
+  std::size_t threads = 2;
+  double duration_s = 30;   // замер
+  double warmup_s = 2;      // до замера, в статистику не попадает
+  std::size_t sensors = 1000;
+  std::size_t batch = 1;
+  int timeout_ms = 5000;    // 0 — запрос ждёт ответа сколько угодно
+};
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "Usage: %s --rate <req/s> [--host H] [--port P] [--path /ingest]\n"
+               "          [--connections N] [--threads N] [--duration S]\n"
+               "          [--warmup S] [--sensors N] [--batch N] [--timeout MS]\n",
+               argv0);
+}
+
+bool parse_args(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string key = argv[i];
+    if (i + 1 >= argc)
+      return false;
+    const char *v = argv[++i];
+    if (key == "--host")
+      o.host = v;
+    else if (key == "--port")
+      o.port = static_cast<unsigned short>(std::atoi(v));
+    else if (key == "--path")
+      o.path = v;
+    else if (key == "--rate")
+      o.rate = std::atof(v);
+    else if (key == "--connections")
+      o.connections = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--threads")
+      o.threads = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--duration")
+      o.duration_s = std::atof(v);
+    else if (key == "--warmup")
+      o.warmup_s = std::atof(v);
+    else if (key == "--sensors")
+      o.sensors = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--batch")
+      o.batch = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--timeout")
+      o.timeout_ms = std::atoi(v);
+    else
+      return false;
+  }
+  return o.rate > 0 && o.connections > 0 && o.threads > 0 && o.sensors > 0 &&
+         o.batch > 0 && o.duration_s > 0 && o.timeout_ms >= 0;
+}
+
+// итог по всем соединениям
+struct Stats {
+  std::mutex m;
+  std::vector<std::int64_t> corrected; // нс от запланированного момента
+  std::vector<std::int64_t> service;   // нс от фактической отправки
+  std::map<int, std::uint64_t> statuses;
+  std::uint64_t io_errors{0};
+  std::uint64_t timeouts{0}; // не уложились в --timeout
+  std::uint64_t late{0}; // ушли позже расписания более чем на 1 мс
+};
+
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+  Connection(net::io_context &ioc, const Options &o, std::size_t index,
+             Clock::time_point start, Stats &stats)
+      : opt_(o), index_(index), start_(start),
+        measure_from_(start + to_duration(o.warmup_s)),
+        end_(measure_from_ + to_duration(o.duration_s)),
+        period_(std::chrono::duration<double>(1.0 / o.rate)),
+        stream_(net::make_strand(ioc)), timer_(stream_.get_executor()),
+        rng_(static_cast<unsigned>(index) * 7919u + 1u), stats_(stats) {
+    corrected_.reserve(static_cast<std::size_t>(
+        o.rate * o.duration_s / static_cast<double>(o.connections) + 16));
+    service_.reserve(corrected_.capacity());
+  }
+
+  void run(const tcp::resolver::results_type &endpoints) {
+    endpoints_ = endpoints;
+    net::dispatch(stream_.get_executor(),
+                  [self = shared_from_this()] { self->schedule(); });
+  }
+
+private:
+  static Clock::duration to_duration(double s) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(s));
+  }
+
+  Clock::time_point intended(std::uint64_t k) const {
+    const double slot =
+        static_cast<double>(k * opt_.connections + index_) * period_.count();
+    return start_ + to_duration(slot);
+  }
+
+  void schedule() {
+    intended_ = intended(seq_);
+    if (intended_ >= end_) {
+      finish();
+      return;
+    }
+    if (Clock::now() >= intended_) {
+      send();
+      return;
+    }
+    timer_.expires_at(intended_);
+    timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+      if (!ec)
+        self->send();
+    });
+  }
+
+  // предел на следующую операцию потока: соединение или запрос с ответом
+  void arm_deadline() {
+    if (opt_.timeout_ms > 0)
+      stream_.expires_after(std::chrono::milliseconds(opt_.timeout_ms));
+  }
+
+  void send() {
+    arm_deadline();
+    if (!connected_) {
+      stream_.async_connect(endpoints_, [self = shared_from_this()](
+                                            beast::error_code ec,
+                                            const tcp::endpoint &) {
+        if (ec) {
+          self->fail(ec);
+          return;
+        }
+        self->stream_.socket().set_option(tcp::no_delay(true));
+        self->connected_ = true;
+        self->send();
+      });
+      return;
+    }
+
+    req_ = {};
+    req_.method(http::verb::post);
+    req_.target(opt_.path);
+    req_.version(11);
+    req_.keep_alive(true);
+    req_.set(http::field::host, opt_.host);
+    req_.set(http::field::content_type, "application/json");
+    req_.body() = make_body();
+    req_.prepare_payload();
+
+    sent_ = Clock::now();
+    if (intended_ >= measure_from_ &&
+        sent_ - intended_ > std::chrono::milliseconds(1))
+      ++late_;
+    http::async_write(stream_, req_,
+                      [self = shared_from_this()](beast::error_code ec,
+                                                  std::size_t) {
+                        if (ec) {
+                          self->fail(ec);
+                          return;
+                        }
+                        self->read();
+                      });
+  }
+
+  void read() {
+    res_ = {};
+    http::async_read(stream_, buffer_, res_,
+                     [self = shared_from_this()](beast::error_code ec,
+                                                 std::size_t) {
+                       if (ec) {
+                         self->fail(ec);
+                         return;
+                       }
+                       self->done(static_cast<int>(self->res_.result_int()));
+                       if (!self->res_.keep_alive())
+                         self->reset();
+                       ++self->seq_;
+                       self->schedule();
+                     });
+  }
+
+  void done(int status) {
+    const auto now = Clock::now();
+    if (intended_ < measure_from_)
+      return;
+    ++statuses_[status];
+    corrected_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - intended_)
+            .count());
+    service_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent_)
+            .count());
+  }
+
+  // ошибка ввода-вывода или --timeout: запрос считается потерянным,
+  // расписание идёт дальше
+  void fail(const beast::error_code &ec) {
+    if (intended_ >= measure_from_)
+      ++(ec == beast::error::timeout ? timeouts_ : io_errors_);
+    reset();
+    ++seq_;
+    schedule();
+  }
+
+  void reset() {
+    beast::error_code ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+    stream_.close();
+    buffer_.clear();
+    connected_ = false;
+  }
+
+  std::string make_body() {
+    const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+    std::uniform_int_distribution<std::size_t> sensor(0, opt_.sensors - 1);
+    std::uniform_real_distribution<double> temp(15.0, 30.0);
+    std::uniform_real_distribution<double> hum(40.0, 70.0);
+    std::string body;
+    for (std::size_t i = 0; i < opt_.batch; ++i) {
+      char line[192];
+      const int n = std::snprintf(
+          line, sizeof(line),
+          R"({"sensor_id":"lg-%zu","ts":%lld,"metrics":{"temperature":%.2f,"humidity":%.2f}})",
+          sensor(rng_), static_cast<long long>(ts), temp(rng_), hum(rng_));
+      body.append(line, static_cast<std::size_t>(n));
+      if (opt_.batch > 1)
+        body.push_back('\n');
+    }
+    return body;
+  }
+
+  void finish() {
+    reset();
+    std::lock_guard<std::mutex> lk(stats_.m);
+    stats_.corrected.insert(stats_.corrected.end(), corrected_.begin(),
+                            corrected_.end());
+    stats_.service.insert(stats_.service.end(), service_.begin(),
+                          service_.end());
+    for (const auto &[code, n] : statuses_)
+      stats_.statuses[code] += n;
+    stats_.io_errors += io_errors_;
+    stats_.timeouts += timeouts_;
+    stats_.late += late_;
+  }
+
+  const Options &opt_;
+  const std::size_t index_;
+  const Clock::time_point start_;
+  const Clock::time_point measure_from_;
+  const Clock::time_point end_;
+  const std::chrono::duration<double> period_;
+
+  beast::tcp_stream stream_;
+  net::steady_timer timer_;
+  tcp::resolver::results_type endpoints_;
+  beast::flat_buffer buffer_;
+  http::request<http::string_body> req_;
+  http::response<http::string_body> res_;
+  bool connected_{false};
+
+  std::uint64_t seq_{0};
+  Clock::time_point intended_;
+  Clock::time_point sent_;
+  std::mt19937_64 rng_;
+
+  // только своё соединение, сливаются в Stats в finish()
+  std::vector<std::int64_t> corrected_;
+  std::vector<std::int64_t> service_;
+  std::map<int, std::uint64_t> statuses_;
+  std::uint64_t io_errors_{0};
+  std::uint64_t timeouts_{0};
+  std::uint64_t late_{0};
+  Stats &stats_;
+};
+
+void print_percentiles(const char *name, std::vector<std::int64_t> &v) {
+  if (v.empty()) {
+    std::printf("%-10s no samples\n", name);
+    return;
+  }
+  std::sort(v.begin(), v.end());
+  auto at = [&](double q) {
+    const auto idx = static_cast<std::size_t>(q * static_cast<double>(v.size() - 1));
+    return static_cast<double>(v[idx]) / 1e6;
+  };
+  std::printf("%-10s p50 %8.3f  p90 %8.3f  p99 %8.3f  p99.9 %8.3f  "
+              "p99.99 %8.3f  max %8.3f ms\n",
+              name, at(0.5), at(0.9), at(0.99), at(0.999), at(0.9999),
+              static_cast<double>(v.back()) / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parse_args(argc, argv, opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  net::io_context ioc;
+  tcp::resolver resolver(ioc);
+  beast::error_code ec;
+  const auto endpoints =
+      resolver.resolve(opt.host, std::to_string(opt.port), ec);
+  if (ec) {
+    std::fprintf(stderr, "resolve %s: %s\n", opt.host.c_str(),
+                 ec.message().c_str());
+    return 1;
+  }
+
+  Stats stats;
+  // небольшой запас на установку соединений до первого слота
+  const auto start = Clock::now() + std::chrono::milliseconds(200);
+  for (std::size_t i = 0; i < opt.connections; ++i)
+    std::make_shared<Connection>(ioc, opt, i, start, stats)->run(endpoints);
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < opt.threads; ++i)
+    threads.emplace_back([&] { ioc.run(); });
+  for (auto &t : threads)
+    t.join();
+
+  const double expected = opt.rate * opt.duration_s;
+  const auto completed = stats.corrected.size();
+  std::uint64_t ok = 0;
+  for (const auto &[code, n] : stats.statuses)
+    if (code >= 200 && code < 300)
+      ok += n;
+
+  std::printf("target %.0f req/s x %.1f s over %zu connections (batch %zu)\n",
+              opt.rate, opt.duration_s, opt.connections, opt.batch);
+  std::printf("completed %zu of %.0f scheduled, %.0f req/s, %.0f readings/s\n",
+              completed, expected,
+              static_cast<double>(completed) / opt.duration_s,
+              static_cast<double>(ok * opt.batch) / opt.duration_s);
+  std::printf("io errors %llu, timeouts (>%d ms) %llu, "
+              "sent late (>1ms behind schedule) %llu\n",
+              static_cast<unsigned long long>(stats.io_errors), opt.timeout_ms,
+              static_cast<unsigned long long>(stats.timeouts),
+              static_cast<unsigned long long>(stats.late));
+  std::printf("status:");
+  for (const auto &[code, n] : stats.statuses)
+    std::printf(" %d=%llu", code, static_cast<unsigned long long>(n));
+  std::printf("\n");
+  print_percentiles("latency", stats.corrected);
+  print_percentiles("service", stats.service);
+  return 0;
+}
@@ -0,0 +1,178 @@
+// Обучение словаря zstd для сжатых тел ingest (ingest_zstd_dictionary).
+//
+// Образцы — показания в том виде, в каком их шлют клиенты: по строке
+// NDJSON на образец из файлов или синтетика в форме тела sensors_loadgen.
+// Словарь раздаётся клиентам и серверу заранее; кадр, сжатый с ним,
+// несёт id словаря, и сервер без него такой кадр не распакует.
+//
+// Запуск:
+//   zstd_dict_train --out sensors.dict [--size 8192] [--level 3]
+//                   [--synthetic 20000] [--sensors 1000] [samples.ndjson...]
+// В конце печатается средний размер образца без словаря и со словарём.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <zdict.h>
+#include <zstd.h>
+
+namespace {
+
+struct Options {
+  std::string out;
+  std::size_t size = 8192; // размер словаря
+  int level = 3;
+  std::size_t synthetic = 0; // синтетических образцов
+  std::size_t sensors = 1000;
+  std::vector<std::string> inputs;
+};
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "Usage: %s --out <dict> [--size BYTES] [--level N]\n"
+               "          [--synthetic N] [--sensors N] [samples.ndjson...]\n",
+               argv0);
+}
+
+bool parse_args(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string key = argv[i];
+    if (key.rfind("--", 0) != 0) {
+      o.inputs.push_back(key);
+      continue;
+    }
+    if (i + 1 >= argc)
+      return false;
+    const char *v = argv[++i];
+    if (key == "--out")
+      o.out = v;
+    else if (key == "--size")
+      o.size = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--level")
+      o.level = std::atoi(v);
+    else if (key == "--synthetic")
+      o.synthetic = static_cast<std::size_t>(std::atoll(v));
+    else if (key == "--sensors")
+      o.sensors = static_cast<std::size_t>(std::atoll(v));
+    else
+      return false;
+  }
+  return !o.out.empty() && o.size > 0 && o.sensors > 0 &&
+         (o.synthetic > 0 || !o.inputs.empty());
+}
+
+// образцы подряд в одном буфере + размеры, как ждёт ZDICT
+struct Samples {
+  std::string data;
+  std::vector<std::size_t> sizes;
+
+  void add(const char *p, std::size_t n) {
+    data.append(p, n);
+    sizes.push_back(n);
+  }
+};
+
+bool read_ndjson(const std::string &path, Samples &s) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty())
+      s.add(line.data(), line.size());
+  }
+  return true;
+}
+
+// то же тело, что у sensors_loadgen: датчик, ts в мс, две метрики
+void synthesize(const Options &o, Samples &s) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> sensor(0, o.sensors - 1);
+  std::uniform_real_distribution<double> temp(15.0, 30.0);
+  std::uniform_real_distribution<double> hum(40.0, 70.0);
+  long long ts = 1700000000000LL;
+  for (std::size_t i = 0; i < o.synthetic; ++i) {
+    char line[192];
+    const int n = std::snprintf(
+        line, sizeof(line),
+        R"({"sensor_id":"lg-%zu","ts":%lld,"metrics":{"temperature":%.2f,"humidity":%.2f}})",
+        sensor(rng), ts += 7, temp(rng), hum(rng));
+    s.add(line, static_cast<std::size_t>(n));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parse_args(argc, argv, opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Samples samples;
+  for (const auto &path : opt.inputs) {
+    if (!read_ndjson(path, samples)) {
+      std::fprintf(stderr, "cannot read %s\n", path.c_str());
+      return 1;
+    }
+  }
+  synthesize(opt, samples);
+  std::printf("samples: %zu (%zu bytes)\n", samples.sizes.size(),
+              samples.data.size());
+
+  std::string dict(opt.size, '\0');
+  const std::size_t n = ZDICT_trainFromBuffer(
+      dict.data(), dict.size(), samples.data.data(), samples.sizes.data(),
+      static_cast<unsigned>(samples.sizes.size()));
+  if (ZDICT_isError(n)) {
+    std::fprintf(stderr, "training failed: %s (more samples needed?)\n",
+                 ZDICT_getErrorName(n));
+    return 1;
+  }
+  dict.resize(n);
+  std::ofstream out(opt.out, std::ios::binary);
+  if (!out.write(dict.data(), static_cast<std::streamsize>(dict.size()))) {
+    std::fprintf(stderr, "cannot write %s\n", opt.out.c_str());
+    return 1;
+  }
+  std::printf("dictionary %u: %zu bytes -> %s\n",
+              ZDICT_getDictID(dict.data(), dict.size()), dict.size(),
+              opt.out.c_str());
+
+  // выигрыш на самих образцах: одиночное показание без словаря и с ним
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  ZSTD_CDict *cdict = ZSTD_createCDict(dict.data(), dict.size(), opt.level);
+  std::string frame(ZSTD_compressBound(64 * 1024), '\0');
+  std::size_t plain = 0, raw = 0, with_dict = 0, counted = 0;
+  std::size_t offset = 0;
+  for (const std::size_t size : samples.sizes) {
+    const char *p = samples.data.data() + offset;
+    offset += size;
+    if (size > 64 * 1024)
+      continue;
+    const std::size_t a = ZSTD_compressCCtx(cctx, frame.data(), frame.size(),
+                                            p, size, opt.level);
+    const std::size_t b = ZSTD_compress_usingCDict(
+        cctx, frame.data(), frame.size(), p, size, cdict);
+    if (ZSTD_isError(a) || ZSTD_isError(b))
+      continue;
+    plain += size;
+    raw += a;
+    with_dict += b;
+    ++counted;
+  }
+  ZSTD_freeCDict(cdict);
+  ZSTD_freeCCtx(cctx);
+  if (counted)
+    std::printf("avg sample: %.1f bytes, zstd %.1f, zstd+dict %.1f\n",
+                static_cast<double>(plain) / static_cast<double>(counted),
+                static_cast<double>(raw) / static_cast<double>(counted),
+                static_cast<double>(with_dict) / static_cast<double>(counted));
+  return 0;
+}